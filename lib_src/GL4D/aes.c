@@ -859,35 +859,6 @@ void aes_cbc_decrypt( aes_context *ctx,
     }
 }
 
-extern void vaetvient(unsigned char * data, int len, int vaouvient) {
-	int i;
-    static aes_context ctx;
-	static int ft = 1;
-	static unsigned char buf[32] = { 0xAA, 0x99, 0x55, 0x51, 0x25, 0x76, 0x58, 0x8C,
-									 0xFA, 0x10, 0x54, 0x11, 0xCA, 0xCD, 0xDD, 0xAD,
-									 0x21, 0x30, 0xAB, 0xB5, 0x5D, 0x2B, 0x3C, 0x7A,
-									 0xDC, 0x24, 0xCD, 0xA1, 0xF3, 0x39, 0x95, 0x00 };
-	if(ft) {
-		aes_set_key( &ctx, buf, 256 );
-		for(i = 0; i < 15; i++)
-			aes_encrypt(&ctx, buf, buf);
-		aes_set_key( &ctx, buf, 256 );
-		ft = 0;
-	}
-	i = 0;
-	if(vaouvient == 0) {
-		while(i < len) {
-			aes_encrypt(&ctx, &data[i], &data[i]);
-			i += 16;
-		}
-	} else {
-		while(i < len) {
-			aes_decrypt(&ctx, &data[i], &data[i]);
-			i += 16;
-		}
-	}
-}
-
 #if !defined(WIN32)
 #  include <unistd.h>
 #endif
@@ -895,8 +866,171 @@ extern void vaetvient(unsigned char * data, int len, int vaouvient) {
 #include <assert.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include "thread_pool.h"
+#include "gl4dCPU.h"
+#if defined(__unix__) || defined(__APPLE__)
+#  define AES_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
 
-extern char * aes_from_tar(const char * file) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define AES_X86
+#  include <emmintrin.h>
+#  include <wmmintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define AES_TARGET(t) __attribute__((target(t)))
+#else
+#  define AES_TARGET(t)
+#endif
+
+/*!\brief taille (en octets, multiple de 16) des morceaux de données
+ * (dé)cryptés par chaque tâche de la réserve de threads. */
+#define AES_CHUNK (64 << 10)
+
+/*!\brief contexte de \ref vaetvient : clé dérivée une seule fois, au
+ * premier appel, puis partagée (en lecture seule) par les threads. */
+static aes_context _vvctx;
+/*!\brief -1 tant que \ref _vvctx n'est pas prêt, puis 1 si les
+ * blocs sont décryptés avec AES-NI, 0 s'ils le sont avec les tables. */
+static int _vvlevel = -1;
+
+#ifdef AES_X86
+/*!\brief clés de tours pour aesdec, dans l'ordre du décryptage. */
+static __m128i _vvdk[15];
+
+/*!\brief construit les clés de tours de aesdec à partir des clés de
+ * cryptage de \a ctx (mots gros-boutistes) : ordre inverse et
+ * InvMixColumns sur les tours intermédiaires. */
+AES_TARGET("aes,sse2") static void aesniKeys(aes_context * ctx) {
+  int r, i;
+  unsigned char k[16];
+  __m128i ek[15];
+  memset(ek, 0, sizeof ek);
+  for(r = 0; r <= ctx->nr; r++) {
+    for(i = 0; i < 16; i++)
+      k[i] = (unsigned char)(ctx->erk[4 * r + (i >> 2)] >> (24 - 8 * (i & 3)));
+    ek[r] = _mm_loadu_si128((const __m128i *)k);
+  }
+  _vvdk[0] = ek[ctx->nr];
+  for(r = 1; r < ctx->nr; r++)
+    _vvdk[r] = _mm_aesimc_si128(ek[ctx->nr - r]);
+  _vvdk[ctx->nr] = ek[0];
+}
+
+/*!\brief décrypte \a n blocs de \a in vers \a out (éventuellement
+ * confondus) avec AES-NI, quatre blocs à la fois pour remplir le
+ * pipeline. */
+AES_TARGET("aes,sse2") static void aesniDecrypt(const unsigned char * in, unsigned char * out, size_t n) {
+  const int nr = _vvctx.nr;
+  int r;
+  __m128i a, b, c, d;
+  for(; n >= 4; n -= 4, in += 64, out += 64) {
+    a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in),        _vvdk[0]);
+    b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16)), _vvdk[0]);
+    c = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 32)), _vvdk[0]);
+    d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 48)), _vvdk[0]);
+    for(r = 1; r < nr; r++) {
+      a = _mm_aesdec_si128(a, _vvdk[r]); b = _mm_aesdec_si128(b, _vvdk[r]);
+      c = _mm_aesdec_si128(c, _vvdk[r]); d = _mm_aesdec_si128(d, _vvdk[r]);
+    }
+    _mm_storeu_si128((__m128i *)out,        _mm_aesdeclast_si128(a, _vvdk[nr]));
+    _mm_storeu_si128((__m128i *)(out + 16), _mm_aesdeclast_si128(b, _vvdk[nr]));
+    _mm_storeu_si128((__m128i *)(out + 32), _mm_aesdeclast_si128(c, _vvdk[nr]));
+    _mm_storeu_si128((__m128i *)(out + 48), _mm_aesdeclast_si128(d, _vvdk[nr]));
+  }
+  for(; n; n--, in += 16, out += 16) {
+    a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), _vvdk[0]);
+    for(r = 1; r < nr; r++)
+      a = _mm_aesdec_si128(a, _vvdk[r]);
+    _mm_storeu_si128((__m128i *)out, _mm_aesdeclast_si128(a, _vvdk[nr]));
+  }
+}
+#endif
+
+static void vvInit(void) {
+  int i;
+  static unsigned char buf[32] = { 0xAA, 0x99, 0x55, 0x51, 0x25, 0x76, 0x58, 0x8C,
+                                   0xFA, 0x10, 0x54, 0x11, 0xCA, 0xCD, 0xDD, 0xAD,
+                                   0x21, 0x30, 0xAB, 0xB5, 0x5D, 0x2B, 0x3C, 0x7A,
+                                   0xDC, 0x24, 0xCD, 0xA1, 0xF3, 0x39, 0x95, 0x00 };
+  aes_set_key(&_vvctx, buf, 256);
+  for(i = 0; i < 15; i++)
+    aes_encrypt(&_vvctx, buf, buf);
+  aes_set_key(&_vvctx, buf, 256);
+  _vvlevel = 0;
+#ifdef AES_X86
+  if(cpuHasAESNI()) {
+    aesniKeys(&_vvctx);
+    _vvlevel = 1;
+  }
+#endif
+}
+
+/*!\brief (dé)crypte \a n blocs de \a in vers \a out (éventuellement
+ * confondus). */
+static void vvBlocks(const unsigned char * in, unsigned char * out, size_t n, int vaouvient) {
+  if(vaouvient == 0) {
+    for(; n; n--, in += 16, out += 16)
+      aes_encrypt(&_vvctx, (unsigned char *)in, out);
+    return;
+  }
+#ifdef AES_X86
+  if(_vvlevel == 1) {
+    aesniDecrypt(in, out, n);
+    return;
+  }
+#endif
+  for(; n; n--, in += 16, out += 16)
+    aes_decrypt(&_vvctx, (unsigned char *)in, out);
+}
+
+typedef struct vvjob_t vvjob_t;
+struct vvjob_t {
+  const unsigned char * in;
+  unsigned char * out;
+  size_t n;
+  int vaouvient;
+};
+
+static void vvTask(size_t task, GLuint thread, void * data) {
+  vvjob_t * j = (vvjob_t *)data;
+  size_t first = task * (AES_CHUNK / 16), n = j->n - first;
+  (void)thread;
+  if(n > AES_CHUNK / 16) n = AES_CHUNK / 16;
+  vvBlocks(j->in + 16 * first, j->out + 16 * first, n, j->vaouvient);
+}
+
+/*!\brief (dé)crypte en ECB les \a n blocs de \a in vers \a out : les
+ * blocs étant indépendants, ils sont répartis par morceaux de \ref
+ * AES_CHUNK octets sur la réserve de threads. */
+static void vvRun(const unsigned char * in, unsigned char * out, size_t n, int vaouvient) {
+  vvjob_t j;
+  if(_vvlevel < 0)
+    vvInit();
+  j.in = in; j.out = out; j.n = n; j.vaouvient = vaouvient;
+  tpoolFor((n + AES_CHUNK / 16 - 1) / (AES_CHUNK / 16), vvTask, &j);
+}
+
+/*!\brief crypte (\a vaouvient = 0) ou décrypte (sinon) sur place les
+ * \a len octets de \a data. Un dernier bloc incomplet est traité en
+ * entier : \a data doit donc pouvoir contenir \a len arrondi au
+ * multiple de 16 supérieur. */
+extern void vaetvient(unsigned char * data, int len, int vaouvient) {
+  if(len <= 0) return;
+  vvRun(data, data, ((size_t)len + 15) >> 4, vaouvient);
+}
+
+/*!\brief lit et décrypte l'archive \a file ; le résultat (alloué,
+ * à libérer avec free) est terminé par un '\\0' et sa taille est
+ * renvoyée dans \a len si ce dernier n'est pas NULL.
+ *
+ * Quand c'est possible, le fichier est projeté en mémoire (mmap) et
+ * décrypté directement de la projection vers le résultat, sans copie
+ * intermédiaire. */
+extern char * aes_from_tar_n(const char * file, size_t * len) {
   size_t l = 0;
   char * data = NULL;
   FILE * f;
@@ -905,8 +1039,36 @@ extern char * aes_from_tar(const char * file) {
     fprintf(stderr, "%s:%d: erreur %d: %s\n", __FILE__, __LINE__, errno, strerror(errno));
     return NULL;
   }
-  data = malloc( (buf.st_size + 1) * sizeof * data );
+  /* arrondi au bloc AES suivant : le décryptage va jusqu'au bout du
+   * dernier bloc entamé */
+  data = calloc((buf.st_size + 16) & ~(size_t)15, sizeof * data);
   assert(data);
+#ifdef AES_MMAP
+  if(buf.st_size > 0) {
+    int fd;
+    void * m = MAP_FAILED;
+    if((fd = open(file, O_RDONLY)) >= 0) {
+      m = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+    }
+    if(m != MAP_FAILED) {
+      size_t full = (size_t)buf.st_size & ~(size_t)15;
+      l = (size_t)buf.st_size;
+      vvRun((const unsigned char *)m, (unsigned char *)data, full >> 4, 1);
+      if(full < l) {
+        /* dernier bloc incomplet : complété par des zéros, comme
+         * l'aurait été le tampon de lecture */
+        unsigned char last[16] = { 0 };
+        memcpy(last, (const char *)m + full, l - full);
+        vvRun(last, (unsigned char *)data + full, 1, 1);
+      }
+      munmap(m, buf.st_size);
+      data[l] = '\0';
+      if(len) *len = l;
+      return data;
+    }
+  }
+#endif
   if( (f = fopen(file, "rb")) == NULL ) {
     fprintf(stderr, "%s:%d: erreur %d: %s\n", __FILE__, __LINE__, errno, strerror(errno));
     free(data);
@@ -921,9 +1083,15 @@ extern char * aes_from_tar(const char * file) {
   }
   fclose(f);
   vaetvient((unsigned char *)data, (int)l, 1);
+  data[l] = '\0';
+  if(len) *len = l;
   return data;
 }
 
+extern char * aes_from_tar(const char * file) {
+  return aes_from_tar_n(file, NULL);
+}
+
 
 
 
@@ -31,6 +31,8 @@
 #ifndef _AES_H
 #define _AES_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -109,6 +111,7 @@ void aes_cbc_decrypt( aes_context *ctx,
 
 extern void vaetvient(unsigned char * data, int len, int vaouvient);
 extern char * aes_from_tar(const char * file);
+extern char * aes_from_tar_n(const char * file, size_t * len);
 
 /**
  * \brief          Checkup routine
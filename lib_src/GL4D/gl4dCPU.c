@@ -0,0 +1,87 @@
+/*!\file gl4dCPU.c
+ *
+ * \brief détection des capacités SIMD du processeur, partagée par les
+ * noyaux de gl4dp (gl4dpSpan.c), de gl4dm et le décryptage AES (aes.c).
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4dCPU.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define CPU_X86
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    include <immintrin.h>
+#  endif
+#endif
+
+#ifdef CPU_X86
+static int x86Level(void) {
+#if defined(_MSC_VER)
+  int r[4], sse2, avx2 = 0;
+  __cpuid(r, 0);
+  if(r[0] >= 7) {
+    int osxsave, avx;
+    __cpuid(r, 1);
+    osxsave = (r[2] >> 27) & 1;
+    avx     = (r[2] >> 28) & 1;
+    __cpuidex(r, 7, 0);
+    avx2 = osxsave && avx && ((r[1] >> 5) & 1) && (_xgetbv(0) & 6) == 6;
+  }
+  __cpuid(r, 1);
+  sse2 = (r[3] >> 26) & 1;
+  return avx2 ? 1 : (sse2 ? 2 : 0);
+#elif defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) return 1;
+  if(__builtin_cpu_supports("sse2")) return 2;
+  return 0;
+#else
+  return 0;
+#endif
+}
+
+static int x86AESNI(void) {
+#if defined(_MSC_VER)
+  int r[4];
+  __cpuid(r, 1);
+  return ((r[2] >> 25) & 1) && ((r[3] >> 26) & 1);
+#elif defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+#else
+  return 0;
+#endif
+}
+#endif
+
+/*!\brief renvoie 1 si le processeur (et le système, pour la sauvegarde
+ * des registres YMM) supporte AVX2, 2 s'il ne supporte que SSE2, 0
+ * sinon ou hors x86. La détection n'est faite qu'une fois. */
+int cpuX86Level(void) {
+#if defined(CPU_X86)
+  static int level = -1;
+  if(level < 0)
+    level = x86Level();
+  return level;
+#else
+  return 0;
+#endif
+}
+
+/*!\brief renvoie 1 si le processeur supporte les instructions AES-NI
+ * (et SSE2), 0 sinon ou hors x86. La détection n'est faite qu'une
+ * fois. */
+int cpuHasAESNI(void) {
+#if defined(CPU_X86)
+  static int aesni = -1;
+  if(aesni < 0)
+    aesni = x86AESNI();
+  return aesni;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,32 @@
+/*!\file gl4dCPU.h
+ *
+ * \brief détection des capacités SIMD du processeur, partagée par les
+ * noyaux de gl4dp (gl4dpSpan.c), de gl4dm et le décryptage AES (aes.c).
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DCPU_H
+#define _GL4DCPU_H
+
+#include "gl4dummies.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief niveau SIMD du processeur x86 : 1 pour AVX2, 2 pour SSE2
+   * seul, 0 sinon (ou hors x86).
+   */
+  extern GL4DHIDDEN int cpuX86Level(void);
+  /*!\brief 1 si le processeur x86 supporte AES-NI (et SSE2), 0 sinon.
+   */
+  extern GL4DHIDDEN int cpuHasAESNI(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,7 +9,7 @@
  * \todo écrire le code pour : GL4D/gl4dfMedian.c
  * GL4D/gl4dfScattering.c GL4D/gl4dfFocus.c GL4D/gl4dfConversion.c
  * GL4D/gl4dfMedia.c GL4D/gl4dfFractalPainting.c GL4D/gl4dfHatching.c
- * GL4D/gl4dfSegmentation.c GL4D/gl4dfOpticalFlow.c
+ * GL4D/gl4dfOpticalFlow.c
  *
  * \todo en l'état, ses fonctionnalités ne sont pas designées pour
  * être ni thread-safe ni fonctionnant avec plusieurs contextes
@@ -44,8 +44,44 @@ extern "C" {
     GL4DF_CANNY_MIX_NONE,
     GL4DF_CANNY_MIX_ADD,
     GL4DF_CANNY_MIX_MULT,
+    GL4DF_CANNY_HYSTERESIS_CPU,
+    GL4DF_CANNY_HYSTERESIS_GPU, /* par défault */
+    GL4DF_SEGMENTATION_RESULT_LABELS, /* par défault */
+    GL4DF_SEGMENTATION_RESULT_MEAN,
+    GL4DF_BLUR_AUTO, /* par défault */
+    GL4DF_BLUR_DIRECT,
+    GL4DF_BLUR_LINEAR,
+    GL4DF_BLUR_PYRAMID,
   };
   typedef enum GL4DFenum GL4DFenum;
+
+  /*!\brief statistiques d'une composante connexe, voir \ref
+   * gl4dfSegmentationGetComponents. Les coordonnées sont celles des
+   * pixels de la texture (ligne 0 en bas). */
+  typedef struct GL4DFcomponent GL4DFcomponent;
+  struct GL4DFcomponent {
+    GLuint area;                  /* nombre de pixels */
+    GLint xmin, ymin, xmax, ymax; /* boîte englobante (bornes incluses) */
+    GLfloat cx, cy;               /* centroïde */
+    GLfloat mean, max;            /* valeurs moyenne et maximale, entre 0 et 1 */
+  };
+  /* Dans gl4dfCommon.c */
+  /*!\brief Débute une chaîne de filtres. L'état GL (viewport,
+   * framebuffer, program, texture liée, modes de rendu) est relevé une
+   * seule fois ici et rétabli par \ref gl4dfChainEnd, au lieu de
+   * l'être par chaque filtre (requêtes synchrones sur nombre de
+   * pilotes).
+   *
+   * Entre les deux appels, seuls des filtres gl4df doivent être
+   * appelés : les modifications de l'état GL faites entre-temps par
+   * l'appelant ne seraient pas vues (un filtre sans entrée ou sans
+   * sortie utilise le viewport et le framebuffer relevés ici).
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfChainBegin(void);
+  /*!\brief Termine une chaîne de filtres et rétablit l'état relevé
+   * par \ref gl4dfChainBegin.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfChainEnd(void);
   /* Dans gl4dConversion.c */
   /*!\brief Envoie le framebuffer actif (ou l'écran) vers une texture.
    *
@@ -98,6 +134,25 @@ extern "C" {
    *\param weightMapScale le scale à appliquer.
    */
   GL4DAPI void GL4DAPIENTRY gl4dfBlurSetWeightMapScale(GLfloat weightMapScale);
+  /*!\brief Choisit le moteur de \ref gl4dfBlur.
+   *
+   * - GL4DF_BLUR_DIRECT : une lecture de texture par poids du masque
+   *   (le comportement historique) ;
+   * - GL4DF_BLUR_LINEAR : deux poids voisins par lecture bilinéaire,
+   *   soit deux fois moins de lectures pour le même flou ;
+   * - GL4DF_BLUR_PYRAMID : réduction par moitiés successives, flou au
+   *   niveau le plus bas puis remontée bilinéaire ; coût quasi
+   *   indépendant du rayon et du nombre d'itérations, résultat
+   *   approché (voir \ref gl4dfBlur). Retombe sur GL4DF_BLUR_LINEAR
+   *   si le flou demandé est trop petit pour la pyramide ;
+   * - GL4DF_BLUR_AUTO (par défaut) : la pyramide pour les grands flous
+   *   (écart type cumulé d'au moins 12 pixels), le bilinéaire sinon.
+   *
+   * Une weight map impose toujours le moteur direct.
+   *
+   *\param mode le moteur à utiliser.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfBlurSetMode(GL4DFenum mode);
   /*!\brief Filtre 2D de flou Gaussien 
    *
    *\param in identifiant de texture source. Si 0, le framebuffer écran est pris à la place.
@@ -106,6 +161,15 @@ extern "C" {
    *\param nb_iterations le nombre d'itérations de flou.
    *\param weight identifiant de texture (niveaux de gris) à utiliser pour pondérer le rayon de flou. Si 0, aucune pondération n'est appliquée.
    *\param flipV indique s'il est nécessaire d'effectuer un mirroir vertical du résultat.
+   *
+   * Le moteur pyramide (voir \ref gl4dfBlurSetMode) reproduit la
+   * variance du flou demandé, itérations comprises, mais pas la forme
+   * exacte du masque tronqué. À plus d'un rayon des bords, l'écart
+   * avec le moteur direct est en moyenne de 1 à 3 niveaux sur 255 et
+   * au plus d'une dizaine (contours francs, une seule itération) ;
+   * près des bords, où les deux moteurs ne répètent pas le bord de la
+   * même façon, il peut atteindre une trentaine de niveaux sur une
+   * image très bruitée.
    */
   GL4DAPI void GL4DAPIENTRY gl4dfBlur(GLuint in, GLuint out, GLuint radius, GLuint nb_iterations, GLuint weight, GLboolean flipV);
   /* Dans gl4dfMedian.c */
@@ -348,6 +412,161 @@ extern "C" {
    *\param highTh seuil haut du filtre Canny
    */
   GL4DAPI void GL4DAPIENTRY gl4dfCannySetThresholds(GLfloat lowTh, GLfloat highTh);
+  /*!\brief Fonction liée au filtre Canny. Méthode de suivi des
+   * contours par hystérésis (connexité 4 des pixels au-dessus du seuil
+   * bas avec un pixel au-dessus du seuil haut)
+   *
+   *\param mode indique les différents modes possibles. Plusieurs
+   * choix sont disponibles:\n
+   * - GL4DF_CANNY_HYSTERESIS_CPU : l'image est rapatriée et les contours suivis en CPU (implémentation de référence) ;\n
+   * - GL4DF_CANNY_HYSTERESIS_GPU : mode par défault, les contours sont propagés sur le GPU par passes successives (voir \ref gl4dfCannySetHysteresisPasses), la texture ne quitte pas le GPU.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfCannySetHysteresisMode(GL4DFenum mode);
+  /*!\brief Fonction liée au filtre Canny. Nombre de passes de
+   * l'hystérésis GPU.
+   *
+   * Chaque passe prolonge les contours d'au plus 8 pixels dans chaque
+   * direction horizontale ou verticale.
+   *
+   *\param passes nombre fixe de passes (résultat approché si les
+   * contours sont plus longs), ou 0 (par défaut) pour itérer jusqu'à
+   * convergence, testée toutes les 8 passes par une requête
+   * d'occlusion (le résultat est alors celui du mode CPU).
+   *\see gl4dfCannySetHysteresisMode
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfCannySetHysteresisPasses(GLuint passes);
+  /* Dans gl4dfSegmentation.c */
+  /*!\brief Filtre 2D de segmentation en composantes connexes (en CPU)
+   * : deux pixels voisins sont dans la même région si leurs luminances
+   * sont au-dessus du seuil (voir \ref gl4dfSegmentationSetThreshold)
+   * et diffèrent d'au plus la tolérance (voir \ref
+   * gl4dfSegmentationSetTolerance).
+   *
+   *\param in identifiant de texture source. Si 0, le framebuffer écran est pris à la place.
+   *\param out identifiant de texture destination. Si 0, la sortie s'effectuera à l'écran.
+   *\param flipV indique s'il est nécessaire d'effectuer un mirroir vertical du résultat.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfSegmentation(GLuint in, GLuint out, GLboolean flipV);
+  /*!\brief Fonction liée au filtre Segmentation. Méthode de rendu des
+   * régions (les pixels sous le seuil sont noirs).
+   *
+   *\param mode indique les différents modes possibles. Plusieurs
+   * choix sont disponibles:\n
+   * - GL4DF_SEGMENTATION_RESULT_LABELS : mode par défault, une couleur arbitraire par région ;\n
+   * - GL4DF_SEGMENTATION_RESULT_MEAN : chaque région prend sa luminance moyenne.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfSegmentationSetResultMode(GL4DFenum mode);
+  /*!\brief Fonction liée au filtre Segmentation. Seuil de luminance
+   * sous lequel les pixels forment le fond (0 par défaut, aucun fond).
+   *
+   *\param th seuil compris entre 0 et 1.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfSegmentationSetThreshold(GLfloat th);
+  /*!\brief Fonction liée au filtre Segmentation. Ecart maximal de
+   * luminance entre deux pixels voisins d'une même région (0.04 par
+   * défaut ; 1 pour ne séparer que le fond du reste).
+   *
+   *\param tolerance écart compris entre 0 et 1.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfSegmentationSetTolerance(GLfloat tolerance);
+  /*!\brief Fonction liée au filtre Segmentation. Connexité des pixels.
+   *
+   *\param connectivity 4 (par défaut) ou 8.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfSegmentationSetConnectivity(GLuint connectivity);
+  /*!\brief Fonction liée au filtre Segmentation. Régions trouvées par
+   * le dernier appel à \ref gl4dfSegmentation.
+   *
+   *\param components si non NULL, reçoit le tableau (interne à la lib,
+   * valable jusqu'au prochain appel) des statistiques des régions ; les
+   * coordonnées sont celles de la texture en entrée.
+   *\return le nombre de régions.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfSegmentationGetComponents(const GL4DFcomponent ** components);
+  /* Dans gl4dfGraph.c */
+  /*!\brief Crée un graphe de filtres. Un graphe décrit une chaîne (ou
+   * un DAG) de filtres, compilée au premier \ref gl4dfGraphRun en un
+   * minimum de passes : les étapes ponctuelles (Op) et les voisinages
+   * utilisés une seule fois sont fusionnés dans le shader de leur
+   * consommateur, la dernière passe écrit directement dans la sortie
+   * et les textures intermédiaires sont réutilisées dès qu'elles ne
+   * sont plus lues.
+   *
+   * Les nœuds sont créés à partir de nœuds existants, l'identifiant 0
+   * indiquant une erreur. Exemple (Sobel, multiplié par l'image, puis
+   * flouté) :
+   * \code
+   * GLuint g = gl4dfGraphGen(), i = gl4dfGraphInput(g, tex), n;
+   * n = gl4dfGraphSobel(g, i, GL4DF_SOBEL_RESULT_INV_LUMINANCE, GL4DF_SOBEL_MIX_NONE, 0.0f);
+   * n = gl4dfGraphOp(g, n, i, GL4DF_OP_MULT);
+   * n = gl4dfGraphBlur(g, n, 5, 1);
+   * gl4dfGraphOutput(g, n, 0, GL_TRUE);
+   * ...
+   * gl4dfGraphRun(g);
+   * \endcode
+   *
+   *\return l'identifiant du graphe.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphGen(void);
+  /*!\brief Libère le graphe \a graph et ses textures intermédiaires. */
+  GL4DAPI void GL4DAPIENTRY gl4dfGraphDelete(GLuint graph);
+  /*!\brief Ajoute une entrée au graphe.
+   *
+   *\param tex identifiant de texture source. Si 0, le framebuffer
+   * écran est pris à la place (copié une fois par exécution).
+   *\return l'identifiant du nœud.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphInput(GLuint graph, GLuint tex);
+  /*!\brief Change la texture d'une entrée sans reconstruire le graphe
+   * (textures alternées d'une image à l'autre par exemple). */
+  GL4DAPI void GL4DAPIENTRY gl4dfGraphSetInput(GLuint graph, GLuint node, GLuint tex);
+  /*!\brief Ajoute un nœud équivalent à \ref gl4dfOp.
+   *
+   *\param op une valeur parmi GL4DF_OP_ADD, GL4DF_OP_SUB,
+   * GL4DF_OP_MULT, GL4DF_OP_DIV, GL4DF_OP_OVERLAY.
+   *\return l'identifiant du nœud.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphOp(GLuint graph, GLuint node1, GLuint node2, GL4DFenum op);
+  /*!\brief Ajoute un nœud équivalent à \ref gl4dfSobel ; les modes,
+   * donnés ici, sont ceux de \ref gl4dfSobelSetResultMode, \ref
+   * gl4dfSobelSetMixMode et \ref gl4dfSobelSetMixFactor.
+   *
+   *\return l'identifiant du nœud.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphSobel(GLuint graph, GLuint node, GL4DFenum resultMode, GL4DFenum mixMode, GLfloat mixFactor);
+  /*!\brief Ajoute \a nb_iterations nœuds équivalents à \ref gl4dfMedian.
+   *
+   *\return l'identifiant du dernier nœud (\a node si \a nb_iterations est nul).
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphMedian(GLuint graph, GLuint node, GLuint nb_iterations);
+  /*!\brief Ajoute les passes équivalentes à \ref gl4dfBlur sans carte
+   * de poids.
+   *
+   *\return l'identifiant du dernier nœud (\a node si \a nb_iterations est nul).
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphBlur(GLuint graph, GLuint node, GLuint radius, GLuint nb_iterations);
+  /*!\brief Ajoute un nœud appelant un filtre de la forme
+   * filtre(in, out, flipV), par exemple \ref gl4dfCanny ou \ref
+   * gl4dfSegmentation. Ce nœud n'est pas fusionné ; les réglages du
+   * filtre sont ceux en vigueur lors de \ref gl4dfGraphRun.
+   *
+   *\return l'identifiant du nœud.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphFilter(GLuint graph, GLuint node, void (*filter)(GLuint in, GLuint out, GLboolean flipV));
+  /*!\brief Choisit le nœud dont le résultat est la sortie du graphe.
+   *
+   *\param out identifiant de texture destination. Si 0, la sortie
+   * s'effectuera à l'écran (framebuffer et viewport courants).
+   *\param flipV indique s'il est nécessaire d'effectuer un mirroir vertical du résultat.
+   */
+  GL4DAPI void GL4DAPIENTRY gl4dfGraphOutput(GLuint graph, GLuint node, GLuint out, GLboolean flipV);
+  /*!\brief Exécute le graphe (en le compilant s'il a changé). Les
+   * passes sont aux dimensions de la sortie. */
+  GL4DAPI void GL4DAPIENTRY gl4dfGraphRun(GLuint graph);
+  /*!\brief Nombre de passes du graphe compilé (appels de filtres
+   * compris), pour mesurer l'effet des fusions.
+   */
+  GL4DAPI GLuint GL4DAPIENTRY gl4dfGraphGetNbPasses(GLuint graph);
 
 #ifdef __cplusplus
 }
@@ -3,6 +3,17 @@
  * \brief filre réalisant un flou à partir d'une texture ou l'écran
  * vers une texture ou l'écran.
  *
+ * Trois moteurs, choisis par \ref gl4dfBlurSetMode ou automatiquement
+ * : direct (une lecture par poids, seul compatible avec une weight
+ * map), bilinéaire (deux poids voisins fusionnés en une lecture
+ * filtrée, soit deux fois moins de lectures pour le même résultat au
+ * filtrage près) et pyramide (réduction par moitiés successives, flou
+ * au niveau le plus bas, puis remontée bilinéaire ; coût par pixel
+ * quasi constant quel que soit le rayon). La pyramide reproduit la
+ * variance du flou demandé (itérations comprises), pas la troncature
+ * exacte du masque : écart de quelques niveaux sur 255 (voir \ref
+ * gl4dfBlur).
+ *
  * \author Farès BELHADJ amsi@ai.univ-paris8.fr
  * \date April 14, 2016
  *
@@ -10,17 +21,43 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "gl4du.h"
 #include "gl4df.h"
 #include "gl4dfCommon.h"
+#include "gl4duProfile.h"
 #include "gl4dfBlurWeights.h"
 
-static GLuint _blurPId = 0, _width = 1, _height = 1, _weightMapComponent = 0, _tempTexId[3] = {0};
-static GLfloat _offsetV[BLUR_MAX_RADIUS << 1], _offsetH[BLUR_MAX_RADIUS << 1], _weightMapTranslate = 0, _weightMapScale = 1;
+/*!\brief nombre maximal de lectures par côté du moteur bilinéaire. */
+#define BLUR_LINEAR_TAPS ((BLUR_MAX_RADIUS >> 1) + 1)
+/*!\brief nombre maximal de niveaux de la pyramide. */
+#define BLUR_PYRAMID_LEVELS 6
+/*!\brief écart type (en pixels) à partir duquel le mode automatique
+ * passe à la pyramide. */
+#define BLUR_PYRAMID_SIGMA 12.0f
+/*!\brief écart type minimal du flou au niveau le plus bas de la
+ * pyramide (en deçà, la remontée bilinéaire se verrait). */
+#define BLUR_PYRAMID_MIN_SIGMA 2.0f
+/*!\brief taille minimale du niveau le plus bas de la pyramide. */
+#define BLUR_PYRAMID_MIN_SIZE 8
+
+static GLuint _blurPId = 0, _linearPId = 0, _copyPId = 0, _sampler = 0;
+static GLuint _width = 1, _height = 1, _weightMapComponent = 0, _tempTexId[3] = {0};
+static GLuint _pyrTexId[BLUR_PYRAMID_LEVELS + 1] = {0};
+static GLint _pyrW[BLUR_PYRAMID_LEVELS + 1], _pyrH[BLUR_PYRAMID_LEVELS + 1];
+static GLfloat _weightMapTranslate = 0, _weightMapScale = 1;
+static GL4DFenum _mode = GL4DF_BLUR_AUTO;
+/* poids actuellement dans les programs, pour ne les renvoyer que s'ils changent */
+static GLint _directRadius = -1, _linearTaps = -1;
+static GLfloat _linearWeight[BLUR_LINEAR_TAPS], _linearOffset[BLUR_LINEAR_TAPS];
+/* uniform locations, relevées une fois (shaders en mémoire, jamais
+ * reliés après leur création) */
+static GLint _ulWeight, _ulNWeights, _ulDir, _ulInv, _ulUseWeightMap,
+  _ulWeightMapComponent, _ulWeightMapTranslate, _ulWeightMapScale;
+static GLint _ullWeight, _ullOffset, _ullTaps, _ullDir, _ullInv, _ulcInv;
 
 static void init(void);
-static void setDimensions(GLuint w, GLuint h);
 static void quit(void);
 
 MKFWINIT6(blur, void, GLuint, GLuint, GLuint, GLuint, GLuint, GLboolean);
@@ -37,8 +74,24 @@ void gl4dfBlurSetWeightMapScale(GLfloat weightMapScale) {
   _weightMapScale = weightMapScale;
 }
 
+void gl4dfBlurSetMode(GL4DFenum mode) {
+  switch(mode) {
+  case GL4DF_BLUR_AUTO:
+  case GL4DF_BLUR_DIRECT:
+  case GL4DF_BLUR_LINEAR:
+  case GL4DF_BLUR_PYRAMID:
+    _mode = mode;
+    break;
+  default:
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, mode);
+    break;
+  }
+}
+
 void gl4dfBlur(GLuint in, GLuint out, GLuint radius, GLuint nb_iterations, GLuint weight, GLboolean flipV) {
+  GL4D_PROF_BEGIN("gl4dfBlur");
   blurfptr(in, out, radius, nb_iterations, weight, flipV);
+  GL4D_PROF_END();
 }
 
 /* appelée la première fois */
@@ -48,19 +101,190 @@ static void blurfinit(GLuint in, GLuint out, GLuint radius, GLuint nb_iterations
   blurfptr(in, out, radius, nb_iterations, weight, flipV);
 }
 
+/*!\brief fusionne les \a n poids \a w (centre puis un côté) deux à
+ * deux : une lecture bilinéaire entre les pixels i et i + 1, placée
+ * au barycentre de leurs poids, vaut la somme des deux lectures.
+ *
+ * \return le nombre de lectures par côté, centre compris.
+ */
+static GLint linearTaps(const GLfloat * w, GLint n, GLfloat * lw, GLfloat * lo) {
+  GLint i, k;
+  lw[0] = w[0];
+  lo[0] = 0.0f;
+  for(i = 1, k = 1; i < n; i += 2, ++k) {
+    GLfloat b = i + 1 < n ? w[i + 1] : 0.0f;
+    lw[k] = w[i] + b;
+    lo[k] = lw[k] > 0.0f ? (i * w[i] + (i + 1) * b) / lw[k] : (GLfloat)i;
+  }
+  return k;
+}
+
+/*!\brief envoie au program bilinéaire (courant) les lectures qui
+ * diffèrent de celles qu'il a déjà. */
+static void sendLinearTaps(GLint n, const GLfloat * lw, const GLfloat * lo) {
+  if(n == _linearTaps && !memcmp(lw, _linearWeight, n * sizeof *lw) && !memcmp(lo, _linearOffset, n * sizeof *lo))
+    return;
+  memcpy(_linearWeight, lw, n * sizeof *lw);
+  memcpy(_linearOffset, lo, n * sizeof *lo);
+  glUniform1fv(_ullWeight, n, lw);
+  glUniform1fv(_ullOffset, n, lo);
+  glUniform1i(_ullTaps, _linearTaps = n);
+}
+
+/*!\brief redimensionne le niveau \a l de la pyramide. */
+static void pyramidSize(GLuint l, GLint w, GLint h) {
+  if(_pyrW[l] == w && _pyrH[l] == h)
+    return;
+  glBindTexture(GL_TEXTURE_2D, _pyrTexId[l]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  _pyrW[l] = w;
+  _pyrH[l] = h;
+}
+
+/*!\brief variance (en pixels²) ajoutée par \a levels descentes par
+ * moitié (moyenne 2x2) et remontées bilinéaires : au niveau l, 4^(l-1)
+ * / 4 pour la descente et 3 x 4^l / 16 pour la remontée, soit au total
+ * (4^levels - 1) / 3. */
+static GLfloat pyramidVariance(GLuint levels) {
+  return ((GLfloat)(1 << (levels << 1)) - 1.0f) / 3.0f;
+}
+
+/*!\brief nombre de niveaux de pyramide pour un flou de variance \a
+ * var sur une image \a w x \a h : le plus grand tel que le flou restant
+ * au niveau le plus bas ne soit pas trop petit et que ce niveau garde
+ * une taille raisonnable ; 0 si aucun. */
+static GLuint pyramidLevels(GLfloat var, GLint w, GLint h) {
+  GLuint l;
+  for(l = BLUR_PYRAMID_LEVELS; l > 0; --l)
+    if((w >> l) >= BLUR_PYRAMID_MIN_SIZE && (h >> l) >= BLUR_PYRAMID_MIN_SIZE &&
+       (var - pyramidVariance(l)) / (GLfloat)(1 << (l << 1)) >= BLUR_PYRAMID_MIN_SIGMA * BLUR_PYRAMID_MIN_SIGMA)
+      break;
+  return l;
+}
+
+/*!\brief moteur direct : le flou d'origine, une lecture par poids. */
+static void directBlur(GLuint in, GLuint rout, GLuint radius, GLuint nb_iterations, GLuint weight, GLboolean flipV) {
+  GLfloat dir[2][2] = { { 0.0f, 1.0f / (GLfloat)_height }, { 1.0f / (GLfloat)_width, 0.0f } };
+  GLuint n, i;
+  fcommViewport(0, 0, _width, _height);
+  fcommUseProgram(_blurPId);
+  glUniform1i(_ulUseWeightMap, weight ? 1 : 0);
+  glUniform1i(_ulWeightMapComponent, _weightMapComponent);
+  glUniform1f(_ulWeightMapTranslate, _weightMapTranslate);
+  glUniform1f(_ulWeightMapScale, _weightMapScale);
+  if((GLint)radius != _directRadius) {
+    glUniform1fv(_ulWeight, radius ? radius : 1, &weights[(radius * (radius - 1)) >> 1]);
+    glUniform1i(_ulNWeights, _directRadius = radius);
+  }
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, weight);
+  glActiveTexture(GL_TEXTURE0);
+  for(n = 0; n < nb_iterations; n++) {
+    for(i = 0; i < 2; i++) {
+      fcommFramebuffer(GL_FRAMEBUFFER, i == 0 ? _tempTexId[2] : rout, 0);
+      glUniform1i(_ulInv, i ? flipV : 0);
+      glUniform2fv(_ulDir, 1, dir[i]);
+      glBindTexture(GL_TEXTURE_2D, i == 0 ? in : _tempTexId[2]);
+      gl4dgDraw(fcommGetPlane());
+    }
+    in = rout;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+/*!\brief moteur bilinéaire : mêmes passes que le direct, deux poids
+ * par lecture filtrée. */
+static void linearBlur(GLuint in, GLuint rout, GLuint radius, GLuint nb_iterations, GLboolean flipV) {
+  GLfloat dir[2][2] = { { 0.0f, 1.0f / (GLfloat)_height }, { 1.0f / (GLfloat)_width, 0.0f } };
+  GLfloat lw[BLUR_LINEAR_TAPS], lo[BLUR_LINEAR_TAPS];
+  GLuint n, i;
+  radius = radius ? radius : 1;
+  fcommViewport(0, 0, _width, _height);
+  fcommUseProgram(_linearPId);
+  sendLinearTaps(linearTaps(&weights[(radius * (radius - 1)) >> 1], radius, lw, lo), lw, lo);
+  glActiveTexture(GL_TEXTURE0);
+  glBindSampler(0, _sampler);
+  for(n = 0; n < nb_iterations; n++) {
+    for(i = 0; i < 2; i++) {
+      fcommFramebuffer(GL_FRAMEBUFFER, i == 0 ? _tempTexId[2] : rout, 0);
+      glUniform1i(_ullInv, i ? flipV : 0);
+      glUniform2fv(_ullDir, 1, dir[i]);
+      glBindTexture(GL_TEXTURE_2D, i == 0 ? in : _tempTexId[2]);
+      gl4dgDraw(fcommGetPlane());
+    }
+    in = rout;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindSampler(0, 0);
+}
+
+/*!\brief moteur pyramide : \a levels réductions par moitié (une
+ * lecture bilinéaire au coin de quatre pixels), flou Gaussien au
+ * niveau le plus bas de variance \a var moins celle apportée par la
+ * pyramide, puis remontées bilinéaires jusqu'à \a rout. */
+static void pyramidBlur(GLuint in, GLuint rout, GLfloat var, GLuint levels, GLboolean flipV) {
+  GLfloat w[BLUR_MAX_RADIUS], lw[BLUR_LINEAR_TAPS], lo[BLUR_LINEAR_TAPS], dir[2][2], sigma, sum;
+  GLuint l, i, bottom = levels - 1, tmp = BLUR_PYRAMID_LEVELS;
+  GLint n;
+  glActiveTexture(GL_TEXTURE0);
+  glBindSampler(0, _sampler);
+  fcommUseProgram(_copyPId);
+  glUniform1i(_ulcInv, 0);
+  for(l = 0; l < levels; ++l) {
+    pyramidSize(l, _width >> (l + 1), _height >> (l + 1));
+    fcommViewport(0, 0, _pyrW[l], _pyrH[l]);
+    fcommFramebuffer(GL_FRAMEBUFFER, _pyrTexId[l], 0);
+    glBindTexture(GL_TEXTURE_2D, l ? _pyrTexId[l - 1] : in);
+    gl4dgDraw(fcommGetPlane());
+  }
+  /* Gaussienne de l'écart type restant, en pixels du niveau le plus
+   * bas, tronquée à 3 écarts types */
+  sigma = sqrtf((var - pyramidVariance(levels)) / (GLfloat)(1 << (levels << 1)));
+  n = (GLint)ceilf(3.0f * sigma) + 1;
+  n = n > BLUR_MAX_RADIUS ? BLUR_MAX_RADIUS : n;
+  for(i = 0, sum = 0.0f; i < (GLuint)n; ++i)
+    sum += (i ? 2.0f : 1.0f) * (w[i] = expf(-0.5f * i * i / (sigma * sigma)));
+  for(i = 0; i < (GLuint)n; ++i)
+    w[i] /= sum;
+  pyramidSize(tmp, _pyrW[bottom], _pyrH[bottom]);
+  dir[0][0] = dir[1][1] = 0.0f;
+  dir[0][1] = 1.0f / (GLfloat)_pyrH[bottom];
+  dir[1][0] = 1.0f / (GLfloat)_pyrW[bottom];
+  fcommUseProgram(_linearPId);
+  sendLinearTaps(linearTaps(w, n, lw, lo), lw, lo);
+  glUniform1i(_ullInv, 0);
+  for(i = 0; i < 2; i++) {
+    fcommFramebuffer(GL_FRAMEBUFFER, i == 0 ? _pyrTexId[tmp] : _pyrTexId[bottom], 0);
+    glUniform2fv(_ullDir, 1, dir[i]);
+    glBindTexture(GL_TEXTURE_2D, i == 0 ? _pyrTexId[bottom] : _pyrTexId[tmp]);
+    gl4dgDraw(fcommGetPlane());
+  }
+  /* remontée, chaque niveau écrasant le précédent devenu inutile */
+  fcommUseProgram(_copyPId);
+  for(l = levels; l-- > 0; ) {
+    if(l) {
+      fcommViewport(0, 0, _pyrW[l - 1], _pyrH[l - 1]);
+      fcommFramebuffer(GL_FRAMEBUFFER, _pyrTexId[l - 1], 0);
+    } else {
+      fcommViewport(0, 0, _width, _height);
+      fcommFramebuffer(GL_FRAMEBUFFER, rout, 0);
+      glUniform1i(_ulcInv, flipV);
+    }
+    glBindTexture(GL_TEXTURE_2D, _pyrTexId[l]);
+    gl4dgDraw(fcommGetPlane());
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindSampler(0, 0);
+}
+
 /* appelée les autres fois (après la première qui lance init) */
 static void blurffunc(GLuint in, GLuint out, GLuint radius, GLuint nb_iterations, GLuint weight, GLboolean flipV) {
-  GLuint rout = out, fbo;
-  GLint i, n, vp[4], w, h, cfbo, ctex, cpId;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out, levels = 0;
+  GLint w, h;
 
   if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
     fcommMatchTex(in = _tempTexId[0], 0);
@@ -68,72 +292,50 @@ static void blurffunc(GLuint in, GLuint out, GLuint radius, GLuint nb_iterations
   }
   if(out == 0) { /* Pas de sortie, donc sortie aux dimensions du viewport */
 
-    w = vp[2];// - vp[0];
-    h = vp[3];// - vp[1];
+    w = st->vp[2];// - vp[0];
+    h = st->vp[3];// - vp[1];
     fcommMatchTex(rout = _tempTexId[1], out);
   } else {
     glBindTexture(GL_TEXTURE_2D, out);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
   }
-  if((GLuint)w != _width || (GLuint)h != _height)
-    setDimensions(w, h);
+  _width = w;
+  _height = h;
   fcommMatchTex(_tempTexId[2], rout);
 
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  if(dt) glDisable(GL_DEPTH_TEST);
-  if(bl) glDisable(GL_BLEND);
-  glViewport(0, 0, _width, _height);
+  fcommDrawState(GL_FALSE);
   radius = radius > BLUR_MAX_RADIUS ? BLUR_MAX_RADIUS : radius;
-  glUseProgram(_blurPId);
-  glUniform1i(glGetUniformLocation(_blurPId,  "myTexture"), 0);
-  glUniform1i(glGetUniformLocation(_blurPId,  "myWeights"), 1);
-  glUniform1i(glGetUniformLocation(_blurPId,  "useWeightMap"), weight ? 1 : 0);
-  glUniform1i(glGetUniformLocation(_blurPId,  "weightMapComponent"), _weightMapComponent);
-  glUniform1f(glGetUniformLocation(_blurPId,  "weightMapTranslate"), _weightMapTranslate);
-  glUniform1f(glGetUniformLocation(_blurPId,  "weightMapScale"), _weightMapScale);
-  glUniform1fv(glGetUniformLocation(_blurPId, "weight"), BLUR_MAX_RADIUS, &weights[(radius * (radius - 1)) >> 1]);
-  glUniform1i(glGetUniformLocation(_blurPId,  "nweights"), radius);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  for(n = 0; n < (int)nb_iterations; n++) {
-    for(i = 0; i < 2; i++) {
-      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, i == 0 ? _tempTexId[2] : rout,  0);
-      glUniform1i(glGetUniformLocation(_blurPId,  "inv"), i ? flipV : 0);
-      glUniform2fv(glGetUniformLocation(_blurPId, "offset"), BLUR_MAX_RADIUS, (i % 2) ? _offsetH : _offsetV);
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, i == 0 ? in : _tempTexId[2]);
-      glActiveTexture(GL_TEXTURE1);
-      glBindTexture(GL_TEXTURE_2D, weight);
-      gl4dgDraw(fcommGetPlane());
-      glActiveTexture(GL_TEXTURE1);
-      glBindTexture(GL_TEXTURE_2D, 0);
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, 0);
-    }
-    in = rout;
+  if(!weight && _mode != GL4DF_BLUR_DIRECT && nb_iterations && _mode != GL4DF_BLUR_LINEAR) {
+    /* les variances des itérations s'ajoutent */
+    const GLfloat * wr = &weights[(radius * (radius - 1)) >> 1];
+    GLfloat var = 0.0f;
+    GLuint i;
+    for(i = 1; i < radius; ++i)
+      var += 2.0f * wr[i] * i * i;
+    var *= nb_iterations;
+    if(_mode == GL4DF_BLUR_PYRAMID || var >= BLUR_PYRAMID_SIGMA * BLUR_PYRAMID_SIGMA)
+      levels = pyramidLevels(var, w, h);
+    if(levels) /* une seule passe pour toutes les itérations : le flip
+		* suit celui, cumulé, des itérations du moteur direct */
+      pyramidBlur(in, rout, var, levels, flipV && (nb_iterations & 1));
+  }
+  if(!levels) {
+    if(weight || _mode == GL4DF_BLUR_DIRECT)
+      directBlur(in, rout, radius, nb_iterations, weight, flipV);
+    else
+      linearBlur(in, rout, radius, nb_iterations, flipV);
   }
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, _width, _height, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, _width, _height, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   }
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glBindFramebuffer(GL_FRAMEBUFFER, cfbo);
-  glBindTexture(GL_TEXTURE_2D, ctex);
-  glUseProgram(cpId);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(bl) glEnable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
-  GLint vp[4], ctex;
+  GLint ctex;
   GLuint i;
   glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
   if(!_tempTexId[0])
@@ -146,8 +348,26 @@ static void init(void) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
   }
+  if(!_pyrTexId[0])
+    glGenTextures((sizeof _pyrTexId / sizeof *_pyrTexId), _pyrTexId);
+  for(i = 0; i < (sizeof _pyrTexId / sizeof *_pyrTexId); ++i) {
+    glBindTexture(GL_TEXTURE_2D, _pyrTexId[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _pyrW[i] = 1, _pyrH[i] = 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  }
   glBindTexture(GL_TEXTURE_2D, ctex);
-  glGetIntegerv(GL_VIEWPORT, vp);
+  if(!_sampler) {
+    /* filtrage bilinéaire imposé aux lectures des moteurs bilinéaire et
+     * pyramide, quels que soient les réglages des textures lues */
+    glGenSamplers(1, &_sampler);
+    glSamplerParameteri(_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(_sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(_sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
   if(!_blurPId) {
     const char * imfs =
       "<imfs>gl4df_blur1D.fs</imfs>\n"
@@ -160,14 +380,14 @@ static void init(void) {
        uniform sampler2D myWeights;\n					\
        uniform int nweights, useWeightMap, weightMapComponent;\n	\
        uniform float weight[128], weightMapTranslate, weightMapScale;\n	\
-       uniform vec2 offset[128];\n					\
+       uniform vec2 dir;\n						\
        in  vec2 vsoTexCoord;\n						\
        out vec4 fragColor;\n						\
        vec4 uniformBlur(void) {\n					\
          vec4 c = texture(myTexture, vsoTexCoord.st) * weight[0];\n	\
          for (int i = 1; i < nweights; i++) {\n				\
-           c += texture(myTexture, vsoTexCoord.st + offset[i]) * weight[i];\n \
-           c += texture(myTexture, vsoTexCoord.st - offset[i]) * weight[i];\n \
+           c += texture(myTexture, vsoTexCoord.st + float(i) * dir) * weight[i];\n \
+           c += texture(myTexture, vsoTexCoord.st - float(i) * dir) * weight[i];\n \
          }\n								\
          return c;\n							\
        }\n								\
@@ -179,30 +399,77 @@ static void init(void) {
            w += 2.0 * weight[i];\n					\
          }\n								\
          for (int i = 1; i < sub_nweights; i++) {\n			\
-           c += texture(myTexture, vsoTexCoord.st + offset[i]) * weight[i];\n \
-           c += texture(myTexture, vsoTexCoord.st - offset[i]) * weight[i];\n \
+           c += texture(myTexture, vsoTexCoord.st + float(i) * dir) * weight[i];\n \
+           c += texture(myTexture, vsoTexCoord.st - float(i) * dir) * weight[i];\n \
          }\n								\
          return c / w;\n						\
        }\n								\
        void main(void) {\n						\
          fragColor = ((useWeightMap != 0) ? weightedBlur() : uniformBlur());\n \
        }";
+    const char * imfsLinear =
+      "<imfs>gl4df_blur1DLinear.fs</imfs>\n"
+#ifdef __GLES4D__
+      "#version 300 es\n"
+#else
+      "#version 330\n"
+#endif
+      "uniform sampler2D myTexture;\n					\
+       uniform int ntaps;\n						\
+       uniform float weight[65], offset[65];\n				\
+       uniform vec2 dir;\n						\
+       in  vec2 vsoTexCoord;\n						\
+       out vec4 fragColor;\n						\
+       void main(void) {\n						\
+         vec4 c = texture(myTexture, vsoTexCoord.st) * weight[0];\n	\
+         for (int i = 1; i < ntaps; i++) {\n				\
+           c += texture(myTexture, vsoTexCoord.st + offset[i] * dir) * weight[i];\n \
+           c += texture(myTexture, vsoTexCoord.st - offset[i] * dir) * weight[i];\n \
+         }\n								\
+         fragColor = c;\n						\
+       }";
+    const char * imfsCopy =
+      "<imfs>gl4df_blurCopy.fs</imfs>\n"
+#ifdef __GLES4D__
+      "#version 300 es\n"
+#else
+      "#version 330\n"
+#endif
+      "uniform sampler2D myTexture;\n					\
+       in  vec2 vsoTexCoord;\n						\
+       out vec4 fragColor;\n						\
+       void main(void) {\n						\
+         fragColor = texture(myTexture, vsoTexCoord.st);\n		\
+       }";
     _blurPId = gl4duCreateProgram(gl4dfBasicVS, imfs, NULL);
+    _linearPId = gl4duCreateProgram(gl4dfBasicVS, imfsLinear, NULL);
+    _copyPId = gl4duCreateProgram(gl4dfBasicVS, imfsCopy, NULL);
+    _ulWeight = glGetUniformLocation(_blurPId, "weight");
+    _ulNWeights = glGetUniformLocation(_blurPId, "nweights");
+    _ulDir = glGetUniformLocation(_blurPId, "dir");
+    _ulInv = glGetUniformLocation(_blurPId, "inv");
+    _ulUseWeightMap = glGetUniformLocation(_blurPId, "useWeightMap");
+    _ulWeightMapComponent = glGetUniformLocation(_blurPId, "weightMapComponent");
+    _ulWeightMapTranslate = glGetUniformLocation(_blurPId, "weightMapTranslate");
+    _ulWeightMapScale = glGetUniformLocation(_blurPId, "weightMapScale");
+    _ullWeight = glGetUniformLocation(_linearPId, "weight");
+    _ullOffset = glGetUniformLocation(_linearPId, "offset");
+    _ullTaps = glGetUniformLocation(_linearPId, "ntaps");
+    _ullDir = glGetUniformLocation(_linearPId, "dir");
+    _ullInv = glGetUniformLocation(_linearPId, "inv");
+    _ulcInv = glGetUniformLocation(_copyPId, "inv");
+    /* unités de textures, fixes */
+    fcommBegin();
+    fcommUseProgram(_blurPId);
+    glUniform1i(glGetUniformLocation(_blurPId,  "myTexture"), 0);
+    glUniform1i(glGetUniformLocation(_blurPId,  "myWeights"), 1);
+    fcommUseProgram(_linearPId);
+    glUniform1i(glGetUniformLocation(_linearPId,  "myTexture"), 0);
+    fcommUseProgram(_copyPId);
+    glUniform1i(glGetUniformLocation(_copyPId,  "myTexture"), 0);
+    fcommEnd();
     gl4duAtExit(quit);
   }
-  if(_tempTexId[0])
-    setDimensions(vp[2]/* - vp[0]*/, vp[3]/* - vp[1]*/);
-}
-
-static void setDimensions(GLuint w, GLuint h) {
-  int i;
-  _width  = w;
-  _height = h;
-  for(i = 0; i < BLUR_MAX_RADIUS; i++) {
-    _offsetH[(i << 1) + 0] = i / (GLfloat)_width;
-    _offsetV[(i << 1) + 1] = i / (GLfloat)_height;
-    _offsetH[(i << 1) + 1] = _offsetV[(i << 1) + 0] = 0.0;
-  }
 }
 
 static void quit(void) {
@@ -210,6 +477,15 @@ static void quit(void) {
     glDeleteTextures((sizeof _tempTexId / sizeof *_tempTexId), _tempTexId);
     _tempTexId[0] = 0;
   }
-  _blurPId = 0;
+  if(_pyrTexId[0]) {
+    glDeleteTextures((sizeof _pyrTexId / sizeof *_pyrTexId), _pyrTexId);
+    _pyrTexId[0] = 0;
+  }
+  if(_sampler) {
+    glDeleteSamplers(1, &_sampler);
+    _sampler = 0;
+  }
+  _blurPId = _linearPId = _copyPId = 0;
+  _directRadius = _linearTaps = -1;
   blurfptr = blurfinit;
 }
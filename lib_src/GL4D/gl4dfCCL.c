@@ -0,0 +1,373 @@
+/*!\file gl4dfCCL.c
+ *
+ * \brief étiquetage en composantes connexes (CCL) en CPU, par
+ * union-find parallèle sur des bandes de lignes.
+ *
+ * L'image est découpée en bandes horizontales traitées par la réserve
+ * de threads (\ref tpoolFor) :
+ * - chaque bande est d'abord étiquetée seule (union-find classique,
+ *   la racine d'une composante est son plus petit indice de pixel) ;
+ * - les coutures entre bandes voisines sont ensuite fusionnées en
+ *   parallèle, sans verrou : une racine n'est rattachée à une autre
+ *   que par un SDL_AtomicCAS qui échoue (et l'on recommence) si elle a
+ *   cessé d'être racine entre-temps ;
+ * - les arbres sont aplatis, les racines numérotées de 1 à n dans
+ *   l'ordre de balayage et les statistiques de chaque composante
+ *   accumulées par la bande qui contient sa racine ; les pixels des
+ *   composantes qui débordent sur les bandes suivantes sont repris
+ *   ensuite, en un seul balayage séquentiel de ces bandes.
+ *
+ * Les tampons de travail appartiennent au contexte (ccl_t) et ne sont
+ * agrandis que si l'image ou le nombre de composantes augmente : pas
+ * d'allocation d'une image à l'autre une fois le régime atteint.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4dfCCL.h"
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+/*!\brief nombre de bandes par thread, pour l'équilibrage. */
+#define CCL_BANDS_PER_THREAD 4
+
+typedef struct cclacc_t cclacc_t;
+
+/*!\brief accumulateur des statistiques d'une composante. */
+struct cclacc_t {
+  GLuint area, max;
+  GLint xmin, ymin, xmax, ymax;
+  GLuint64 sx, sy, sv;
+};
+
+struct ccl_t {
+  SDL_atomic_t * par;    /* parent de chaque pixel, -1 pour le fond */
+  GLuint * labels;       /* étiquette de chaque pixel, 0 pour le fond */
+  GLuint * roots;        /* nombre de racines de chaque bande puis première étiquette - 1 */
+  GLuint * cross;        /* pixels de chaque bande dont la racine est dans une bande précédente */
+  cclacc_t * acc;        /* un accumulateur par composante */
+  GL4DFcomponent * comps;
+  size_t spar, slabels, sbands, scross, sacc, scomps;
+  GLuint n, nthreads, nbands;
+  /* paramètres de l'appel en cours */
+  const GLubyte * data;
+  GLint w, h, step, lowTh, tol, conn, bandRows;
+};
+
+static void * grow(void * p, size_t * size, size_t n, size_t esize) {
+  if(n <= *size)
+    return p;
+  p = realloc(p, n * esize);
+  assert(p);
+  *size = n;
+  return p;
+}
+
+static inline GLint value(const ccl_t * c, GLint i) {
+  return c->data[(size_t)i * c->step];
+}
+
+/*!\brief \a i est au premier plan, \a j lui est connecté s'il l'est
+ * aussi et que leurs valeurs diffèrent d'au plus la tolérance. */
+static inline GLint same(const ccl_t * c, GLint i, GLint j) {
+  GLint a = value(c, i), b = value(c, j);
+  return b >= c->lowTh && abs(a - b) <= c->tol;
+}
+
+static inline GLint findLocal(SDL_atomic_t * par, GLint i) {
+  while(par[i].value != i) {
+    par[i].value = par[par[i].value].value; /* compression par moitié */
+    i = par[i].value;
+  }
+  return i;
+}
+
+static inline void unionLocal(SDL_atomic_t * par, GLint i, GLint j) {
+  i = findLocal(par, i);
+  j = findLocal(par, j);
+  if(i < j)
+    par[j].value = i;
+  else if(j < i)
+    par[i].value = j;
+}
+
+static inline GLint findShared(SDL_atomic_t * par, GLint i) {
+  GLint p;
+  while((p = SDL_AtomicGet(&par[i])) != i)
+    i = p;
+  return i;
+}
+
+static inline void unionShared(SDL_atomic_t * par, GLint i, GLint j) {
+  for(;;) {
+    i = findShared(par, i);
+    j = findShared(par, j);
+    if(i == j)
+      return;
+    if(i < j) {
+      GLint t = i; i = j; j = t;
+    }
+    /* i n'est rattachée à j que si elle est encore racine */
+    if(SDL_AtomicCAS(&par[i], i, j))
+      return;
+  }
+}
+
+static inline void bandRange(const ccl_t * c, size_t band, GLint * y0, GLint * y1) {
+  *y0 = (GLint)band * c->bandRows;
+  *y1 = *y0 + c->bandRows < c->h ? *y0 + c->bandRows : c->h;
+}
+
+static void localPass(size_t band, GLuint thread, void * data) {
+  ccl_t * c = data;
+  SDL_atomic_t * par = c->par;
+  GLint x, y, y0, y1, i, w = c->w;
+  (void)thread;
+  bandRange(c, band, &y0, &y1);
+  for(y = y0; y < y1; ++y)
+    for(x = 0, i = y * w; x < w; ++x, ++i) {
+      if(value(c, i) < c->lowTh) {
+	par[i].value = -1;
+	continue;
+      }
+      par[i].value = i;
+      if(x > 0 && same(c, i, i - 1))
+	unionLocal(par, i, i - 1);
+      if(y == y0)
+	continue;
+      if(same(c, i, i - w))
+	unionLocal(par, i, i - w);
+      if(c->conn == 8) {
+	if(x > 0 && same(c, i, i - w - 1))
+	  unionLocal(par, i, i - w - 1);
+	if(x < w - 1 && same(c, i, i - w + 1))
+	  unionLocal(par, i, i - w + 1);
+      }
+    }
+}
+
+/*!\brief couture entre la première ligne de la bande \a band + 1 et
+ * la dernière de la précédente. */
+static void seamPass(size_t band, GLuint thread, void * data) {
+  ccl_t * c = data;
+  SDL_atomic_t * par = c->par;
+  GLint x, y, y1, i, w = c->w;
+  (void)thread;
+  bandRange(c, band + 1, &y, &y1);
+  for(x = 0, i = y * w; x < w; ++x, ++i) {
+    if(value(c, i) < c->lowTh) /* fond ; par[i] peut changer sous un autre thread */
+      continue;
+    if(same(c, i, i - w))
+      unionShared(par, i, i - w);
+    if(c->conn == 8) {
+      if(x > 0 && same(c, i, i - w - 1))
+	unionShared(par, i, i - w - 1);
+      if(x < w - 1 && same(c, i, i - w + 1))
+	unionShared(par, i, i - w + 1);
+    }
+  }
+}
+
+static void flattenPass(size_t band, GLuint thread, void * data) {
+  ccl_t * c = data;
+  SDL_atomic_t * par = c->par;
+  GLint y0, y1, i, e, r;
+  GLuint n = 0;
+  (void)thread;
+  bandRange(c, band, &y0, &y1);
+  for(i = y0 * c->w, e = y1 * c->w; i < e; ++i) {
+    if(par[i].value < 0)
+      continue;
+    if((r = findShared(par, i)) == i)
+      ++n;
+    else
+      SDL_AtomicSet(&par[i], r);
+  }
+  c->roots[band] = n;
+}
+
+/*!\brief numérote les racines de la bande et remet à zéro leurs
+ * accumulateurs. */
+static void rootPass(size_t band, GLuint thread, void * data) {
+  ccl_t * c = data;
+  GLint y0, y1, i, e;
+  GLuint l = c->roots[band];
+  (void)thread;
+  bandRange(c, band, &y0, &y1);
+  for(i = y0 * c->w, e = y1 * c->w; i < e; ++i)
+    c->labels[i] = c->par[i].value == i ? ++l : 0;
+  memset(&c->acc[c->roots[band]], 0, (l - c->roots[band]) * sizeof *c->acc);
+}
+
+static inline void accumulate(cclacc_t * a, GLint x, GLint y, GLint v) {
+  if(a->area++ == 0) {
+    a->xmin = a->xmax = x;
+    a->ymin = a->ymax = y;
+  } else {
+    if(x < a->xmin) a->xmin = x;
+    if(x > a->xmax) a->xmax = x;
+    if(y < a->ymin) a->ymin = y;
+    if(y > a->ymax) a->ymax = y;
+  }
+  a->sx += x;
+  a->sy += y;
+  a->sv += v;
+  if((GLuint)v > a->max) a->max = v;
+}
+
+/*!\brief étiquette les pixels de la bande et accumule ceux dont la
+ * racine est dans la bande ; les autres sont comptés pour \ref
+ * crossPass. */
+static void statsPass(size_t band, GLuint thread, void * data) {
+  ccl_t * c = data;
+  GLint x, y, y0, y1, i, p, first;
+  GLuint cross = 0;
+  (void)thread;
+  bandRange(c, band, &y0, &y1);
+  first = y0 * c->w;
+  for(y = y0; y < y1; ++y)
+    for(x = 0, i = y * c->w; x < c->w; ++x, ++i) {
+      if((p = c->par[i].value) < 0)
+	continue;
+      /* une racine est déjà étiquetée (rootPass) et d'autres bandes
+       * lisent son étiquette : ne pas la réécrire */
+      if(p != i)
+	c->labels[i] = c->labels[p];
+      if(p < first)
+	++cross;
+      else
+	accumulate(&c->acc[c->labels[i] - 1], x, y, value(c, i));
+    }
+  c->cross[band] = cross;
+}
+
+/*!\brief accumule, séquentiellement, les pixels de la bande \a band
+ * dont la racine est dans une bande précédente. */
+static void crossPass(ccl_t * c, GLuint band) {
+  GLint x, y, y0, y1, i, first;
+  GLuint left = c->cross[band];
+  bandRange(c, band, &y0, &y1);
+  first = y0 * c->w;
+  for(y = y0; y < y1 && left; ++y)
+    for(x = 0, i = y * c->w; x < c->w; ++x, ++i)
+      if(c->par[i].value >= 0 && c->par[i].value < first) {
+	accumulate(&c->acc[c->labels[i] - 1], x, y, value(c, i));
+	--left;
+      }
+}
+
+static void reducePass(size_t chunk, GLuint thread, void * data) {
+  ccl_t * c = data;
+  GLuint k, k0 = (GLuint)(c->n * chunk / c->nbands), k1 = (GLuint)(c->n * (chunk + 1) / c->nbands);
+  (void)thread;
+  for(k = k0; k < k1; ++k) {
+    const cclacc_t * s = &c->acc[k];
+    GL4DFcomponent * o = &c->comps[k];
+    o->area = s->area;
+    o->xmin = s->xmin; o->ymin = s->ymin;
+    o->xmax = s->xmax; o->ymax = s->ymax;
+    o->cx = (GLfloat)((double)s->sx / s->area);
+    o->cy = (GLfloat)((double)s->sy / s->area);
+    o->mean = (GLfloat)((double)s->sv / (255.0 * s->area));
+    o->max = s->max / 255.0f;
+  }
+}
+
+/*!\brief crée un contexte d'étiquetage, à libérer avec \ref
+ * cclDelete. Un contexte ne doit pas être utilisé par deux appels
+ * simultanés (en revanche, plusieurs contextes le peuvent). */
+ccl_t * cclNew(void) {
+  ccl_t * c = calloc(1, sizeof *c);
+  assert(c);
+  return c;
+}
+
+/*!\brief libère le contexte \a ccl et ses tampons. */
+void cclDelete(ccl_t * ccl) {
+  if(!ccl)
+    return;
+  free(ccl->par);
+  free(ccl->labels);
+  free(ccl->roots);
+  free(ccl->cross);
+  free(ccl->acc);
+  free(ccl->comps);
+  free(ccl);
+}
+
+/*!\brief étiquette les composantes connexes de l'image \a data.
+ *
+ * \param ccl le contexte (tampons réutilisés d'un appel à l'autre).
+ * \param data premier octet (canal) du pixel (0, 0) ; les lignes sont
+ * contiguës.
+ * \param w largeur de l'image.
+ * \param h hauteur de l'image.
+ * \param step nombre d'octets entre deux pixels (4 pour un canal d'une
+ * image RGBA).
+ * \param lowTh les pixels de valeur inférieure à \a lowTh forment le
+ * fond (étiquette 0).
+ * \param tolerance deux pixels voisins du premier plan sont connectés
+ * si leurs valeurs diffèrent d'au plus \a tolerance (255 pour une
+ * image binaire).
+ * \param connectivity 4 ou 8.
+ *
+ * \return le nombre n de composantes, étiquetées de 1 à n dans l'ordre
+ * de balayage. Voir \ref cclGetLabels et \ref cclGetComponents.
+ */
+GLuint cclLabel(ccl_t * ccl, const GLubyte * data, GLint w, GLint h, GLint step,
+		GLubyte lowTh, GLubyte tolerance, GLuint connectivity) {
+  ccl_t * c = ccl;
+  size_t wh = (size_t)w * h;
+  GLuint b, t;
+  c->n = 0;
+  if(w <= 0 || h <= 0)
+    return 0;
+  assert(wh <= INT_MAX);
+  c->data = data;
+  c->w = w;
+  c->h = h;
+  c->step = step;
+  c->lowTh = lowTh;
+  c->tol = tolerance;
+  c->conn = connectivity == 8 ? 8 : 4;
+  c->nthreads = tpoolGetNbThreads();
+  c->nbands = c->nthreads * CCL_BANDS_PER_THREAD < (GLuint)h ? c->nthreads * CCL_BANDS_PER_THREAD : (GLuint)h;
+  c->bandRows = (h + c->nbands - 1) / c->nbands;
+  c->nbands = (h + c->bandRows - 1) / c->bandRows;
+  c->par = grow(c->par, &c->spar, wh, sizeof *c->par);
+  c->labels = grow(c->labels, &c->slabels, wh, sizeof *c->labels);
+  c->roots = grow(c->roots, &c->sbands, c->nbands, sizeof *c->roots);
+  c->cross = grow(c->cross, &c->scross, c->nbands, sizeof *c->cross);
+  tpoolFor(c->nbands, localPass, c);
+  tpoolFor(c->nbands - 1, seamPass, c);
+  tpoolFor(c->nbands, flattenPass, c);
+  for(b = 0; b < c->nbands; ++b) {
+    t = c->roots[b];
+    c->roots[b] = c->n;
+    c->n += t;
+  }
+  c->comps = grow(c->comps, &c->scomps, c->n, sizeof *c->comps);
+  c->acc = grow(c->acc, &c->sacc, c->n, sizeof *c->acc);
+  tpoolFor(c->nbands, rootPass, c);
+  tpoolFor(c->nbands, statsPass, c);
+  for(b = 1; b < c->nbands; ++b)
+    if(c->cross[b])
+      crossPass(c, b);
+  tpoolFor(c->n ? c->nbands : 0, reducePass, c);
+  return c->n;
+}
+
+/*!\brief étiquettes (w x h, 0 pour le fond) du dernier \ref
+ * cclLabel. */
+const GLuint * cclGetLabels(const ccl_t * ccl) {
+  return ccl->labels;
+}
+
+/*!\brief statistiques des composantes du dernier \ref cclLabel ;
+ * l'élément i décrit l'étiquette i + 1. */
+const GL4DFcomponent * cclGetComponents(const ccl_t * ccl) {
+  return ccl->comps;
+}
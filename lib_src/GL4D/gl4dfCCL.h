@@ -0,0 +1,33 @@
+/*!\file gl4dfCCL.h
+ *
+ * \brief étiquetage en composantes connexes (CCL) en CPU, par
+ * union-find parallèle sur des bandes de lignes.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DFCCL_H
+#define _GL4DFCCL_H
+
+#include "gl4df.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct ccl_t ccl_t;
+
+  extern ccl_t *  cclNew(void);
+  extern void     cclDelete(ccl_t * ccl);
+  extern GLuint   cclLabel(ccl_t * ccl, const GLubyte * data, GLint w, GLint h, GLint step,
+			   GLubyte lowTh, GLubyte tolerance, GLuint connectivity);
+  extern const GLuint * cclGetLabels(const ccl_t * ccl);
+  extern const GL4DFcomponent * cclGetComponents(const ccl_t * ccl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,15 +14,21 @@
 #include "gl4du.h"
 #include "gl4df.h"
 #include "gl4dfCommon.h"
+#include "gl4dfCCL.h"
+#include "gl4duProfile.h"
 
-static GLfloat _mixFactor = 0.5f, _lowTh = 0.37f, _highTh = 0.75f;
-static GLuint _cannyPId[3] = {0}, _mixMode = 0 /* none */, _tempTexId[5] = {0};
-static GLboolean _isLuminance = GL_FALSE, _isInvert = GL_FALSE;
+/*!\brief nombre de passes de l'hystérésis GPU entre deux tests de
+ * convergence. */
+#define HYST_CHECK 8
 
-static void queueInit(int n);
-static inline void queuePut(int i);
-static inline int queueGet(void);
-static inline int queueEmpty(void);
+static GLfloat _mixFactor = 0.5f, _lowTh = 0.37f, _highTh = 0.75f;
+static GLuint _cannyPId[5] = {0}, _mixMode = 0 /* none */, _tempTexId[7] = {0};
+static GLuint _hystQuery = 0, _hystPasses = 0;
+static GLboolean _isLuminance = GL_FALSE, _isInvert = GL_FALSE, _isHystGPU = GL_TRUE;
+/*!\brief tampons de l'hystérésis CPU, conservés d'un appel à l'autre. */
+static GLubyte * _pixmap = NULL;
+static size_t _pixmapSize = 0;
+static ccl_t * _ccl = NULL;
 
 static void init(void);
 static void quit(void);
@@ -30,7 +36,9 @@ static void quit(void);
 MKFWINIT3(canny, void, GLuint, GLuint, GLboolean);
 
 void gl4dfCanny(GLuint in, GLuint out, GLboolean flipV) {
+  GL4D_PROF_BEGIN("gl4dfCanny");
   cannyfptr(in, out, flipV);
+  GL4D_PROF_END();
 }
 
 void gl4dfCannySetResultMode(GL4DFenum mode) {
@@ -83,6 +91,24 @@ void gl4dfCannySetThresholds(GLfloat lowTh, GLfloat highTh) {
   _highTh = highTh / 4.0f; /* ??? */
 }
 
+void gl4dfCannySetHysteresisMode(GL4DFenum mode) {
+  switch(mode) {
+  case GL4DF_CANNY_HYSTERESIS_CPU:
+    _isHystGPU = GL_FALSE;
+    break;
+  case GL4DF_CANNY_HYSTERESIS_GPU:
+    _isHystGPU = GL_TRUE;
+    break;
+  default:
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, mode);
+    break;
+  }
+}
+
+void gl4dfCannySetHysteresisPasses(GLuint passes) {
+  _hystPasses = passes;
+}
+
 /* appelée la première fois */
 static void cannyfinit(GLuint in, GLuint out, GLboolean flipV) {
   init();
@@ -90,70 +116,97 @@ static void cannyfinit(GLuint in, GLuint out, GLboolean flipV) {
   cannyfptr(in, out, flipV);
 }
 
+/*!\brief hystérésis en CPU de \a tex : pour chaque composante, les
+ * composantes connexes (4-connexité) de pixels au-dessus du seuil bas
+ * sont gardées si l'une d'elles atteint le seuil haut. */
 static inline void ccl(GLuint tex) {
-  /* CCL (Connected-Component Labeling) en CPU */
-  GLubyte *_pixmap = NULL, *_marks = NULL;
-  GLint w, h, wh, cc, i, lTh = _lowTh * 255, hTh = _highTh * 255;
+  GLint w, h, wh, cc, i, lTh = (GLint)(_lowTh * 255), hTh = (GLint)(_highTh * 255);
+  size_t size;
+  lTh = lTh < 0 ? 0 : (lTh > 255 ? 255 : lTh);
   glBindTexture(GL_TEXTURE_2D, tex);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
-  queueInit(w * h);
-  _pixmap = malloc(4 * w * h * sizeof *_pixmap);
-  assert(_pixmap);
-  _marks = calloc(4 * w * h, sizeof *_marks);
-  assert(_marks);
+  if((size = 4 * (size_t)w * h) > _pixmapSize) {
+    _pixmap = realloc(_pixmap, size);
+    assert(_pixmap);
+    _pixmapSize = size;
+  }
   glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pixmap);
-  for(cc = 0, wh = 4 * w * h; cc < 4; ++cc) {
-    /* GLint d[] = {4, 4 - (w << 2), -(w << 2), -4 - (w << 2), -4, -4 + (w << 2), (w << 2), 4 + (w << 2)}, */
-    /*   d2[][2] = {{1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}}; */
-    GLint d[] = {4, -(w << 2), -4, (w << 2)},
-      d2[][2] = {{1, 0}, {0, -1}, {-1, 0}, {0, 1}};
-    for(i = cc; i < wh; i += 4) {
-      if(!_marks[i] && _pixmap[i] >= hTh) {
-	_marks[i] = 2;
-	queuePut(i);
-      }
-      while(!queueEmpty()) {
-	GLint j, q = queueGet(), x, y;
-	x = (q >> 2); y = x / w; x = x % w;
-	for(j = 0; j < (GLint)(sizeof d / sizeof *d); ++j) {
-	  GLint nx = x + d2[j][0], ny = y + d2[j][1], nq = q + d[j];
-	  if(nx >= 0 && ny >= 0 && nx < w && ny < h &&
-	     !_marks[nq]) {
-	    if(_pixmap[nq] >= lTh) {
-	      _marks[nq] = 2;
-	      queuePut(nq);
-	    } else
-	      _marks[nq] = 1;
-	  }
-	}
-      }
-    }
-    for(i = cc; i < wh; i += 4) {
-      if(_marks[i] < 2)
-	_pixmap[i] = 0;
-      else
-	_pixmap[i] = 255;//_pixmap[i] == 255 ? _pixmap[i] : 100;
-    }
+  for(cc = 0, wh = w * h; cc < 4; ++cc) {
+    const GLuint * labels;
+    const GL4DFcomponent * comps;
+    cclLabel(_ccl, _pixmap + cc, w, h, 4, (GLubyte)lTh, 255, 4);
+    labels = cclGetLabels(_ccl);
+    comps = cclGetComponents(_ccl);
+    for(i = 0; i < wh; ++i)
+      _pixmap[4 * i + cc] = (labels[i] && (GLint)(comps[labels[i] - 1].max * 255.0f + 0.5f) >= hTh) ? 255 : 0;
   }
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pixmap);
-  free(_pixmap);
-  free(_marks);
-}  
+}
+
+/*!\brief hystérésis en GPU de \a tex (w x h) : les pixels au-dessus
+ * du seuil haut sont propagés, par passes ping-pong entre _tempTexId[5]
+ * et _tempTexId[6], aux pixels 4-connexes au-dessus du seuil bas ;
+ * jusqu'à convergence (aucun pixel modifié, mesuré par une requête
+ * d'occlusion sur une passe de comparaison sans écriture) ou pendant
+ * _hystPasses passes. Les cibles sont prises dans le pool de FBO
+ * partagé (voir gl4dfCommon.c).
+ *
+ * \return la texture du résultat (1 sur les contours, 0 ailleurs).
+ */
+static GLuint hysteresis(GLuint tex, GLint w, GLint h) {
+  GLuint src = _tempTexId[5], dst = _tempTexId[6], t, n, max = _hystPasses ? _hystPasses : (GLuint)(w * h), changed = 1;
+  /* mêmes seuils que ccl, qui compare des octets */
+  GLfloat lTh = (GLint)(_lowTh * 255) / 255.0f - 0.5f / 255.0f, hTh = (GLint)(_highTh * 255) / 255.0f - 0.5f / 255.0f;
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  for(n = 0; n < max && changed; ) {
+    fcommUseProgram(_cannyPId[3]);
+    glUniform1i(glGetUniformLocation(_cannyPId[3],  "len"), 0);
+    glUniform1i(glGetUniformLocation(_cannyPId[3],  "state"), 1);
+    glUniform1f(glGetUniformLocation(_cannyPId[3],  "lowTh"), lTh);
+    glUniform1f(glGetUniformLocation(_cannyPId[3],  "highTh"), hTh);
+    do {
+      glUniform1i(glGetUniformLocation(_cannyPId[3],  "first"), n == 0);
+      fcommFramebuffer(GL_FRAMEBUFFER, dst, 0);
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, src);
+      gl4dgDraw(fcommGetPlane());
+      t = src; src = dst; dst = t;
+    } while(++n < max && n % HYST_CHECK);
+    if(_hystPasses)
+      continue;
+    /* src est le dernier état, dst le précédent */
+    fcommUseProgram(_cannyPId[4]);
+    glUniform1i(glGetUniformLocation(_cannyPId[4],  "a"), 1);
+    glUniform1i(glGetUniformLocation(_cannyPId[4],  "b"), 2);
+    /* l'unité 1 tient encore l'ancien src (devenu dst) */
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, src);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, dst);
+    /* cible libre, rien n'y est écrit */
+    fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[2], 0);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, _hystQuery);
+    gl4dgDraw(fcommGetPlane());
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGetQueryObjectuiv(_hystQuery, GL_QUERY_RESULT, &changed);
+  }
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return src;
+}
 
 /* appelée les autres fois (après la première qui lance init) */
 static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
-  GLuint rout = out, fbo;
-  GLint vp[4], w, h, cfbo, ctex, cpId;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out, res;
+  GLint w, h;
   if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
     fcommMatchTex(in = _tempTexId[0], 0);
     gl4dfConvFrame2Tex(&_tempTexId[0]);
@@ -162,8 +215,8 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
     gl4dfConvTex2Tex(out, _tempTexId[0], GL_FALSE);
   }
   if(out == 0) { /* Pas de sortie, donc sortie aux dimensions du viewport */
-    w = vp[2];
-    h = vp[3];
+    w = st->vp[2];
+    h = st->vp[3];
     fcommMatchTex(rout = _tempTexId[1], out);
   } else {
     glBindTexture(GL_TEXTURE_2D, out);
@@ -173,20 +226,15 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
   fcommMatchTex(_tempTexId[2], rout);
   fcommMatchTex(_tempTexId[3], rout);
   fcommMatchTex(_tempTexId[4], rout);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  if(dt) glDisable(GL_DEPTH_TEST);
-  if(bl) glDisable(GL_BLEND);
-  glViewport(0, 0, w, h);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
+  if(_isHystGPU) {
+    fcommMatchTex(_tempTexId[5], rout);
+    fcommMatchTex(_tempTexId[6], rout);
+  }
+  fcommDrawState(GL_FALSE);
+  fcommViewport(0, 0, w, h); {
     GLfloat step[] = {1.0f / (GLfloat)w, 1.0f / (GLfloat)h};
-    GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, buffers);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _tempTexId[2],  0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, _tempTexId[3],  0);
-    glUseProgram(_cannyPId[0]);
+    fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[2], _tempTexId[3]);
+    fcommUseProgram(_cannyPId[0]);
     glUniform1i(glGetUniformLocation(_cannyPId[0],  "inv"), 0);
     glUniform1i(glGetUniformLocation(_cannyPId[0],  "myTexture"), 0);
     glUniform2fv(glGetUniformLocation(_cannyPId[0], "step"), 1, step);
@@ -194,10 +242,9 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
     glBindTexture(GL_TEXTURE_2D, in);
     gl4dgDraw(fcommGetPlane());
     glBindTexture(GL_TEXTURE_2D, 0);
-    glDrawBuffers(1, buffers);
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _tempTexId[4],  0);
-    glUseProgram(_cannyPId[1]);
+    fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[4], 0);
+    fcommUseProgram(_cannyPId[1]);
     glUniform1i(glGetUniformLocation(_cannyPId[1],  "len"), 0);
     glUniform1i(glGetUniformLocation(_cannyPId[1],  "dir"), 0);
     glUniform1i(glGetUniformLocation(_cannyPId[1],  "inv"), 0);
@@ -215,10 +262,10 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    ccl(_tempTexId[4]);
+    res = _isHystGPU ? hysteresis(_tempTexId[4], w, h) : (ccl(_tempTexId[4]), _tempTexId[4]);
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rout,  0);
-    glUseProgram(_cannyPId[2]);
+    fcommFramebuffer(GL_FRAMEBUFFER, rout, 0);
+    fcommUseProgram(_cannyPId[2]);
     glUniform1i(glGetUniformLocation(_cannyPId[2],  "len"), 0);
     glUniform1i(glGetUniformLocation(_cannyPId[2],  "orig"), 1);
     glUniform1i(glGetUniformLocation(_cannyPId[2],  "inv"), flipV);
@@ -227,7 +274,7 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
     glUniform1i(glGetUniformLocation(_cannyPId[2],  "mixMode"), _mixMode);
     glUniform1f(glGetUniformLocation(_cannyPId[2],  "mixFactor"), _mixFactor);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _tempTexId[4]);
+    glBindTexture(GL_TEXTURE_2D, res);
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, in);
     gl4dgDraw(fcommGetPlane());
@@ -238,19 +285,11 @@ static void cannyffunc(GLuint in, GLuint out, GLboolean flipV) {
   }
 
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, w, h, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, w, h, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   }
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
-  glUseProgram(cpId);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(bl) glEnable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
@@ -281,14 +320,11 @@ static void init(void) {
        in  vec2 vsoTexCoord;\n						\
        layout (location = 0) out vec4 fragLen;\n			\
        layout (location = 1) out vec4 fragDir;\n			\
-       const int ossize = 9;\n						\
+       #include \"gl4df/neighbours3x3.glsl\"\n			\
        const float _2pi = 6.283;\n					\
        const vec2 G[ossize] = vec2[]( vec2(-1.0,  -1.0), vec2(0.0,  -2.0), vec2(1.0,  -1.0),\n \
                                       vec2(-2.0,  0.0), vec2(0.0,  0.0), vec2(2.0,  0.0),\n \
                                       vec2(-1.0, 1.0), vec2(0.0, 2.0), vec2(1.0, 1.0) );\n \
-       vec2 offset[ossize] = vec2[](vec2(-step.x , -step.y), vec2( 0.0, -step.y), vec2( step.x , -step.y),\n \
-                                    vec2(-step.x, 0.0),      vec2( 0.0, 0.0),     vec2( step.x, 0.0),\n \
-                                    vec2(-step.x,   step.y), vec2( 0.0, step.y),  vec2( step.x ,  step.y) );\n	\
        void canny(in sampler2D s, in vec2 c, out vec4 len, out vec4 dir) {\n \
          vec2 r = vec2(0.0, 0.0), g = vec2(0.0, 0.0), b = vec2(0.0, 0.0), a = vec2(0.0, 0.0);\n \
          for(int i = 0; i < ossize; i++) {\n				\
@@ -366,9 +402,62 @@ static void init(void) {
          else\n								\
            fragColor = c * l;\n						\
        }";
+    const char * imfs3 =
+      "<imfs>gl4df_canny3.fs</imfs>\n"
+#ifdef __GLES4D__
+      "#version 300 es\n"
+#else
+      "#version 330\n"
+#endif
+      "uniform sampler2D len, state;\n  \
+       uniform float lowTh, highTh;\n					\
+       uniform int first;\n						\
+       out vec4 fragColor;\n						\
+       const int RUN = 8;\n						\
+       const ivec2 d[4] = ivec2[](ivec2(1, 0), ivec2(0, -1), ivec2(-1, 0), ivec2(0, 1));\n \
+       vec4 marked(ivec2 q, vec4 l) {\n				\
+         return first != 0 ? step(vec4(highTh), l) : texelFetch(state, q, 0);\n \
+       }\n								\
+       void main(void) {\n						\
+         ivec2 p = ivec2(gl_FragCoord.xy), sz = textureSize(len, 0);\n	\
+         vec4 l = texelFetch(len, p, 0), s = marked(p, l);\n		\
+         for(int j = 0; j < 4; ++j) {\n				\
+           /* remonte une suite de pixels au-dessus du seuil bas */\n	\
+           vec4 run = step(vec4(lowTh), l) * (vec4(1.0) - s);\n	\
+           ivec2 q = p;\n						\
+           for(int k = 0; k < RUN && any(greaterThan(run, vec4(0.0))); ++k) {\n \
+             q += d[j];\n						\
+             if(any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, sz))) break;\n \
+             vec4 ql = texelFetch(len, q, 0);\n			\
+             s = max(s, run * marked(q, ql));\n			\
+             run *= step(vec4(lowTh), ql) * (vec4(1.0) - s);\n	\
+           }\n							\
+         }\n								\
+         fragColor = s;\n						\
+       }";
+    const char * imfs4 =
+      "<imfs>gl4df_canny4.fs</imfs>\n"
+#ifdef __GLES4D__
+      "#version 300 es\n"
+#else
+      "#version 330\n"
+#endif
+      "uniform sampler2D a, b;\n  \
+       out vec4 fragColor;\n						\
+       void main(void) {\n						\
+         ivec2 p = ivec2(gl_FragCoord.xy);\n				\
+         if(texelFetch(a, p, 0) == texelFetch(b, p, 0))\n		\
+           discard;\n							\
+         fragColor = vec4(1.0);\n					\
+       }";
+    fcommShaderIncludes();
     _cannyPId[0] = gl4duCreateProgram(gl4dfBasicVS, imfs0, NULL);
     _cannyPId[1] = gl4duCreateProgram(gl4dfBasicVS, imfs1, NULL);
     _cannyPId[2] = gl4duCreateProgram(gl4dfBasicVS, imfs2, NULL);
+    _cannyPId[3] = gl4duCreateProgram(gl4dfBasicVS, imfs3, NULL);
+    _cannyPId[4] = gl4duCreateProgram(gl4dfBasicVS, imfs4, NULL);
+    glGenQueries(1, &_hystQuery);
+    _ccl = cclNew();
     gl4duAtExit(quit);
   }
 }
@@ -377,38 +466,16 @@ static void quit(void) {
   if(_tempTexId[0]) {
     glDeleteTextures((sizeof _tempTexId / sizeof *_tempTexId), _tempTexId);
     _tempTexId[0] = 0;
-    queueInit(0);
+  }
+  cclDelete(_ccl);
+  _ccl = NULL;
+  free(_pixmap);
+  _pixmap = NULL;
+  _pixmapSize = 0;
+  if(_hystQuery) {
+    glDeleteQueries(1, &_hystQuery);
+    _hystQuery = 0;
   }
   _cannyPId[0] = 0;
   cannyfptr = cannyfinit;
 }
-
-/* FIFO sans implémentation de tests de débordement */
-static int * _fifo = NULL, _head = -1, _queue = -1, _size = 0;
-static void queueInit(int n) {
-  int * nfifo = NULL;
-  _head = _queue = -1;
-  if(n == 0) {
-    if(_fifo) free(_fifo);
-    _fifo = NULL; _size = 0;
-    return;
-  }
-  if(_size != n) {
-    _size = n;
-    nfifo = realloc(_fifo, n * sizeof *_fifo);
-    if(nfifo == NULL) {
-      queueInit(0);
-      assert(0);
-    }
-    _fifo = nfifo;
-  }
-}
-static inline void queuePut(int i) {
-  _fifo[++_queue] = i;
-}
-static inline int queueGet(void) {
-  return _fifo[++_head];
-}
-static inline int queueEmpty(void) {
-  return _head == _queue;
-}
@@ -4,19 +4,52 @@
  *
  * A usage interne à la lib.
  *
+ * Contexte partagé des filtres : chaque point d'entrée est encadré par
+ * fcommBegin / fcommEnd. Seul l'appel de premier niveau (ou \ref
+ * gl4dfChainBegin) interroge l'état GL de l'appelant ; ensuite, une
+ * copie de l'état courant est tenue à jour par les fonctions fcommXXX,
+ * qui n'émettent un appel GL que si la valeur change, et fcommEnd ne
+ * rétablit que ce que le filtre a modifié. Les FBO viennent d'une
+ * réserve persistante, par niveau d'imbrication, et sont retrouvés par
+ * leurs attachements.
+ *
  * \author Farès BELHADJ amsi@ai.univ-paris8.fr
  * \date May 27, 2016
  *
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 #include "gl4du.h"
 #include "gl4df.h"
 #include "gl4dfCommon.h"
 
+/*!\brief profondeur maximale d'imbrication des filtres (un filtre qui
+ * en appelle un autre, une chaîne). */
+#define FCOMM_DEPTH 8
+/*!\brief nombre de FBO réservés par niveau d'imbrication. */
+#define FCOMM_FBOS  8
+
+typedef struct fcommfbo_t fcommfbo_t;
+
+/*!\brief FBO de la réserve ; tex n'est fiable que si valid, remis à
+ * faux à chaque appel de premier niveau (les noms de textures de
+ * l'appelant peuvent être recyclés entre deux appels). */
+struct fcommfbo_t {
+  GLuint id, tex[2], age;
+  GLsizei nbuf;
+  GLboolean valid;
+};
+
 static GLuint _plan = 0;
+static fcommstate_t _cur, _stack[FCOMM_DEPTH];
+static fcommfbo_t _fbos[FCOMM_DEPTH][FCOMM_FBOS];
+static GLuint _depth = 0, _chain = 0, _age = 0;
+static GLboolean _fbosAtExit = GL_FALSE;
 static void init(void);
 static void quit(void);
+static void fbosQuit(void);
 
 MKFWINIT0(plane, GLuint);
 
@@ -42,15 +75,21 @@ static void quit(void) {
   planefptr = planefinit;
 }
 
+/* dans un filtre (_depth > 0), le viewport est connu et la texture
+ * liée sera rétablie par fcommEnd. */
 void fcommMatchTex(GLuint goal, GLuint orig) {
-  GLint vp[4], w, h, pw, ph, ctex;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
+  GLint vp[4], w, h, pw, ph, ctex = 0;
+  if(!_depth)
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
   if(orig) {
     glBindTexture(GL_TEXTURE_2D, orig);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
   } else {
-    glGetIntegerv(GL_VIEWPORT, vp);
+    if(_depth)
+      memcpy(vp, _cur.vp, sizeof vp);
+    else
+      glGetIntegerv(GL_VIEWPORT, vp);
     w = vp[2];// - vp[0];
     h = vp[3];// - vp[1];
   }
@@ -59,7 +98,223 @@ void fcommMatchTex(GLuint goal, GLuint orig) {
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &ph);
   if(pw != w || ph != h)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-  glBindTexture(GL_TEXTURE_2D, (GLuint)ctex);
+  if(!_depth)
+    glBindTexture(GL_TEXTURE_2D, (GLuint)ctex);
+}
+
+static inline void setCapability(GLenum cap, GLboolean * cur, GLboolean enable) {
+  if(*cur == enable)
+    return;
+  if(enable)
+    glEnable(cap);
+  else
+    glDisable(cap);
+  *cur = enable;
+}
+
+#ifndef __GLES4D__
+static inline void setPolygonMode(GLint mode) {
+  if(_cur.polygonMode == mode)
+    return;
+  glPolygonMode(GL_FRONT_AND_BACK, mode);
+  _cur.polygonMode = mode;
+}
+#endif
+
+/*!\brief entrée dans un filtre.
+ *
+ * Au premier niveau, l'état de l'appelant est relevé (les seules
+ * requêtes glGet/glIsEnabled du contexte) ; à un niveau imbriqué, la
+ * copie courante suffit.
+ *
+ * \return l'état à l'entrée du filtre (viewport et framebuffer de
+ * l'appelant notamment), valable jusqu'au fcommEnd correspondant.
+ */
+const fcommstate_t * fcommBegin(void) {
+  GLuint i, j;
+  assert(_depth < FCOMM_DEPTH);
+  if(!_depth) {
+    GLint v, pm[2] = {0};
+    glGetIntegerv(GL_VIEWPORT, _cur.vp);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &v);
+    _cur.drawFbo = _cur.readFbo = (GLuint)v;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &v);
+    _cur.program = (GLuint)v;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &v);
+    _cur.tex = (GLuint)v;
+#ifndef __GLES4D__
+    glGetIntegerv(GL_POLYGON_MODE, pm);
+#endif
+    _cur.polygonMode = pm[0];
+    _cur.depthTest = glIsEnabled(GL_DEPTH_TEST);
+    _cur.blend = glIsEnabled(GL_BLEND);
+  }
+  if(_depth == _chain) /* appel de premier niveau */
+    for(i = 0; i < FCOMM_DEPTH; ++i)
+      for(j = 0; j < FCOMM_FBOS; ++j)
+	_fbos[i][j].valid = GL_FALSE;
+  _stack[_depth] = _cur;
+  return &_stack[_depth++];
+}
+
+/*!\brief sortie d'un filtre : rétablit, sans requête, ce qui a changé
+ * depuis le fcommBegin correspondant (et la texture liée au premier
+ * niveau). */
+void fcommEnd(void) {
+  const fcommstate_t * s;
+  assert(_depth > 0);
+  s = &_stack[--_depth];
+  fcommViewport(s->vp[0], s->vp[1], s->vp[2], s->vp[3]);
+  if(s->drawFbo == s->readFbo)
+    fcommBindFramebuffer(GL_FRAMEBUFFER, s->drawFbo);
+  else {
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, s->drawFbo);
+    fcommBindFramebuffer(GL_READ_FRAMEBUFFER, s->readFbo);
+  }
+  fcommUseProgram(s->program);
+#ifndef __GLES4D__
+  setPolygonMode(s->polygonMode);
+#endif
+  setCapability(GL_DEPTH_TEST, &_cur.depthTest, s->depthTest);
+  setCapability(GL_BLEND, &_cur.blend, s->blend);
+  if(!_depth) {
+    glBindTexture(GL_TEXTURE_2D, s->tex);
+    _cur.tex = s->tex;
+  }
+}
+
+/*!\brief lie à \a target un FBO de la réserve du niveau courant dont
+ * les attachements de couleur 0 et 1 sont \a tex0 et \a tex1 (0 pour
+ * aucun). Un FBO qui les a déjà (depuis le début de l'appel de premier
+ * niveau) est réutilisé tel quel, sinon le moins récemment utilisé est
+ * réattaché. Pour une cible d'écriture, les draw buffers suivent le
+ * nombre d'attachements.
+ *
+ * \return l'identifiant du FBO.
+ */
+GLuint fcommFramebuffer(GLenum target, GLuint tex0, GLuint tex1) {
+  fcommfbo_t * pool, * f = NULL;
+  GLuint i;
+  GLsizei nbuf = tex1 ? 2 : 1;
+  assert(_depth > 0);
+  pool = _fbos[_depth - 1];
+  for(i = 0; i < FCOMM_FBOS; ++i)
+    if(pool[i].valid && pool[i].tex[0] == tex0 && pool[i].tex[1] == tex1) {
+      f = &pool[i];
+      break;
+    }
+  if(f)
+    fcommBindFramebuffer(target, f->id);
+  else {
+    for(f = pool, i = 1; i < FCOMM_FBOS; ++i)
+      if(pool[i].age < f->age)
+	f = &pool[i];
+    if(!f->id) {
+      glGenFramebuffers(1, &f->id);
+      f->nbuf = 1;
+      if(!_fbosAtExit) {
+	gl4duAtExit(fbosQuit);
+	_fbosAtExit = GL_TRUE;
+      }
+    }
+    fcommBindFramebuffer(target, f->id);
+    if(!f->valid || f->tex[0] != tex0)
+      glFramebufferTexture2D(target, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex0, 0);
+    if(!f->valid || f->tex[1] != tex1)
+      glFramebufferTexture2D(target, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, tex1, 0);
+    f->tex[0] = tex0;
+    f->tex[1] = tex1;
+    f->valid = GL_TRUE;
+  }
+  if(target != GL_READ_FRAMEBUFFER && f->nbuf != nbuf) {
+    static const GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(nbuf, buffers);
+    f->nbuf = nbuf;
+  }
+  f->age = ++_age;
+  return f->id;
+}
+
+void fcommBindFramebuffer(GLenum target, GLuint fbo) {
+  switch(target) {
+  case GL_DRAW_FRAMEBUFFER:
+    if(_cur.drawFbo != fbo)
+      glBindFramebuffer(target, _cur.drawFbo = fbo);
+    break;
+  case GL_READ_FRAMEBUFFER:
+    if(_cur.readFbo != fbo)
+      glBindFramebuffer(target, _cur.readFbo = fbo);
+    break;
+  default:
+    if(_cur.drawFbo != fbo || _cur.readFbo != fbo)
+      glBindFramebuffer(GL_FRAMEBUFFER, _cur.drawFbo = _cur.readFbo = fbo);
+    break;
+  }
+}
+
+void fcommViewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+  if(_cur.vp[0] == x && _cur.vp[1] == y && _cur.vp[2] == w && _cur.vp[3] == h)
+    return;
+  glViewport(x, y, w, h);
+  _cur.vp[0] = x; _cur.vp[1] = y;
+  _cur.vp[2] = w; _cur.vp[3] = h;
+}
+
+void fcommUseProgram(GLuint pId) {
+  if(_cur.program != pId)
+    glUseProgram(_cur.program = pId);
+}
+
+/*!\brief état de dessin des filtres : polygones pleins, sans test de
+ * profondeur, mélange selon \a blend. */
+void fcommDrawState(GLboolean blend) {
+#ifndef __GLES4D__
+  setPolygonMode(GL_FILL);
+#endif
+  setCapability(GL_DEPTH_TEST, &_cur.depthTest, GL_FALSE);
+  setCapability(GL_BLEND, &_cur.blend, blend);
+}
+
+/*!\brief débute une chaîne de filtres : l'état GL de l'appelant est
+ * relevé une fois pour toute la chaîne au lieu de l'être à chaque
+ * filtre, et rétabli par \ref gl4dfChainEnd. */
+void gl4dfChainBegin(void) {
+  if(_chain)
+    return;
+  fcommBegin();
+  _chain = 1;
+}
+
+/*!\brief termine la chaîne débutée par \ref gl4dfChainBegin. */
+void gl4dfChainEnd(void) {
+  if(!_chain)
+    return;
+  _chain = 0;
+  fcommEnd();
+}
+
+static void fbosQuit(void) {
+  GLuint i, j;
+  for(i = 0; i < FCOMM_DEPTH; ++i)
+    for(j = 0; j < FCOMM_FBOS; ++j)
+      if(_fbos[i][j].id)
+	glDeleteFramebuffers(1, &_fbos[i][j].id);
+  memset(_fbos, 0, sizeof _fbos);
+  _age = 0;
+  _fbosAtExit = GL_FALSE;
+}
+
+/*!\brief enregistre les extraits GLSL communs aux filtres, à
+ * inclure par #include "gl4df/xxx.glsl" dans leurs shaders. L'extrait
+ * neighbours3x3.glsl (la taille et les décalages du voisinage 3x3,
+ * après la déclaration de l'uniforme vec2 step) est partagé par Sobel
+ * et Canny. */
+void fcommShaderIncludes(void) {
+  gl4duAddShaderInclude("gl4df/neighbours3x3.glsl",
+			"const int ossize = 9;\n\
+       vec2 offset[ossize] = vec2[](vec2(-step.x , -step.y), vec2( 0.0, -step.y), vec2( step.x , -step.y),\n \
+                                    vec2(-step.x, 0.0),      vec2( 0.0, 0.0),     vec2( step.x, 0.0),\n \
+                                    vec2(-step.x,   step.y), vec2( 0.0, step.y),  vec2( step.x ,  step.y) );\n");
 }
 
 GLuint fcommGetPlane(void) {
@@ -49,8 +49,25 @@ extern "C" {
          fragColor = texture(tex, vsoTexCoord);\n			\
      }";
 
+  /*!\brief état GL relevé à l'entrée d'un filtre, voir fcommBegin. */
+  typedef struct fcommstate_t fcommstate_t;
+  struct fcommstate_t {
+    GLint vp[4];
+    GLuint drawFbo, readFbo, program, tex;
+    GLint polygonMode;
+    GLboolean depthTest, blend;
+  };
+
   extern void   fcommMatchTex(GLuint goal, GLuint orig);
   extern GLuint fcommGetPlane(void);
+  extern void   fcommShaderIncludes(void);
+  extern const fcommstate_t * fcommBegin(void);
+  extern void   fcommEnd(void);
+  extern GLuint fcommFramebuffer(GLenum target, GLuint tex0, GLuint tex1);
+  extern void   fcommBindFramebuffer(GLenum target, GLuint fbo);
+  extern void   fcommViewport(GLint x, GLint y, GLsizei w, GLsizei h);
+  extern void   fcommUseProgram(GLuint pId);
+  extern void   fcommDrawState(GLboolean blend);
 
 
 #ifdef __cplusplus
@@ -19,14 +19,11 @@ static GLenum _filter = GL_NEAREST;
 static GLuint _pId = 0;
 
 void gl4dfConvFrame2Tex(GLuint * out) {
-  GLint vp[4], w, h, cfbo, ctex;
-  GLuint fbo;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_VIEWPORT, vp);
+  const fcommstate_t * st = fcommBegin();
+  GLint w, h;
   if(*out == 0) {
-    w = vp[2];// - vp[0];
-    h = vp[3];// - vp[1];
+    w = st->vp[2];// - vp[0];
+    h = st->vp[3];// - vp[1];
     glGenTextures(1, out);
     glBindTexture(GL_TEXTURE_2D, *out);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _filter);
@@ -37,43 +34,29 @@ void gl4dfConvFrame2Tex(GLuint * out) {
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
   }
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)cfbo);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
-  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *out,  0);
-  glBlitFramebuffer(vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], 0, 0, w, h, GL_COLOR_BUFFER_BIT, _filter);
-  glDeleteFramebuffers(1, &fbo);
-  glBindTexture(GL_TEXTURE_2D, (GLuint)ctex);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
+  fcommBindFramebuffer(GL_READ_FRAMEBUFFER, st->drawFbo);
+  fcommFramebuffer(GL_DRAW_FRAMEBUFFER, *out, 0);
+  glBlitFramebuffer(st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], 0, 0, w, h, GL_COLOR_BUFFER_BIT, _filter);
+  fcommEnd();
 }
 
 void gl4dfConvTex2Frame(GLuint in) {
-  GLint vp[4], w, h, cfbo, ctex;
-  GLuint fbo;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_VIEWPORT, vp);
+  const fcommstate_t * st = fcommBegin();
+  GLint w, h;
 
   glBindTexture(GL_TEXTURE_2D, in);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
 
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
-  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, in,  0);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)cfbo);
-  glBlitFramebuffer(0, 0, w, h, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, _filter);
-
-  glDeleteFramebuffers(1, &fbo);
-  glBindTexture(GL_TEXTURE_2D, (GLuint)ctex);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
+  fcommFramebuffer(GL_READ_FRAMEBUFFER, in, 0);
+  fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, st->drawFbo);
+  glBlitFramebuffer(0, 0, w, h, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, _filter);
+  fcommEnd();
 }
 
 void gl4dfConvTex2Tex(GLuint in, GLuint out, GLboolean flipV) {
-  GLint inw, inh, outw, outh, ctex, cfbo;
-  GLuint fbo[2];
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
+  GLint inw, inh, outw, outh;
+  fcommBegin();
 
   glBindTexture(GL_TEXTURE_2D, in);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &inw);
@@ -82,20 +65,15 @@ void gl4dfConvTex2Tex(GLuint in, GLuint out, GLboolean flipV) {
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &outw);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &outh);
 
-  glGenFramebuffers(2, fbo);
-  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo[0]);
-  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, in,  0);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo[1]);
-  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, out,  0);
+  fcommFramebuffer(GL_READ_FRAMEBUFFER, in, 0);
+  fcommFramebuffer(GL_DRAW_FRAMEBUFFER, out, 0);
   
   if(flipV)
     glBlitFramebuffer(0, 0, inw, inh, 0, outh, outw, 0, GL_COLOR_BUFFER_BIT, _filter);
   else
     glBlitFramebuffer(0, 0, inw, inh, 0, 0, outw, outh, GL_COLOR_BUFFER_BIT, _filter);
 
-  glDeleteFramebuffers(2, fbo);
-  glBindTexture(GL_TEXTURE_2D, (GLuint)ctex);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
+  fcommEnd();
 }
 
 void gl4dfConvSetFilter(GLenum filter) {
@@ -74,10 +74,11 @@ static void fractalPaintingfinit(GLuint in, GLuint out, GLboolean flipV) {
 }
 
 static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
-  GLint i, ati = 0, vp[4], polygonMode[2], cpId = 0, cfbo, end, n;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND), tex = glIsEnabled(GL_TEXTURE_2D);
+  const fcommstate_t * st = fcommBegin();
+  GLint i, ati = 0, end, n;
+  GLboolean tex = glIsEnabled(GL_TEXTURE_2D);
   GLfloat H[4], Hf;
-  GLuint fbo, md = ( _mcmd_H_map_tex_id || _mcmd_I_map_tex_id ||
+  GLuint md = ( _mcmd_H_map_tex_id || _mcmd_I_map_tex_id ||
          _mcmd_NS_map_tex_id || _mcmd_NT_map_tex_id ) ? 4 : 0;
   if(_subdivision_method == 0) { /* Triangle-Edge */
     for(i = 0, Hf = 1.0f; i < 4; ++i)
@@ -87,14 +88,7 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
       H[i] = 0.5f * _mcmd_noise_H[i];
   }
   glEnable(GL_TEXTURE_2D);
-  glDisable(GL_BLEND);
-  glDisable(GL_DEPTH_TEST);
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
-  glGenFramebuffers(1, &fbo);
+  fcommDrawState(GL_FALSE);
   gl4dfConvSetFilter(GL_NEAREST);
   if(_skeletonize) {
     if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
@@ -107,11 +101,10 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
     } else
       gl4dfConvTex2Tex(in, _tempTexId[1], GL_FALSE);
   }
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
-    glViewport(0, 0, _width, _height);
+  fcommViewport(0, 0, _width, _height); {
     if(_skeletonize) {
-      glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _tempTexId[1],  0);
-      glUseProgram(_pId[1]);
+      fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[1], 0);
+      fcommUseProgram(_pId[1]);
       glUniform1f(glGetUniformLocation(_pId[1], "rand_threshold"), _rand_threshold);
       glUniform1i(glGetUniformLocation(_pId[1], "etage0"), 0);
       glUniform1i(glGetUniformLocation(_pId[1], "inv"), 0);
@@ -122,7 +115,7 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
       gl4dgDraw(fcommGetPlane());
     }
     /* mdbu */
-    glUseProgram(_pId[_mdbu_version]);
+    fcommUseProgram(_pId[_mdbu_version]);
     glActiveTexture(GL_TEXTURE4); glBindTexture(GL_TEXTURE_2D, _mcmd_Ir_map_tex_id);
     glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, _tempTexId[2]);
     glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, _mdTexId[3]);
@@ -142,7 +135,7 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
     end = (nbLevels(_width, _height) >> (_subdivision_method == 0 ? 0 : 1)) - 1;
     //end = _mdbu_version > 2 ? (end >> 2) : end;
     for(i = 0, ati = 0; i < end; i++) {
-      glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,    GL_TEXTURE_2D, _tempTexId[ati], 0);
+      fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[ati], 0);
       ati = (ati + 1) % 2;
       glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, _tempTexId[ati]);
       gl4dgDraw(fcommGetPlane());
@@ -152,7 +145,7 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
     glActiveTexture(GL_TEXTURE0);
     /* fin mdbu */
     /* debut md */
-    glUseProgram(_pId[md]);
+    fcommUseProgram(_pId[md]);
     glActiveTexture(GL_TEXTURE6); glBindTexture(GL_TEXTURE_2D, _mcmd_NT_map_tex_id);
     glActiveTexture(GL_TEXTURE5); glBindTexture(GL_TEXTURE_2D, _mcmd_NS_map_tex_id);
     glActiveTexture(GL_TEXTURE4); glBindTexture(GL_TEXTURE_2D, _mcmd_I_map_tex_id);
@@ -183,7 +176,7 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
     if(_change_seed)
       _seed += 0.0001f;
     for(i = 0, n = nbLevels(_width, _height); i < n; i++) {
-      glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,    GL_TEXTURE_2D, _tempTexId[ati], 0);
+      fcommFramebuffer(GL_FRAMEBUFFER, _tempTexId[ati], 0);
       ati = (ati + 1) % 2;
       glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, _tempTexId[ati]);
       glUniform1i(glGetUniformLocation(_pId[md], "level"), i);
@@ -199,22 +192,16 @@ static void fractalPaintingffunc(GLuint in, GLuint out, GLboolean flipV) {
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, 0);
   }
   /* fin: */
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
     if(flipV)
-      glBlitFramebuffer(0, 0, _width, _height, vp[0], vp[1] + vp[3], vp[0] + vp[2], vp[1], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+      glBlitFramebuffer(0, 0, _width, _height, st->vp[0], st->vp[1] + st->vp[3], st->vp[0] + st->vp[2], st->vp[1], GL_COLOR_BUFFER_BIT, GL_LINEAR);
     else
-      glBlitFramebuffer(0, 0, _width, _height, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+      glBlitFramebuffer(0, 0, _width, _height, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   } else
     gl4dfConvTex2Tex(_tempTexId[(ati + 1) % 2], out, flipV);
-  glDeleteFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-  glUseProgram(cpId);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  if(bl) glEnable(GL_BLEND);
+  fcommEnd();
   if(!tex) glDisable(GL_TEXTURE_2D);
 
 }
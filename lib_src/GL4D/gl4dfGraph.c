@@ -0,0 +1,694 @@
+/*!\file gl4dfGraph.c
+ *
+ * \brief graphes de filtres : description déclarative d'une chaîne de
+ * filtres gl4df et compilation en un minimum de passes.
+ *
+ * Un graphe est un DAG dont les nœuds sont créés dans l'ordre
+ * topologique (un nœud ne référence que des nœuds déjà créés). À la
+ * compilation :
+ * - un nœud ponctuel (Op) ou à voisinage (Sobel, Median, passes 1D du
+ *   Blur) utilisé une seule fois est fusionné dans la passe de son
+ *   consommateur : il devient une fonction GLSL appelée par celle du
+ *   consommateur au lieu d'être écrit puis relu en mémoire. Un voisinage
+ *   n'est jamais fusionné dans un autre voisinage (le coût serait le
+ *   produit des tailles des voisinages) ;
+ * - la dernière passe écrit directement dans la sortie (texture ou
+ *   framebuffer de l'appelant, avec le flip vertical), sans copie ;
+ * - les textures intermédiaires sont prises dans une réserve propre au
+ *   graphe et réutilisées dès la fin de leur durée de vie ;
+ * - les programmes générés sont mis en cache (toutes instances de
+ *   graphes confondues) par leur source, qui ne dépend que de la
+ *   structure de la passe et des paramètres de ses nœuds.
+ *
+ * Les nœuds gl4dfGraphFilter appellent un filtre existant
+ * (gl4dfCanny, gl4dfSegmentation, ...) et ne sont pas fusionnés.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+#include "gl4du.h"
+#include "gl4df.h"
+#include "gl4dfCommon.h"
+#include "gl4duProfile.h"
+#include "gl4dfBlurWeights.h"
+
+/*!\brief nombre maximum de textures lues par une passe fusionnée. */
+#define GRAPH_MAX_SAMPLERS 8
+
+typedef enum gnode_e gnode_e;
+typedef struct gnode_t gnode_t;
+typedef struct gpass_t gpass_t;
+typedef struct graph_t graph_t;
+typedef struct gprog_t gprog_t;
+typedef struct gsrc_t gsrc_t;
+
+enum gnode_e {
+  GN_INPUT = 0,
+  GN_OP,
+  GN_SOBEL,
+  GN_MEDIAN,
+  GN_BLUR_V,
+  GN_BLUR_H,
+  GN_FILTER
+};
+
+struct gnode_t {
+  gnode_e type;
+  GLuint in[2];               /* nœuds d'entrée (indices + 1, 0 si aucun) */
+  GLuint tex;                 /* GN_INPUT : texture, 0 pour l'écran */
+  GLint op, radius;           /* GN_OP : opération, GN_BLUR_x : rayon */
+  GLint invResult, luminance, mixMode; /* GN_SOBEL */
+  GLfloat mixFactor;
+  void (*filter)(GLuint, GLuint, GLboolean); /* GN_FILTER */
+  /* résultats de la compilation */
+  GLuint uses, lastPass, leaves;
+  GLint slot;                 /* texture de la réserve, -1 si aucune */
+  GLboolean reachable, fused, stencil;
+};
+
+/*!\brief passe compilée : calcule le nœud \a node (et ceux fusionnés
+ * avec lui) en lisant les nœuds \a samplers. */
+struct gpass_t {
+  GLuint node, pId, nbSamplers;
+  GLuint samplers[GRAPH_MAX_SAMPLERS];
+};
+
+struct graph_t {
+  gnode_t * nodes;
+  GLuint nbNodes, sizeNodes;
+  gpass_t * passes;
+  GLuint nbPasses;
+  GLuint * pool, poolSize;    /* textures intermédiaires */
+  GLuint output, out, screenTex;
+  GLboolean flipV, copyOut, dirty;
+};
+
+/*!\brief programme généré, retrouvé par sa source. */
+struct gprog_t {
+  GLuint hash, pId;
+  char * src;
+};
+
+/*!\brief chaîne extensible pour la génération des sources. */
+struct gsrc_t {
+  char * s;
+  size_t len, size;
+};
+
+static graph_t ** _graphs = NULL;
+static GLuint _nbGraphs = 0;
+static gprog_t * _progs = NULL;
+static GLuint _nbProgs = 0, _sizeProgs = 0;
+/* jamais remis à zéro : les shaders de gl4du sont nommés par ce compteur */
+static GLuint _progName = 0;
+static int _hasInit = 0;
+
+static void init(void);
+static void quit(void);
+static void freeGraph(graph_t * g);
+static void genTextures(GLsizei n, GLuint * tex);
+static void compile(graph_t * g);
+static GLuint passProgram(graph_t * g, gpass_t * p);
+
+static void init(void) {
+  fcommShaderIncludes();
+  gl4duAtExit(quit);
+  _hasInit = 1;
+}
+
+static void quit(void) {
+  GLuint i;
+  for(i = 0; i < _nbGraphs; ++i)
+    if(_graphs[i])
+      freeGraph(_graphs[i]);
+  free(_graphs);
+  _graphs = NULL;
+  _nbGraphs = 0;
+  for(i = 0; i < _nbProgs; ++i)
+    free(_progs[i].src);
+  free(_progs);
+  _progs = NULL;
+  _nbProgs = _sizeProgs = 0;
+  _hasInit = 0;
+}
+
+static graph_t * getGraph(GLuint graph, const char * func) {
+  if(!graph || graph > _nbGraphs || !_graphs[graph - 1]) {
+    fprintf(stderr, "%s: graph %u does not exist\n", func, graph);
+    return NULL;
+  }
+  return _graphs[graph - 1];
+}
+
+static GLboolean checkNode(graph_t * g, GLuint node, const char * func) {
+  if(!node || node > g->nbNodes) {
+    fprintf(stderr, "%s: node %u does not exist\n", func, node);
+    return GL_FALSE;
+  }
+  return GL_TRUE;
+}
+
+static GLuint addNode(graph_t * g, gnode_e type, GLuint in0, GLuint in1) {
+  gnode_t * n;
+  if(g->nbNodes == g->sizeNodes) {
+    g->nodes = realloc(g->nodes, (g->sizeNodes = g->sizeNodes ? 2 * g->sizeNodes : 16) * sizeof *g->nodes);
+    assert(g->nodes);
+  }
+  n = &g->nodes[g->nbNodes];
+  memset(n, 0, sizeof *n);
+  n->type = type;
+  n->in[0] = in0;
+  n->in[1] = in1;
+  n->slot = -1;
+  g->dirty = GL_TRUE;
+  return ++g->nbNodes;
+}
+
+static void freeGraph(graph_t * g) {
+  if(g->pool) {
+    glDeleteTextures(g->poolSize, g->pool);
+    free(g->pool);
+  }
+  if(g->screenTex)
+    glDeleteTextures(1, &g->screenTex);
+  free(g->nodes);
+  free(g->passes);
+  free(g);
+}
+
+GLuint gl4dfGraphGen(void) {
+  GLuint i;
+  if(!_hasInit) init();
+  for(i = 0; i < _nbGraphs; ++i)
+    if(!_graphs[i])
+      break;
+  if(i == _nbGraphs) {
+    _graphs = realloc(_graphs, ++_nbGraphs * sizeof *_graphs);
+    assert(_graphs);
+  }
+  _graphs[i] = calloc(1, sizeof *_graphs[i]);
+  assert(_graphs[i]);
+  return i + 1;
+}
+
+void gl4dfGraphDelete(GLuint graph) {
+  graph_t * g = getGraph(graph, __func__);
+  if(!g) return;
+  freeGraph(g);
+  _graphs[graph - 1] = NULL;
+}
+
+GLuint gl4dfGraphInput(GLuint graph, GLuint tex) {
+  graph_t * g = getGraph(graph, __func__);
+  GLuint n;
+  if(!g) return 0;
+  n = addNode(g, GN_INPUT, 0, 0);
+  g->nodes[n - 1].tex = tex;
+  return n;
+}
+
+void gl4dfGraphSetInput(GLuint graph, GLuint node, GLuint tex) {
+  graph_t * g = getGraph(graph, __func__);
+  gnode_t * n;
+  if(!g || !checkNode(g, node, __func__)) return;
+  if((n = &g->nodes[node - 1])->type != GN_INPUT) {
+    fprintf(stderr, "%s: node %u is not an input\n", __func__, node);
+    return;
+  }
+  /* seul le recouvrement avec la sortie change la compilation */
+  if(g->out && (n->tex == g->out || tex == g->out))
+    g->dirty = GL_TRUE;
+  n->tex = tex;
+}
+
+GLuint gl4dfGraphOp(GLuint graph, GLuint node1, GLuint node2, GL4DFenum op) {
+  graph_t * g = getGraph(graph, __func__);
+  GLuint n;
+  if(!g || !checkNode(g, node1, __func__) || !checkNode(g, node2, __func__)) return 0;
+  if(op < GL4DF_OP_ADD || op > GL4DF_OP_OVERLAY) {
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, op);
+    return 0;
+  }
+  n = addNode(g, GN_OP, node1, node2);
+  g->nodes[n - 1].op = op - GL4DF_OP_ADD;
+  return n;
+}
+
+GLuint gl4dfGraphSobel(GLuint graph, GLuint node, GL4DFenum resultMode, GL4DFenum mixMode, GLfloat mixFactor) {
+  graph_t * g = getGraph(graph, __func__);
+  gnode_t * n;
+  if(!g || !checkNode(g, node, __func__)) return 0;
+  if(resultMode < GL4DF_SOBEL_RESULT_RGB || resultMode > GL4DF_SOBEL_RESULT_INV_LUMINANCE) {
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, resultMode);
+    return 0;
+  }
+  if(mixMode < GL4DF_SOBEL_MIX_NONE || mixMode > GL4DF_SOBEL_MIX_MULT) {
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, mixMode);
+    return 0;
+  }
+  n = &g->nodes[addNode(g, GN_SOBEL, node, 0) - 1];
+  n->invResult = resultMode == GL4DF_SOBEL_RESULT_INV_RGB || resultMode == GL4DF_SOBEL_RESULT_INV_LUMINANCE;
+  n->luminance = resultMode == GL4DF_SOBEL_RESULT_LUMINANCE || resultMode == GL4DF_SOBEL_RESULT_INV_LUMINANCE;
+  n->mixMode = mixMode - GL4DF_SOBEL_MIX_NONE;
+  n->mixFactor = mixFactor;
+  return g->nbNodes;
+}
+
+GLuint gl4dfGraphMedian(GLuint graph, GLuint node, GLuint nb_iterations) {
+  graph_t * g = getGraph(graph, __func__);
+  if(!g || !checkNode(g, node, __func__)) return 0;
+  while(nb_iterations--)
+    node = addNode(g, GN_MEDIAN, node, 0);
+  return node;
+}
+
+GLuint gl4dfGraphBlur(GLuint graph, GLuint node, GLuint radius, GLuint nb_iterations) {
+  graph_t * g = getGraph(graph, __func__);
+  if(!g || !checkNode(g, node, __func__)) return 0;
+  /* comme gl4dfBlur : un rayon nul équivaut à un rayon de 1 */
+  radius = radius > BLUR_MAX_RADIUS ? BLUR_MAX_RADIUS : (radius ? radius : 1);
+  while(nb_iterations--) {
+    node = addNode(g, GN_BLUR_V, node, 0);
+    g->nodes[node - 1].radius = radius;
+    node = addNode(g, GN_BLUR_H, node, 0);
+    g->nodes[node - 1].radius = radius;
+  }
+  return node;
+}
+
+GLuint gl4dfGraphFilter(GLuint graph, GLuint node, void (*filter)(GLuint in, GLuint out, GLboolean flipV)) {
+  graph_t * g = getGraph(graph, __func__);
+  GLuint n;
+  if(!g || !checkNode(g, node, __func__)) return 0;
+  assert(filter);
+  n = addNode(g, GN_FILTER, node, 0);
+  g->nodes[n - 1].filter = filter;
+  return n;
+}
+
+void gl4dfGraphOutput(GLuint graph, GLuint node, GLuint out, GLboolean flipV) {
+  graph_t * g = getGraph(graph, __func__);
+  if(!g || !checkNode(g, node, __func__)) return;
+  g->output = node;
+  g->out = out;
+  g->flipV = flipV;
+  g->dirty = GL_TRUE;
+}
+
+GLuint gl4dfGraphGetNbPasses(GLuint graph) {
+  graph_t * g = getGraph(graph, __func__);
+  if(!g || !g->output) return 0;
+  if(g->dirty)
+    compile(g);
+  return g->nbPasses + (g->copyOut ? 1 : 0);
+}
+
+/*!\brief texture contenant le résultat du nœud matérialisé \a node. */
+static GLuint nodeTex(graph_t * g, GLuint node) {
+  gnode_t * n = &g->nodes[node - 1];
+  if(n->type == GN_INPUT)
+    return n->tex ? n->tex : g->screenTex;
+  assert(n->slot >= 0);
+  return g->pool[n->slot];
+}
+
+void gl4dfGraphRun(GLuint graph) {
+  graph_t * g = getGraph(graph, __func__);
+  const fcommstate_t * st;
+  GLuint i, j, last;
+  GLint w, h;
+  if(!g) return;
+  if(!g->output) {
+    fprintf(stderr, "%s: graph %u has no output\n", __func__, graph);
+    return;
+  }
+  GL4D_PROF_BEGIN("gl4dfGraphRun");
+  if(g->dirty)
+    compile(g);
+  st = fcommBegin();
+  if(g->out) {
+    glBindTexture(GL_TEXTURE_2D, g->out);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+  } else {
+    w = st->vp[2];
+    h = st->vp[3];
+  }
+  for(i = 0; i < g->nbNodes; ++i)
+    if(g->nodes[i].reachable && g->nodes[i].type == GN_INPUT && !g->nodes[i].tex) {
+      /* une seule copie de l'écran pour toutes les entrées 0 */
+      if(!g->screenTex)
+	genTextures(1, &g->screenTex);
+      fcommMatchTex(g->screenTex, 0);
+      gl4dfConvFrame2Tex(&g->screenTex);
+      break;
+    }
+  for(i = 0; i < g->poolSize; ++i)
+    fcommMatchTex(g->pool[i], g->out);
+  last = g->copyOut ? g->nbPasses : g->nbPasses - 1;
+  for(i = 0; i < g->nbPasses; ++i) {
+    gpass_t * p = &g->passes[i];
+    gnode_t * n = &g->nodes[p->node - 1];
+    GLfloat step[2];
+    if(n->type == GN_FILTER) {
+      if(i == last) {
+	/* le filtre relève l'état courant comme celui de l'appelant :
+	 * on lui rend ceux d'avant les passes précédentes */
+	fcommViewport(st->vp[0], st->vp[1], st->vp[2], st->vp[3]);
+	fcommBindFramebuffer(GL_FRAMEBUFFER, st->drawFbo);
+	n->filter(nodeTex(g, n->in[0]), g->out, g->flipV);
+      } else
+	n->filter(nodeTex(g, n->in[0]), g->pool[n->slot], GL_FALSE);
+      continue;
+    }
+    fcommDrawState(GL_FALSE);
+    if(i != last) {
+      fcommViewport(0, 0, w, h);
+      fcommFramebuffer(GL_FRAMEBUFFER, g->pool[n->slot], 0);
+    } else if(g->out) {
+      fcommViewport(0, 0, w, h);
+      fcommFramebuffer(GL_FRAMEBUFFER, g->out, 0);
+    } else { /* directement dans le framebuffer de l'appelant */
+      fcommViewport(st->vp[0], st->vp[1], st->vp[2], st->vp[3]);
+      fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, st->drawFbo);
+    }
+    step[0] = 1.0f / (GLfloat)w;
+    step[1] = 1.0f / (GLfloat)h;
+    fcommUseProgram(p->pId);
+    glUniform1i(glGetUniformLocation(p->pId,  "inv"), i == last ? g->flipV : 0);
+    glUniform2fv(glGetUniformLocation(p->pId, "step"), 1, step);
+    for(j = 0; j < p->nbSamplers; ++j) {
+      char name[16];
+      snprintf(name, sizeof name, "t%u", j);
+      glUniform1i(glGetUniformLocation(p->pId, name), j);
+      glActiveTexture(GL_TEXTURE0 + j);
+      glBindTexture(GL_TEXTURE_2D, nodeTex(g, p->samplers[j]));
+    }
+    gl4dgDraw(fcommGetPlane());
+    for(j = p->nbSamplers; j-- > 0; ) {
+      glActiveTexture(GL_TEXTURE0 + j);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+  }
+  if(g->copyOut) /* la sortie est aussi une entrée du graphe */
+    gl4dfConvTex2Tex(g->pool[g->nodes[g->output - 1].slot], g->out, g->flipV);
+  fcommEnd();
+  GL4D_PROF_END();
+}
+
+/*!\brief un nœud à voisinage lit son entrée en plusieurs points. */
+static GLboolean isStencil(gnode_e type) {
+  return type == GN_SOBEL || type == GN_MEDIAN || type == GN_BLUR_V || type == GN_BLUR_H;
+}
+
+/*!\brief ajoute les nœuds matérialisés lus par l'arbre fusionné de
+ * \a node aux textures de la passe \a p. */
+static void passSamplers(graph_t * g, gpass_t * p, GLuint node) {
+  gnode_t * n = &g->nodes[node - 1];
+  GLuint i, k;
+  for(i = 0; i < 2 && n->in[i]; ++i) {
+    if(g->nodes[n->in[i] - 1].fused) {
+      passSamplers(g, p, n->in[i]);
+      continue;
+    }
+    for(k = 0; k < p->nbSamplers; ++k)
+      if(p->samplers[k] == n->in[i])
+	break;
+    if(k == p->nbSamplers) {
+      assert(k < GRAPH_MAX_SAMPLERS);
+      p->samplers[p->nbSamplers++] = n->in[i];
+    }
+  }
+}
+
+/*!\brief textures intermédiaires, comme les _tempTexId des filtres. */
+static void genTextures(GLsizei n, GLuint * tex) {
+  GLint ctex;
+  GLsizei i;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
+  glGenTextures(n, tex);
+  for(i = 0; i < n; ++i) {
+    glBindTexture(GL_TEXTURE_2D, tex[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  }
+  glBindTexture(GL_TEXTURE_2D, ctex);
+}
+
+/*!\brief compile le graphe : décisions de fusion, liste des passes,
+ * durées de vie et affectation des textures intermédiaires,
+ * programmes. */
+static void compile(graph_t * g) {
+  GLuint i, j, k, nbSlots = 0, * freeSlots;
+  GLint nbFree = 0;
+  gnode_t * n;
+  for(i = 0; i < g->nbNodes; ++i) {
+    n = &g->nodes[i];
+    n->uses = n->lastPass = n->leaves = 0;
+    n->slot = -1;
+    n->reachable = n->fused = GL_FALSE;
+    n->stencil = isStencil(n->type);
+  }
+  /* les entrées d'un nœud le précèdent : un parcours à rebours suffit */
+  g->nodes[g->output - 1].reachable = GL_TRUE;
+  for(i = g->output; i-- > 0; ) {
+    if(!(n = &g->nodes[i])->reachable) continue;
+    for(j = 0; j < 2 && n->in[j]; ++j) {
+      g->nodes[n->in[j] - 1].reachable = GL_TRUE;
+      g->nodes[n->in[j] - 1].uses++;
+    }
+  }
+  /* fusion : le consommateur unique de chaque nœud décide. n->stencil
+   * devient « l'arbre fusionné de n contient un voisinage ». */
+  for(i = 0; i < g->output; ++i) {
+    if(!(n = &g->nodes[i])->reachable) continue;
+    for(j = 0; j < 2 && n->in[j]; ++j) {
+      gnode_t * in = &g->nodes[n->in[j] - 1];
+      in->fused = in->type != GN_INPUT && in->type != GN_FILTER && n->type != GN_FILTER &&
+	in->uses == 1 && !(isStencil(n->type) && in->stencil) &&
+	n->leaves + in->leaves <= GRAPH_MAX_SAMPLERS;
+      if(in->fused) {
+	n->leaves += in->leaves;
+	n->stencil = n->stencil || in->stencil;
+      } else
+	n->leaves++;
+    }
+  }
+  /* une passe par nœud calculé non fusionné */
+  g->passes = realloc(g->passes, g->output * sizeof *g->passes);
+  assert(g->passes);
+  g->nbPasses = 0;
+  for(i = 0; i < g->output; ++i) {
+    n = &g->nodes[i];
+    if(!n->reachable || n->fused || (n->type == GN_INPUT && i + 1 != g->output)) continue;
+    memset(&g->passes[g->nbPasses], 0, sizeof *g->passes);
+    g->passes[g->nbPasses].node = i + 1;
+    if(n->type == GN_INPUT) /* graphe trivial : une copie */
+      g->passes[g->nbPasses].samplers[g->passes[g->nbPasses].nbSamplers++] = i + 1;
+    else
+      passSamplers(g, &g->passes[g->nbPasses], i + 1);
+    for(k = 0; k < g->passes[g->nbPasses].nbSamplers; ++k)
+      g->nodes[g->passes[g->nbPasses].samplers[k] - 1].lastPass = g->nbPasses;
+    ++g->nbPasses;
+  }
+  /* la dernière passe écrit dans la sortie, sauf si celle-ci est lue
+   * par le graphe (hors filtre, qui gère ce cas lui-même) */
+  g->copyOut = GL_FALSE;
+  if(g->out && g->nodes[g->output - 1].type != GN_FILTER)
+    for(i = 0; i < g->output; ++i)
+      if(g->nodes[i].reachable && g->nodes[i].type == GN_INPUT && g->nodes[i].tex == g->out)
+	g->copyOut = GL_TRUE;
+  /* affectation des textures intermédiaires selon les durées de vie :
+   * la sortie d'une passe est prise avant de libérer ses entrées */
+  freeSlots = malloc(g->nbPasses * sizeof *freeSlots);
+  assert(freeSlots || !g->nbPasses);
+  for(i = 0; i < g->nbPasses; ++i) {
+    n = &g->nodes[g->passes[i].node - 1];
+    if(i + 1 < g->nbPasses || g->copyOut)
+      n->slot = nbFree ? (GLint)freeSlots[--nbFree] : (GLint)nbSlots++;
+    for(k = 0; k < g->passes[i].nbSamplers; ++k) {
+      gnode_t * in = &g->nodes[g->passes[i].samplers[k] - 1];
+      if(in->lastPass == i && in->slot >= 0)
+	freeSlots[nbFree++] = in->slot;
+    }
+  }
+  free(freeSlots);
+  if(nbSlots > g->poolSize) {
+    g->pool = realloc(g->pool, nbSlots * sizeof *g->pool);
+    assert(g->pool);
+    genTextures(nbSlots - g->poolSize, &g->pool[g->poolSize]);
+    g->poolSize = nbSlots;
+  }
+  for(i = 0; i < g->nbPasses; ++i)
+    if(g->nodes[g->passes[i].node - 1].type != GN_FILTER)
+      g->passes[i].pId = passProgram(g, &g->passes[i]);
+  g->dirty = GL_FALSE;
+}
+
+static void srcPrintf(gsrc_t * b, const char * format, ...) {
+  va_list pa;
+  int n;
+  for(;;) {
+    va_start(pa, format);
+    n = vsnprintf(b->s + b->len, b->size - b->len, format, pa);
+    va_end(pa);
+    assert(n >= 0);
+    if(b->len + n < b->size)
+      break;
+    b->s = realloc(b->s, b->size = 2 * (b->len + n + 1));
+    assert(b->s);
+  }
+  b->len += n;
+}
+
+/*!\brief écrit la fonction GLSL \c fK(vec2 tc) du nœud \a node et,
+ * avant elle, celles de son arbre fusionné. \a names reçoit, pour
+ * chaque nœud, l'indice de sa fonction ; les textures de la passe sont
+ * les fonctions \c sK.
+ *
+ * \return le numéro de la fonction générée.
+ */
+static GLuint genNode(graph_t * g, gpass_t * p, gsrc_t * b, GLuint node, GLuint * nbFuncs) {
+  static const char * ops[] = {
+    "c0 + c1", "c0 - c1", "c0 * c1", "c0 / c1", "(length(c1) > 0.0) ? c1 : c0"
+  };
+  gnode_t * n = &g->nodes[node - 1];
+  char a[2][16];
+  GLuint i, k, f;
+  for(i = 0; i < 2; ++i) {
+    if(!n->in[i]) continue;
+    if(g->nodes[n->in[i] - 1].fused)
+      snprintf(a[i], sizeof a[i], "f%u", genNode(g, p, b, n->in[i], nbFuncs));
+    else {
+      for(k = 0; p->samplers[k] != n->in[i]; ++k);
+      snprintf(a[i], sizeof a[i], "s%u", k);
+    }
+  }
+  f = (*nbFuncs)++;
+  switch(n->type) {
+  case GN_INPUT:
+    return f; /* non atteint, voir passProgram */
+  case GN_OP:
+    srcPrintf(b, "vec4 f%u(vec2 tc) {\n"
+	      "  vec4 c0 = %s(tc), c1 = %s(tc);\n"
+	      "  return clamp(%s, 0.0, 1.0);\n"
+	      "}\n", f, a[0], a[1], ops[n->op]);
+    break;
+  case GN_SOBEL:
+    srcPrintf(b, "vec4 f%u(vec2 tc) {\n"
+	      "  vec2 r = vec2(0.0), g = vec2(0.0), b = vec2(0.0);\n"
+	      "  vec4 c;\n"
+	      "  for(int i = 0; i < ossize; i++) {\n"
+	      "    vec4 s = %s(tc + offset[i]);\n"
+	      "    if(i == 4) c = s;\n"
+	      "    r += s.r * sobelG[i]; g += s.g * sobelG[i]; b += s.b * sobelG[i];\n"
+	      "  }\n"
+	      "  vec3 e = vec3(length(r), length(g), length(b));\n", f, a[0]);
+    if(n->invResult)
+      srcPrintf(b, "  e = vec3(1.0) - e;\n");
+    if(n->luminance)
+      srcPrintf(b, "  e = vec3(dot(vec3(0.299, 0.587, 0.114), e));\n");
+    if(n->mixMode == 0)
+      srcPrintf(b, "  return clamp(vec4(e, c.a), 0.0, 1.0);\n}\n");
+    else if(n->mixMode == 1)
+      srcPrintf(b, "  return clamp(vec4(mix(c.rgb, e, %.9e), c.a), 0.0, 1.0);\n}\n", n->mixFactor);
+    else
+      srcPrintf(b, "  return clamp(vec4(c.rgb * e, c.a), 0.0, 1.0);\n}\n");
+    break;
+  case GN_MEDIAN:
+    srcPrintf(b, "vec4 f%u(vec2 tc) {\n"
+	      "  vec4 e[ossize], c;\n"
+	      "  for(int i = 0, j; i < ossize; i++) {\n"
+	      "    c.rgb = %s(tc + offset[i]).rgb;\n"
+	      "    c.a = dot(c.rgb, c.rgb);\n"
+	      "    for(j = 0; j < i; j++)\n"
+	      "      if(c.a > e[j].a) break;\n"
+	      "    for(int k = i - 1; k >= j; k--)\n"
+	      "      e[k + 1] = e[k];\n"
+	      "    e[j] = c;\n"
+	      "  }\n"
+	      "  return vec4(e[4].rgb, 1.0);\n"
+	      "}\n", f, a[0]);
+    break;
+  case GN_BLUR_V:
+  case GN_BLUR_H: {
+    const GLfloat * w = &weights[(n->radius * (n->radius - 1)) >> 1];
+    srcPrintf(b, "const float w%u[%d] = float[](", f, n->radius);
+    for(i = 0; i < (GLuint)n->radius; ++i)
+      srcPrintf(b, i ? ", %.9e" : "%.9e", w[i]);
+    srcPrintf(b, ");\n"
+	      "vec4 f%u(vec2 tc) {\n"
+	      "  vec4 c = %s(tc) * w%u[0];\n"
+	      "  for(int i = 1; i < %d; i++) {\n"
+	      "    vec2 d = vec2(%s);\n"
+	      "    c += (%s(tc + d) + %s(tc - d)) * w%u[i];\n"
+	      "  }\n"
+	      "  return clamp(c, 0.0, 1.0);\n"
+	      "}\n", f, a[0], f, n->radius,
+	      n->type == GN_BLUR_V ? "0.0, float(i) * step.y" : "float(i) * step.x, 0.0",
+	      a[0], a[0], f);
+    break;
+  }
+  case GN_FILTER:
+    assert(0);
+    break;
+  }
+  return f;
+}
+
+/*!\brief génère la source de la passe \a p et retourne le programme
+ * correspondant, pris dans le cache s'il existe. */
+static GLuint passProgram(graph_t * g, gpass_t * p) {
+  gsrc_t b = { NULL, 0, 0 };
+  GLuint i, f = 0, hash = 2166136261u;
+  const char * s;
+  char * imfs;
+  srcPrintf(&b, "uniform vec2 step;\n"
+	    "in  vec2 vsoTexCoord;\n"
+	    "out vec4 fragColor;\n"
+	    "#include \"gl4df/neighbours3x3.glsl\"\n"
+	    "const vec2 sobelG[ossize] = vec2[](vec2(1.0,  1.0), vec2(0.0,  2.0), vec2(-1.0,  1.0),\n"
+	    "                                   vec2(2.0,  0.0), vec2(0.0,  0.0), vec2(-2.0,  0.0),\n"
+	    "                                   vec2(1.0, -1.0), vec2(0.0, -2.0), vec2(-1.0, -1.0));\n");
+  for(i = 0; i < p->nbSamplers; ++i)
+    srcPrintf(&b, "uniform sampler2D t%u;\n"
+	      "vec4 s%u(vec2 tc) { return texture(t%u, tc); }\n", i, i, i);
+  if(g->nodes[p->node - 1].type == GN_INPUT)
+    srcPrintf(&b, "void main(void) {\n  fragColor = s0(vsoTexCoord);\n}\n");
+  else
+    srcPrintf(&b, "void main(void) {\n  fragColor = f%u(vsoTexCoord);\n}\n", genNode(g, p, &b, p->node, &f));
+  for(s = b.s; *s; ++s)
+    hash = (hash ^ (GLubyte)*s) * 16777619u;
+  for(i = 0; i < _nbProgs; ++i)
+    if(_progs[i].hash == hash && !strcmp(_progs[i].src, b.s)) {
+      free(b.s);
+      return _progs[i].pId;
+    }
+  imfs = malloc(b.len + 64);
+  assert(imfs);
+  sprintf(imfs, "<imfs>gl4df_graph%u.fs</imfs>\n"
+#ifdef __GLES4D__
+	  "#version 300 es\n"
+#else
+	  "#version 330\n"
+#endif
+	  "%s", _progName++, b.s);
+  if(_nbProgs == _sizeProgs) {
+    _progs = realloc(_progs, (_sizeProgs = _sizeProgs ? 2 * _sizeProgs : 16) * sizeof *_progs);
+    assert(_progs);
+  }
+  _progs[_nbProgs].hash = hash;
+  _progs[_nbProgs].src = b.s;
+  _progs[_nbProgs].pId = gl4duCreateProgram(gl4dfBasicVS, imfs, NULL);
+  free(imfs);
+  return _progs[_nbProgs++].pId;
+}
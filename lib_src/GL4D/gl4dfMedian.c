@@ -11,6 +11,7 @@
 #include "gl4du.h"
 #include "gl4df.h"
 #include "gl4dfCommon.h"
+#include "gl4duProfile.h"
 
 static GLuint _medianPId = 0, _tempTexId[3] = {0};
 
@@ -20,7 +21,9 @@ static void quit(void);
 MKFWINIT4(median, void, GLuint, GLuint, GLuint, GLboolean);
 
 void gl4dfMedian(GLuint in, GLuint out, GLuint nb_iterations, GLboolean flipV) {
+  GL4D_PROF_BEGIN("gl4dfMedian");
   medianfptr(in, out, nb_iterations, flipV);
+  GL4D_PROF_END();
 }
 
 /* appelée la première fois */
@@ -32,18 +35,10 @@ static void medianfinit(GLuint in, GLuint out, GLuint nb_iterations, GLboolean f
 
 /* appelée les autres fois (après la première qui lance init) */
 static void medianffunc(GLuint in, GLuint out, GLuint nb_iterations, GLboolean flipV) {
-  GLuint rout = out, fbo, flipflop[2];
-  GLint vp[4], w, h, cfbo, ctex, cpId;
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out, flipflop[2];
+  GLint w, h;
   GLuint i;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
   if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
     fcommMatchTex(in = _tempTexId[0], 0);
     gl4dfConvFrame2Tex(&_tempTexId[0]);
@@ -52,8 +47,8 @@ static void medianffunc(GLuint in, GLuint out, GLuint nb_iterations, GLboolean f
     gl4dfConvTex2Tex(out, _tempTexId[0], GL_FALSE);
   }
   if(out == 0) { /* Pas de sortie, donc sortie aux dimensions du viewport */
-    w = vp[2];// - vp[0];
-    h = vp[3];// - vp[1];
+    w = st->vp[2];// - vp[0];
+    h = st->vp[3];// - vp[1];
     fcommMatchTex(rout = _tempTexId[1], out);
   } else {
     glBindTexture(GL_TEXTURE_2D, out);
@@ -63,22 +58,16 @@ static void medianffunc(GLuint in, GLuint out, GLuint nb_iterations, GLboolean f
   fcommMatchTex(_tempTexId[2], rout);
   flipflop[!(nb_iterations&1)] = rout;
   flipflop[nb_iterations&1] = _tempTexId[2];
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  if(dt) glDisable(GL_DEPTH_TEST);
-  if(bl) glDisable(GL_BLEND);
-  glViewport(0, 0, w, h);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
+  fcommDrawState(GL_FALSE);
+  fcommViewport(0, 0, w, h); {
     GLfloat step[2] = { 1.0f / (w - 1.0f), 1.0f / (h - 1.0f) };
-    glUseProgram(_medianPId);
+    fcommUseProgram(_medianPId);
     glUniform1i(glGetUniformLocation(_medianPId,  "myTex"), 0);
     glUniform1i(glGetUniformLocation(_medianPId,  "inv"), flipV);
     glUniform2fv(glGetUniformLocation(_medianPId,  "step"), 1, step);
     glActiveTexture(GL_TEXTURE0);
     for(i = 0; i < nb_iterations; ++i) {
-      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, flipflop[i&1],  0);
+      fcommFramebuffer(GL_FRAMEBUFFER, flipflop[i&1], 0);
       glBindTexture(GL_TEXTURE_2D, (i == 0) ? in : flipflop[!(i&1)]);
       gl4dgDraw(fcommGetPlane());
       glUniform1i(glGetUniformLocation(_medianPId,  "inv"), 0);
@@ -87,19 +76,11 @@ static void medianffunc(GLuint in, GLuint out, GLuint nb_iterations, GLboolean f
   }
 
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, w, h, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, w, h, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   }
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
-  glUseProgram(cpId);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(bl) glEnable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
@@ -40,17 +40,9 @@ static void opfinit(GLuint in1, GLuint in2, GLuint out, GLboolean flipV) {
 
 /* appelée les autres fois (après la première qui lance init) */
 static void opffunc(GLuint in1, GLuint in2, GLuint out, GLboolean flipV) {
-  GLuint fbo, rout = out;
-  GLint vp[4], w, h, cpId, cfbo, ctex;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out;
+  GLint w, h;
 
   /* vérifier toutes les dimensions */
   if( out == 0 /* pas de sortie, donc la sortie est l'écran */ ||
@@ -68,16 +60,10 @@ static void opffunc(GLuint in1, GLuint in2, GLuint out, GLboolean flipV) {
   glBindTexture(GL_TEXTURE_2D, rout);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
-  if(!bl) glEnable(GL_BLEND);
-  if(dt) glDisable(GL_DEPTH_TEST);
-#ifndef __GLES4D__
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  glViewport(0, 0, w, h);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rout,  0);
-    glUseProgram(_opPId);
+  fcommDrawState(GL_TRUE);
+  fcommViewport(0, 0, w, h); {
+    fcommFramebuffer(GL_FRAMEBUFFER, rout, 0);
+    fcommUseProgram(_opPId);
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, in1);
     glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, in2);
     glUniform1i(glGetUniformLocation(_opPId,  "tex0"), 0);
@@ -90,20 +76,11 @@ static void opffunc(GLuint in1, GLuint in2, GLuint out, GLboolean flipV) {
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, 0);
   }
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, w, h, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, w, h, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
   } else if(rout == _tempTexId[2])
     gl4dfConvTex2Tex(_tempTexId[2], out, GL_FALSE);
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glUseProgram(cpId);
-  glBindFramebuffer(GL_FRAMEBUFFER, cfbo);
-  glBindTexture(GL_TEXTURE_2D, ctex);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(!bl) glDisable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
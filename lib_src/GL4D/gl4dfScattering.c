@@ -36,17 +36,9 @@ static void scatteringfinit(GLuint in, GLuint out, GLuint radius, GLuint displac
 }
 
 static void scatteringffunc(GLuint in, GLuint out, GLuint radius, GLuint displacementmap, GLuint weightmap, GLboolean flipV) {
-  GLuint rout = out, fbo;
-  GLint vp[4], w, h, cfbo, ctex, cpId;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out;
+  GLint w, h;
   if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
     fcommMatchTex(in = _tempTexId[0], 0);
     gl4dfConvFrame2Tex(&_tempTexId[0]);
@@ -55,8 +47,8 @@ static void scatteringffunc(GLuint in, GLuint out, GLuint radius, GLuint displac
     gl4dfConvTex2Tex(out, _tempTexId[0], GL_FALSE);
   }
   if(out == 0) { /* Pas de sortie, donc sortie aux dimensions du viewport */
-    w = vp[2];// - vp[0];
-    h = vp[3];// - vp[1];
+    w = st->vp[2];// - vp[0];
+    h = st->vp[3];// - vp[1];
     fcommMatchTex(rout = _tempTexId[1], out);
   } else {
     glBindTexture(GL_TEXTURE_2D, out);
@@ -65,17 +57,11 @@ static void scatteringffunc(GLuint in, GLuint out, GLuint radius, GLuint displac
   }
   if((GLuint)w != _width || (GLuint)h != _height)
     setDimensions(w, h);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  if(dt) glDisable(GL_DEPTH_TEST);
-  if(bl) glDisable(GL_BLEND);
-  glViewport(0, 0, w, h);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
+  fcommDrawState(GL_FALSE);
+  fcommViewport(0, 0, w, h); {
     GLfloat d[] = {radius / (GLfloat)_width, radius / (GLfloat)_height};
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rout,  0);
-    glUseProgram(_scatteringPId);
+    fcommFramebuffer(GL_FRAMEBUFFER, rout, 0);
+    fcommUseProgram(_scatteringPId);
     glUniform1i(glGetUniformLocation(_scatteringPId,  "myTexture"), 0);
     glUniform1i(glGetUniformLocation(_scatteringPId,  "noiseTexture"), 1);
     glUniform1i(glGetUniformLocation(_scatteringPId,  "wmTexture"), 2);
@@ -106,19 +92,11 @@ static void scatteringffunc(GLuint in, GLuint out, GLuint radius, GLuint displac
     glBindTexture(GL_TEXTURE_2D, 0);
   }
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, _width, _height, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, _width, _height, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   }
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
-  glUseProgram(cpId);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(bl) glEnable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
@@ -1,9 +1,184 @@
-/*!\file gl4dfOpticalFlow.c
+/*!\file gl4dfSegmentation.c
  *
  * \brief filres de segmentation d'images à partir d'une texture ou
  * l'écran vers une texture ou l'écran.
  *
+ * Les régions sont les composantes connexes de pixels de luminances
+ * voisines, étiquetées en CPU (voir gl4dfCCL.c).
+ *
  * \author Farès BELHADJ amsi@ai.univ-paris8.fr
  * \date April 21, 2016
- * 
+ *
  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "gl4du.h"
+#include "gl4df.h"
+#include "gl4dfCommon.h"
+#include "gl4dfCCL.h"
+#include "gl4duProfile.h"
+#include "thread_pool.h"
+
+static GLfloat _lowTh = 0.0f, _tolerance = 0.04f;
+static GLuint _connectivity = 4, _tempTexId[2] = {0}, _nbComponents = 0;
+static GLboolean _isMean = GL_FALSE;
+static GLubyte * _pixmap = NULL;
+static size_t _pixmapSize = 0;
+static GLint _w = 0, _h = 0;
+static GLboolean _flipV = GL_FALSE;
+static ccl_t * _ccl = NULL;
+
+static void init(void);
+static void quit(void);
+
+MKFWINIT3(segmentation, void, GLuint, GLuint, GLboolean);
+
+void gl4dfSegmentation(GLuint in, GLuint out, GLboolean flipV) {
+  GL4D_PROF_BEGIN("gl4dfSegmentation");
+  segmentationfptr(in, out, flipV);
+  GL4D_PROF_END();
+}
+
+void gl4dfSegmentationSetResultMode(GL4DFenum mode) {
+  switch(mode) {
+  case GL4DF_SEGMENTATION_RESULT_LABELS:
+    _isMean = GL_FALSE;
+    break;
+  case GL4DF_SEGMENTATION_RESULT_MEAN:
+    _isMean = GL_TRUE;
+    break;
+  default:
+    fprintf(stderr, "%s: this value (%d) has no effect\n", __func__, mode);
+    break;
+  }
+}
+
+void gl4dfSegmentationSetThreshold(GLfloat th) {
+  _lowTh = th;
+}
+
+void gl4dfSegmentationSetTolerance(GLfloat tolerance) {
+  _tolerance = tolerance;
+}
+
+void gl4dfSegmentationSetConnectivity(GLuint connectivity) {
+  if(connectivity != 4 && connectivity != 8) {
+    fprintf(stderr, "%s: this value (%u) has no effect\n", __func__, connectivity);
+    return;
+  }
+  _connectivity = connectivity;
+}
+
+GLuint gl4dfSegmentationGetComponents(const GL4DFcomponent ** components) {
+  if(components)
+    *components = _ccl ? cclGetComponents(_ccl) : NULL;
+  return _nbComponents;
+}
+
+static GLubyte toByte(GLfloat v) {
+  return v <= 0.0f ? 0 : (v >= 1.0f ? 255 : (GLubyte)(v * 255.0f + 0.5f));
+}
+
+/*!\brief luminance de la ligne \a y, rangée dans la composante alpha. */
+static void luminanceRow(size_t y, GLuint thread, void * data) {
+  GLubyte * p = &_pixmap[4 * y * _w], * e = p + 4 * _w;
+  (void)thread; (void)data;
+  for(; p < e; p += 4)
+    p[3] = (GLubyte)((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+}
+
+/*!\brief couleurs de la ligne \a y du résultat (lue, si _flipV, dans
+ * la ligne symétrique des étiquettes). */
+static void resultRow(size_t y, GLuint thread, void * data) {
+  const GLuint * l = &cclGetLabels(_ccl)[(_flipV ? _h - 1 - y : y) * _w];
+  const GL4DFcomponent * comps = cclGetComponents(_ccl);
+  GLubyte * p = &_pixmap[4 * y * _w];
+  GLint x;
+  (void)thread; (void)data;
+  for(x = 0; x < _w; ++x, p += 4) {
+    if(!l[x]) {
+      p[0] = p[1] = p[2] = 0;
+    } else if(_isMean) {
+      p[0] = p[1] = p[2] = toByte(comps[l[x] - 1].mean);
+    } else {
+      GLuint c = l[x] * 2654435761u;
+      p[0] = (GLubyte)(c >> 24);
+      p[1] = (GLubyte)(c >> 16);
+      p[2] = (GLubyte)(c >> 8);
+    }
+    p[3] = 255;
+  }
+}
+
+/* appelée la première fois */
+static void segmentationfinit(GLuint in, GLuint out, GLboolean flipV) {
+  init();
+  segmentationfptr = segmentationffunc;
+  segmentationfptr(in, out, flipV);
+}
+
+/* appelée les autres fois (après la première qui lance init) */
+static void segmentationffunc(GLuint in, GLuint out, GLboolean flipV) {
+  size_t size;
+  fcommBegin();
+  if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
+    fcommMatchTex(in = _tempTexId[0], 0);
+    gl4dfConvFrame2Tex(&_tempTexId[0]);
+  }
+  glBindTexture(GL_TEXTURE_2D, in);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &_w);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &_h);
+  if((size = 4 * (size_t)_w * _h) > _pixmapSize) {
+    _pixmap = realloc(_pixmap, size);
+    assert(_pixmap);
+    _pixmapSize = size;
+  }
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pixmap);
+  tpoolFor(_h, luminanceRow, NULL);
+  _nbComponents = cclLabel(_ccl, _pixmap + 3, _w, _h, 4, toByte(_lowTh), toByte(_tolerance), _connectivity);
+  _flipV = flipV;
+  tpoolFor(_h, resultRow, NULL);
+  glBindTexture(GL_TEXTURE_2D, _tempTexId[1]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _w, _h, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pixmap);
+  if(out)
+    gl4dfConvTex2Tex(_tempTexId[1], out, GL_FALSE);
+  else
+    gl4dfConvTex2Frame(_tempTexId[1]);
+  fcommEnd();
+}
+
+static void init(void) {
+  GLint ctex;
+  GLuint i;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
+  if(!_tempTexId[0])
+    glGenTextures((sizeof _tempTexId / sizeof *_tempTexId), _tempTexId);
+  for(i = 0; i < (sizeof _tempTexId / sizeof *_tempTexId); ++i) {
+    glBindTexture(GL_TEXTURE_2D, _tempTexId[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  }
+  glBindTexture(GL_TEXTURE_2D, ctex);
+  if(!_ccl) {
+    _ccl = cclNew();
+    gl4duAtExit(quit);
+  }
+}
+
+static void quit(void) {
+  if(_tempTexId[0]) {
+    glDeleteTextures((sizeof _tempTexId / sizeof *_tempTexId), _tempTexId);
+    _tempTexId[0] = 0;
+  }
+  cclDelete(_ccl);
+  _ccl = NULL;
+  free(_pixmap);
+  _pixmap = NULL;
+  _pixmapSize = 0;
+  _nbComponents = 0;
+  segmentationfptr = segmentationfinit;
+}
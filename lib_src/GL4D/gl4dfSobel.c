@@ -86,17 +86,9 @@ static void sobelfinit(GLuint in, GLuint out, GLboolean flipV) {
 
 /* appelée les autres fois (après la première qui lance init) */
 static void sobelffunc(GLuint in, GLuint out, GLboolean flipV) {
-  GLuint rout = out, fbo;
-  GLint vp[4], w, h, cfbo, ctex, cpId;
-  GLboolean dt = glIsEnabled(GL_DEPTH_TEST), bl = glIsEnabled(GL_BLEND);
-#ifndef __GLES4D__
-  GLint polygonMode[2];
-  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
-#endif
-  glGetIntegerv(GL_VIEWPORT, vp);
-  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &cfbo);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &ctex);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &cpId);
+  const fcommstate_t * st = fcommBegin();
+  GLuint rout = out;
+  GLint w, h;
   if(in == 0) { /* Pas d'entrée, donc l'entrée est le dernier draw */
     fcommMatchTex(in = _tempTexId[0], 0);
     gl4dfConvFrame2Tex(&_tempTexId[0]);
@@ -105,25 +97,19 @@ static void sobelffunc(GLuint in, GLuint out, GLboolean flipV) {
     gl4dfConvTex2Tex(out, _tempTexId[0], GL_FALSE);
   }
   if(out == 0) { /* Pas de sortie, donc sortie aux dimensions du viewport */
-    w = vp[2];// - vp[0];
-    h = vp[3];// - vp[1];
+    w = st->vp[2];// - vp[0];
+    h = st->vp[3];// - vp[1];
     fcommMatchTex(rout = _tempTexId[1], out);
   } else {
     glBindTexture(GL_TEXTURE_2D, out);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
   }
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
-  if(dt) glDisable(GL_DEPTH_TEST);
-  if(bl) glDisable(GL_BLEND);
-  glViewport(0, 0, w, h);
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo); {
+  fcommDrawState(GL_FALSE);
+  fcommViewport(0, 0, w, h); {
     GLfloat step[] = {1.0f / (GLfloat)w, 1.0f / (GLfloat)h};
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rout,  0);
-    glUseProgram(_sobelPId);
+    fcommFramebuffer(GL_FRAMEBUFFER, rout, 0);
+    fcommUseProgram(_sobelPId);
     glUniform1i(glGetUniformLocation(_sobelPId,  "myTexture"), 0);
     glUniform1i(glGetUniformLocation(_sobelPId,  "inv"), flipV);
     glUniform1i(glGetUniformLocation(_sobelPId,  "width"), w);
@@ -140,19 +126,11 @@ static void sobelffunc(GLuint in, GLuint out, GLboolean flipV) {
     glBindTexture(GL_TEXTURE_2D, 0);
   }
   if(!out) { /* Copier à l'écran en cas de out nul */
-    glUseProgram(0);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, w, h, vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    fcommUseProgram(0);
+    fcommBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, w, h, st->vp[0], st->vp[1], st->vp[0] + st->vp[2], st->vp[1] + st->vp[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
   }
-  glViewport(vp[0], vp[1], vp[2], vp[3]);
-  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)cfbo);
-  glUseProgram(cpId);
-#ifndef __GLES4D__
-  glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
-#endif
-  if(bl) glEnable(GL_BLEND);
-  if(dt) glEnable(GL_DEPTH_TEST);
-  glDeleteFramebuffers(1, &fbo);
+  fcommEnd();
 }
 
 static void init(void) {
@@ -184,13 +162,10 @@ static void init(void) {
        uniform float mixFactor;\n					\
        in  vec2 vsoTexCoord;\n	      \
        out vec4 fragColor;\n	      \
-       const int ossize = 9;\n						\
+       #include \"gl4df/neighbours3x3.glsl\"\n			\
        const vec2 G[ossize] = vec2[]( vec2(1.0,  1.0), vec2(0.0,  2.0), vec2(-1.0,  1.0),\n \
                                       vec2(2.0,  0.0), vec2(0.0,  0.0), vec2(-2.0,  0.0),\n \
                                       vec2(1.0, -1.0), vec2(0.0, -2.0), vec2(-1.0, -1.0) );\n \
-       vec2 offset[ossize] = vec2[](vec2(-step.x , -step.y), vec2( 0.0, -step.y), vec2( step.x , -step.y),\n \
-                                    vec2(-step.x, 0.0),        vec2( 0.0, 0.0),     vec2( step.x, 0.0),\n \
-                                    vec2(-step.x,   step.y),  vec2( 0.0, step.y), vec2( step.x ,  step.y) );\n	\
        vec3 sobel(sampler2D s, vec2 c) {\n				\
          vec2 r = vec2(0.0, 0.0), g = vec2(0.0, 0.0), b = vec2(0.0, 0.0);\n \
          for(int i = 0; i < ossize; i++) {\n				\
@@ -214,6 +189,7 @@ static void init(void) {
          else\n								\
            fragColor = vec4(c.rgb * r, c.a);\n				\
        }";
+    fcommShaderIncludes();
     _sobelPId = gl4duCreateProgram(gl4dfBasicVS, imfs, NULL);
     gl4duAtExit(quit);
   }
@@ -12,43 +12,65 @@
 #include <math.h>
 #include "linked_list.h"
 #include "gl4dg.h"
+#include "gl4du.h"
+#include "gl4duProfile.h"
 #include "gl4dm.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
+/*!\brief taille du cache post-transformation simulé par
+ * optimizeVertexCache. */
+#define VCACHE_SIZE 32
+
 /*!\brief permet de sélectionner une topologie à utiliser selon le
  * niveau d'optimisation géométrique choisie. */
-#define SELECT_GEOMETRY_OPTIMIZATION(index, geom, w, h) do {		\
+#define SELECT_GEOMETRY_OPTIMIZATION(index, geom, w, h, data, stride) do { \
     switch(_geometry_optimization_level) {				\
     case 0:								\
       (index) = mkRegularGridTriangleIndices((w), (h));			\
       (geom)->index_mode = GL_TRIANGLES;				\
       (geom)->index_row_count = 6 * ((w) - 1) * ((h) - 1);		\
       (geom)->index_nb_rows = 1;					\
+      (geom)->index_row_stride = (geom)->index_row_count;		\
       break;								\
     case 1:								\
       (index) = mkRegularGridStripsIndices((w), (h));			\
       (geom)->index_mode = GL_TRIANGLE_STRIP;				\
       (geom)->index_row_count = 2 * (w);				\
       (geom)->index_nb_rows = ((h) - 1);				\
+      (index) = joinStrips((index), (geom)->index_row_count, (geom)->index_nb_rows); \
+      (geom)->index_row_stride = (geom)->index_row_count + 2;		\
       break;								\
     case 2:								\
       index = mkRegularGridStripIndices((w), (h));			\
       (geom)->index_mode = GL_TRIANGLE_STRIP;				\
       (geom)->index_row_count = 2 * (w) * ((h) - 1);			\
       (geom)->index_nb_rows = 1;					\
+      (geom)->index_row_stride = (geom)->index_row_count;		\
       break;								\
     case 3:								\
       index = mkRegularGridTriangleAdjacencyIndices((w), (h));		\
       (geom)->index_mode = GL_TRIANGLES_ADJACENCY;			\
       (geom)->index_row_count = 12 * ((w) - 1) * ((h) - 1);		\
       (geom)->index_nb_rows = 1;					\
+      (geom)->index_row_stride = (geom)->index_row_count;		\
+      break;								\
+    case 5:								\
+      (index) = mkRegularGridTriangleIndices((w), (h));			\
+      (geom)->index_mode = GL_TRIANGLES;				\
+      (geom)->index_row_count = 6 * ((w) - 1) * ((h) - 1);		\
+      (geom)->index_nb_rows = 1;					\
+      (geom)->index_row_stride = (geom)->index_row_count;		\
+      optimizeVertexCache((index), (geom)->index_row_count, (data), (stride), (w) * (h)); \
       break;								\
     default: /* GL_TRIANGLE_STRIP_ADJACENCY */				\
       (index) = mkRegularGridStripsAdjacencyIndices((w), (h));		\
       (geom)->index_mode = GL_TRIANGLE_STRIP_ADJACENCY;			\
       (geom)->index_row_count = 4 * (w);				\
       (geom)->index_nb_rows = ((h) - 1);				\
+      (geom)->index_row_stride = (geom)->index_row_count;		\
       break;								\
     }									\
   } while(0)
@@ -58,10 +80,27 @@
     int i, d;								\
     for(i = 0, d = 0; i <  (geom)->index_nb_rows; ++i) {		\
       glDrawElements((geom)->index_mode, (geom)->index_row_count, GL4D_VAO_INDEX, (const GLvoid *)(intptr_t)d); \
-      d += (geom)->index_row_count * sizeof(GL4Dvaoindex);		\
+      d += (geom)->index_row_stride * sizeof(GL4Dvaoindex);		\
     }									\
   } while(0)
 
+/*!\brief nombre total d'indices de l'element-array de l'objet. */
+#define INDEX_COUNT(geom) ((geom)->index_row_stride * ((geom)->index_nb_rows - 1) + (geom)->index_row_count)
+
+/*!\brief dessine \a count instances d'un element-array : en un seul
+ * appel, sauf pour les triangle_strips avec adjacence en plusieurs
+ * rangées (un appel par rangée). */
+#define DRAW_INSTANCED_WITH_GEOMETRY_OPTIMIZATION(geom, count) do {	\
+    int i, d;								\
+    if((geom)->index_mode == GL_TRIANGLE_STRIP_ADJACENCY)		\
+      for(i = 0, d = 0; i <  (geom)->index_nb_rows; ++i) {		\
+	glDrawElementsInstanced((geom)->index_mode, (geom)->index_row_count, GL4D_VAO_INDEX, (const GLvoid *)(intptr_t)d, (count)); \
+	d += (geom)->index_row_stride * sizeof(GL4Dvaoindex);		\
+      }									\
+    else								\
+      glDrawElementsInstanced((geom)->index_mode, INDEX_COUNT(geom), GL4D_VAO_INDEX, (const GLvoid *)0, (count)); \
+  } while(0)
+
 typedef struct geom_t geom_t;
 typedef struct gsphere_t gsphere_t;
 typedef struct gstatic_t gstatic_t;
@@ -71,6 +110,9 @@ typedef struct gdisk_t gdisk_t;
 typedef struct gtorus_t gtorus_t;
 typedef struct ggrid2d_t ggrid2d_t;
 typedef struct gteapot_t gteapot_t;
+typedef struct gpacked_t gpacked_t;
+typedef struct garena_t garena_t;
+typedef struct gbatch_t gbatch_t;
 typedef enum   geom_e geom_e;
 
 enum geom_e {
@@ -90,19 +132,57 @@ enum geom_e {
 struct geom_t {
   GLuint id, vao;
   geom_e type;
+  GLuint vsize; /* octets par sommet */
+  /* place dans l'arène (acount nul si l'objet n'y est pas) : indices
+   * [afirst, afirst + acount[ et sommets [avfirst, avfirst + avcount[ */
+  GLuint afirst, acount, avfirst, avcount;
   void * geom;
 };
 
+/*!\brief sommet au format GL4DG_VERTEX_PACKED (16 octets) : position
+ * en half-floats (w = 1), normale en octaèdre sur deux SNORM16 et
+ * coordonnée de texture en UNORM16. */
+struct gpacked_t {
+  GLushort p[4];
+  GLshort n[2];
+  GLushort t[2];
+};
+
+/*!\brief arène : un VAO, un buffer de sommets (8 GLfloat : position,
+ * normale, coordonnée de texture) et un buffer d'indices (triangles,
+ * indices absolus) partagés par les géométries créées en mode arène,
+ * voir \ref gl4dgSetArenaMode. */
+struct garena_t {
+  GLuint vao, buffers[2];
+  GLuint nv, sv; /* sommets utilisés, capacité */
+  GLuint ni, si; /* indices utilisés, capacité */
+};
+
+/*!\brief lot d'objets à dessiner par \ref gl4dgBatchDraw : les
+ * commandes "DrawElementsIndirectCommand" des objets de l'arène, les
+ * autres objets à part. */
+struct gbatch_t {
+  GLuint (*cmds)[5];     /* count, instanceCount, firstIndex, baseVertex, baseInstance */
+  GLuint ncmds, scmds;
+  GLuint (*others)[3];   /* id, instances, première instance */
+  GLuint nothers, sothers;
+  GLuint ninstances;
+  GLuint indirect;       /* buffer GL_DRAW_INDIRECT_BUFFER */
+  GLboolean dirty;       /* commandes modifiées depuis leur envoi */
+};
+
 struct gsphere_t {
   GLuint buffers[2];
   GLuint slices, stacks;
   GLenum index_mode;
   GLsizei index_row_count;
+  GLsizei index_row_stride; /* écart entre deux rangées (indices dégénérés compris) */
   GLsizei index_nb_rows;
 };
 
 struct gstatic_t {
   GLuint buffer;
+  GLuint ibuffer; /* triangles du cube, 0 pour le quad */
 };
 
 struct gcone_t {
@@ -128,6 +208,7 @@ struct gtorus_t {
   GLdouble radius;
   GLenum index_mode;
   GLsizei index_row_count;
+  GLsizei index_row_stride; /* écart entre deux rangées (indices dégénérés compris) */
   GLsizei index_nb_rows;
 };
 
@@ -136,6 +217,7 @@ struct ggrid2d_t {
   GLuint width, height;
   GLenum index_mode;
   GLsizei index_row_count;
+  GLsizei index_row_stride; /* écart entre deux rangées (indices dégénérés compris) */
   GLsizei index_nb_rows;
 };
 
@@ -149,6 +231,10 @@ static GLint _garray_size = 256;
 static linked_list_t * _glist = NULL;
 static int _hasInit = 0;
 static GLuint _geometry_optimization_level = 1;
+static GLuint _vertex_format = GL4DG_VERTEX_FLOAT;
+static GLboolean _arena_mode = GL_FALSE;
+static garena_t * _arena = NULL;
+static gbatch_t _batch = { NULL, 0, 0, NULL, 0, 0, 0, 0, GL_FALSE };
 
 static void            freeGeom(void * data);
 static GLuint          genId(void);
@@ -159,6 +245,7 @@ static GL4Dvaoindex  * mkRegularGridStripsIndices(GLuint width, GLuint height);
 static GL4Dvaoindex  * mkRegularGridStripIndices(GLuint width, GLuint height);
 static GL4Dvaoindex  * mkRegularGridTriangleAdjacencyIndices(GLuint width, GLuint height);
 static GL4Dvaoindex  * mkRegularGridStripsAdjacencyIndices(GLuint width, GLuint height);
+static GL4Dvaoindex  * joinStrips(GL4Dvaoindex * index, GLsizei rowCount, GLsizei nbRows);
 static GLfloat       * mkConeVerticesf(GLuint slices, GLboolean base);
 static GLfloat       * mkFanConeVerticesf(GLuint slices, GLboolean base);
 static GLfloat       * mkCylinderVerticesf(GLuint slices, GLboolean base);
@@ -167,6 +254,15 @@ static GLfloat       * mkTorusVerticesf(GLuint slices, GLuint stacks, GLfloat ra
 static GLfloat       * mkGrid2dVerticesf(GLuint width, GLuint height, GLfloat * heightmap);
 static GLfloat       * mkTeapotVerticesf(GLuint slices);
 static void            mkGrid2dNormalsf(GLuint width, GLuint height, GLfloat * data);
+static void            optimizeVertexCache(GL4Dvaoindex * index, GLuint nindex, GLfloat * data, GLuint stride, GLuint nv);
+static GLuint          vertexBufferf(GLfloat * data, GLuint nv, GLuint stride, GLboolean normals);
+static void            arenaAdd(GLuint i, GLfloat * data, GLuint nv, GLuint stride, GLboolean normals, GL4Dvaoindex * index, GLuint nindex);
+static void            arenaAddGrid(GLuint i, GLfloat * data, GLuint stride, GLboolean normals, GLuint width, GLuint height);
+static void            arenaAddRanges(GLuint i, GLfloat * data, GLuint nv, int nranges, const GLenum * modes, const GLuint * firsts, const GLuint * counts);
+static void            arenaRelease(geom_t * geom);
+static void            arenaFree(void);
+static void            drawInstanced(GLuint id, GLsizei count, GLuint buffer, GLuint first);
+static void            instanceAttribs(GLuint buffer, GLuint first, GLboolean enable);
 static inline void     triangleNormalf(GLfloat * out, GLfloat * p0, GLfloat * p1, GLfloat * p2);
 static inline int      _maxi(int a, int b);
 static inline int      _mini(int a, int b);
@@ -197,6 +293,7 @@ void gl4dgClean(void) {
     free(_garray);
     _garray = NULL;
   }
+  arenaFree();
   _garray_size = 256;
   _hasInit = 0;
 }
@@ -205,6 +302,93 @@ void gl4dgSetGeometryOptimizationLevel(GLuint level) {
   _geometry_optimization_level = level;
 }
 
+void gl4dgSetVertexFormat(GLuint format) {
+  _vertex_format = format;
+  if(format == GL4DG_VERTEX_PACKED)
+    gl4duAddShaderInclude("gl4dg/octahedral.glsl",
+			  "vec3 gl4dgOctDecode(vec2 e) {\n\
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n\
+  float t = max(-n.z, 0.0);\n\
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n\
+  return normalize(n);\n\
+}\n");
+}
+
+GLuint gl4dgGetVertexSize(GLuint id) {
+  return _garray[--id].vsize;
+}
+
+void gl4dgSetArenaMode(GLboolean enable) {
+  _arena_mode = enable;
+}
+
+void gl4dgBatchBegin(void) {
+  _batch.ncmds = _batch.nothers = _batch.ninstances = 0;
+  _batch.dirty = GL_TRUE;
+}
+
+void gl4dgBatchAdd(GLuint id, GLsizei count) {
+  geom_t * g = &_garray[id - 1];
+  if(g->acount) {
+    if(_batch.ncmds == _batch.scmds) {
+      _batch.scmds = _batch.scmds ? _batch.scmds << 1 : 64;
+      _batch.cmds = realloc(_batch.cmds, _batch.scmds * sizeof *_batch.cmds);
+      assert(_batch.cmds);
+    }
+    _batch.cmds[_batch.ncmds][0] = g->acount;
+    _batch.cmds[_batch.ncmds][1] = count;
+    _batch.cmds[_batch.ncmds][2] = g->afirst;
+    _batch.cmds[_batch.ncmds][3] = 0; /* indices absolus */
+    _batch.cmds[_batch.ncmds][4] = _batch.ninstances;
+    _batch.ncmds++;
+  } else {
+    if(_batch.nothers == _batch.sothers) {
+      _batch.sothers = _batch.sothers ? _batch.sothers << 1 : 16;
+      _batch.others = realloc(_batch.others, _batch.sothers * sizeof *_batch.others);
+      assert(_batch.others);
+    }
+    _batch.others[_batch.nothers][0] = id;
+    _batch.others[_batch.nothers][1] = count;
+    _batch.others[_batch.nothers][2] = _batch.ninstances;
+    _batch.nothers++;
+  }
+  _batch.ninstances += count;
+  _batch.dirty = GL_TRUE;
+}
+
+void gl4dgBatchDraw(GLuint buffer) {
+  GLuint i;
+  GL4D_PROF_BEGIN("gl4dgBatchDraw");
+  if(_batch.ncmds) {
+    glBindVertexArray(_arena->vao);
+#ifndef __GLES4D__
+    instanceAttribs(buffer, 0, GL_TRUE);
+    if(!_batch.indirect)
+      glGenBuffers(1, &_batch.indirect);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _batch.indirect);
+    if(_batch.dirty) {
+      glBufferData(GL_DRAW_INDIRECT_BUFFER, _batch.ncmds * sizeof *_batch.cmds, _batch.cmds, GL_DYNAMIC_DRAW);
+      _batch.dirty = GL_FALSE;
+    }
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL4D_VAO_INDEX, (const void *)0, _batch.ncmds, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#else
+    /* pas de glMultiDrawElementsIndirect ni de baseInstance : une
+     * commande par appel, les matrices décalées à la main */
+    for(i = 0; i < _batch.ncmds; ++i) {
+      instanceAttribs(buffer, _batch.cmds[i][4], GL_TRUE);
+      glDrawElementsInstanced(GL_TRIANGLES, _batch.cmds[i][0], GL4D_VAO_INDEX,
+			      (const GLvoid *)(intptr_t)(_batch.cmds[i][2] * sizeof(GL4Dvaoindex)), _batch.cmds[i][1]);
+    }
+#endif
+    instanceAttribs(buffer, 0, GL_FALSE);
+    glBindVertexArray(0);
+  }
+  for(i = 0; i < _batch.nothers; ++i)
+    drawInstanced(_batch.others[i][0] - 1, _batch.others[i][1], buffer, _batch.others[i][2]);
+  GL4D_PROF_END();
+}
+
 GLuint gl4dgGetVAO(GLuint id) {
   return _garray[--id].vao;
 }
@@ -219,7 +403,12 @@ GLuint gl4dgGenSpheref(GLuint slices, GLuint stacks) {
   _garray[i].type = GE_SPHERE;
   s->slices = slices; s->stacks = stacks;
   idata = mkSphereVerticesf(slices, stacks);
-  SELECT_GEOMETRY_OPTIMIZATION(index, s, slices + 1, stacks + 1);
+  if(_arena_mode) {
+    arenaAddGrid(i, idata, 5, GL_FALSE, slices + 1, stacks + 1);
+    free(idata);
+    return ++i;
+  }
+  SELECT_GEOMETRY_OPTIMIZATION(index, s, slices + 1, stacks + 1, idata, 5);
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -227,12 +416,9 @@ GLuint gl4dgGenSpheref(GLuint slices, GLuint stacks) {
   glEnableVertexAttribArray(2);
   glGenBuffers(2, s->buffers);
   glBindBuffer(GL_ARRAY_BUFFER, s->buffers[0]);
-  glBufferData(GL_ARRAY_BUFFER, 5 * (slices + 1) * (stacks + 1) * sizeof *idata, idata, GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (5 * sizeof *idata), (const void *)0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (5 * sizeof *idata), (const void *)0);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (5 * sizeof *idata), (const void *)(3 * sizeof *idata));
+  _garray[i].vsize = vertexBufferf(idata, (slices + 1) * (stacks + 1), 5, GL_FALSE);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s->buffers[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, s->index_row_count * s->index_nb_rows * sizeof *index, index, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, INDEX_COUNT(s) * sizeof *index, index, GL_STATIC_DRAW);
   free(idata);
   free(index);
   glBindVertexArray(0);
@@ -258,6 +444,13 @@ GLuint gl4dgGenConef(GLuint slices, GLboolean base) {
   _garray[i].type = GE_CONE;
   c->slices = slices; c->base = base;
   data = mkConeVerticesf(slices, base);
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN };
+    GLuint f[] = { 0, 2 * (slices + 1) }, n[] = { 2 * (slices + 1), slices + 2 };
+    arenaAddRanges(i, data, 2 * (slices + 1) + (base ? slices + 2 : 0), base ? 2 : 1, m, f, n);
+    free(data);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -284,6 +477,13 @@ GLuint gl4dgGenFanConef(GLuint slices, GLboolean base) {
   _garray[i].type = GE_FAN_CONE;
   c->slices = slices; c->base = base;
   data = mkFanConeVerticesf(slices, base);
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_FAN, GL_TRIANGLE_FAN };
+    GLuint f[] = { 0, slices + 2 }, n[] = { slices + 2, slices + 2 };
+    arenaAddRanges(i, data, (base ? 2 : 1) * (slices + 2), base ? 2 : 1, m, f, n);
+    free(data);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -310,6 +510,13 @@ GLuint gl4dgGenCylinderf(GLuint slices, GLboolean base) {
   _garray[i].type = GE_CYLINDER;
   c->slices = slices; c->base = base;
   data = mkCylinderVerticesf(slices, base);
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLE_FAN };
+    GLuint f[] = { 0, 2 * (slices + 1), 2 * (slices + 1) + slices + 2 }, n[] = { 2 * (slices + 1), slices + 2, slices + 2 };
+    arenaAddRanges(i, data, 2 * (slices + 1) + (base ? 2 * (slices + 2) : 0), base ? 3 : 1, m, f, n);
+    free(data);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -336,6 +543,13 @@ GLuint gl4dgGenDiskf(GLuint slices) {
   _garray[i].type = GE_DISK;
   c->slices = slices;
   data = mkDiskVerticesf(slices);
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_FAN };
+    GLuint f[] = { 0 }, n[] = { slices + 2 };
+    arenaAddRanges(i, data, slices + 2, 1, m, f, n);
+    free(data);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -364,7 +578,12 @@ GLuint gl4dgGenTorusf(GLuint slices, GLuint stacks, GLfloat radius) {
   s->slices = slices; s->stacks = stacks;
   s->radius = radius;
   idata = mkTorusVerticesf(slices, stacks, radius);
-  SELECT_GEOMETRY_OPTIMIZATION(index, s, slices + 1, stacks + 1);
+  if(_arena_mode) {
+    arenaAddGrid(i, idata, 8, GL_TRUE, slices + 1, stacks + 1);
+    free(idata);
+    return ++i;
+  }
+  SELECT_GEOMETRY_OPTIMIZATION(index, s, slices + 1, stacks + 1, idata, 8);
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -372,12 +591,9 @@ GLuint gl4dgGenTorusf(GLuint slices, GLuint stacks, GLfloat radius) {
   glEnableVertexAttribArray(2);
   glGenBuffers(2, s->buffers);
   glBindBuffer(GL_ARRAY_BUFFER, s->buffers[0]);
-  glBufferData(GL_ARRAY_BUFFER, 8 * (slices + 1) * (stacks + 1) * sizeof *idata, idata, GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)(3 * sizeof *idata));
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)(6 * sizeof *idata));
+  _garray[i].vsize = vertexBufferf(idata, (slices + 1) * (stacks + 1), 8, GL_TRUE);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s->buffers[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, s->index_row_count * s->index_nb_rows * sizeof *index, index, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, INDEX_COUNT(s) * sizeof *index, index, GL_STATIC_DRAW);
   free(idata);
   free(index);
   glBindVertexArray(0);
@@ -400,7 +616,12 @@ GLuint gl4dgGenGrid2dFromHeightMapf(GLuint width, GLuint height, GLfloat * heigh
   _garray[i].type = GE_GRID2D;
   s->width = width; s->height = height;
   idata = mkGrid2dVerticesf(width, height, heightmap);
-  SELECT_GEOMETRY_OPTIMIZATION(index, s, width, height);
+  if(_arena_mode) {
+    arenaAddGrid(i, idata, 8, GL_TRUE, width, height);
+    free(idata);
+    return ++i;
+  }
+  SELECT_GEOMETRY_OPTIMIZATION(index, s, width, height, idata, 8);
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -408,12 +629,9 @@ GLuint gl4dgGenGrid2dFromHeightMapf(GLuint width, GLuint height, GLfloat * heigh
   glEnableVertexAttribArray(2);
   glGenBuffers(2, s->buffers);
   glBindBuffer(GL_ARRAY_BUFFER, s->buffers[0]);
-  glBufferData(GL_ARRAY_BUFFER, 8 * width * height * sizeof *idata, idata, GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)(3 * sizeof *idata));
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (8 * sizeof *idata), (const void *)(6 * sizeof *idata));
+  _garray[i].vsize = vertexBufferf(idata, width * height, 8, GL_TRUE);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s->buffers[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, s->index_row_count * s->index_nb_rows * sizeof *index, index, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, INDEX_COUNT(s) * sizeof *index, index, GL_STATIC_DRAW);
   free(idata);
   free(index);
   glBindVertexArray(0);
@@ -431,6 +649,13 @@ GLuint gl4dgGenTeapotf(GLuint slices) {
   _garray[i].type = GE_TEAPOT;
   c->slices = slices;
   data = mkTeapotVerticesf(slices);
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_STRIP };
+    GLuint f[] = { 0 }, n[] = { 49 * slices + 1 };
+    arenaAddRanges(i, data, 49 * slices + 1, 1, m, f, n);
+    free(data);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -449,7 +674,15 @@ GLuint gl4dgGenTeapotf(GLuint slices) {
 }
 
 void gl4dgDraw(GLuint id) {
-  switch(_garray[--id].type) {
+  GL4D_PROF_BEGIN("gl4dgDraw");
+  if(_garray[--id].acount) {
+    glBindVertexArray(_garray[id].vao);
+    glDrawElements(GL_TRIANGLES, _garray[id].acount, GL4D_VAO_INDEX, (const GLvoid *)(intptr_t)(_garray[id].afirst * sizeof(GL4Dvaoindex)));
+    glBindVertexArray(0);
+    GL4D_PROF_END();
+    return;
+  }
+  switch(_garray[id].type) {
   case GE_SPHERE:
     glBindVertexArray(_garray[id].vao);
     DRAW_WITH_GEOMETRY_OPTIMIZATION((gsphere_t *)(_garray[id].geom));
@@ -472,12 +705,7 @@ void gl4dgDraw(GLuint id) {
     break;
   case GE_CUBE:
     glBindVertexArray(_garray[id].vao);
-    glDrawArrays(GL_TRIANGLE_STRIP,  0, 4);
-    glDrawArrays(GL_TRIANGLE_STRIP,  4, 4);
-    glDrawArrays(GL_TRIANGLE_STRIP,  8, 4);
-    glDrawArrays(GL_TRIANGLE_STRIP, 12, 4);
-    glDrawArrays(GL_TRIANGLE_STRIP, 16, 4);
-    glDrawArrays(GL_TRIANGLE_STRIP, 20, 4);
+    glDrawElements(GL_TRIANGLES, 36, GL4D_VAO_INDEX, (const GLvoid *)0);
     glBindVertexArray(0);
     break;
   case GE_CONE:
@@ -518,6 +746,95 @@ void gl4dgDraw(GLuint id) {
   default:
     break;
   }
+  GL4D_PROF_END();
+}
+
+/*!\brief lie (\a enable vrai) les matrices d'instances de \a buffer, à
+ * partir de la \a first-ième, aux attributs GL4DG_INSTANCE_ATTRIB à
+ * GL4DG_INSTANCE_ATTRIB + 3 du VAO courant, ou les désactive. */
+static void instanceAttribs(GLuint buffer, GLuint first, GLboolean enable) {
+  GLuint c;
+  if(!buffer)
+    return;
+  if(!enable) {
+    for(c = 0; c < 4; ++c)
+      glDisableVertexAttribArray(GL4DG_INSTANCE_ATTRIB + c);
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  for(c = 0; c < 4; ++c) {
+    glEnableVertexAttribArray(GL4DG_INSTANCE_ATTRIB + c);
+    glVertexAttribPointer(GL4DG_INSTANCE_ATTRIB + c, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat), (const void *)(intptr_t)((16 * first + 4 * c) * sizeof(GLfloat)));
+    glVertexAttribDivisor(GL4DG_INSTANCE_ATTRIB + c, 1);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void gl4dgDrawInstanced(GLuint id, GLsizei count, GLuint buffer) {
+  GL4D_PROF_BEGIN("gl4dgDrawInstanced");
+  drawInstanced(--id, count, buffer, 0);
+  GL4D_PROF_END();
+}
+
+/*!\brief dessine \a count instances de l'objet d'indice \a id, leurs
+ * matrices étant celles de \a buffer à partir de la \a first-ième. */
+static void drawInstanced(GLuint id, GLsizei count, GLuint buffer, GLuint first) {
+  glBindVertexArray(_garray[id].vao);
+  instanceAttribs(buffer, first, GL_TRUE);
+  if(_garray[id].acount) {
+    glDrawElementsInstanced(GL_TRIANGLES, _garray[id].acount, GL4D_VAO_INDEX, (const GLvoid *)(intptr_t)(_garray[id].afirst * sizeof(GL4Dvaoindex)), count);
+    instanceAttribs(buffer, 0, GL_FALSE);
+    glBindVertexArray(0);
+    return;
+  }
+  switch(_garray[id].type) {
+  case GE_SPHERE:
+    DRAW_INSTANCED_WITH_GEOMETRY_OPTIMIZATION((gsphere_t *)(_garray[id].geom), count);
+    break;
+  case GE_TORUS:
+    DRAW_INSTANCED_WITH_GEOMETRY_OPTIMIZATION((gtorus_t *)(_garray[id].geom), count);
+    break;
+  case GE_GRID2D:
+    DRAW_INSTANCED_WITH_GEOMETRY_OPTIMIZATION((ggrid2d_t *)(_garray[id].geom), count);
+    break;
+  case GE_QUAD:
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    break;
+  case GE_CUBE:
+    glDrawElementsInstanced(GL_TRIANGLES, 36, GL4D_VAO_INDEX, (const GLvoid *)0, count);
+    break;
+  case GE_CONE:
+  case GE_FAN_CONE:
+    if(_garray[id].type == GE_CONE)
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (((gcone_t *)(_garray[id].geom))->slices + 1), count);
+    else
+      glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, ((gcone_t *)(_garray[id].geom))->slices + 2, count);
+    if(((gcone_t *)(_garray[id].geom))->base) {
+      if(_garray[id].type == GE_CONE)
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 2 * (((gcone_t *)(_garray[id].geom))->slices + 1), ((gcone_t *)(_garray[id].geom))->slices + 2, count);
+      else
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, ((gcone_t *)(_garray[id].geom))->slices + 2, ((gcone_t *)(_garray[id].geom))->slices + 2, count);
+    }
+    break;
+  case GE_CYLINDER:
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (((gcylinder_t *)(_garray[id].geom))->slices + 1), count);
+    if(((gcylinder_t *)(_garray[id].geom))->base) {
+      glDrawArraysInstanced(GL_TRIANGLE_FAN, 2 * (((gcylinder_t *)(_garray[id].geom))->slices + 1), ((gcylinder_t *)(_garray[id].geom))->slices + 2, count);
+      glDrawArraysInstanced(GL_TRIANGLE_FAN, 2 * (((gcylinder_t *)(_garray[id].geom))->slices + 1) + ((gcylinder_t *)(_garray[id].geom))->slices + 2,
+			    ((gcylinder_t *)(_garray[id].geom))->slices + 2, count);
+    }
+    break;
+  case GE_DISK:
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, ((gdisk_t *)(_garray[id].geom))->slices + 2, count);
+    break;
+  case GE_TEAPOT:
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 49 * (((gteapot_t *)(_garray[id].geom))->slices )+1, count);
+    break;
+  default:
+    break;
+  }
+  instanceAttribs(buffer, 0, GL_FALSE);
+  glBindVertexArray(0);
 }
 
 void gl4dgDelete(GLuint id) {
@@ -530,7 +847,11 @@ void gl4dgDelete(GLuint id) {
 
 static void freeGeom(void * data) {
   geom_t * geom = (geom_t *)data;
-  switch(geom->type) {
+  /* les objets de l'arène n'ont ni VAO ni buffers propres */
+  geom_e type = geom->acount ? GE_NONE : geom->type;
+  if(geom->acount)
+    arenaRelease(geom);
+  switch(type) {
   case GE_SPHERE:
     glDeleteVertexArrays(1, &(geom->vao));
     glDeleteBuffers(2, ((gsphere_t *)(geom->geom))->buffers);
@@ -547,6 +868,8 @@ static void freeGeom(void * data) {
   case GE_CUBE:
     glDeleteVertexArrays(1, &(geom->vao));
     glDeleteBuffers(1, &(((gstatic_t *)(geom->geom))->buffer));
+    if(((gstatic_t *)(geom->geom))->ibuffer)
+      glDeleteBuffers(1, &(((gstatic_t *)(geom->geom))->ibuffer));
     break;
   case GE_CONE:
   case GE_FAN_CONE:
@@ -587,7 +910,10 @@ static GLuint genId(void) {
       llPush(_glist, &_garray[i]);
     }
   }
-  return ((geom_t *)llPop(_glist))->id;
+  i = ((geom_t *)llPop(_glist))->id;
+  _garray[i].vsize = 8 * sizeof(GLfloat);
+  _garray[i].afirst = _garray[i].acount = _garray[i].avfirst = _garray[i].avcount = 0;
+  return i;
 }
 
 static GLuint mkStaticf(geom_e type) {
@@ -629,11 +955,21 @@ static GLuint mkStaticf(geom_e type) {
     -1.0f, -1.0f,  1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
      1.0f, -1.0f,  1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f
   };
-  GLuint i = genId();
-  gstatic_t * q = malloc(sizeof *q);
+  GL4Dvaoindex cube_index[36];
+  GLuint i = genId(), f;
+  gstatic_t * q = calloc(1, sizeof *q);
   assert(q);
   _garray[i].geom = q;
   _garray[i].type = type;
+  if(_arena_mode) {
+    GLenum m[] = { GL_TRIANGLE_STRIP, GL_TRIANGLE_STRIP, GL_TRIANGLE_STRIP, GL_TRIANGLE_STRIP, GL_TRIANGLE_STRIP, GL_TRIANGLE_STRIP };
+    GLuint fi[] = { 0, 4, 8, 12, 16, 20 }, n[] = { 4, 4, 4, 4, 4, 4 };
+    if(type == GE_QUAD)
+      arenaAddRanges(i, quad_data, 4, 1, m, fi, n);
+    else
+      arenaAddRanges(i, cube_data, 24, 6, m, fi, n);
+    return ++i;
+  }
   glGenVertexArrays(1, &_garray[i].vao);
   glBindVertexArray(_garray[i].vao);
   glEnableVertexAttribArray(0);
@@ -647,6 +983,18 @@ static GLuint mkStaticf(geom_e type) {
     break;
   case GE_CUBE:
     glBufferData(GL_ARRAY_BUFFER, sizeof cube_data, cube_data, GL_STATIC_DRAW);
+    /* les 6 strips de 4 sommets en 12 triangles : un seul appel de dessin */
+    for(f = 0; f < 6; ++f) {
+      cube_index[6 * f + 0] = 4 * f + 0;
+      cube_index[6 * f + 1] = 4 * f + 1;
+      cube_index[6 * f + 2] = 4 * f + 2;
+      cube_index[6 * f + 3] = 4 * f + 2;
+      cube_index[6 * f + 4] = 4 * f + 1;
+      cube_index[6 * f + 5] = 4 * f + 3;
+    }
+    glGenBuffers(1, &(q->ibuffer));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, q->ibuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof cube_index, cube_index, GL_STATIC_DRAW);
     break;
   default:
     assert(0);
@@ -657,6 +1005,7 @@ static GLuint mkStaticf(geom_e type) {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (8 * sizeof *quad_data), (const void *)(6 * sizeof *quad_data));
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   return ++i;
 }
 
@@ -815,6 +1164,27 @@ static GL4Dvaoindex * mkRegularGridStripsAdjacencyIndices(GLuint width, GLuint h
   return index;
 }
 
+/*!\brief insère entre les \a nbRows rangées (triangle_strips) de \a
+ * rowCount indices de \a index deux indices dégénérés (le dernier de
+ * la rangée et le premier de la suivante) afin qu'elles puissent aussi
+ * être dessinées en une seule strip ; \a rowCount étant pair,
+ * l'orientation des triangles est conservée. Libère \a index. */
+static GL4Dvaoindex * joinStrips(GL4Dvaoindex * index, GLsizei rowCount, GLsizei nbRows) {
+  GLsizei r, k;
+  GL4Dvaoindex * joined = malloc(((rowCount + 2) * (nbRows - 1) + rowCount) * sizeof *joined);
+  assert(joined);
+  for(r = 0, k = 0; r < nbRows; ++r) {
+    if(r) {
+      joined[k] = joined[k - 1]; ++k;
+      joined[k++] = index[r * rowCount];
+    }
+    memcpy(&joined[k], &index[r * rowCount], rowCount * sizeof *joined);
+    k += rowCount;
+  }
+  free(index);
+  return joined;
+}
+
 static inline void fcvNormals(GLfloat * p, GLfloat y, int i) {
   (void)y; /* warning silenced */
   p[i] = 2.0f * p[i - 3] / sqrt(5.0);
@@ -1188,6 +1558,376 @@ static GLfloat * mkTeapotVerticesf(GLuint slices) {
   return data;
 }
 
+/*!\brief remplace le buffer \a old, dont les \a used premiers octets
+ * sont conservés, par un buffer de \a size octets (les cibles
+ * GL_COPY_* ne touchent pas à l'état du VAO courant). */
+static GLuint arenaRealloc(GLuint old, GLsizeiptr used, GLsizeiptr size) {
+  GLuint b;
+  glGenBuffers(1, &b);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, b);
+  glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+  if(old) {
+    if(used) {
+      glBindBuffer(GL_COPY_READ_BUFFER, old);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &old);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return b;
+}
+
+/*!\brief créé l'arène ou l'agrandit (au moins du double) pour qu'elle
+ * puisse recevoir \a nv sommets et \a ni indices de plus. */
+static void arenaReserve(GLuint nv, GLuint ni) {
+  GLboolean rebind = GL_FALSE;
+  if(!_arena) {
+    _arena = calloc(1, sizeof *_arena);
+    assert(_arena);
+    glGenVertexArrays(1, &_arena->vao);
+  }
+  if(_arena->nv + nv > _arena->sv) {
+    _arena->sv = _maxi(_maxi(2 * _arena->sv, _arena->nv + nv), 1 << 14);
+    _arena->buffers[0] = arenaRealloc(_arena->buffers[0], _arena->nv * 8 * sizeof(GLfloat), _arena->sv * 8 * sizeof(GLfloat));
+    rebind = GL_TRUE;
+  }
+  if(_arena->ni + ni > _arena->si) {
+    _arena->si = _maxi(_maxi(2 * _arena->si, _arena->ni + ni), 1 << 16);
+    _arena->buffers[1] = arenaRealloc(_arena->buffers[1], _arena->ni * sizeof(GL4Dvaoindex), _arena->si * sizeof(GL4Dvaoindex));
+    rebind = GL_TRUE;
+  }
+  if(rebind) {
+    glBindVertexArray(_arena->vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, _arena->buffers[0]);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (8 * sizeof(GLfloat)), (const void *)0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (8 * sizeof(GLfloat)), (const void *)(3 * sizeof(GLfloat)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (8 * sizeof(GLfloat)), (const void *)(6 * sizeof(GLfloat)));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _arena->buffers[1]);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+}
+
+/*!\brief place dans l'arène l'objet d'indice \a i : ses \a nv sommets
+ * \a data (\a stride flottants, normale incluse si \a normals, voir
+ * \ref vertexBufferf) et ses \a nindex indices de triangles \a index
+ * (modifiés : ils deviennent absolus). */
+static void arenaAdd(GLuint i, GLfloat * data, GLuint nv, GLuint stride, GLboolean normals, GL4Dvaoindex * index, GLuint nindex) {
+  GLuint k, t = normals ? 6 : 3;
+  GLfloat * v = data;
+  arenaReserve(nv, nindex);
+  if(stride != 8 || !normals) {
+    v = malloc(nv * 8 * sizeof *v);
+    assert(v);
+    for(k = 0; k < nv; ++k) {
+      memcpy(&v[8 * k], &data[stride * k], 3 * sizeof *v);
+      memcpy(&v[8 * k + 3], &data[stride * k + (normals ? 3 : 0)], 3 * sizeof *v);
+      memcpy(&v[8 * k + 6], &data[stride * k + t], 2 * sizeof *v);
+    }
+  }
+  for(k = 0; k < nindex; ++k)
+    index[k] += _arena->nv;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, _arena->buffers[0]);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, _arena->nv * 8 * sizeof *v, nv * 8 * sizeof *v, v);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, _arena->buffers[1]);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, _arena->ni * sizeof *index, nindex * sizeof *index, index);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  _garray[i].vao = _arena->vao;
+  _garray[i].vsize = 8 * sizeof *v;
+  _garray[i].avfirst = _arena->nv;
+  _garray[i].avcount = nv;
+  _garray[i].afirst = _arena->ni;
+  _garray[i].acount = nindex;
+  _arena->nv += nv;
+  _arena->ni += nindex;
+  if(v != data)
+    free(v);
+}
+
+/*!\brief place dans l'arène une grille régulière de \a width x \a
+ * height sommets (sphère, tore, grilles) en liste de triangles,
+ * optimisée pour le cache post-transformation au niveau 5. */
+static void arenaAddGrid(GLuint i, GLfloat * data, GLuint stride, GLboolean normals, GLuint width, GLuint height) {
+  GLuint n = 6 * (width - 1) * (height - 1);
+  GL4Dvaoindex * index = mkRegularGridTriangleIndices(width, height);
+  if(_geometry_optimization_level == 5)
+    optimizeVertexCache(index, n, data, stride, width * height);
+  arenaAdd(i, data, width * height, stride, normals, index, n);
+  free(index);
+}
+
+/*!\brief place dans l'arène un objet de \a nv sommets (8 flottants)
+ * dessiné par \a nranges glDrawArrays (triangle_strips ou
+ * triangle_fans), convertis en triangles. */
+static void arenaAddRanges(GLuint i, GLfloat * data, GLuint nv, int nranges, const GLenum * modes, const GLuint * firsts, const GLuint * counts) {
+  GLuint n = 0, k, a, b, c;
+  int r;
+  GL4Dvaoindex * index;
+  for(r = 0; r < nranges; ++r)
+    n += 3 * (counts[r] - 2);
+  index = malloc(n * sizeof *index);
+  assert(index);
+  for(r = 0, n = 0; r < nranges; ++r)
+    for(k = 0; k + 2 < counts[r]; ++k) {
+      if(modes[r] == GL_TRIANGLE_FAN) {
+	a = firsts[r]; b = firsts[r] + k + 1; c = firsts[r] + k + 2;
+      } else if(k & 1) {
+	a = firsts[r] + k + 1; b = firsts[r] + k; c = firsts[r] + k + 2;
+      } else {
+	a = firsts[r] + k; b = firsts[r] + k + 1; c = firsts[r] + k + 2;
+      }
+      index[n++] = a; index[n++] = b; index[n++] = c;
+    }
+  arenaAdd(i, data, nv, 8, GL_TRUE, index, n);
+  free(index);
+}
+
+/*!\brief retire \a geom de l'arène ; sa place n'est récupérée que
+ * s'il en est le dernier objet (sinon à \ref gl4dgClean). */
+static void arenaRelease(geom_t * geom) {
+  if(geom->afirst + geom->acount == _arena->ni && geom->avfirst + geom->avcount == _arena->nv) {
+    _arena->ni = geom->afirst;
+    _arena->nv = geom->avfirst;
+  }
+  geom->afirst = geom->acount = geom->avfirst = geom->avcount = 0;
+}
+
+static void arenaFree(void) {
+  free(_batch.cmds);
+  free(_batch.others);
+  if(_batch.indirect)
+    glDeleteBuffers(1, &_batch.indirect);
+  memset(&_batch, 0, sizeof _batch);
+  if(!_arena)
+    return;
+  glDeleteVertexArrays(1, &_arena->vao);
+  glDeleteBuffers(2, _arena->buffers);
+  free(_arena);
+  _arena = NULL;
+}
+
+/*!\brief score (Forsyth) d'un sommet en position \a pos du cache (-1
+ * s'il n'y est pas) et encore utilisé par \a ntris triangles à
+ * émettre. */
+static inline float vcacheScore(int pos, GLuint ntris) {
+  float s;
+  if(!ntris)
+    return -1.0f;
+  if(pos < 0)
+    s = 0.0f;
+  else if(pos < 3) /* les sommets du dernier triangle */
+    s = 0.75f;
+  else
+    s = powf(1.0f - (pos - 3) / (float)(VCACHE_SIZE - 3), 1.5f);
+  return s + 2.0f / sqrtf((float)ntris);
+}
+
+/*!\brief réordonne les \a nindex indices (liste de triangles) de \a
+ * index pour le cache post-transformation du GPU (algorithme "linear
+ * speed vertex cache optimisation" de T. Forsyth, cache LRU de
+ * VCACHE_SIZE sommets), puis les \a nv sommets de \a data (\a stride
+ * flottants chacun) dans l'ordre de leur première utilisation pour la
+ * localité des lectures de sommets ; \a index est renuméroté en
+ * conséquence. */
+static void optimizeVertexCache(GL4Dvaoindex * index, GLuint nindex, GLfloat * data, GLuint stride, GLuint nv) {
+  GLuint ntri = nindex / 3, i, j, k, t, v, * off, * adj, * live, * remap;
+  GL4Dvaoindex * out;
+  GLfloat * vdata;
+  float * vscore, * tscore, bs;
+  int * cpos, cache[VCACHE_SIZE], lru[VCACHE_SIZE + 3], ncache = 0, nc, best, cursor = 0;
+  unsigned char * emitted;
+  off = calloc(nv + 1, sizeof * off);
+  live = calloc(nv, sizeof * live);
+  adj = malloc(nindex * sizeof * adj);
+  vscore = malloc(nv * sizeof * vscore);
+  cpos = malloc(nv * sizeof * cpos);
+  tscore = malloc(ntri * sizeof * tscore);
+  emitted = calloc(ntri, sizeof * emitted);
+  out = malloc(nindex * sizeof * out);
+  assert(off && live && adj && vscore && cpos && tscore && emitted && out);
+  /* triangles de chaque sommet */
+  for(i = 0; i < nindex; ++i)
+    off[index[i] + 1]++;
+  for(v = 0; v < nv; ++v)
+    off[v + 1] += off[v];
+  for(i = 0; i < nindex; ++i)
+    adj[off[index[i]] + live[index[i]]++] = i / 3;
+  for(v = 0; v < nv; ++v) {
+    cpos[v] = -1;
+    vscore[v] = vcacheScore(-1, live[v]);
+  }
+  for(t = 0; t < ntri; ++t)
+    tscore[t] = vscore[index[3 * t]] + vscore[index[3 * t + 1]] + vscore[index[3 * t + 2]];
+  for(k = 0, best = -1; k < ntri; ++k) {
+    if(best < 0) {
+      /* aucun candidat dans le cache : premier triangle non émis */
+      while(emitted[cursor])
+	++cursor;
+      best = cursor;
+    }
+    t = best;
+    emitted[t] = 1;
+    memcpy(&out[3 * k], &index[3 * t], 3 * sizeof * out);
+    /* retire t des triangles à émettre de ses sommets */
+    for(i = 0; i < 3; ++i) {
+      v = index[3 * t + i];
+      for(j = off[v]; adj[j] != t; ++j);
+      adj[j] = adj[off[v] + --live[v]];
+    }
+    /* les sommets de t passent en tête du cache LRU, les derniers en
+     * sortent */
+    nc = 0;
+    for(i = 0; i < 3; ++i)
+      lru[nc++] = index[3 * t + i];
+    for(i = 0; i < (GLuint)ncache; ++i)
+      if(cache[i] != (int)index[3 * t] && cache[i] != (int)index[3 * t + 1] && cache[i] != (int)index[3 * t + 2])
+	lru[nc++] = cache[i];
+    for(i = 0; i < (GLuint)nc; ++i) {
+      v = lru[i];
+      cpos[v] = i < VCACHE_SIZE ? (int)i : -1;
+      vscore[v] = vcacheScore(cpos[v], live[v]);
+    }
+    ncache = nc < VCACHE_SIZE ? nc : VCACHE_SIZE;
+    memcpy(cache, lru, ncache * sizeof * cache);
+    /* nouveaux scores des triangles touchant ces sommets et meilleur
+     * d'entre eux */
+    for(i = 0, best = -1, bs = -1.0f; i < (GLuint)nc; ++i) {
+      v = lru[i];
+      for(j = off[v]; j < off[v] + live[v]; ++j) {
+	t = adj[j];
+	tscore[t] = vscore[index[3 * t]] + vscore[index[3 * t + 1]] + vscore[index[3 * t + 2]];
+	if(tscore[t] > bs) {
+	  bs = tscore[t];
+	  best = t;
+	}
+      }
+    }
+  }
+  /* ordre des sommets : celui de leur première utilisation */
+  remap = live; /* tous à 0, réutilisé */
+  for(v = 0; v < nv; ++v)
+    remap[v] = (GLuint)-1;
+  for(i = 0, k = 0; i < nindex; ++i) {
+    if(remap[out[i]] == (GLuint)-1)
+      remap[out[i]] = k++;
+    index[i] = remap[out[i]];
+  }
+  for(v = 0; v < nv; ++v)
+    if(remap[v] == (GLuint)-1)
+      remap[v] = k++;
+  vdata = malloc(nv * stride * sizeof * vdata);
+  assert(vdata);
+  for(v = 0; v < nv; ++v)
+    memcpy(&vdata[remap[v] * stride], &data[v * stride], stride * sizeof * vdata);
+  memcpy(data, vdata, nv * stride * sizeof * vdata);
+  free(vdata);
+  free(out);
+  free(emitted);
+  free(tscore);
+  free(cpos);
+  free(vscore);
+  free(adj);
+  free(live);
+  free(off);
+}
+
+/*!\brief conversion en half-float (arrondi au plus proche, les
+ * valeurs trop petites sont ramenées à 0). */
+static inline GLushort halff(GLfloat f) {
+  union { GLfloat f; GLuint u; } c;
+  GLuint sign, m;
+  int e;
+  c.f = f;
+  sign = (c.u >> 16) & 0x8000;
+  e = (int)((c.u >> 23) & 0xff) - 127 + 15;
+  m = c.u & 0x7fffff;
+  if(e <= 0)
+    return (GLushort)sign;
+  if(e >= 31)
+    return (GLushort)(sign | 0x7c00);
+  m += 0xfff + ((m >> 13) & 1); /* au pair le plus proche */
+  if(m & 0x800000) {
+    m = 0;
+    if(++e >= 31)
+      return (GLushort)(sign | 0x7c00);
+  }
+  return (GLushort)(sign | (e << 10) | (m >> 13));
+}
+
+static inline GLshort snorm16f(GLfloat f) {
+  f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+  return (GLshort)floorf(f * 32767.0f + 0.5f);
+}
+
+static inline GLushort unorm16f(GLfloat f) {
+  f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+  return (GLushort)floorf(f * 65535.0f + 0.5f);
+}
+
+/*!\brief encodage octaédrique de la normale \a n (décodé par
+ * gl4dgOctDecode de "gl4dg/octahedral.glsl"). */
+static inline void octf(const GLfloat * n, GLshort * out) {
+  GLfloat l = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]), x, y, t;
+  if(l <= 0.0f) {
+    out[0] = out[1] = 0;
+    return;
+  }
+  x = n[0] / l;
+  y = n[1] / l;
+  if(n[2] < 0.0f) {
+    t = x;
+    x = (1.0f - fabsf(y)) * (t >= 0.0f ? 1.0f : -1.0f);
+    y = (1.0f - fabsf(t)) * (y >= 0.0f ? 1.0f : -1.0f);
+  }
+  out[0] = snorm16f(x);
+  out[1] = snorm16f(y);
+}
+
+/*!\brief envoie dans le GL_ARRAY_BUFFER courant les \a nv sommets de
+ * \a data (\a stride flottants : position, normale si \a normals --
+ * sinon la normale est la position, cas de la sphère unité -- puis
+ * coordonnée de texture) selon le format choisi par \ref
+ * gl4dgSetVertexFormat et décrit les attributs 0, 1 et 2 du VAO
+ * courant.
+ *
+ * \return la taille d'un sommet en octets.
+ */
+static GLuint vertexBufferf(GLfloat * data, GLuint nv, GLuint stride, GLboolean normals) {
+  GLuint v, t = normals ? 6 : 3;
+  gpacked_t * p;
+  GLfloat * d;
+  if(_vertex_format != GL4DG_VERTEX_PACKED) {
+    glBufferData(GL_ARRAY_BUFFER, nv * stride * sizeof *data, data, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (stride * sizeof *data), (const void *)0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (stride * sizeof *data), (const void *)((normals ? 3 : 0) * sizeof *data));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (stride * sizeof *data), (const void *)(t * sizeof *data));
+    return stride * sizeof *data;
+  }
+  p = malloc(nv * sizeof *p);
+  assert(p);
+  for(v = 0; v < nv; ++v) {
+    d = &data[v * stride];
+    p[v].p[0] = halff(d[0]);
+    p[v].p[1] = halff(d[1]);
+    p[v].p[2] = halff(d[2]);
+    p[v].p[3] = 0x3c00; /* 1.0 */
+    octf(normals ? &d[3] : d, p[v].n);
+    p[v].t[0] = unorm16f(d[t]);
+    p[v].t[1] = unorm16f(d[t + 1]);
+  }
+  glBufferData(GL_ARRAY_BUFFER, nv * sizeof *p, p, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, sizeof *p, (const void *)offsetof(gpacked_t, p));
+  glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof *p, (const void *)offsetof(gpacked_t, n));
+  glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof *p, (const void *)offsetof(gpacked_t, t));
+  free(p);
+  return sizeof *p;
+}
+
 static inline void triangleNormalf(GLfloat * out, GLfloat * p0, GLfloat * p1, GLfloat * p2) {
   GLfloat v0[3], v1[3];
   v0[0] = p1[0] - p0[0];
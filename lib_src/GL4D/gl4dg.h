@@ -14,6 +14,18 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+  /*!\brief formats de sommets des géométries indexées (sphère, tore et
+   * grilles), voir \ref gl4dgSetVertexFormat. */
+  enum GL4DGvertexformat {
+    GL4DG_VERTEX_FLOAT  = 0, /* position, normale et coordonnée de texture en flottants */
+    GL4DG_VERTEX_PACKED = 1  /* 16 octets : half-floats, normale octaédrique SNORM16, texture UNORM16 */
+  };
+  typedef enum GL4DGvertexformat GL4DGvertexformat;
+
+/*!\brief premier des quatre attributs (colonnes de la mat4 par
+ * instance) alimentés par le buffer passé à \ref gl4dgDrawInstanced. */
+#define GL4DG_INSTANCE_ATTRIB 3
+
   /*!\brief Initialise les structures nécessaire au stockage des
    * géométries proposées par GL4Dummies. Cette fonction est appelée
    * par la fonction \ref gl4duInit, utilisez donc cette dernière. 
@@ -41,11 +53,83 @@ extern "C" {
   /*!\brief Modifie le niveau d'optimisation de certaines des
    * géométries à générer (exemple le torus, la grid et la sphère).
    * 
-   * \param level trois niveaux sont possibles : 0 fabriquer surtout
-   * des triangles, 1 (par défaut) tenter de faire des
-   * triangle_strips, 2 essayer de tout faire en une seule strip.
+   * \param level 0 fabriquer surtout des triangles, 1 (par défaut)
+   * tenter de faire des triangle_strips, 2 essayer de tout faire en
+   * une seule strip, 3 et 4 des triangles et des triangle_strips avec
+   * adjacence, 5 des triangles réordonnés pour le cache
+   * post-transformation du GPU (algorithme de Forsyth), les sommets
+   * étant rangés dans l'ordre de leur première utilisation ; ce
+   * dernier niveau est conseillé pour les maillages très fins.
    */
   GL4DAPI void      GL4DAPIENTRY gl4dgSetGeometryOptimizationLevel(GLuint level);
+  /*!\brief Modifie le format de sommets des géométries indexées à
+   * générer (le tore, la grid et la sphère).
+   *
+   * \param format GL4DG_VERTEX_FLOAT (par défaut) ou
+   * GL4DG_VERTEX_PACKED. Le format compact occupe 16 octets par
+   * sommet au lieu de 32 (20 pour la sphère) : position en half-floats
+   * (attribut 0, vec4 avec w = 1), normale encodée en octaèdre
+   * (attribut 1, vec2 normalisé dans [-1, 1], à décoder par
+   * gl4dgOctDecode après un #include "gl4dg/octahedral.glsl" dans le
+   * vertex shader) et coordonnée de texture en UNORM16 (attribut
+   * 2). La précision des half-floats (11 bits) limite ce format aux
+   * géométries de quelques milliers de sommets de côté.
+   * \see gl4dgGetVertexSize
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgSetVertexFormat(GLuint format);
+  /*!\brief Renvoie la taille en octets d'un sommet de
+   * l'objet-géométrie référencé par \a id, dans son buffer de sommets.
+   *
+   * \param id la référence de l'objet-géométrie généré par cette bibliothèque.
+   * \return le nombre d'octets par sommet.
+   * \see gl4dgSetVertexFormat
+   */
+  GL4DAPI GLuint    GL4DAPIENTRY gl4dgGetVertexSize(GLuint id);
+  /*!\brief Active ou désactive le mode arène pour les géométries à
+   * générer.
+   *
+   * En mode arène, les géométries ne reçoivent pas leur propre VAO :
+   * leurs sommets (toujours au format GL4DG_VERTEX_FLOAT complet, 32
+   * octets) et leurs indices (listes de triangles, réordonnées pour le
+   * cache au niveau d'optimisation 5) sont placés dans un grand buffer
+   * de sommets et un grand buffer d'indices partagés, agrandis au
+   * besoin, sous un VAO commun. Une scène mêlant sphères, cones, tores
+   * et grilles peut alors être dessinée en un seul appel, voir \ref
+   * gl4dgBatchDraw. La place d'un objet détruit n'est récupérée que
+   * s'il est le dernier de l'arène, ou à \ref gl4dgClean.
+   *
+   * \param enable GL_TRUE pour placer les géométries suivantes dans
+   * l'arène, GL_FALSE (par défaut) pour revenir à un VAO par objet.
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgSetArenaMode(GLboolean enable);
+  /*!\brief Vide le lot d'objets à dessiner par \ref gl4dgBatchDraw.
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgBatchBegin(void);
+  /*!\brief Ajoute au lot \a count instances de l'objet-géométrie \a
+   * id ; les matrices de ces instances sont, dans le buffer passé à
+   * \ref gl4dgBatchDraw, à la suite de celles des objets ajoutés
+   * précédemment.
+   *
+   * \param id identifiant de l'objet à dessiner.
+   * \param count nombre d'instances (1 pour un simple objet).
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgBatchAdd(GLuint id, GLsizei count);
+  /*!\brief Dessine le lot constitué depuis le dernier \ref
+   * gl4dgBatchBegin (il peut être redessiné à chaque frame sans être
+   * reconstruit).
+   *
+   * Les objets de l'arène sont dessinés par un unique
+   * glMultiDrawElementsIndirect (une commande par objet, le buffer de
+   * commandes n'étant renvoyé que si le lot a changé), sans changement
+   * de VAO ; sous GLES, par un glDrawElementsInstanced par objet. Les
+   * autres objets sont dessinés à part comme par \ref
+   * gl4dgDrawInstanced.
+   *
+   * \param buffer si non nul, buffer des matrices de toutes les
+   * instances du lot, dans l'ordre des \ref gl4dgBatchAdd (voir \ref
+   * gl4dgDrawInstanced et \ref gl4duUploadInstanceMatrices).
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgBatchDraw(GLuint buffer);
   /*!\brief Renvoie l'identifiant du Vertex Array Object correspondant
    * à l'objet-géométrie référencé par \a id.
    * 
@@ -184,6 +268,24 @@ extern "C" {
    * \param id identifiant de l'objet à dessiner.
    */
   GL4DAPI void      GL4DAPIENTRY gl4dgDraw(GLuint id);
+  /*!\brief Dessine \a count instances de l'objet-géométrie dont
+   * l'identifiant (référence) est passé en argument.
+   *
+   * Chaque partie de l'objet est dessinée en un seul appel
+   * glDrawArraysInstanced ou glDrawElementsInstanced pour toutes les
+   * instances (les rangées de triangle_strips de la sphère, du tore et
+   * des grilles sont reliées par des triangles dégénérés, le cube est
+   * indexé en triangles) ; seules les strips avec adjacence (niveau
+   * d'optimisation 4) restent dessinées rangée par rangée.
+   *
+   * \param id identifiant de l'objet à dessiner.
+   * \param count nombre d'instances.
+   * \param buffer si non nul, buffer de \a count matrices 4x4 (GLfloat
+   * rangés par colonnes, voir \ref gl4duUploadInstanceMatrices) lues
+   * une par instance dans l'attribut "layout(location = 3) in mat4"
+   * (GL4DG_INSTANCE_ATTRIB) ; sinon le shader utilise gl_InstanceID.
+   */
+  GL4DAPI void      GL4DAPIENTRY gl4dgDrawInstanced(GLuint id, GLsizei count, GLuint buffer);
   /*!\brief Détruit un objet-géométrie dont l'identifiant (référence)
    * est passé en argument.
    * 
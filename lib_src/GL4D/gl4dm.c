@@ -8,9 +8,25 @@
 */
 
 #include "gl4dm.h"
+#include "gl4dCPU.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define GL4DM_X86
+#  include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define GL4DM_NEON
+#  include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define GL4DM_TARGET(t) __attribute__((target(t)))
+#else
+#  define GL4DM_TARGET(t)
+#endif
+
 /*!\brief Retourne un nombre pseudo-aleatoire dans l'intervalle [0,
  * 1[. Ici la distribution est uniforme.
  *
@@ -134,3 +150,191 @@ GLfloat * gl4dmTriangleEdge(GLuint width, GLuint height, GLfloat H) {
   triangle_edge(hm, 0, 0, width - 1, height - 1, width, 1, H);
   return hm;
 }
+
+/* NOYAUX MATRICIELS (GLfloat, matrices 4x4 rangées par lignes) */
+
+static void mat4mulinit(GLfloat * r, const GLfloat * a, const GLfloat * b);
+static void mat4vecinit(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n);
+
+/*!\brief noyaux utilisés par \ref gl4dmMat4XMat4f et \ref
+ * gl4dmMat4XVec4Arrayf, choisis au premier appel. */
+static void (*_mat4mul)(GLfloat * r, const GLfloat * a, const GLfloat * b) = mat4mulinit;
+static void (*_mat4vec)(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) = mat4vecinit;
+
+static void mat4mulScalar(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  GLfloat t[16];
+  MMAT4XMAT4(t, a, b);
+  memcpy(r, t, sizeof t);
+}
+
+static void mat4vecScalar(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  GLfloat t[4];
+  for(; n--; dst += 4, src += 4) {
+    MMAT4XVEC4(t, m, src);
+    dst[0] = t[0]; dst[1] = t[1]; dst[2] = t[2]; dst[3] = t[3];
+  }
+}
+
+#ifdef GL4DM_X86
+/* Les sommes sont faites dans le même ordre que MMAT4XMAT4 et
+ * MMAT4XVEC4 (sans FMA) : les résultats sont identiques au calcul
+ * scalaire. */
+GL4DM_TARGET("sse") static void mat4mulSSE(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  const __m128 b0 = _mm_loadu_ps(b),     b1 = _mm_loadu_ps(b + 4);
+  const __m128 b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+  __m128 rows[4];
+  int i;
+  for(i = 0; i < 4; i++) {
+    const GLfloat * ai = a + 4 * i;
+    __m128 v = _mm_mul_ps(_mm_set1_ps(ai[0]), b0);
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(ai[1]), b1));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(ai[2]), b2));
+    rows[i] = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(ai[3]), b3));
+  }
+  for(i = 0; i < 4; i++)
+    _mm_storeu_ps(r + 4 * i, rows[i]);
+}
+
+GL4DM_TARGET("sse") static void mat4vecSSE(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  /* colonnes de m */
+  const __m128 c0 = _mm_setr_ps(m[0], m[4], m[8],  m[12]), c1 = _mm_setr_ps(m[1], m[5], m[9],  m[13]);
+  const __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], m[14]), c3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+  for(; n--; dst += 4, src += 4) {
+    __m128 v = _mm_loadu_ps(src), r;
+    r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), c1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), c2));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xff), c3));
+    _mm_storeu_ps(dst, r);
+  }
+}
+
+/* AVX : deux lignes (ou deux vecteurs) par registre de 256 bits. */
+GL4DM_TARGET("avx") static void mat4mulAVX(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  const __m256 b0 = _mm256_broadcast_ps((const __m128 *)b),       b1 = _mm256_broadcast_ps((const __m128 *)(b + 4));
+  const __m256 b2 = _mm256_broadcast_ps((const __m128 *)(b + 8)), b3 = _mm256_broadcast_ps((const __m128 *)(b + 12));
+  const __m256 a01 = _mm256_loadu_ps(a), a23 = _mm256_loadu_ps(a + 8);
+  __m256 r01, r23;
+  r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+  r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xaa), b2));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xaa), b2));
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xff), b3));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xff), b3));
+  _mm256_storeu_ps(r, r01);
+  _mm256_storeu_ps(r + 8, r23);
+}
+
+GL4DM_TARGET("avx") static void mat4vecAVX(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  const __m256 c0 = _mm256_setr_ps(m[0], m[4], m[8],  m[12], m[0], m[4], m[8],  m[12]);
+  const __m256 c1 = _mm256_setr_ps(m[1], m[5], m[9],  m[13], m[1], m[5], m[9],  m[13]);
+  const __m256 c2 = _mm256_setr_ps(m[2], m[6], m[10], m[14], m[2], m[6], m[10], m[14]);
+  const __m256 c3 = _mm256_setr_ps(m[3], m[7], m[11], m[15], m[3], m[7], m[11], m[15]);
+  for(; n >= 2; n -= 2, dst += 8, src += 8) {
+    __m256 v = _mm256_loadu_ps(src), r;
+    r = _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x00), c0);
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x55), c1));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0xaa), c2));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0xff), c3));
+    _mm256_storeu_ps(dst, r);
+  }
+  if(n)
+    mat4vecSSE(dst, m, src, n);
+}
+#endif
+
+#ifdef GL4DM_NEON
+static void mat4mulNEON(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  const float32x4_t b0 = vld1q_f32(b),     b1 = vld1q_f32(b + 4);
+  const float32x4_t b2 = vld1q_f32(b + 8), b3 = vld1q_f32(b + 12);
+  float32x4_t rows[4];
+  int i;
+  for(i = 0; i < 4; i++) {
+    const GLfloat * ai = a + 4 * i;
+    float32x4_t v = vmulq_n_f32(b0, ai[0]);
+    v = vaddq_f32(v, vmulq_n_f32(b1, ai[1]));
+    v = vaddq_f32(v, vmulq_n_f32(b2, ai[2]));
+    rows[i] = vaddq_f32(v, vmulq_n_f32(b3, ai[3]));
+  }
+  for(i = 0; i < 4; i++)
+    vst1q_f32(r + 4 * i, rows[i]);
+}
+
+static void mat4vecNEON(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  const GLfloat cols[16] = { m[0], m[4], m[8],  m[12], m[1], m[5], m[9],  m[13],
+                             m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15] };
+  const float32x4_t c0 = vld1q_f32(cols),     c1 = vld1q_f32(cols + 4);
+  const float32x4_t c2 = vld1q_f32(cols + 8), c3 = vld1q_f32(cols + 12);
+  for(; n--; dst += 4, src += 4) {
+    float32x4_t r = vmulq_n_f32(c0, src[0]);
+    r = vaddq_f32(r, vmulq_n_f32(c1, src[1]));
+    r = vaddq_f32(r, vmulq_n_f32(c2, src[2]));
+    r = vaddq_f32(r, vmulq_n_f32(c3, src[3]));
+    vst1q_f32(dst, r);
+  }
+}
+#endif
+
+/*!\brief choisit, au premier appel, les noyaux matriciels adaptés au
+ * processeur. */
+static void mat4select(void) {
+  _mat4mul = mat4mulScalar;
+  _mat4vec = mat4vecScalar;
+#if defined(GL4DM_X86)
+  switch(cpuX86Level()) {
+  case 1: /* AVX2, donc AVX */
+    _mat4mul = mat4mulAVX;
+    _mat4vec = mat4vecAVX;
+    break;
+  case 2:
+    _mat4mul = mat4mulSSE;
+    _mat4vec = mat4vecSSE;
+    break;
+  default: break;
+  }
+#elif defined(GL4DM_NEON)
+  _mat4mul = mat4mulNEON;
+  _mat4vec = mat4vecNEON;
+#endif
+}
+
+static void mat4mulinit(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  mat4select();
+  _mat4mul(r, a, b);
+}
+
+static void mat4vecinit(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  mat4select();
+  _mat4vec(dst, m, src, n);
+}
+
+/*!\brief Multiplication de deux matrices 4x4 de GLfloat : \a r = \a a
+ * x \a b ; équivalent à \ref MMAT4XMAT4 en utilisant le noyau SIMD
+ * (AVX, SSE ou NEON) disponible.
+ *
+ * \a r peut être \a a ou \a b.
+ *
+ * \param r la matrice résultat.
+ * \param a la matrice de gauche.
+ * \param b la matrice de droite.
+ */
+void gl4dmMat4XMat4f(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+  _mat4mul(r, a, b);
+}
+
+/*!\brief Multiplication par la matrice 4x4 \a m des \a n vecteurs
+ * (x, y, z, w) consécutifs de \a src ; les résultats sont rangés dans
+ * \a dst (équivalent à \a n \ref MMAT4XVEC4).
+ *
+ * \a dst peut être \a src.
+ *
+ * \param dst les 4 * \a n GLfloat résultat.
+ * \param m la matrice 4x4.
+ * \param src les 4 * \a n GLfloat à transformer.
+ * \param n le nombre de vecteurs.
+ */
+void gl4dmMat4XVec4Arrayf(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n) {
+  _mat4vec(dst, m, src, n);
+}
@@ -334,6 +334,26 @@
   } while(0)
 
 
+/*!\brief Multiplication à droite de la matrice 4x4 \a m par la
+ * translation (\a tx, \a ty, \a tz) : seule la dernière colonne de \a
+ * m change (même résultat que MMAT4XMAT4 avec la matrice de
+ * translation). */
+#define MMAT4XTRANSLATE(m, tx, ty, tz) do {				\
+    int i_;								\
+    for(i_ = 0; i_ < 16; i_ += 4)					\
+      (m)[i_ + 3] = (m)[i_] * (tx) + (m)[i_ + 1] * (ty) + (m)[i_ + 2] * (tz) + (m)[i_ + 3]; \
+  } while(0)
+
+/*!\brief Multiplication à droite de la matrice 4x4 \a m par
+ * l'homothétie (\a sx, \a sy, \a sz) : seules les trois premières
+ * colonnes de \a m sont mises à l'échelle. */
+#define MMAT4XSCALE(m, sx, sy, sz) do {					\
+    int i_;								\
+    for(i_ = 0; i_ < 16; i_ += 4) {					\
+      (m)[i_] *= (sx); (m)[i_ + 1] *= (sy); (m)[i_ + 2] *= (sz);	\
+    }									\
+  } while(0)
+
 /*!\brief Chargement d'une matrice identitéé dans \a m. */
 #define MIDENTITY(m) do {						\
     (m)[1] = (m)[2] = (m)[3] = (m)[4] = (m)[6] = (m)[7] = (m)[8] = (m)[9] = (m)[11] = (m)[12] = (m)[13] = (m)[14] = 0.0; \
@@ -349,6 +369,8 @@ GL4DAPI double    GL4DAPIENTRY gl4dmSURand(void);
 GL4DAPI double    GL4DAPIENTRY gl4dmGRand(void);
 GL4DAPI double    GL4DAPIENTRY gl4dmGURand(void);
 GL4DAPI GLfloat * GL4DAPIENTRY gl4dmTriangleEdge(GLuint width, GLuint height, GLfloat H);
+GL4DAPI void      GL4DAPIENTRY gl4dmMat4XMat4f(GLfloat * r, const GLfloat * a, const GLfloat * b);
+GL4DAPI void      GL4DAPIENTRY gl4dmMat4XVec4Arrayf(GLfloat * dst, const GLfloat * m, const GLfloat * src, size_t n);
 
 #ifdef __cplusplus
 }
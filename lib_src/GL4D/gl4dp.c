@@ -16,14 +16,55 @@
 #include <math.h>
 #include "gl4dp.h"
 #include "gl4dg.h"
+#include "gl4dpSpan.h"
+#include "gl4duProfile.h"
+#include "thread_pool.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#if defined(_MSC_VER)
+#  define THREAD_LOCAL __declspec(thread)
+#else
+#  define THREAD_LOCAL __thread
+#endif
+
+/*!\brief log2 du côté (en pixels) d'une tuile utilisée pour le
+ * suivi des zones modifiées (dirty tiles) d'un écran. */
+#define DIRTY_TILE_SHIFT 6
+/*!\brief côté (en pixels) d'une tuile de suivi des zones modifiées. */
+#define DIRTY_TILE_SIZE (1 << DIRTY_TILE_SHIFT)
+/*!\brief nombre de PBO de l'anneau d'envoi d'un écran en mode flux. */
+#define STREAM_RING_SIZE 3
+
+/*!\brief ressources du mode flux (streaming) d'un écran, voir \ref
+ * gl4dpSetStreaming. */
+typedef struct stream_t stream_t;
+struct stream_t {
+  GLuint upPBO[STREAM_RING_SIZE], downPBO, cur;
+  /* pointeurs des PBO mappés de manière persistante ; NULL si
+   * glBufferStorage n'est pas disponible (mappage à chaque envoi). */
+  GLubyte * upMap[STREAM_RING_SIZE];
+  GLsync upFence[STREAM_RING_SIZE], downFence;
+};
+
 typedef struct screen_node_t screen_node_t;
 struct screen_node_t {
   Uint32 * pixels;
   GLuint w, h, tId, isCPUToDate, isGPUToDate;
+  /* grille des tuiles modifiées côté CPU et non encore envoyées au
+   * GPU ; tw x th tuiles de DIRTY_TILE_SIZE^2 pixels. rects reçoit
+   * les rectangles (x, y, w, h) issus de leur fusion. */
+  GLubyte * dirty;
+  GLuint tw, th;
+  GLint * rects;
+  /* NULL si le mode flux n'est pas activé */
+  stream_t * stream;
+  /* requêtes GL_TIMESTAMP encadrant le dernier envoi et temps (en
+   * ms) des derniers transferts, voir \ref gl4dpGetTransferTimes. */
+  GLuint tQueries[2], tPending;
+  GLdouble times[3];
   struct screen_node_t * next;
 };
 
@@ -31,6 +72,14 @@ static screen_node_t * _screen_list = NULL, ** _cur_screen = &_screen_list;
 static void addScreen(GLuint w, GLuint h);
 static void drawTex(GLuint tId, const GLfloat scale[2], const GLfloat translate[2]);
 static void updateScreenFromGPU(void);
+static void markDirtyRect(screen_node_t * scr, int x0, int y0, int x1, int y1);
+static void clearDirty(screen_node_t * scr);
+static GLuint mergeDirtyTiles(screen_node_t * scr);
+static void uploadRects(screen_node_t * scr, const GLint * rects, GLuint n);
+static void requestReadback(screen_node_t * scr);
+static void freeStream(screen_node_t * scr);
+static void hspan(screen_node_t * scr, int x0, int x1, int y);
+static void clipBounds(screen_node_t * scr, GLint b[4]);
 
 /*!\brief identifiant du programme GLSL */
 static GLuint _pId = 0;
@@ -38,17 +87,34 @@ static GLuint _pId = 0;
 /*!\brief identifiant de la géométrie QUAD GL4Dummies */
 static GLuint _quadId = 0;
 
-/*!\brief La couleur en cours ; a modifier avec les fonctions setColor */
+/*!\brief La couleur en cours ; a modifier avec les fonctions
+ * setColor. */
 static Uint32 _cur_color = 0xFF0000FF;
 
+/*!\brief tuile (x0, y0, x1, y1, bornes incluses) à laquelle sont
+ * restreintes les primitives lorsque le thread courant exécute un
+ * noyau de \ref gl4dpParallelTiles ; NULL sinon. */
+static THREAD_LOCAL const GLint * _tile = NULL;
+
+/*!\brief copie de \a _cur_color propre au thread qui exécute un
+ * noyau de \ref gl4dpParallelTiles : elle part de la couleur de
+ * l'appelant et les setColor faits dans le noyau n'y touchent qu'elle. */
+static THREAD_LOCAL Uint32 _tile_color = 0xFF0000FF;
+
+/*!\brief couleur à utiliser par les primitives du thread courant. */
+#define CUR_COLOR (_tile ? _tile_color : _cur_color)
+
 /*!\brief revoie la \a _cur_color. */
 Uint32 gl4dpGetColor(void) {
-  return _cur_color;
+  return CUR_COLOR;
 }
 
 /*!\brief met dans \a _cur_color la couleur passee en argument. */
 void gl4dpSetColor(Uint32 color) {
-  _cur_color = color;
+  if(_tile)
+    _tile_color = color;
+  else
+    _cur_color = color;
 }
 
 /*!\brief initialise (ou réinitialise) l'écran aux dimensions \a w et
@@ -130,8 +196,19 @@ static void addScreen(GLuint w, GLuint h) {
   assert(newscr->pixels);
   newscr->w = w;
   newscr->h = h;
+  newscr->tw = (w + DIRTY_TILE_SIZE - 1) >> DIRTY_TILE_SHIFT;
+  newscr->th = (h + DIRTY_TILE_SIZE - 1) >> DIRTY_TILE_SHIFT;
+  newscr->dirty = calloc(newscr->tw * newscr->th, sizeof *(newscr->dirty));
+  assert(newscr->dirty);
+  newscr->rects = malloc(4 * newscr->tw * newscr->th * sizeof *(newscr->rects));
+  assert(newscr->rects);
+  newscr->stream = NULL;
+  newscr->tQueries[0] = newscr->tQueries[1] = 0;
+  newscr->tPending = 0;
+  newscr->times[0] = newscr->times[1] = newscr->times[2] = 0.0;
   newscr->isCPUToDate = 1;
   newscr->isGPUToDate = 0;
+  markDirtyRect(newscr, 0, 0, w - 1, h - 1);
   newscr->next = _screen_list;
   _screen_list = newscr;
   _cur_screen = &_screen_list;
@@ -159,6 +236,13 @@ void gl4dpDeleteScreen(void) {
   if(!*_cur_screen) return;
   if((*_cur_screen)->pixels != NULL)
     free((*_cur_screen)->pixels);
+  if((*_cur_screen)->dirty != NULL)
+    free((*_cur_screen)->dirty);
+  if((*_cur_screen)->rects != NULL)
+    free((*_cur_screen)->rects);
+  freeStream(*_cur_screen);
+  if((*_cur_screen)->tQueries[0])
+    glDeleteQueries(2, (*_cur_screen)->tQueries);
   if((*_cur_screen)->tId)
     glDeleteTextures(1, &((*_cur_screen)->tId));
   to_delete = *_cur_screen;
@@ -191,20 +275,28 @@ GLuint * gl4dpGetPixels(void) {
 
 /*!\brief Efface l'écran en mettant 0. */
 void gl4dpClearScreen(void) {
+  if(_tile) {
+    gl4dpClearScreenWith(0);
+    return;
+  }
   if(!(*_cur_screen)->isCPUToDate)
     updateScreenFromGPU();
   memset((*_cur_screen)->pixels, 0, (*_cur_screen)->w * (*_cur_screen)->h * sizeof *(*_cur_screen)->pixels);
-  (*_cur_screen)->isGPUToDate = 0;
+  markDirtyRect(*_cur_screen, 0, 0, (*_cur_screen)->w - 1, (*_cur_screen)->h - 1);
 }
 
 /*!\brief Efface l'écran en y mettant la valeur \a color. */
 void gl4dpClearScreenWith(Uint32 color) {
-  GLuint wh = (*_cur_screen)->w * (*_cur_screen)->h, i;
+  GLint y;
+  if(_tile) {
+    for(y = _tile[1]; y <= _tile[3]; y++)
+      pspanFill(&(*_cur_screen)->pixels[y * (*_cur_screen)->w + _tile[0]], color, _tile[2] - _tile[0] + 1);
+    return;
+  }
   if(!(*_cur_screen)->isCPUToDate)
     updateScreenFromGPU();
-  for(i = 0; i < wh; i++)
-    (*_cur_screen)->pixels[i] = color;
-  (*_cur_screen)->isGPUToDate = 0;
+  pspanFill((*_cur_screen)->pixels, color, (size_t)(*_cur_screen)->w * (*_cur_screen)->h);
+  markDirtyRect(*_cur_screen, 0, 0, (*_cur_screen)->w - 1, (*_cur_screen)->h - 1);
 }
 
 /*!\brief renvoie la couleur à la coordonnée (x, y) */
@@ -216,16 +308,44 @@ Uint32 gl4dpGetPixel(int x, int y) {
 
 /*!\brief met la couleur en cours à la coordonnée (x, y) */
 void gl4dpPutPixel(int x, int y) {
+  if(_tile) {
+    if(x >= _tile[0] && x <= _tile[2] && y >= _tile[1] && y <= _tile[3])
+      (*_cur_screen)->pixels[y * (*_cur_screen)->w + x] = CUR_COLOR;
+    return;
+  }
   if(!(*_cur_screen)->isCPUToDate)
     updateScreenFromGPU();
-  (*_cur_screen)->pixels[y * (*_cur_screen)->w + x] = _cur_color;
+  (*_cur_screen)->pixels[y * (*_cur_screen)->w + x] = CUR_COLOR;
+  (*_cur_screen)->dirty[(y >> DIRTY_TILE_SHIFT) * (*_cur_screen)->tw + (x >> DIRTY_TILE_SHIFT)] = 1;
   (*_cur_screen)->isGPUToDate = 0;
 }
 
+/*!\brief récupère côté CPU le contenu GPU de l'écran courant. En mode
+ * flux, utilise la lecture asynchrone lancée par \ref requestReadback
+ * et n'attend que sa barrière (fence) ; sinon lit la texture de
+ * manière synchrone.
+ */
 static void updateScreenFromGPU(void) {
   const GLfloat s[2] = {1.0, 1.0}, t[2] = {0.0, 0.0};
-  glBindTexture(GL_TEXTURE_2D, (*_cur_screen)->tId);
-  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, (*_cur_screen)->pixels);
+  screen_node_t * scr = *_cur_screen;
+  double t0 = gl4dGetElapsedTime();
+  GLsizeiptr size = scr->w * scr->h * sizeof *(scr->pixels);
+  void * p;
+  glBindTexture(GL_TEXTURE_2D, scr->tId);
+  if(scr->stream && scr->stream->downFence) {
+    while(glClientWaitSync(scr->stream->downFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(scr->stream->downFence);
+    scr->stream->downFence = 0;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, scr->stream->downPBO);
+    if((p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT)) != NULL) {
+      memcpy(scr->pixels, p, size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  } else
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, scr->pixels);
+  scr->times[2] = gl4dGetElapsedTime() - t0;
+  clearDirty(*_cur_screen);
   (*_cur_screen)->isCPUToDate = (*_cur_screen)->isGPUToDate = 1;
   drawTex((*_cur_screen)->tId, s, t);
 }
@@ -234,51 +354,330 @@ static void updateScreenFromGPU(void) {
  * (CPU), qu'il sera donc nécessaire de mettre à jour la mémoire
  * graphique (GPU) lors de l'appel à la fonction \ref
  * gl4dpUpdateScreen.
+ *
+ * La zone modifiée n'étant pas connue, tout l'écran est marqué comme
+ * à renvoyer.
  */
 void gl4dpScreenHasChanged(void) {
-  (*_cur_screen)->isGPUToDate = 0;
+  markDirtyRect(*_cur_screen, 0, 0, (*_cur_screen)->w - 1, (*_cur_screen)->h - 1);
 }
 
 /*!\brief met à jour l'écran en envoyant la sous texture de dimensions
- * \a rect à GL. Si rect vaut NULL, met à jour toute la texture.
+ * \a rect à GL. Si rect vaut NULL, n'envoie que les tuiles modifiées
+ * depuis la dernière mise à jour (voir \ref mergeDirtyTiles).
  *
  * \param rect le pointeur vers les quatre entiers positifs x,y (coin haut gauche du rectangle) et w,h (les dimensions du rectangle).
  */
 void gl4dpUpdateScreen(GLint * rect) {
   const GLfloat s[2] = {1.0, 1.0}, t[2] = {0.0, 0.0};
+  GL4D_PROF_BEGIN("gl4dpUpdateScreen");
   if(!(*_cur_screen)->isCPUToDate) {
-  updateScreenFromGPU();
-  return;
+    updateScreenFromGPU();
+    GL4D_PROF_END();
+    return;
   }
   glBindTexture(GL_TEXTURE_2D, (*_cur_screen)->tId);
   if(!(*_cur_screen)->isGPUToDate) {
     if(rect == NULL)
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (*_cur_screen)->w, (*_cur_screen)->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, (*_cur_screen)->pixels);
-    else {
-      glPixelStorei(GL_UNPACK_ROW_LENGTH, (*_cur_screen)->w);
-      glTexSubImage2D(GL_TEXTURE_2D, 0, rect[0], rect[1], rect[2], rect[3], GL_RGBA, GL_UNSIGNED_BYTE, &(*_cur_screen)->pixels[rect[0] + rect[1] * (*_cur_screen)->w]);
-      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    }
+      uploadRects(*_cur_screen, (*_cur_screen)->rects, mergeDirtyTiles(*_cur_screen));
+    else
+      uploadRects(*_cur_screen, rect, 1);
   }
+  clearDirty(*_cur_screen);
   (*_cur_screen)->isCPUToDate = (*_cur_screen)->isGPUToDate = 1;
   drawTex((*_cur_screen)->tId, s, t);
+  GL4D_PROF_END();
+}
+
+/*!\brief marque comme modifiées (à renvoyer au GPU) toutes les tuiles
+ * de l'écran \a scr intersectant le rectangle (x0, y0) - (x1, y1)
+ * (bornes incluses). Le rectangle est ramené aux limites de l'écran.
+ */
+static void markDirtyRect(screen_node_t * scr, int x0, int y0, int x1, int y1) {
+  int tx, ty, tx0, tx1, ty0, ty1;
+  if(_tile) return; /* tout l'écran est marqué à la fin de gl4dpParallelTiles */
+  if(x0 > x1) { tx = x0; x0 = x1; x1 = tx; }
+  if(y0 > y1) { ty = y0; y0 = y1; y1 = ty; }
+  if(x1 < 0 || y1 < 0 || x0 >= (int)scr->w || y0 >= (int)scr->h)
+    return;
+  tx0 = MAX(0, x0) >> DIRTY_TILE_SHIFT;
+  ty0 = MAX(0, y0) >> DIRTY_TILE_SHIFT;
+  tx1 = MIN(x1, (int)scr->w - 1) >> DIRTY_TILE_SHIFT;
+  ty1 = MIN(y1, (int)scr->h - 1) >> DIRTY_TILE_SHIFT;
+  for(ty = ty0; ty <= ty1; ty++)
+    memset(&scr->dirty[ty * scr->tw + tx0], 1, tx1 - tx0 + 1);
+  scr->isGPUToDate = 0;
+}
+
+/*!\brief remet à zéro la grille des tuiles modifiées de l'écran \a scr. */
+static void clearDirty(screen_node_t * scr) {
+  memset(scr->dirty, 0, scr->tw * scr->th * sizeof *(scr->dirty));
+}
+
+/*!\brief fusionne les tuiles modifiées de l'écran \a scr en
+ * rectangles (x, y, w, h) rangés dans scr->rects et remet la grille
+ * à zéro.
+ *
+ * Chaque suite horizontale de tuiles modifiées est étendue vers le
+ * bas tant que les lignes de tuiles suivantes sont entièrement
+ * modifiées sur le même intervalle ; un écran totalement modifié
+ * donne donc un seul rectangle.
+ *
+ * \return le nombre de rectangles produits.
+ */
+static GLuint mergeDirtyTiles(screen_node_t * scr) {
+  GLuint tx, ty, tx0, ty1, i, n = 0;
+  GLint * r = scr->rects;
+  for(ty = 0; ty < scr->th; ty++) {
+    for(tx = 0; tx < scr->tw; ) {
+      if(!scr->dirty[ty * scr->tw + tx]) { tx++; continue; }
+      for(tx0 = tx; tx < scr->tw && scr->dirty[ty * scr->tw + tx]; tx++)
+        scr->dirty[ty * scr->tw + tx] = 0;
+      for(ty1 = ty + 1; ty1 < scr->th; ty1++) {
+        for(i = tx0; i < tx && scr->dirty[ty1 * scr->tw + i]; i++);
+        if(i < tx) break;
+        memset(&scr->dirty[ty1 * scr->tw + tx0], 0, tx - tx0);
+      }
+      r[0] = tx0 << DIRTY_TILE_SHIFT;
+      r[1] = ty  << DIRTY_TILE_SHIFT;
+      r[2] = MIN(tx  << DIRTY_TILE_SHIFT, scr->w) - r[0];
+      r[3] = MIN(ty1 << DIRTY_TILE_SHIFT, scr->h) - r[1];
+      r += 4; n++;
+    }
+  }
+  return n;
+}
+
+/*!\brief envoie au GPU, via glTexSubImage2D, les \a n rectangles
+ * (x, y, w, h) de \a rects de l'écran \a scr (dont la texture doit
+ * être liée). Le stockage de la texture, alloué à l'initialisation de
+ * l'écran, est réutilisé.
+ *
+ * En mode flux, les rectangles sont recopiés dans le PBO suivant de
+ * l'anneau (en n'attendant que la barrière posée lors de sa
+ * précédente utilisation, STREAM_RING_SIZE envois plus tôt) puis
+ * transférés depuis ce PBO ; l'appel rend la main sans attendre la
+ * fin du transfert.
+ *
+ * Le temps CPU de l'envoi est mesuré à chaque appel ; le temps GPU
+ * l'est par une paire de GL_TIMESTAMP dont le résultat n'est lu que
+ * lorsqu'il est disponible, sans jamais bloquer.
+ */
+static void uploadRects(screen_node_t * scr, const GLint * rects, GLuint n) {
+  GLuint i, y, k;
+  GLint available = 0;
+  GLuint64 ts[2];
+  GLubyte * map = NULL;
+  GLsizeiptr size = scr->w * scr->h * sizeof *(scr->pixels);
+  stream_t * st = scr->stream;
+  double t0 = gl4dGetElapsedTime();
+  if(!scr->tQueries[0])
+    glGenQueries(2, scr->tQueries);
+  if(scr->tPending) {
+    glGetQueryObjectiv(scr->tQueries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available) {
+      glGetQueryObjectui64v(scr->tQueries[0], GL_QUERY_RESULT, &ts[0]);
+      glGetQueryObjectui64v(scr->tQueries[1], GL_QUERY_RESULT, &ts[1]);
+      scr->times[1] = (ts[1] - ts[0]) / 1000000.0;
+      scr->tPending = 0;
+    }
+  }
+  if(!scr->tPending)
+    glQueryCounter(scr->tQueries[0], GL_TIMESTAMP);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, scr->w);
+  if(st) {
+    k = st->cur;
+    if(st->upFence[k]) {
+      while(glClientWaitSync(st->upFence[k], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+      glDeleteSync(st->upFence[k]);
+      st->upFence[k] = 0;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->upPBO[k]);
+    map = st->upMap[k] ? st->upMap[k] :
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if(map) {
+      for(i = 0; i < n; i++) {
+        const GLint * r = &rects[4 * i];
+        for(y = r[1]; y < (GLuint)(r[1] + r[3]); y++)
+          memcpy(&map[(y * scr->w + r[0]) * sizeof *(scr->pixels)], &scr->pixels[y * scr->w + r[0]], r[2] * sizeof *(scr->pixels));
+      }
+      if(!st->upMap[k])
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      for(i = 0; i < n; i++) {
+        const GLint * r = &rects[4 * i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r[0], r[1], r[2], r[3], GL_RGBA, GL_UNSIGNED_BYTE,
+                        (const GLvoid *)((r[1] * scr->w + r[0]) * sizeof *(scr->pixels)));
+      }
+      st->upFence[k] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      st->cur = (k + 1) % STREAM_RING_SIZE;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  if(!map) /* pas de mode flux ou mappage impossible */
+    for(i = 0; i < n; i++) {
+      const GLint * r = &rects[4 * i];
+      glTexSubImage2D(GL_TEXTURE_2D, 0, r[0], r[1], r[2], r[3], GL_RGBA, GL_UNSIGNED_BYTE, &scr->pixels[r[1] * scr->w + r[0]]);
+    }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  if(!scr->tPending) {
+    glQueryCounter(scr->tQueries[1], GL_TIMESTAMP);
+    scr->tPending = 1;
+  }
+  scr->times[0] = gl4dGetElapsedTime() - t0;
+}
+
+/*!\brief en mode flux, lance la lecture asynchrone de la texture de
+ * l'écran \a scr vers son PBO de lecture et pose une barrière
+ * ; \ref updateScreenFromGPU n'aura plus qu'à attendre cette
+ * dernière. Sans effet hors mode flux.
+ */
+static void requestReadback(screen_node_t * scr) {
+  if(!scr->stream) return;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, scr->stream->downPBO);
+  glBindTexture(GL_TEXTURE_2D, scr->tId);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if(scr->stream->downFence)
+    glDeleteSync(scr->stream->downFence);
+  scr->stream->downFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/*!\brief libère les ressources du mode flux de l'écran \a scr. */
+static void freeStream(screen_node_t * scr) {
+  GLuint i;
+  stream_t * st = scr->stream;
+  if(!st) return;
+  for(i = 0; i < STREAM_RING_SIZE; i++) {
+    if(st->upFence[i])
+      glDeleteSync(st->upFence[i]);
+    if(st->upMap[i]) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->upPBO[i]);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if(st->downFence)
+    glDeleteSync(st->downFence);
+  glDeleteBuffers(STREAM_RING_SIZE, st->upPBO);
+  glDeleteBuffers(1, &(st->downPBO));
+  free(st);
+  scr->stream = NULL;
+}
+
+/*!\brief active ou désactive le mode flux (streaming) de l'écran
+ * courant.
+ *
+ * En mode flux, les envois vers le GPU passent par un anneau de
+ * STREAM_RING_SIZE PBO (mappés de manière persistante si GL >= 4.4,
+ * sinon mappés à chaque envoi sans synchronisation implicite) :
+ * \ref gl4dpUpdateScreen rend la main sans attendre le transfert, le
+ * dessin CPU de l'image suivante se recouvre donc avec l'envoi de la
+ * précédente. Les lectures depuis le GPU (après \ref gl4dpMap ou
+ * \ref gl4dpCopyFromSDLSurfaceWithTransforms) sont lancées de
+ * manière asynchrone vers un PBO dès la fin du rendu GPU et ne sont
+ * attendues qu'au premier accès CPU.
+ *
+ * \param enable GL_TRUE pour activer, GL_FALSE pour désactiver.
+ * \see gl4dpGetTransferTimes
+ */
+void gl4dpSetStreaming(GLboolean enable) {
+  GLuint i;
+  GLint major = 0, minor = 0;
+  GLsizeiptr size;
+  stream_t * st;
+  screen_node_t * scr = *_cur_screen;
+  if(!enable) {
+    freeStream(scr);
+    return;
+  }
+  if(scr->stream) return;
+  size = scr->w * scr->h * sizeof *(scr->pixels);
+  st = scr->stream = calloc(1, sizeof *st);
+  assert(st);
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  glGenBuffers(STREAM_RING_SIZE, st->upPBO);
+  glGenBuffers(1, &(st->downPBO));
+  for(i = 0; i < STREAM_RING_SIZE; i++) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->upPBO[i]);
+#ifdef GL_MAP_PERSISTENT_BIT
+    if(major > 4 || (major == 4 && minor >= 4)) {
+      const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+      st->upMap[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+      continue;
+    }
+#endif
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, st->downPBO);
+  glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/*!\brief renvoie les temps (en millisecondes) des derniers transferts
+ * de l'écran courant.
+ *
+ * \param times reçoit : times[0] le temps CPU du dernier envoi
+ * (\ref gl4dpUpdateScreen), times[1] le temps GPU du dernier envoi
+ * dont la mesure est disponible (généralement une ou deux images de
+ * retard) et times[2] le temps CPU de la dernière lecture depuis le
+ * GPU (attente incluse).
+ */
+void gl4dpGetTransferTimes(GLdouble times[3]) {
+  times[0] = (*_cur_screen)->times[0];
+  times[1] = (*_cur_screen)->times[1];
+  times[2] = (*_cur_screen)->times[2];
 }
 
 /*!\brief dessine un rectangle
- * \a rect en utilisant la couleur en cours.
+ * \a rect en utilisant la couleur en cours. Le rectangle est découpé
+ * aux limites de l'écran.
  *
  * \param rect le pointeur vers les quatre entiers positifs x,y (coin haut gauche du rectangle) et w,h (les dimensions du rectangle).
  */
 void gl4dpRect(GLint * rect) {
-  GLint x, y, yw, mx = rect[0] + rect[2], my = rect[1] + rect[3];
-  if(!(*_cur_screen)->isCPUToDate)
+  screen_node_t * scr = *_cur_screen;
+  GLint y, x0, y0, mx, my, b[4];
+  clipBounds(scr, b);
+  x0 = MAX(b[0], rect[0]);
+  y0 = MAX(b[1], rect[1]);
+  mx = MIN(rect[0] + rect[2], b[2] + 1);
+  my = MIN(rect[1] + rect[3], b[3] + 1);
+  if(x0 >= mx || y0 >= my) return;
+  if(!scr->isCPUToDate)
     updateScreenFromGPU();
-  for(y = rect[1]; y < my; y++) {
-    yw = y * (*_cur_screen)->w;
-    for(x = rect[0]; x < mx; x++)
-      (*_cur_screen)->pixels[x + yw] = _cur_color;
+  for(y = y0; y < my; y++)
+    pspanFill(&scr->pixels[y * scr->w + x0], CUR_COLOR, mx - x0);
+  markDirtyRect(scr, x0, y0, mx - 1, my - 1);
+}
+
+/*!\brief remplit avec la couleur en cours le segment horizontal (x0,
+ * y) -> (x1, y) de l'écran \a scr. Le segment est découpé une seule
+ * fois (voir \ref clipBounds) puis confié à \ref pspanFill ; les
+ * tuiles modifiées ne sont pas marquées (à la charge de l'appelant).
+ */
+static void hspan(screen_node_t * scr, int x0, int x1, int y) {
+  GLint t, b[4];
+  clipBounds(scr, b);
+  if(x0 > x1) { t = x0; x0 = x1; x1 = t; }
+  if(y < b[1] || y > b[3] || x1 < b[0] || x0 > b[2])
+    return;
+  x0 = MAX(b[0], x0);
+  x1 = MIN(x1, b[2]);
+  pspanFill(&scr->pixels[y * scr->w + x0], CUR_COLOR, x1 - x0 + 1);
+}
+
+/*!\brief renvoie dans \a b les bornes (x0, y0, x1, y1, incluses) de
+ * la zone dessinable de l'écran \a scr : la tuile courante dans un
+ * noyau de \ref gl4dpParallelTiles, l'écran entier sinon. */
+static void clipBounds(screen_node_t * scr, GLint b[4]) {
+  if(_tile) {
+    b[0] = _tile[0]; b[1] = _tile[1]; b[2] = _tile[2]; b[3] = _tile[3];
+  } else {
+    b[0] = 0; b[1] = 0; b[2] = (GLint)scr->w - 1; b[3] = (GLint)scr->h - 1;
   }
-  (*_cur_screen)->isGPUToDate = 0;
 }
 
 /*!\brief dessine un segment (x0, y0) -> (x1, y1) de couleur \a
@@ -317,7 +716,6 @@ void gl4dpLine(int x0, int y0, int x1, int y1) {
       }
     }
   }
-  (*_cur_screen)->isGPUToDate = 0;
 }
 
 /*!\brief dessine un cercle centré en (x0, y0) de rayon r en
@@ -346,41 +744,36 @@ void gl4dpCircle(int x0, int y0, int r) {
       del += incO;
     }
   }
-  (*_cur_screen)->isGPUToDate = 0;
 }
 
-/*!\brief dessine un segment horizontal (x0, y) -> (x1, y).
+/*!\brief dessine un segment horizontal (x0, y) -> (x1, y). Le
+ * segment est découpé aux limites de l'écran.
  */
 void gl4dpHLine(int x0, int x1, int y) {
-  int x, pasX = (x1 - x0) < 0 ? -1 : 1, x1pp;
   if(!(*_cur_screen)->isCPUToDate)
     updateScreenFromGPU();
-  y  = MIN(MAX(0, y), ((int)gl4dpGetHeight()) - 1);
-  x0 = MIN(MAX(0, x0), ((int)gl4dpGetWidth()) - 1);
-  x1 = MIN(MAX(0, x1), ((int)gl4dpGetWidth()) - 1);
-  x1pp = x1 + pasX;
-  for(x = x0; x != x1pp; x += pasX)
-    gl4dpPutPixel(x, y);
-  (*_cur_screen)->isGPUToDate = 0;
+  hspan(*_cur_screen, x0, x1, y);
+  markDirtyRect(*_cur_screen, x0, y, x1, y);
 }
 
 /*!\brief dessine un cercle plein centré en (x0, y0) de rayon r
  * en utilisant l'algorithme de Bresenham'77.
  *
- * \see hLine
+ * \see hspan
  */
 void gl4dpFilledCircle(int x0, int y0, int r) {
   int x, y, del, incH, incO, t = M_SQRT1_2 * r + 1;
-  if(!(*_cur_screen)->isCPUToDate)
+  screen_node_t * scr = *_cur_screen;
+  if(!scr->isCPUToDate)
     updateScreenFromGPU();
   del = 3 - (r << 1);
   incH = 6;
   incO = 10 - (r << 2);
   for(x = 0, y = r; x <= t; x++, incH += 4, incO += 4) {
-    gl4dpHLine(x0 + x, x0 - x, y0 + y);
-    gl4dpHLine(x0 + x, x0 - x, y0 - y);
-    gl4dpHLine(x0 + y, x0 - y, y0 + x);
-    gl4dpHLine(x0 + y, x0 - y, y0 - x);
+    hspan(scr, x0 + x, x0 - x, y0 + y);
+    hspan(scr, x0 + x, x0 - x, y0 - y);
+    hspan(scr, x0 + y, x0 - y, y0 + x);
+    hspan(scr, x0 + y, x0 - y, y0 - x);
     if(del < 0) del += incH;
     else {
       y--;
@@ -388,7 +781,464 @@ void gl4dpFilledCircle(int x0, int y0, int r) {
       del += incO;
     }
   }
-  (*_cur_screen)->isGPUToDate = 0;
+  markDirtyRect(scr, x0 - r, y0 - r, x0 + r, y0 + r);
+}
+
+/*!\brief travail partagé par les tâches (une par tuile) de \ref
+ * gl4dpParallelTiles, \ref gl4dpParallelRows et \ref
+ * gl4dpParallelPixels ; un seul des noyaux est renseigné. */
+typedef struct ptile_job_t ptile_job_t;
+struct ptile_job_t {
+  screen_node_t * scr;
+  Uint32 color;
+  void   (*tfunc)(const GLint rect[4], void * data);
+  void   (*rfunc)(Uint32 * row, int x0, int x1, int y, void * data);
+  Uint32 (*pfunc)(int x, int y, Uint32 color, void * data);
+  void * data;
+};
+
+/*!\brief exécute le noyau du travail \a arg sur la tuile \a task
+ * (tuiles de DIRTY_TILE_SIZE^2 pixels, numérotées ligne par ligne). */
+static void ptileTask(size_t task, GLuint thread, void * arg) {
+  ptile_job_t * job = (ptile_job_t *)arg;
+  screen_node_t * scr = job->scr;
+  GLint clip[4], x, y;
+  (void)thread;
+  clip[0] = (GLint)(task % scr->tw) << DIRTY_TILE_SHIFT;
+  clip[1] = (GLint)(task / scr->tw) << DIRTY_TILE_SHIFT;
+  clip[2] = MIN(clip[0] + DIRTY_TILE_SIZE, (GLint)scr->w) - 1;
+  clip[3] = MIN(clip[1] + DIRTY_TILE_SIZE, (GLint)scr->h) - 1;
+  _tile_color = job->color;
+  _tile = clip;
+  if(job->tfunc) {
+    const GLint rect[4] = { clip[0], clip[1], clip[2] - clip[0] + 1, clip[3] - clip[1] + 1 };
+    job->tfunc(rect, job->data);
+  } else if(job->rfunc) {
+    for(y = clip[1]; y <= clip[3]; y++)
+      job->rfunc(&scr->pixels[y * scr->w], clip[0], clip[2] + 1, y, job->data);
+  } else {
+    for(y = clip[1]; y <= clip[3]; y++) {
+      Uint32 * p = &scr->pixels[y * scr->w];
+      for(x = clip[0]; x <= clip[2]; x++)
+        p[x] = job->pfunc(x, y, p[x], job->data);
+    }
+  }
+  _tile = NULL;
+}
+
+/*!\brief répartit les tuiles de l'écran courant entre les threads de
+ * la réserve (voir \ref tpoolFor) puis marque l'écran comme modifié,
+ * une seule fois, à la fin. */
+static void parallelRun(ptile_job_t * job) {
+  screen_node_t * scr = *_cur_screen;
+  assert(!_tile); /* pas d'appel imbriqué depuis un noyau */
+  if(!scr->isCPUToDate)
+    updateScreenFromGPU();
+  job->scr = scr;
+  job->color = _cur_color;
+  tpoolFor(scr->tw * scr->th, ptileTask, job);
+  markDirtyRect(scr, 0, 0, scr->w - 1, scr->h - 1);
+}
+
+/*!\brief exécute en parallèle le noyau \a func sur chaque tuile de
+ * l'écran courant.
+ *
+ * L'écran est découpé en tuiles de DIRTY_TILE_SIZE x DIRTY_TILE_SIZE
+ * pixels (16 Ko, qui tiennent en cache L1) réparties entre les
+ * threads de la réserve avec vol de tâches ; le thread appelant y
+ * participe et la fonction ne rend la main qu'une fois toutes les
+ * tuiles traitées. L'écran est alors marqué comme modifié, il reste à
+ * appeler \ref gl4dpUpdateScreen.
+ *
+ * Dans \a func, les primitives de dessin (\ref gl4dpPutPixel, \ref
+ * gl4dpLine, \ref gl4dpFilledCircle, \ref gl4dpClearScreen, ...)
+ * peuvent être appelées sans risque : elles sont restreintes à la
+ * tuile en cours et la couleur en cours (\ref gl4dpSetColor) est
+ * propre à chaque thread, initialisée à celle de l'appelant. \a func
+ * ne doit en revanche ni appeler de fonction GL (dont \ref
+ * gl4dpUpdateScreen et \ref gl4dpMap), ni changer d'écran, ni lancer
+ * une nouvelle boucle parallèle.
+ *
+ * \param func noyau appelé pour chaque tuile avec son rectangle (x,
+ * y, w, h) dans l'écran.
+ * \param data donnée utilisateur passée à \a func.
+ * \see tpoolSetNbThreads
+ */
+void gl4dpParallelTiles(void (*func)(const GLint rect[4], void * data), void * data) {
+  ptile_job_t job = { NULL, 0, NULL, NULL, NULL, NULL };
+  job.tfunc = func;
+  job.data = data;
+  parallelRun(&job);
+}
+
+/*!\brief exécute en parallèle le noyau de ligne \a func sur l'écran
+ * courant, voir \ref gl4dpParallelTiles.
+ *
+ * \param func noyau appelé pour chaque morceau de ligne d'une tuile
+ * avec \a row pointant sur le premier pixel de la ligne \a y de
+ * l'écran ; il doit traiter les pixels row[x0] à row[x1 - 1].
+ * \param data donnée utilisateur passée à \a func.
+ */
+void gl4dpParallelRows(void (*func)(Uint32 * row, int x0, int x1, int y, void * data), void * data) {
+  ptile_job_t job = { NULL, 0, NULL, NULL, NULL, NULL };
+  job.rfunc = func;
+  job.data = data;
+  parallelRun(&job);
+}
+
+/*!\brief exécute en parallèle le noyau de pixel \a func sur l'écran
+ * courant, voir \ref gl4dpParallelTiles.
+ *
+ * \param func noyau appelé pour chaque pixel (x, y) avec sa couleur
+ * actuelle et retournant sa nouvelle couleur.
+ * \param data donnée utilisateur passée à \a func.
+ */
+void gl4dpParallelPixels(Uint32 (*func)(int x, int y, Uint32 color, void * data), void * data) {
+  ptile_job_t job = { NULL, 0, NULL, NULL, NULL, NULL };
+  job.pfunc = func;
+  job.data = data;
+  parallelRun(&job);
+}
+
+/*!\brief types de commandes d'un lot de primitives (\ref GL4DPbatch). */
+enum {
+  BATCH_POINT = 0,
+  BATCH_LINE,
+  BATCH_CIRCLE,
+  BATCH_FILLED_CIRCLE,
+  BATCH_RECT
+};
+
+/*!\brief une commande de dessin enregistrée : son type, sa couleur et
+ * jusqu'à quatre paramètres entiers (x0, y0, x1, y1 pour un segment,
+ * x, y, r pour un cercle, x, y, w, h pour un rectangle). */
+typedef struct batch_cmd_t batch_cmd_t;
+struct batch_cmd_t {
+  Uint32 color;
+  GLint p[4];
+  GLubyte type;
+};
+
+/*!\brief lot de primitives à rasteriser en une passe, voir \ref
+ * gl4dpBatchDraw. Les tableaux de répartition par tuile (bins) sont
+ * conservés d'un tracé à l'autre pour ne pas réallouer à chaque
+ * image. */
+struct GL4DPbatch {
+  batch_cmd_t * cmds;
+  size_t nb, size;
+  /* binStart[t] .. binStart[t + 1] - 1 : indices, dans bins, des
+   * commandes touchant la tuile t (dans l'ordre d'enregistrement). */
+  GLuint * binStart, * binCur, * bins;
+  size_t nbTiles, binsSize;
+};
+
+/*!\brief contexte partagé par les tâches de \ref batchTask. */
+typedef struct batch_job_t batch_job_t;
+struct batch_job_t {
+  GL4DPbatch * b;
+  screen_node_t * scr;
+};
+
+static batch_cmd_t * batchPush(GL4DPbatch * b, GLubyte type, Uint32 color) {
+  if(b->nb == b->size) {
+    b->size = b->size ? b->size << 1 : 256;
+    b->cmds = realloc(b->cmds, b->size * sizeof *(b->cmds));
+    assert(b->cmds);
+  }
+  b->cmds[b->nb].type = type;
+  b->cmds[b->nb].color = color;
+  return &(b->cmds[b->nb++]);
+}
+
+/*!\brief calcule dans \a bb la boîte englobante (x0, y0, x1, y1,
+ * bornes incluses) de la commande \a c découpée à l'écran \a scr.
+ * \return 0 si la commande est entièrement hors de l'écran, 1 sinon.
+ */
+static int batchBBox(const batch_cmd_t * c, const screen_node_t * scr, GLint bb[4]) {
+  switch(c->type) {
+  case BATCH_POINT:
+    bb[0] = bb[2] = c->p[0]; bb[1] = bb[3] = c->p[1];
+    break;
+  case BATCH_LINE:
+    bb[0] = MIN(c->p[0], c->p[2]); bb[2] = MAX(c->p[0], c->p[2]);
+    bb[1] = MIN(c->p[1], c->p[3]); bb[3] = MAX(c->p[1], c->p[3]);
+    break;
+  case BATCH_CIRCLE:
+  case BATCH_FILLED_CIRCLE:
+    bb[0] = c->p[0] - c->p[2]; bb[2] = c->p[0] + c->p[2];
+    bb[1] = c->p[1] - c->p[2]; bb[3] = c->p[1] + c->p[2];
+    break;
+  default: /* BATCH_RECT */
+    bb[0] = c->p[0]; bb[2] = c->p[0] + c->p[2] - 1;
+    bb[1] = c->p[1]; bb[3] = c->p[1] + c->p[3] - 1;
+    break;
+  }
+  bb[0] = MAX(bb[0], 0); bb[2] = MIN(bb[2], (GLint)scr->w - 1);
+  bb[1] = MAX(bb[1], 0); bb[3] = MIN(bb[3], (GLint)scr->h - 1);
+  return bb[0] <= bb[2] && bb[1] <= bb[3];
+}
+
+/*!\brief trace dans l'écran \a scr, restreint au rectangle \a b (x0,
+ * y0, x1, y1, bornes incluses), le segment (x0, y0) -> (x1, y1) de
+ * couleur \a color. Produit exactement les pixels de \ref gl4dpLine
+ * : le Bresenham est repris directement au premier pas entrant dans
+ * \a b (pour un pas k le long de l'axe principal de longueur d et
+ * l'axe secondaire de longueur e, le décalage secondaire vaut
+ * floor((2ke + d) / 2d)).
+ */
+static void batchLine(screen_node_t * scr, const GLint b[4], GLint x0, GLint y0, GLint x1, GLint y1, Uint32 color) {
+  GLint u = x1 - x0, v = y1 - y0, pasX = (u < 0) ? -1 : 1, pasY = (v < 0) ? -1 : 1;
+  GLint du = abs(u), dv = abs(v), d, e, p0, s0, pasP, pasS, lo, hi, k0, k1, k, p, s, del;
+  GLint xmaj = du >= dv, mlo, mhi, slo, shi;
+  if(xmaj) {
+    d = du; e = dv; p0 = x0; s0 = y0; pasP = pasX; pasS = pasY;
+    mlo = b[0]; mhi = b[2]; slo = b[1]; shi = b[3];
+  } else {
+    d = dv; e = du; p0 = y0; s0 = x0; pasP = pasY; pasS = pasX;
+    mlo = b[1]; mhi = b[3]; slo = b[0]; shi = b[2];
+  }
+  /* pas k tels que l'axe principal est dans le rectangle */
+  lo = pasP > 0 ? mlo - p0 : p0 - mhi;
+  hi = pasP > 0 ? mhi - p0 : p0 - mlo;
+  k0 = MAX(lo, 0);
+  k1 = MIN(hi, d);
+  if(k0 > k1) return;
+  s = d ? (GLint)((2LL * k0 * e + d) / (2LL * d)) : 0;
+  del = (GLint)(2LL * e - d + 2LL * k0 * e - 2LL * s * d);
+  s = s0 + pasS * s;
+  for(k = k0, p = p0 + pasP * k0; k <= k1; k++, p += pasP) {
+    if(s >= slo && s <= shi) {
+      if(xmaj) scr->pixels[s * scr->w + p] = color;
+      else     scr->pixels[p * scr->w + s] = color;
+    } else if((pasS > 0 && s > shi) || (pasS < 0 && s < slo))
+      break; /* l'axe secondaire est monotone : on est sorti pour de bon */
+    if(del < 0) del += 2 * e;
+    else {
+      del += 2 * (e - d);
+      s += pasS;
+    }
+  }
+}
+
+/*!\brief remplit le segment horizontal (x0, y) -> (x1, y) de couleur
+ * \a color, restreint au rectangle \a b (x0, y0, x1, y1, inclus). */
+static void batchSpan(screen_node_t * scr, const GLint b[4], GLint x0, GLint x1, GLint y, Uint32 color) {
+  GLint t;
+  if(x0 > x1) { t = x0; x0 = x1; x1 = t; }
+  if(y < b[1] || y > b[3] || x1 < b[0] || x0 > b[2]) return;
+  x0 = MAX(b[0], x0);
+  x1 = MIN(x1, b[2]);
+  pspanFill(&scr->pixels[y * scr->w + x0], color, x1 - x0 + 1);
+}
+
+/*!\brief met le pixel (x, y) à \a color s'il est dans le rectangle \a
+ * b (x0, y0, x1, y1, inclus). */
+#define BATCH_PLOT(scr, b, x, y, color) do {				\
+    if((x) >= (b)[0] && (x) <= (b)[2] && (y) >= (b)[1] && (y) <= (b)[3]) \
+      (scr)->pixels[(y) * (scr)->w + (x)] = (color);			\
+  } while(0)
+
+/*!\brief rasterise la commande \a c dans l'écran \a scr en la
+ * restreignant au rectangle \a b (x0, y0, x1, y1, inclus) ; mêmes
+ * pixels que les primitives gl4dp correspondantes. */
+static void batchRaster(screen_node_t * scr, const batch_cmd_t * c, const GLint b[4]) {
+  GLint x, y, del, incH, incO, t, x0 = c->p[0], y0 = c->p[1], r = c->p[2];
+  switch(c->type) {
+  case BATCH_POINT:
+    BATCH_PLOT(scr, b, x0, y0, c->color);
+    break;
+  case BATCH_LINE:
+    batchLine(scr, b, x0, y0, c->p[2], c->p[3], c->color);
+    break;
+  case BATCH_CIRCLE:
+  case BATCH_FILLED_CIRCLE:
+    t = M_SQRT1_2 * r + 1;
+    del = 3 - (r << 1);
+    incH = 6;
+    incO = 10 - (r << 2);
+    for(x = 0, y = r; x <= t; x++, incH += 4, incO += 4) {
+      if(c->type == BATCH_FILLED_CIRCLE) {
+        batchSpan(scr, b, x0 + x, x0 - x, y0 + y, c->color);
+        batchSpan(scr, b, x0 + x, x0 - x, y0 - y, c->color);
+        batchSpan(scr, b, x0 + y, x0 - y, y0 + x, c->color);
+        batchSpan(scr, b, x0 + y, x0 - y, y0 - x, c->color);
+      } else {
+        BATCH_PLOT(scr, b, x0 + x, y0 + y, c->color);
+        BATCH_PLOT(scr, b, x0 + x, y0 - y, c->color);
+        BATCH_PLOT(scr, b, x0 - x, y0 + y, c->color);
+        BATCH_PLOT(scr, b, x0 - x, y0 - y, c->color);
+        BATCH_PLOT(scr, b, x0 + y, y0 + x, c->color);
+        BATCH_PLOT(scr, b, x0 + y, y0 - x, c->color);
+        BATCH_PLOT(scr, b, x0 - y, y0 + x, c->color);
+        BATCH_PLOT(scr, b, x0 - y, y0 - x, c->color);
+      }
+      if(del < 0) del += incH;
+      else {
+        y--;
+        incO += 4;
+        del += incO;
+      }
+    }
+    break;
+  default: /* BATCH_RECT */
+    for(y = MAX(b[1], y0); y <= MIN(b[3], y0 + c->p[3] - 1); y++)
+      batchSpan(scr, b, x0, x0 + c->p[2] - 1, y, c->color);
+    break;
+  }
+}
+
+/*!\brief rasterise, dans l'ordre d'enregistrement, les commandes
+ * rangées dans la tuile \a task. */
+static void batchTask(size_t task, GLuint thread, void * arg) {
+  batch_job_t * job = (batch_job_t *)arg;
+  GL4DPbatch * bt = job->b;
+  screen_node_t * scr = job->scr;
+  GLuint i;
+  GLint b[4];
+  (void)thread;
+  if(bt->binStart[task] == bt->binStart[task + 1]) return;
+  b[0] = (GLint)(task % scr->tw) << DIRTY_TILE_SHIFT;
+  b[1] = (GLint)(task / scr->tw) << DIRTY_TILE_SHIFT;
+  b[2] = MIN(b[0] + DIRTY_TILE_SIZE, (GLint)scr->w) - 1;
+  b[3] = MIN(b[1] + DIRTY_TILE_SIZE, (GLint)scr->h) - 1;
+  for(i = bt->binStart[task]; i < bt->binStart[task + 1]; i++)
+    batchRaster(scr, &(bt->cmds[bt->bins[i]]), b);
+}
+
+/*!\brief créé un lot de primitives vide.
+ *
+ * Un lot enregistre des commandes de dessin (points, segments,
+ * cercles, disques, rectangles), chacune avec sa propre couleur, puis
+ * les rasterise toutes en une passe avec \ref gl4dpBatchDraw. Il peut
+ * être retracé à chaque image ou vidé (\ref gl4dpBatchClear) et
+ * rempli à nouveau sans réallocation.
+ *
+ * \return le lot créé, à libérer avec \ref gl4dpBatchDelete.
+ */
+GL4DPbatch * gl4dpBatchNew(void) {
+  GL4DPbatch * b = calloc(1, sizeof *b);
+  assert(b);
+  return b;
+}
+
+/*!\brief libère le lot \a b. */
+void gl4dpBatchDelete(GL4DPbatch * b) {
+  if(!b) return;
+  free(b->cmds);
+  free(b->binStart);
+  free(b->binCur);
+  free(b->bins);
+  free(b);
+}
+
+/*!\brief vide le lot \a b de ses commandes (la mémoire est conservée). */
+void gl4dpBatchClear(GL4DPbatch * b) {
+  b->nb = 0;
+}
+
+/*!\brief enregistre dans \a b le point (x, y) de couleur \a color. */
+void gl4dpBatchPoint(GL4DPbatch * b, int x, int y, Uint32 color) {
+  batch_cmd_t * c = batchPush(b, BATCH_POINT, color);
+  c->p[0] = x; c->p[1] = y;
+}
+
+/*!\brief enregistre dans \a b le segment (x0, y0) -> (x1, y1) de
+ * couleur \a color (voir \ref gl4dpLine). */
+void gl4dpBatchLine(GL4DPbatch * b, int x0, int y0, int x1, int y1, Uint32 color) {
+  batch_cmd_t * c = batchPush(b, BATCH_LINE, color);
+  c->p[0] = x0; c->p[1] = y0; c->p[2] = x1; c->p[3] = y1;
+}
+
+/*!\brief enregistre dans \a b le cercle de centre (x0, y0) et de rayon
+ * \a r de couleur \a color (voir \ref gl4dpCircle). */
+void gl4dpBatchCircle(GL4DPbatch * b, int x0, int y0, int r, Uint32 color) {
+  batch_cmd_t * c = batchPush(b, BATCH_CIRCLE, color);
+  c->p[0] = x0; c->p[1] = y0; c->p[2] = r;
+}
+
+/*!\brief enregistre dans \a b le disque de centre (x0, y0) et de rayon
+ * \a r de couleur \a color (voir \ref gl4dpFilledCircle). */
+void gl4dpBatchFilledCircle(GL4DPbatch * b, int x0, int y0, int r, Uint32 color) {
+  batch_cmd_t * c = batchPush(b, BATCH_FILLED_CIRCLE, color);
+  c->p[0] = x0; c->p[1] = y0; c->p[2] = r;
+}
+
+/*!\brief enregistre dans \a b le rectangle \a rect (x, y, w, h) de
+ * couleur \a color (voir \ref gl4dpRect). */
+void gl4dpBatchRect(GL4DPbatch * b, const GLint rect[4], Uint32 color) {
+  batch_cmd_t * c = batchPush(b, BATCH_RECT, color);
+  c->p[0] = rect[0]; c->p[1] = rect[1]; c->p[2] = rect[2]; c->p[3] = rect[3];
+}
+
+/*!\brief rasterise toutes les commandes du lot \a b dans l'écran
+ * courant.
+ *
+ * Chaque commande est découpée une seule fois à l'écran (les
+ * commandes hors écran sont écartées) et rangée dans les tuiles
+ * (DIRTY_TILE_SIZE^2 pixels) que couvre sa boîte englobante, par un
+ * tri par dénombrement qui conserve l'ordre d'enregistrement. Chaque
+ * tuile est ensuite rasterisée indépendamment, directement dans les
+ * pixels de l'écran, éventuellement en parallèle (voir \ref
+ * tpoolFor) ; le résultat est identique à celui des appels
+ * successifs aux primitives correspondantes. Seules les tuiles
+ * touchées sont marquées comme modifiées.
+ *
+ * \param b le lot à tracer (il n'est pas vidé).
+ * \param parallel GL_TRUE pour répartir les tuiles entre les threads
+ * de la réserve.
+ */
+void gl4dpBatchDraw(GL4DPbatch * b, GLboolean parallel) {
+  screen_node_t * scr = *_cur_screen;
+  size_t i, nt = scr->tw * scr->th, total = 0;
+  GLint bb[4], tx, ty;
+  batch_job_t job;
+  assert(!_tile); /* pas depuis un noyau de gl4dpParallelTiles */
+  if(!b->nb) return;
+  if(!scr->isCPUToDate)
+    updateScreenFromGPU();
+  if(b->nbTiles < nt) {
+    b->binStart = realloc(b->binStart, (nt + 1) * sizeof *(b->binStart));
+    b->binCur = realloc(b->binCur, (nt + 1) * sizeof *(b->binCur));
+    assert(b->binStart && b->binCur);
+    b->nbTiles = nt;
+  }
+  memset(b->binStart, 0, (nt + 1) * sizeof *(b->binStart));
+  /* 1ère passe : nombre de commandes par tuile */
+  for(i = 0; i < b->nb; i++) {
+    if(!batchBBox(&(b->cmds[i]), scr, bb)) continue;
+    for(ty = bb[1] >> DIRTY_TILE_SHIFT; ty <= bb[3] >> DIRTY_TILE_SHIFT; ty++)
+      for(tx = bb[0] >> DIRTY_TILE_SHIFT; tx <= bb[2] >> DIRTY_TILE_SHIFT; tx++)
+        b->binStart[ty * scr->tw + tx + 1]++;
+  }
+  for(i = 0; i < nt; i++) {
+    b->binStart[i + 1] += b->binStart[i];
+    b->binCur[i] = b->binStart[i];
+  }
+  total = b->binStart[nt];
+  if(b->binsSize < total) {
+    b->binsSize = total;
+    b->bins = realloc(b->bins, total * sizeof *(b->bins));
+    assert(b->bins);
+  }
+  /* 2nde passe : rangement des indices de commandes */
+  for(i = 0; i < b->nb; i++) {
+    if(!batchBBox(&(b->cmds[i]), scr, bb)) continue;
+    for(ty = bb[1] >> DIRTY_TILE_SHIFT; ty <= bb[3] >> DIRTY_TILE_SHIFT; ty++)
+      for(tx = bb[0] >> DIRTY_TILE_SHIFT; tx <= bb[2] >> DIRTY_TILE_SHIFT; tx++)
+        b->bins[b->binCur[ty * scr->tw + tx]++] = (GLuint)i;
+  }
+  job.b = b;
+  job.scr = scr;
+  if(parallel)
+    tpoolFor(nt, batchTask, &job);
+  else
+    for(i = 0; i < nt; i++)
+      batchTask(i, 0, &job);
+  for(i = 0; i < nt; i++)
+    if(b->binStart[i] != b->binStart[i + 1]) {
+      scr->dirty[i] = 1;
+      scr->isGPUToDate = 0;
+    }
 }
 
 /*!\brief convertie une surface SDL en un tableau de luminances
@@ -453,6 +1303,7 @@ void gl4dpCopyFromSDLSurfaceWithTransforms(SDL_Surface * s, const GLfloat scale[
   }
   glDeleteTextures(1, &id);
   (*_cur_screen)->isCPUToDate = 0;
+  requestReadback(*_cur_screen);
 
   drawTex((*_cur_screen)->tId, s0, t0);
 }
@@ -552,6 +1403,7 @@ void gl4dpMap(GLuint dstSId, GLuint srcSId, const GLfloat pRect[4], const GLfloa
     glDeleteBuffers(1, &buffer);
 
   (*_cur_screen)->isCPUToDate = 0;
+  requestReadback(*_cur_screen);
 }
 
 static void drawTex(GLuint tId, const GLfloat scale[2], const GLfloat translate[2]) {
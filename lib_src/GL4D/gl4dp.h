@@ -75,6 +75,9 @@
 extern "C" {
 #endif
 
+  /*!\brief lot de primitives rasterisées en une passe, voir gl4dpBatchNew. */
+  typedef struct GL4DPbatch GL4DPbatch;
+
   GL4DAPI Uint32    GL4DAPIENTRY gl4dpGetColor(void);
   GL4DAPI void      GL4DAPIENTRY gl4dpSetColor(Uint32 color);
   GL4DAPI GLuint    GL4DAPIENTRY gl4dpInitScreenWithDimensions(GLuint w, GLuint h);
@@ -89,6 +92,8 @@ extern "C" {
   GL4DAPI void      GL4DAPIENTRY gl4dpClearScreenWith(Uint32 color);
   GL4DAPI void      GL4DAPIENTRY gl4dpScreenHasChanged(void);
   GL4DAPI void      GL4DAPIENTRY gl4dpUpdateScreen(GLint * rect);
+  GL4DAPI void      GL4DAPIENTRY gl4dpSetStreaming(GLboolean enable);
+  GL4DAPI void      GL4DAPIENTRY gl4dpGetTransferTimes(GLdouble times[3]);
   GL4DAPI void      GL4DAPIENTRY gl4dpRect(GLint * rect);
   GL4DAPI void      GL4DAPIENTRY gl4dpLine(int x0, int y0, int x1, int y1);
   GL4DAPI void      GL4DAPIENTRY gl4dpCircle(int x0, int y0, int r);
@@ -96,6 +101,18 @@ extern "C" {
   GL4DAPI void      GL4DAPIENTRY gl4dpPutPixel(int x, int y);
   GL4DAPI void      GL4DAPIENTRY gl4dpHLine(int x0, int x1, int y);
   GL4DAPI void      GL4DAPIENTRY gl4dpFilledCircle(int x0, int y0, int r);
+  GL4DAPI void      GL4DAPIENTRY gl4dpParallelTiles(void (*func)(const GLint rect[4], void * data), void * data);
+  GL4DAPI void      GL4DAPIENTRY gl4dpParallelRows(void (*func)(Uint32 * row, int x0, int x1, int y, void * data), void * data);
+  GL4DAPI void      GL4DAPIENTRY gl4dpParallelPixels(Uint32 (*func)(int x, int y, Uint32 color, void * data), void * data);
+  GL4DAPI GL4DPbatch * GL4DAPIENTRY gl4dpBatchNew(void);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchDelete(GL4DPbatch * b);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchClear(GL4DPbatch * b);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchPoint(GL4DPbatch * b, int x, int y, Uint32 color);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchLine(GL4DPbatch * b, int x0, int y0, int x1, int y1, Uint32 color);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchCircle(GL4DPbatch * b, int x0, int y0, int r, Uint32 color);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchFilledCircle(GL4DPbatch * b, int x0, int y0, int r, Uint32 color);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchRect(GL4DPbatch * b, const GLint rect[4], Uint32 color);
+  GL4DAPI void      GL4DAPIENTRY gl4dpBatchDraw(GL4DPbatch * b, GLboolean parallel);
   GL4DAPI void      GL4DAPIENTRY gl4dpCopyFromSDLSurfaceWithTransforms(SDL_Surface * s, const GLfloat scale[2], const GLfloat translate[2]);
   GL4DAPI void      GL4DAPIENTRY gl4dpCopyFromSDLSurface(SDL_Surface * s);
   GL4DAPI GLfloat * GL4DAPIENTRY gl4dpSDLSurfaceToLuminanceMap(SDL_Surface * s);
@@ -0,0 +1,131 @@
+/*!\file gl4dpSpan.c
+ *
+ * \brief remplissage rapide de segments de pixels (spans) pour les
+ * primitives de gl4dp : noyaux AVX2, SSE2, NEON et scalaire choisis à
+ * l'exécution.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4dpSpan.h"
+#include "gl4dCPU.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define SPAN_X86
+#  include <emmintrin.h>
+#  include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define SPAN_NEON
+#  include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define SPAN_TARGET(t) __attribute__((target(t)))
+#else
+#  define SPAN_TARGET(t)
+#endif
+
+/*!\brief taille (en octets) à partir de laquelle les noyaux x86
+ * utilisent des écritures non temporelles : au delà, le segment ne
+ * tient pas en cache et autant ne pas l'y charger. */
+#define SPAN_STREAM_BYTES (1 << 20)
+
+static void spanfinit(Uint32 * dst, Uint32 color, size_t n);
+
+void (*pspanFill)(Uint32 * dst, Uint32 color, size_t n) = spanfinit;
+
+static void spanScalar(Uint32 * dst, Uint32 color, size_t n) {
+  size_t i;
+  for(i = 0; i < n; i++)
+    dst[i] = color;
+}
+
+#ifdef SPAN_X86
+SPAN_TARGET("sse2") static void spanSSE2(Uint32 * dst, Uint32 color, size_t n) {
+  const __m128i c = _mm_set1_epi32((int)color);
+  Uint32 * end = dst + n;
+  __m128i * p;
+  /* tête : jusqu'à l'alignement sur 16 octets */
+  while(((size_t)dst & 15) && dst < end)
+    *dst++ = color;
+  p = (__m128i *)dst;
+  if((size_t)(end - dst) * sizeof *dst >= SPAN_STREAM_BYTES) {
+    for(; dst + 16 <= end; dst += 16, p += 4) {
+      _mm_stream_si128(p,     c); _mm_stream_si128(p + 1, c);
+      _mm_stream_si128(p + 2, c); _mm_stream_si128(p + 3, c);
+    }
+    _mm_sfence();
+  } else {
+    for(; dst + 16 <= end; dst += 16, p += 4) {
+      _mm_store_si128(p,     c); _mm_store_si128(p + 1, c);
+      _mm_store_si128(p + 2, c); _mm_store_si128(p + 3, c);
+    }
+  }
+  for(; dst + 4 <= end; dst += 4, p++)
+    _mm_store_si128(p, c);
+  /* queue */
+  while(dst < end)
+    *dst++ = color;
+}
+
+SPAN_TARGET("avx2") static void spanAVX2(Uint32 * dst, Uint32 color, size_t n) {
+  const __m256i c = _mm256_set1_epi32((int)color);
+  Uint32 * end = dst + n;
+  __m256i * p;
+  /* tête : jusqu'à l'alignement sur 32 octets */
+  while(((size_t)dst & 31) && dst < end)
+    *dst++ = color;
+  p = (__m256i *)dst;
+  if((size_t)(end - dst) * sizeof *dst >= SPAN_STREAM_BYTES) {
+    for(; dst + 32 <= end; dst += 32, p += 4) {
+      _mm256_stream_si256(p,     c); _mm256_stream_si256(p + 1, c);
+      _mm256_stream_si256(p + 2, c); _mm256_stream_si256(p + 3, c);
+    }
+    _mm_sfence();
+  } else {
+    for(; dst + 32 <= end; dst += 32, p += 4) {
+      _mm256_store_si256(p,     c); _mm256_store_si256(p + 1, c);
+      _mm256_store_si256(p + 2, c); _mm256_store_si256(p + 3, c);
+    }
+  }
+  for(; dst + 8 <= end; dst += 8, p++)
+    _mm256_store_si256(p, c);
+  /* queue */
+  while(dst < end)
+    *dst++ = color;
+}
+#endif
+
+#ifdef SPAN_NEON
+static void spanNEON(Uint32 * dst, Uint32 color, size_t n) {
+  const uint32x4_t c = vdupq_n_u32(color);
+  Uint32 * end = dst + n;
+  for(; dst + 16 <= end; dst += 16) {
+    vst1q_u32(dst,     c); vst1q_u32(dst + 4,  c);
+    vst1q_u32(dst + 8, c); vst1q_u32(dst + 12, c);
+  }
+  for(; dst + 4 <= end; dst += 4)
+    vst1q_u32(dst, c);
+  while(dst < end)
+    *dst++ = color;
+}
+#endif
+
+/*!\brief choisit, au premier appel, le noyau adapté au processeur,
+ * l'installe dans \ref pspanFill puis l'utilise. */
+static void spanfinit(Uint32 * dst, Uint32 color, size_t n) {
+  void (*f)(Uint32 *, Uint32, size_t) = spanScalar;
+#if defined(SPAN_X86)
+  switch(cpuX86Level()) {
+  case 1: f = spanAVX2; break;
+  case 2: f = spanSSE2; break;
+  default: break;
+  }
+#elif defined(SPAN_NEON)
+  f = spanNEON;
+#endif
+  pspanFill = f;
+  f(dst, color, n);
+}
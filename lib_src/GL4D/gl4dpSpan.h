@@ -0,0 +1,33 @@
+/*!\file gl4dpSpan.h
+ *
+ * \brief remplissage rapide de segments de pixels (spans) pour les
+ * primitives de gl4dp.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DPSPAN_H
+#define _GL4DPSPAN_H
+
+#include "gl4dummies.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief remplit les \a n pixels consécutifs de \a dst avec la
+   * couleur \a color. Aucun découpage n'est effectué : l'appelant
+   * doit avoir ramené le segment aux limites de l'écran.
+   *
+   * Le noyau utilisé (AVX2, SSE2, NEON ou scalaire) est choisi au
+   * premier appel selon les capacités du processeur.
+   */
+  extern GL4DHIDDEN void (*pspanFill)(Uint32 * dst, Uint32 color, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,17 +21,26 @@
 #ifndef __GLES4D__
 #include "gl4dh.h"
 #endif
-#include "bin_tree.h"
 #include "linked_list.h"
+#include "gl4duWatch.h"
+#include "gl4duInclude.h"
+#include "gl4duProfile.h"
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 #include "aes.h"
+#include "shader_bundle.h"
 #if !defined(_MSC_VER)
 #  include <errno.h>
 #  include <limits.h>
 #endif
+#if defined(_WIN32)
+#  include <direct.h>
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#  define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 typedef struct shader_t shader_t;
 typedef struct program_t program_t;
@@ -42,16 +51,24 @@ struct shader_t {
   GLuint id;
   GLenum shadertype;
   char * filename;
-  time_t mod_time;
-  GLboolean verify_timestamp;
   unsigned todelete:1;
+  unsigned compiled:1; /* 0 tant que la compilation est différée */
+  unsigned logpending:1; /* compilé en mode asynchrone, log pas encore lu */
+  unsigned long long srchash; /* hachage du code source (développé) */
+  char * imsrc;  /* source en mémoire à redévelopper si elle a des #include */
+  char ** deps;  /* fichiers lus (le shader et ses #include) */
+  int ndeps;
   int nprograms, sprograms;
   program_t ** programs;
-  shader_t * next;
+  shader_t * next, ** pprev;
+  shader_t * nnext, * inext; /* chaînages des index par nom et par id */
 };
 
 struct program_t {
   GLuint id;
+  unsigned pending:1; /* link lancé en mode asynchrone, pas encore terminé */
+  unsigned tosave:1;  /* binaire à mettre en cache une fois relié */
+  unsigned long long key; /* clé dans le cache des binaires */
   int nshaders, sshaders;
   shader_t ** shaders;
   program_t * next;
@@ -65,25 +82,135 @@ struct _GL4DUMatrix {
   size_t nmemb; /* le nombre de copies de la matrice strockables dans la pile (taille de la pile) */
   GLuint top;   /* le haut de la pile de "une matrice" */
   void * data;  /* les données de la pile de "une matrice" */
+  GLuint handle; /* identifiant stable : indice + 1 dans _gl4duMatrices */
+  GLuint hash;   /* hachage du nom */
+  _GL4DUMatrix * hnext; /* suivante dans la même alvéole de _gl4duMatBuckets */
+  unsigned long long version; /* numéro (unique) de la dernière modification */
+};
+
+/*!\brief valeur d'une uniform location pas encore demandée à GL. */
+#define ULOC_UNKNOWN (-2)
+
+/*!\brief cache des uniform locations des matrices pour un program :
+ * locs[handle - 1] pour la matrice d'identifiant handle et sent[handle
+ * - 1] la version de cette matrice dernièrement envoyée au program (0
+ * si jamais). */
+typedef struct uloc_cache_t uloc_cache_t;
+struct uloc_cache_t {
+  GLuint pId;
+  GLuint nlocs;
+  GLint * locs;
+  unsigned long long * sent;
+  GLint block; /* indice du bloc GL4DU_MATRIX_BLOCK, -1 si absent */
+  uloc_cache_t * next;
 };
+
+#ifdef GL_UNIFORM_BUFFER
+/*!\brief nombre de régions de l'anneau d'UBO des matrices. */
+#  define UBO_RING_SIZE 3
+/*!\brief anneau d'UBO recevant les instantanés des matrices (mode
+ * UBO, voir \ref gl4duSetMatrixUBO) : UBO_RING_SIZE régions remplies
+ * l'une après l'autre, chacune protégée par une barrière posée quand
+ * on la quitte et attendue quand on y revient. */
+typedef struct matrix_ubo_t matrix_ubo_t;
+struct matrix_ubo_t {
+  GLuint buffer;
+  GLubyte * map;         /* mappage persistant (GL >= 4.4) ou NULL */
+  GLsizeiptr regionSize; /* taille d'une région */
+  GLint align;           /* GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
+  GLuint region;         /* région courante */
+  GLsizeiptr offset;     /* prochaine écriture dans la région courante */
+  GLsync fence[UBO_RING_SIZE];
+  unsigned long long version; /* _gl4duVersion du dernier instantané */
+  GLuint nbMatrices;     /* _gl4duNbMatrices du dernier instantané */
+};
+#endif
 /*!\brief liste de vertex et fragment shaders. Chaque shader est
  * composé d'un id (GL), du type, du nom de fichier et de la date de
  * modification du fichier.
  */
 static shader_t * shaders_list = NULL;
+/*!\brief index de \ref shaders_list par nom de fichier et par
+ * identifiant openGL (tables de _shNbBuckets alvéoles, une puissance
+ * de 2, agrandies quand elles contiennent plus de shaders). */
+static shader_t ** _shByName = NULL, ** _shById = NULL;
+static GLuint _shNbBuckets = 0, _shCount = 0;
 
 /*!\brief liste de programs. Chaque program est composé d'un id (GL),
  * il est lié à une liste de shaders.
  */
 static program_t * programs_list = NULL;
 
-/*!\brief arbre binaire contenant l'ensemble des matrices \a
- * _GL4DUMatrix gérées. */
-static bin_tree_t  *  _gl4duMatrices = NULL;
+/*!\brief dernière archive cryptée utilisée par \ref
+ * gl4duCreateProgramFED (son nom) et sa version ouverte et indexée. */
+static const char * _fedEncData = NULL;
+static sbundle_t * _fedBundle = NULL;
+
+/*!\brief répertoire du cache des binaires de programs, NULL si le
+ * cache est désactivé ; voir \ref gl4duSetProgramCacheDir. */
+static char * _pcacheDir = NULL;
+static int _pcacheInit = 0;
+/*!\brief nombre de programs chargés depuis le cache et nombre de
+ * programs compilés faute d'y être, voir \ref gl4duGetIntegerv. */
+static GLint _pcacheHits = 0, _pcacheMisses = 0;
+/*!\brief non nul pendant la création d'un program : la compilation
+ * des nouveaux shaders est alors différée jusqu'au link, où elle
+ * devient inutile si le binaire du program est en cache. */
+static int _deferCompile = 0;
+/*!\brief profondeur d'imbrication des lots de créations asynchrones
+ * de programs, voir \ref gl4duBeginAsyncPrograms. */
+static int _asyncDepth = 0;
+/*!\brief 1 si le pilote supporte KHR (ou ARB) _parallel_shader_compile,
+ * -1 tant que ce n'est pas testé. */
+static int _parallelCompile = -1;
+
+/*!\brief signature des fichiers du cache des binaires de programs. */
+#define PCACHE_MAGIC "GL4DPBIN"
+#define FNV64_SEED 14695981039346656037ULL
+
+/*!\brief poursuit le hachage FNV-1a (64 bits) \a h avec les \a n
+ * octets pointés par \a p. */
+static inline unsigned long long hash64(unsigned long long h, const void * p, size_t n) {
+  const GLubyte * u = (const GLubyte *)p;
+  while(n--)
+    h = (h ^ *u++) * 1099511628211ULL;
+  return h;
+}
+
+/*!\brief ensemble des matrices \a _GL4DUMatrix gérées, indexées par
+ * identifiant - 1 (NULL pour un identifiant libéré). */
+static _GL4DUMatrix ** _gl4duMatrices = NULL;
+static GLuint _gl4duNbMatrices = 0, _gl4duSMatrices = 0;
+/*!\brief table de hachage (par chaînage, taille puissance de 2) des
+ * matrices \a _GL4DUMatrix selon leur nom. */
+static _GL4DUMatrix ** _gl4duMatBuckets = NULL;
+static GLuint _gl4duNbMatBuckets = 0, _gl4duNbLiveMatrices = 0;
 /*!\brief la matrice \a _GL4DUMatrix courante. */
 static _GL4DUMatrix * _gl4dCurMatrix = NULL;
-/*!\brief le noeud vers la dernière matrice \a _GL4DUMatrix créée. */
-static bin_tree_t ** _gl4dLastMatrixn = NULL;
+/*!\brief caches des uniform locations, un par program, le dernier
+ * utilisé en tête. */
+static uloc_cache_t * _ulocs = NULL;
+/*!\brief compteur global des modifications de matrices : chaque
+ * modification donne à la matrice touchée une nouvelle version
+ * (jamais réutilisée, même par une autre matrice). */
+static unsigned long long _gl4duVersion = 0;
+/*!\brief nombre d'envois de matrices effectués et évités (matrice
+ * inchangée depuis son dernier envoi au même program), voir \ref
+ * gl4duGetIntegerv. */
+static GLint _gl4duUploads = 0, _gl4duSkippedUploads = 0;
+/*!\brief mode UBO demandé (\ref gl4duSetMatrixUBO) ; l'anneau \ref
+ * _ubo est créé au premier envoi. */
+static GLboolean _uboMode = GL_FALSE;
+#ifdef GL_UNIFORM_BUFFER
+static matrix_ubo_t * _ubo = NULL;
+#endif
+/*!\brief déclaration GLSL du bloc des matrices, voir \ref
+ * gl4duGetMatrixBlockGLSL. */
+static char * _blockGLSL = NULL;
+/*!\brief matrices d'instances (GLfloat, par colonnes) accumulées par
+ * \ref gl4duAppendInstanceMatrix. */
+static GLfloat * _instances = NULL;
+static GLsizei _nbInstances = 0, _sInstances = 0;
 /*!\brief pile des fonctions à appeler lors du "at exit" de \ref
  *  gl4duClean. Cette liste est remplie par \ref gl4duAtExit. */
 static linked_list_t * _aelist = NULL;
@@ -91,19 +218,28 @@ static linked_list_t * _aelist = NULL;
 static shader_t **  findfnInShadersList(const char * filename);
 static shader_t **  findidInShadersList(GLuint id);
 static shader_t **  addInShadersList(GLenum shadertype, const char * filename, const char * shadercode);
-static shader_t **  addInShadersListFED(const char * decData, GLenum shadertype, const char * filename);
+static shader_t **  addInShadersListFED(const char * src, GLint len, GLenum shadertype, const char * filename);
 static void         deleteFromShadersList(shader_t ** shp);
 static program_t ** findInProgramsList(GLuint id);
 static program_t ** addInProgramsList(GLuint id);
 static void         deleteFromProgramsList(program_t ** pp);
 static void         attachShader(program_t * prg, shader_t * sh);
 static void         detachShader(program_t * prg, shader_t * sh);
+static void         compileShader(shader_t * sh);
+static GLuint       shaderId(shader_t ** sh);
+static void         linkProgram(program_t * prg);
+static GLboolean    finishProgram(program_t * prg);
+static int          pcacheEnabled(void);
 
 static inline _GL4DUMatrix * newGL4DUMatrix(GLenum type, const char * name);
 static inline void freeGL4DUMatrix(void * matrix);
-static inline int matrixCmpFunc(const void * m1, const void * m2);
-static inline bin_tree_t ** findMatrix(const char * name);
+static inline _GL4DUMatrix * findMatrix(const char * name);
+static void sendMatrixUBO(void);
+static void freeMatrices(void);
+static void freeMatrixUBO(void);
+static void bindMatrixBlock(GLuint pId);
 static inline void * matrixData(_GL4DUMatrix * matrix);
+static inline void touchMatrix(_GL4DUMatrix * matrix);
 
 /*!\brief stocke le chemin relatif à partir duquel le binaire a été exécuté. Est initialisée dans
  *  \a gl4dInit.
@@ -277,17 +413,17 @@ void gl4duPrintFPS(FILE * fp) {
 GLuint gl4duCreateShader(GLenum shadertype, const char * filename) {
   char temp[BUFSIZ << 1];
   shader_t ** sh = findfnInShadersList(filename);
-  if(*sh) return (*sh)->id;
+  if(*sh) return shaderId(sh);
   gl4duMakeBinRelativePath(temp, sizeof temp, filename);
   // la ligne précédente fait ça snprintf(temp, sizeof temp, "%s/%s", _pathOfMe, filename);
   sh = findfnInShadersList(temp);
-  if(*sh) return (*sh)->id;
+  if(*sh) return shaderId(sh);
   sh = addInShadersList(shadertype, filename, NULL);
   if(!sh) {
     fprintf(stderr, "trying with another path (%s)\n", temp);
     sh = addInShadersList(shadertype, temp, NULL);
   }
-  return (sh) ? (*sh)->id : 0;
+  return shaderId(sh);
 }
 
 /*!\brief retourne l'identifiant du shader dont le code source est \a
@@ -302,21 +438,38 @@ GLuint gl4duCreateShader(GLenum shadertype, const char * filename) {
  */
 GLuint gl4duCreateShaderIM(GLenum shadertype, const char * filename, const char * shadercode) {
   shader_t ** sh = findfnInShadersList(filename);
-  if(*sh) return (*sh)->id;
+  if(*sh) return shaderId(sh);
   sh = addInShadersList(shadertype, filename, shadercode);
-  return (sh) ? (*sh)->id : 0;
+  return shaderId(sh);
 }
 
 /*!\brief retourne l'identifiant du shader décrit dans \a filename.
- * Version FED de la précédente
+ * Version FED de la précédente ; \a decData étant une chaîne de
+ * taille inconnue, seules les archives balisées y sont cherchées (voir
+ * \ref gl4duCreateProgramFED pour les archives indexées).
  * \todo commenter
  * \todo ajouter la gestion des chemins relatifs à l'emplacement du binaire comme pour \a gl4duCreateShader.
  */
 GLuint gl4duCreateShaderFED(const char * decData, GLenum shadertype, const char * filename) {
+  GLint len;
+  const char * src;
   shader_t ** sh = findfnInShadersList(filename);
-  if(*sh) return (*sh)->id;
-  sh = addInShadersListFED(decData, shadertype, filename);
-  return (sh) ? (*sh)->id : 0;
+  if(*sh) return shaderId(sh);
+  if(!(src = sbundleFindInDecData(decData, strlen(decData) + 1, filename, &len))) return 0;
+  sh = addInShadersListFED(src, len, shadertype, filename);
+  return shaderId(sh);
+}
+
+/*!\brief version de \ref gl4duCreateShaderFED cherchant le shader dans
+ * l'archive ouverte \a b (en temps constant). */
+static GLuint createShaderFromBundle(const sbundle_t * b, GLenum shadertype, const char * filename) {
+  GLint len;
+  const char * src;
+  shader_t ** sh = findfnInShadersList(filename);
+  if(*sh) return shaderId(sh);
+  if(!(src = sbundleFind(b, filename, &len))) return 0;
+  sh = addInShadersListFED(src, len, shadertype, filename);
+  return shaderId(sh);
 }
 
 /*!\brief retourne l'identifiant du shader décrit dans \a filename.
@@ -366,6 +519,7 @@ GLuint gl4duCreateProgram(const char * firstone, ...) {
   char fn[BUFSIZ], format[BUFSIZ];
   if(!pId) return pId;
   prg = addInProgramsList(pId);
+  _deferCompile++;
 
   filename = firstone;
   va_start(pa, firstone);
@@ -456,11 +610,12 @@ GLuint gl4duCreateProgram(const char * firstone, ...) {
     }
   } while((filename = va_arg(pa, const char *)) != NULL);
   va_end(pa);
-  glLinkProgram(pId);
-  gl4duPrintProgramInfoLog(pId, stderr);
+  _deferCompile--;
+  linkProgram(*prg);
   return pId;
  gl4duCreateProgram_ERROR:
   va_end(pa);
+  _deferCompile--;
   deleteFromProgramsList(prg);
   return 0;
 }
@@ -483,19 +638,22 @@ GLuint gl4duCreateProgram(const char * firstone, ...) {
  * supprimés ; un appel à \ref gl4duCleanUnattached peut s'en charger.
  */
 GLuint gl4duCreateProgramFED(const char * encData, const char * firstone, ...) {
-  static const char * prevEncData = NULL;
-  static char * decData = NULL;
   va_list  pa;
   const char * filename;
   program_t ** prg;
   GLuint sId, pId = glCreateProgram();
   if(!pId) return pId;
-  if(prevEncData != encData) {
-    if(decData)
-      free(decData);
-    decData = aes_from_tar(prevEncData = encData);
+  if(_fedEncData != encData) {
+    sbundleClose(_fedBundle);
+    _fedBundle = sbundleLoad(_fedEncData = encData);
+  }
+  if(!_fedBundle) {
+    _fedEncData = NULL;
+    glDeleteProgram(pId);
+    return 0;
   }
   prg = addInProgramsList(pId);
+  _deferCompile++;
 
   filename = firstone;
   va_start(pa, firstone);
@@ -503,25 +661,25 @@ GLuint gl4duCreateProgramFED(const char * encData, const char * firstone, ...) {
   do {
     if(!strncmp("<vs>", filename, 4)) { /* vertex shader */
       fprintf(stderr, "%s : vertex shader\n", &filename[4]);
-      if(!(sId = gl4duCreateShaderFED(decData, GL_VERTEX_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
+      if(!(sId = createShaderFromBundle(_fedBundle, GL_VERTEX_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
       attachShader(*prg, *findidInShadersList(sId));
     } else if(!strncmp("<fs>", filename, 4)) { /* fragment shader */
       fprintf(stderr, "%s : fragment shader\n", &filename[4]);
-      if(!(sId = gl4duCreateShaderFED(decData, GL_FRAGMENT_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
+      if(!(sId = createShaderFromBundle(_fedBundle, GL_FRAGMENT_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
       attachShader(*prg, *findidInShadersList(sId));
     }
 #ifndef __ANDROID__
     else if(!strncmp("<gs>", filename, 4)) { /* geometry shader */
       fprintf(stderr, "%s : geometry shader\n", &filename[4]);
-      if(!(sId = gl4duCreateShaderFED(decData, GL_GEOMETRY_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
+      if(!(sId = createShaderFromBundle(_fedBundle, GL_GEOMETRY_SHADER, &filename[4]))) goto gl4duCreateProgram_ERROR;
       attachShader(*prg, *findidInShadersList(sId));
     } else if(!strncmp("<tcs>", filename, 5)) { /* tessellation control shader */
       fprintf(stderr, "%s : tessellation control shader\n", &filename[5]);
-      if(!(sId = gl4duCreateShaderFED(decData, GL_TESS_CONTROL_SHADER, &filename[5]))) goto gl4duCreateProgram_ERROR;
+      if(!(sId = createShaderFromBundle(_fedBundle, GL_TESS_CONTROL_SHADER, &filename[5]))) goto gl4duCreateProgram_ERROR;
       attachShader(*prg, *findidInShadersList(sId));
     } else if(!strncmp("<tes>", filename, 5)) { /* tessellation evaluation shader */
       fprintf(stderr, "%s : tessellation evaluation shader\n", &filename[5]);
-      if(!(sId = gl4duCreateShaderFED(decData, GL_TESS_EVALUATION_SHADER, &filename[5]))) goto gl4duCreateProgram_ERROR;
+      if(!(sId = createShaderFromBundle(_fedBundle, GL_TESS_EVALUATION_SHADER, &filename[5]))) goto gl4duCreateProgram_ERROR;
       attachShader(*prg, *findidInShadersList(sId));
     }
 #endif
@@ -531,11 +689,12 @@ GLuint gl4duCreateProgramFED(const char * encData, const char * firstone, ...) {
     }
   } while((filename = va_arg(pa, const char *)) != NULL);
   va_end(pa);
-  glLinkProgram(pId);
-  gl4duPrintProgramInfoLog(pId, stderr);
+  _deferCompile--;
+  linkProgram(*prg);
   return pId;
  gl4duCreateProgram_ERROR:
   va_end(pa);
+  _deferCompile--;
   deleteFromProgramsList(prg);
   return 0;
 }
@@ -548,6 +707,349 @@ void gl4duDeleteProgram(GLuint id) {
   if(*prg) deleteFromProgramsList(prg);
 }
 
+/*!\brief fixe le répertoire \a dir (créé si besoin) du cache des
+ * binaires de programs ; NULL (ou "") désactive le cache.
+ *
+ * Quand le cache est actif, \ref gl4duCreateProgram et \ref
+ * gl4duCreateProgramFED cherchent d'abord le binaire
+ * (glProgramBinary) du program, identifié par le hachage des sources
+ * et types de ses shaders et des chaînes GL_VENDOR, GL_RENDERER et
+ * GL_VERSION ; les shaders ne sont alors pas compilés. Sinon, le
+ * program est compilé et relié puis son binaire (glGetProgramBinary)
+ * est enregistré.
+ *
+ * Tant que cette fonction n'a pas été appelée, le répertoire est donné
+ * par la variable d'environnement GL4D_PROGRAM_CACHE (cache désactivé
+ * si elle n'est pas définie). Le cache nécessite GL 4.1 (ou
+ * ARB_get_program_binary) ou GLES 3 et au moins un format de binaire
+ * supporté par le pilote.
+ */
+void gl4duSetProgramCacheDir(const char * dir) {
+  free(_pcacheDir);
+  _pcacheDir = NULL;
+  _pcacheInit = 1;
+  if(!dir || !*dir) return;
+#if defined(_WIN32)
+  _mkdir(dir);
+#else
+  mkdir(dir, 0755);
+#endif
+  _pcacheDir = strdup(dir);
+  assert(_pcacheDir);
+}
+
+/*!\brief indique si le cache des binaires de programs est utilisable. */
+static int pcacheEnabled(void) {
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+  static GLint nformats = -1;
+  if(!_pcacheInit)
+    gl4duSetProgramCacheDir(getenv("GL4D_PROGRAM_CACHE"));
+  if(!_pcacheDir) return 0;
+  if(nformats < 0) {
+    nformats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nformats);
+  }
+  return nformats > 0;
+#else
+  return 0;
+#endif
+}
+
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+/*!\brief clé du program \a prg dans le cache : hachage des types et
+ * sources de ses shaders (dans l'ordre d'attachement) et de
+ * l'identification du pilote. */
+static unsigned long long programKey(program_t * prg) {
+  static const GLenum strs[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  unsigned long long h = hash64(FNV64_SEED, PCACHE_MAGIC, 8);
+  const GLubyte * str;
+  int i;
+  for(i = 0; i < prg->nshaders; i++) {
+    h = hash64(h, &(prg->shaders[i]->shadertype), sizeof prg->shaders[i]->shadertype);
+    h = hash64(h, &(prg->shaders[i]->srchash), sizeof prg->shaders[i]->srchash);
+  }
+  for(i = 0; i < (int)(sizeof strs / sizeof *strs); i++)
+    if((str = glGetString(strs[i])) != NULL)
+      h = hash64(h, str, strlen((const char *)str) + 1);
+  return h;
+}
+
+static int pcachePath(char * path, size_t size, unsigned long long key) {
+  int n = snprintf(path, size, "%s/%016llx.glb", _pcacheDir, key);
+  return n >= 0 && (size_t)n < size;
+}
+
+/*!\brief charge dans \a prg le binaire de clé \a key s'il est en
+ * cache et accepté par le pilote (sinon le fichier est supprimé).
+ *
+ * \return 1 si le program est prêt, 0 sinon.
+ */
+static int loadProgramBinary(program_t * prg, unsigned long long key) {
+  char path[BUFSIZ], magic[8];
+  unsigned long long k;
+  GLenum format;
+  GLint len, status = 0;
+  void * bin;
+  FILE * f;
+  if(!pcachePath(path, sizeof path, key) || (f = fopen(path, "rb")) == NULL)
+    return 0;
+  if(fread(magic, 1, 8, f) != 8 || memcmp(magic, PCACHE_MAGIC, 8) ||
+     fread(&k, sizeof k, 1, f) != 1 || k != key ||
+     fread(&format, sizeof format, 1, f) != 1 ||
+     fread(&len, sizeof len, 1, f) != 1 || len <= 0) {
+    fclose(f);
+    remove(path);
+    return 0;
+  }
+  bin = malloc(len);
+  assert(bin);
+  if(fread(bin, 1, len, f) == (size_t)len) {
+    glProgramBinary(prg->id, format, bin, len);
+    glGetProgramiv(prg->id, GL_LINK_STATUS, &status);
+  }
+  fclose(f);
+  free(bin);
+  if(!status) /* fichier abîmé ou pilote mis à jour */
+    remove(path);
+  return status ? 1 : 0;
+}
+
+/*!\brief enregistre dans le cache, sous la clé \a key, le binaire du
+ * program \a prg s'il est correctement relié. */
+static void saveProgramBinary(program_t * prg, unsigned long long key) {
+  char path[BUFSIZ], tmp[BUFSIZ + 16];
+  GLenum format = 0;
+  GLint len = 0, status = 0;
+  void * bin;
+  FILE * f;
+  int ok;
+  glGetProgramiv(prg->id, GL_LINK_STATUS, &status);
+  glGetProgramiv(prg->id, GL_PROGRAM_BINARY_LENGTH, &len);
+  /* un chemin tronqué désignerait un autre fichier */
+  if(!status || len <= 0 || !pcachePath(path, sizeof path, key)) return;
+  bin = malloc(len);
+  assert(bin);
+  glGetProgramBinary(prg->id, len, &len, &format, bin);
+  /* écrit à côté puis renomme : un lecteur concurrent ne voit jamais
+   * de fichier partiel */
+  snprintf(tmp, sizeof tmp, "%s.%u.tmp", path, prg->id);
+  if((f = fopen(tmp, "wb")) != NULL) {
+    ok = fwrite(PCACHE_MAGIC, 1, 8, f) == 8 &&
+      fwrite(&key, sizeof key, 1, f) == 1 &&
+      fwrite(&format, sizeof format, 1, f) == 1 &&
+      fwrite(&len, sizeof len, 1, f) == 1 &&
+      fwrite(bin, 1, len, f) == (size_t)len;
+    ok = !fclose(f) && ok;
+#if defined(_WIN32)
+    if(ok) remove(path);
+#endif
+    if(!ok || rename(tmp, path) != 0)
+      remove(tmp);
+  }
+  free(bin);
+}
+#endif
+
+/*!\brief compile le shader \a sh si ce n'est pas déjà fait. */
+static void compileShader(shader_t * sh) {
+  if(sh->compiled) return;
+  glCompileShader(sh->id);
+  sh->compiled = 1;
+  if(_asyncDepth)
+    sh->logpending = 1;
+  else
+    gl4duPrintShaderInfoLog(sh->id, stderr);
+}
+
+/*!\brief retourne l'identifiant du shader pointé par \a sh (0 si
+ * NULL) ; hors création de program, le shader est compilé s'il ne
+ * l'était pas encore. */
+static GLuint shaderId(shader_t ** sh) {
+  if(!sh || !*sh) return 0;
+  if(!_deferCompile)
+    compileShader(*sh);
+  return (*sh)->id;
+}
+
+/*!\brief relie le program \a prg, en le chargeant depuis le cache des
+ * binaires quand c'est possible ; sinon, ses shaders sont compilés si
+ * besoin puis le binaire obtenu sera mis en cache.
+ *
+ * En mode asynchrone (\ref gl4duBeginAsyncPrograms), compilations et
+ * link sont seulement lancés : la lecture des logs, la mise en cache
+ * et la liaison du bloc des matrices sont faites par \ref
+ * finishProgram, à la demande ou à la barrière.
+ */
+static void linkProgram(program_t * prg) {
+  int i;
+  prg->tosave = 0;
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+  if(pcacheEnabled()) {
+    prg->key = programKey(prg);
+    if(loadProgramBinary(prg, prg->key)) {
+      _pcacheHits++;
+      finishProgram(prg);
+      return;
+    }
+    _pcacheMisses++;
+    prg->tosave = 1;
+    glProgramParameteri(prg->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+#endif
+  for(i = 0; i < prg->nshaders; i++)
+    compileShader(prg->shaders[i]);
+  glLinkProgram(prg->id);
+  if(_asyncDepth)
+    prg->pending = 1;
+  else
+    finishProgram(prg);
+}
+
+/*!\brief termine le program \a prg : imprime les logs encore en
+ * attente (shaders et program), met son binaire en cache si besoin et
+ * lie son bloc de matrices. Attend la fin du link s'il est en cours.
+ *
+ * \return GL_TRUE si le program est correctement relié.
+ */
+static GLboolean finishProgram(program_t * prg) {
+  int i;
+  GLint status = 0;
+  for(i = 0; i < prg->nshaders; i++)
+    if(prg->shaders[i]->logpending) {
+      gl4duPrintShaderInfoLog(prg->shaders[i]->id, stderr);
+      prg->shaders[i]->logpending = 0;
+    }
+  gl4duPrintProgramInfoLog(prg->id, stderr);
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+  if(prg->tosave)
+    saveProgramBinary(prg, prg->key);
+#endif
+  prg->tosave = 0;
+  prg->pending = 0;
+  bindMatrixBlock(prg->id);
+  glGetProgramiv(prg->id, GL_LINK_STATUS, &status);
+  return status ? GL_TRUE : GL_FALSE;
+}
+
+/*!\brief indique si le pilote compile et relie en parallèle
+ * (KHR_parallel_shader_compile ou ARB_parallel_shader_compile) ; le
+ * cas échéant, il est autorisé à utiliser autant de threads qu'il le
+ * souhaite. */
+static int parallelCompile(void) {
+  if(_parallelCompile < 0) {
+    GLint i, n = 0;
+    const char * e;
+    _parallelCompile = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for(i = 0; i < n && !_parallelCompile; i++)
+      if((e = (const char *)glGetStringi(GL_EXTENSIONS, i)) != NULL)
+        _parallelCompile = !strcmp(e, "GL_KHR_parallel_shader_compile") || !strcmp(e, "GL_ARB_parallel_shader_compile");
+#ifndef __ANDROID__
+    if(_parallelCompile) {
+      typedef void (APIENTRY * maxthreads_t)(GLuint count);
+      maxthreads_t f = (maxthreads_t)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+      if(!f)
+        f = (maxthreads_t)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+      if(f)
+        f(0xFFFFFFFF);
+    }
+#endif
+  }
+  return _parallelCompile;
+}
+
+/*!\brief ouvre un lot de créations asynchrones de programs.
+ *
+ * Jusqu'au \ref gl4duWaitAllPrograms correspondant (les lots peuvent
+ * s'imbriquer), \ref gl4duCreateProgram et \ref
+ * gl4duCreateProgramFED lancent compilations et links sans en
+ * attendre la fin et retournent aussitôt l'identifiant du program,
+ * à considérer comme une promesse : avant de l'utiliser, attendre sa
+ * fin avec \ref gl4duWaitProgram, la tester sans bloquer avec \ref
+ * gl4duIsProgramReady ou fermer le lot. Avec
+ * KHR_parallel_shader_compile, le pilote compile alors les shaders
+ * du lot en parallèle ; sans, seuls les allers-retours de lecture des
+ * logs sont reportés.
+ */
+void gl4duBeginAsyncPrograms(void) {
+  parallelCompile();
+  _asyncDepth++;
+}
+
+/*!\brief indique, sans bloquer si le pilote supporte
+ * KHR_parallel_shader_compile, si le program \a pId créé en mode
+ * asynchrone est prêt ; si oui il est terminé (voir \ref
+ * gl4duWaitProgram). Sans l'extension, équivaut à \ref
+ * gl4duWaitProgram.
+ *
+ * \return GL_TRUE si le program est prêt à l'emploi (ou n'est pas en
+ * attente), GL_FALSE sinon.
+ */
+GLboolean gl4duIsProgramReady(GLuint pId) {
+  GLint done = 1;
+  program_t ** prg = findInProgramsList(pId);
+  if(!*prg || !(*prg)->pending) return GL_TRUE;
+  if(parallelCompile())
+    glGetProgramiv(pId, GL_COMPLETION_STATUS_KHR, &done);
+  if(!done) return GL_FALSE;
+  finishProgram(*prg);
+  return GL_TRUE;
+}
+
+/*!\brief attend la fin du program \a pId créé en mode asynchrone et
+ * le termine : logs imprimés, binaire mis en cache et bloc des
+ * matrices lié.
+ *
+ * \return GL_TRUE si le program est correctement relié, GL_FALSE
+ * sinon ou s'il n'est pas géré par GL4Dummies.
+ */
+GLboolean gl4duWaitProgram(GLuint pId) {
+  GLint status = 0;
+  program_t ** prg = findInProgramsList(pId);
+  if(!*prg) return GL_FALSE;
+  if((*prg)->pending)
+    return finishProgram(*prg);
+  glGetProgramiv(pId, GL_LINK_STATUS, &status);
+  return status ? GL_TRUE : GL_FALSE;
+}
+
+/*!\brief ferme le lot ouvert par \ref gl4duBeginAsyncPrograms et
+ * attend (barrière) tous les programs encore en attente, dans leur
+ * ordre de création.
+ *
+ * \return GL_TRUE si tous ces programs sont correctement reliés.
+ */
+GLboolean gl4duWaitAllPrograms(void) {
+  GLboolean ok = GL_TRUE;
+  program_t * ptr;
+  shader_t * sh;
+  int n = 0, i;
+  program_t ** pending;
+  if(_asyncDepth > 0)
+    _asyncDepth--;
+  for(ptr = programs_list; ptr; ptr = ptr->next)
+    n += ptr->pending;
+  if(n) {
+    pending = malloc(n * sizeof * pending);
+    assert(pending);
+    /* programs_list commence par le plus récent */
+    for(i = n, ptr = programs_list; ptr; ptr = ptr->next)
+      if(ptr->pending)
+        pending[--i] = ptr;
+    for(i = 0; i < n; i++)
+      if(!finishProgram(pending[i]))
+        ok = GL_FALSE;
+    free(pending);
+  }
+  /* shaders compilés dans le lot sans être reliés */
+  for(sh = shaders_list; sh; sh = sh->next)
+    if(sh->logpending) {
+      gl4duPrintShaderInfoLog(sh->id, stderr);
+      sh->logpending = 0;
+    }
+  return ok;
+}
+
 /*!\brief supprime tous les programs et/ou tous les shaders.
  */
 void gl4duClean(GL4DUenum what) {
@@ -563,14 +1065,26 @@ void gl4duClean(GL4DUenum what) {
     program_t ** ptr = &programs_list;
     while(*ptr)
       deleteFromProgramsList(ptr);
+    _asyncDepth = 0;
+    _parallelCompile = -1;
   }
   if(what & GL4DU_SHADER) {
     shader_t ** ptr = &shaders_list;
     while(*ptr)
       deleteFromShadersList(ptr);
+    free(_shByName);
+    free(_shById);
+    _shByName = _shById = NULL;
+    _shNbBuckets = 0;
+    incClean(0);
+    sbundleClose(_fedBundle);
+    _fedBundle = NULL;
+    _fedEncData = NULL;
   }
   if(what & GL4DU_MATRICES)
-    btFree(&_gl4duMatrices, freeGL4DUMatrix);
+    freeMatrices();
+  if(what & GL4DU_AT_EXIT)
+    incClean(1);
   if(what & GL4DU_GEOMETRY)
     gl4dgClean();
 #ifndef __GLES4D__
@@ -616,108 +1130,237 @@ void gl4duCleanUnattached(GL4DUenum what) {
   }
 }
 
-/*!\brief parcours la liste des shaders \ref shaders_list et vérifie
- * s'il y a besoin de mettre à jour le shader (recompiler et relinker).
+/*!\brief remplace le shader \a old par une nouvelle version créée
+ * depuis ses sources (relues dans le cache des #include) et y attache
+ * les programs de \a old, ajoutés (sans doublon) au tableau \a prgs de
+ * taille \a nprgs pour être reliés ensuite. Si la nouvelle version ne
+ * peut être créée, \a old reste en place.
+ */
+static void reloadShader(shader_t * old, program_t *** prgs, int * nprgs) {
+  shader_t * sh;
+  program_t * p;
+  int i;
+  if(!addInShadersList(old->shadertype, old->filename, old->imsrc))
+    return;
+  sh = shaders_list;
+  sh->todelete = old->todelete;
+  /* old ne doit pas être supprimé par le détachement */
+  old->todelete = 0;
+  while(old->nprograms > 0) {
+    p = old->programs[0];
+    detachShader(p, old);
+    attachShader(p, sh);
+    for(i = 0; i < *nprgs && (*prgs)[i] != p; i++);
+    if(i == *nprgs) {
+      *prgs = realloc(*prgs, (*nprgs + 1) * sizeof ** prgs);
+      assert(*prgs);
+      (*prgs)[(*nprgs)++] = p;
+    }
+  }
+  deleteFromShadersList(old->pprev);
+}
+
+/*!\brief indique si le fichier \a fn est lu par le shader \a sh (son
+ * propre fichier ou un #include, même indirect). */
+static int dependsOn(shader_t * sh, const char * fn) {
+  int i;
+  for(i = 0; i < sh->ndeps; i++)
+    if(!strcmp(sh->deps[i], fn))
+      return 1;
+  return 0;
+}
+
+/*!\brief recompile (et relie) les shaders dont le fichier, ou l'un des
+ * fichiers qu'ils incluent, a été modifié.
  *
- * La vérification est effectuée sur la date de modification du
- * fichier representant le shader.
+ * Les fichiers des shaders et de leurs #include sont surveillés par un
+ * thread d'arrière-plan (inotify sous Linux, sinon scrutation de leur
+ * date de modification) qui regroupe les rafales de sauvegardes, lit
+ * les nouvelles sources et les fichiers qu'elles incluent désormais ;
+ * cette fonction, à appeler depuis le thread possédant le contexte GL,
+ * ne fait que développer les #include (en mémoire, depuis le cache),
+ * compiler et relier. Seuls les
+ * shaders dépendant d'un fichier dont le contenu a réellement changé
+ * sont recompilés, et chaque program concerné n'est relié qu'une
+ * fois. Quand rien n'a changé, son coût se réduit à une lecture
+ * atomique.
  *
  * \return 1 s'il y a eu une mise à jour (recompilation et relink)
  * sinon 0.
- *
- * \todo peut être ajouter un test sur le temps passé pour ne
- * parcourir la liste qu'un fois tous les 1/10 de secondes ????
 */
 int gl4duUpdateShaders(void) {
-  GLenum ot;
   char * fn;
-  int maj = 0, i, n;
-  struct stat buf;
-  program_t ** p;
-  shader_t ** ptr = &shaders_list;
+  int maj = 0, i, n, np = 0;
+  shader_t * sh, ** olds;
+  program_t ** prgs = NULL;
 #ifdef COMMERCIAL_V
   return 0;
 #endif
-  while(*ptr) {
-    if(!(*ptr)->verify_timestamp) {
-      ptr = &((*ptr)->next);
-      continue;
-    }
-    if(stat((*ptr)->filename, &buf) != 0) {
-      fprintf(stderr, "%s:%d:In %s: erreur %d: %s\n",
-	      __FILE__, __LINE__, __func__, errno, strerror(errno));
-      return 0;
-    }
-    if((*ptr)->mod_time != buf.st_mtime) {
-      if((n = (*ptr)->nprograms)) {
-	p = malloc(n * sizeof * p);
-	assert(p);
-	memcpy(p, (*ptr)->programs, n * sizeof * p);
-	for(i = 0; i < n; i++)
-	  detachShader(p[i], *ptr);
-	ot = (*ptr)->shadertype;
-	fn = strdup((*ptr)->filename);
-	deleteFromShadersList(ptr);
-	ptr = addInShadersList(ot, fn, NULL);
-	for(i = 0; i < n; i++) {
-	  attachShader(p[i], *ptr);
-	  glLinkProgram(p[i]->id);
-	}
-	free(p);
-	free(fn);
-      } else {
-	ot = (*ptr)->shadertype;
-	fn = strdup((*ptr)->filename);
-	deleteFromShadersList(ptr);
-	ptr = addInShadersList(ot, fn, NULL);
-      }
+  if(!fwPending())
+    return 0;
+  GL4D_PROF_BEGIN("gl4duUpdateShaders");
+  while(fwPop(&fn)) {
+    /* les shaders rechargés passent en tête de liste : on relève
+     * d'abord ceux qui dépendent de ce fichier */
+    for(n = 0, sh = shaders_list; sh; sh = sh->next)
+      n += dependsOn(sh, fn);
+    if(n) {
+      olds = malloc(n * sizeof * olds);
+      assert(olds);
+      for(i = 0, sh = shaders_list; sh; sh = sh->next)
+        if(dependsOn(sh, fn))
+          olds[i++] = sh;
+      for(i = 0; i < n; i++)
+        reloadShader(olds[i], &prgs, &np);
+      free(olds);
       maj = 1;
-    } else
-      ptr = &((*ptr)->next);
+    }
+    free(fn);
+  }
+  for(i = 0; i < np; i++) {
+    gl4duForgetUniformLocations(prgs[i]->id);
+    linkProgram(prgs[i]);
   }
+  free(prgs);
+  GL4D_PROF_END();
   return maj;
 }
 
+/*!\brief enregistre le code \a source sous le nom \a name pour les
+ * directives #include des shaders.
+ *
+ * Avant la création d'un shader, chaque ligne #include "fichier" (ou
+ * #include <fichier>) de son code est remplacée par le contenu du
+ * fichier, cherché d'abord parmi les noms enregistrés par cette
+ * fonction, puis relativement au répertoire du fichier qui l'inclut,
+ * enfin relativement au répertoire courant. Un même fichier n'est
+ * inclus qu'une fois par shader et n'est lu (et haché) qu'une fois
+ * pour tous les shaders qui l'incluent ; sa modification entraîne la
+ * recompilation des seuls shaders qui l'incluent (voir \ref
+ * gl4duUpdateShaders).
+ *
+ * Enregistrer à nouveau un nom en remplace le code pour les shaders
+ * créés ensuite. Les noms enregistrés survivent à \ref gl4duClean avec
+ * GL4DU_SHADER et ne sont oubliés qu'avec GL4DU_AT_EXIT.
+ */
+void gl4duAddShaderInclude(const char * name, const char * source) {
+  incRegister(name, source);
+}
+
+/*!\brief alvéole de \a name dans l'index par nom des shaders. */
+static inline GLuint shNameBucket(const char * name) {
+  return (GLuint)hash64(FNV64_SEED, name, strlen(name)) & (_shNbBuckets - 1);
+}
+
+/*!\brief ajoute \a sh (en tête des alvéoles, le plus récent d'un même
+ * nom est donc trouvé en premier) aux index par nom et par id, en les
+ * agrandissant s'ils contiennent plus de shaders que d'alvéoles. */
+static void indexShader(shader_t * sh) {
+  GLuint b;
+  if(++_shCount > _shNbBuckets) {
+    free(_shByName);
+    free(_shById);
+    _shNbBuckets = _shNbBuckets ? _shNbBuckets << 1 : 64;
+    _shByName = calloc(_shNbBuckets, sizeof * _shByName);
+    _shById = calloc(_shNbBuckets, sizeof * _shById);
+    assert(_shByName && _shById);
+    for(sh = shaders_list; sh; sh = sh->next) {
+      b = shNameBucket(sh->filename);
+      sh->nnext = _shByName[b];
+      _shByName[b] = sh;
+      b = sh->id & (_shNbBuckets - 1);
+      sh->inext = _shById[b];
+      _shById[b] = sh;
+    }
+    return;
+  }
+  b = shNameBucket(sh->filename);
+  sh->nnext = _shByName[b];
+  _shByName[b] = sh;
+  b = sh->id & (_shNbBuckets - 1);
+  sh->inext = _shById[b];
+  _shById[b] = sh;
+}
+
+/*!\brief retire \a sh des index par nom et par id. */
+static void unindexShader(shader_t * sh) {
+  shader_t ** p;
+  for(p = &_shByName[shNameBucket(sh->filename)]; *p != sh; p = &((*p)->nnext));
+  *p = sh->nnext;
+  for(p = &_shById[sh->id & (_shNbBuckets - 1)]; *p != sh; p = &((*p)->inext));
+  *p = sh->inext;
+  _shCount--;
+}
+
 /*!\brief recherche un shader à partir du nom de fichier dans la liste
- * \ref shaders_list.
- *
- * Si le shader n'existe pas la fonction retourne NULL;
+ * \ref shaders_list (via son index par nom).
  *
  * \param filename le nom (le chemin entier (relatif)) du fichier
  * contenant le shader
  *
- * \return le pointeur de pointeur vers le shader.
+ * \return le pointeur de pointeur vers le shader, pointant vers NULL
+ * si le shader n'existe pas.
  */
 static shader_t ** findfnInShadersList(const char * filename) {
-  shader_t ** ptr = &shaders_list;
-  while(*ptr) {
-    if(!strcmp(filename, (*ptr)->filename))
-      return ptr;
-    ptr = &((*ptr)->next);
-  }
-  return ptr;
+  static shader_t * none = NULL;
+  shader_t * sh;
+  if(_shNbBuckets)
+    for(sh = _shByName[shNameBucket(filename)]; sh; sh = sh->nnext)
+      if(!strcmp(filename, sh->filename))
+        return sh->pprev;
+  return &none;
 }
 
 /*!\brief recherche un shader à partir de son identifiant openGL dans
- * la liste \ref shaders_list.
- *
- * Si le shader n'existe pas la fonction retourne NULL;
+ * la liste \ref shaders_list (via son index par id).
  *
  * \param id l'identifiant openGL du shader.
  *
- * \return le pointeur de pointeur vers le shader.
+ * \return le pointeur de pointeur vers le shader, pointant vers NULL
+ * si le shader n'existe pas.
  */
 static shader_t ** findidInShadersList(GLuint id) {
-  shader_t ** ptr = &shaders_list;
-  while(*ptr) {
-    if(id == (*ptr)->id)
-      return ptr;
-    ptr = &((*ptr)->next);
-  }
-  return ptr;
+  static shader_t * none = NULL;
+  shader_t * sh;
+  if(_shNbBuckets)
+    for(sh = _shById[id & (_shNbBuckets - 1)]; sh; sh = sh->inext)
+      if(id == sh->id)
+        return sh->pprev;
+  return &none;
+}
+
+/*!\brief crée l'entrée du shader \a id en tête de la liste \ref
+ * shaders_list et l'indexe. */
+static shader_t * newShader(GLuint id, GLenum shadertype, const char * filename) {
+  shader_t * sh = malloc(sizeof * sh);
+  assert(sh);
+  sh->id         = id;
+  sh->shadertype = shadertype;
+  sh->filename   = strdup(filename);
+  sh->todelete   = 0;
+  sh->compiled   = 0;
+  sh->logpending = 0;
+  sh->srchash    = 0;
+  sh->imsrc      = NULL;
+  sh->deps       = NULL;
+  sh->ndeps      = 0;
+  sh->nprograms  = 0;
+  sh->sprograms  = 2;
+  sh->programs   = malloc(sh->sprograms * sizeof * sh->programs);
+  assert(sh->filename && sh->programs);
+  if((sh->next = shaders_list) != NULL)
+    shaders_list->pprev = &sh->next;
+  sh->pprev = &shaders_list;
+  shaders_list = sh;
+  indexShader(sh);
+  return sh;
 }
 
 /*!\brief ajoute un nouveau shader dans la liste de shaders \ref shaders_list.
+ *
+ * Le code source est passé au préprocesseur des #include ; les
+ * fichiers lus (celui du shader et ceux qu'il inclut) sont surveillés
+ * pour \ref gl4duUpdateShaders.
  *
  * \param shadertype type de shader (vertex, fragment et geometry)
  * \param filename nom du fichier shader
@@ -726,86 +1369,54 @@ static shader_t ** findidInShadersList(GLuint id) {
  */
 static shader_t ** addInShadersList(GLenum shadertype, const char * filename, const char * shadercode) {
   GLuint id;
-  char * txt = NULL;
-  struct stat buf;
-  shader_t * ptr;
+  char * txt, ** deps;
+  int i, ndeps;
+  shader_t * sh;
   if(!(id = glCreateShader(shadertype))) {
     fprintf(stderr, "%s (%d): %s: impossible de créer le shader\nglCreateShader a retourné 0\n",
 	    __FILE__, __LINE__, __func__);
     return NULL;
   }
-  if(shadercode == NULL) {
-    if(!(txt = gl4dReadTextFile(filename))) {
-      glDeleteShader(id);
-      return NULL;
-    }
-    if(stat(filename, &buf) != 0) {
-      fprintf(stderr, "%s:%d:In %s: erreur %d: %s\n",
-	      __FILE__, __LINE__, __func__, errno, strerror(errno));
-      glDeleteShader(id);
-      return NULL;
-    }
-  } else
-    txt = (char *)shadercode;
-  ptr = shaders_list;
-  shaders_list = malloc(sizeof * shaders_list);
-  assert(shaders_list);
-  shaders_list->id         = id;
-  shaders_list->shadertype = shadertype;
-  shaders_list->filename   = strdup(filename);
-  shaders_list->mod_time   = shadercode ? INT_MAX : buf.st_mtime;
-  shaders_list->verify_timestamp = shadercode ? GL_FALSE : GL_TRUE;
-  shaders_list->todelete   = 0;
-  shaders_list->nprograms  = 0;
-  shaders_list->sprograms  = 2;
-  shaders_list->next       = ptr;
-  shaders_list->programs   = malloc(shaders_list->sprograms * sizeof shaders_list->programs);
-  assert(shaders_list->programs);
+  if(!(txt = incExpand(filename, shadercode, &deps, &ndeps))) {
+    glDeleteShader(id);
+    return NULL;
+  }
+  sh = newShader(id, shadertype, filename);
+  sh->srchash    = hash64(FNV64_SEED, txt, strlen(txt));
+  sh->deps       = deps;
+  sh->ndeps      = ndeps;
+  if(shadercode && ndeps) {
+    sh->imsrc = strdup(shadercode);
+    assert(sh->imsrc);
+  }
+  for(i = 0; i < ndeps; i++)
+    fwAdd(deps[i]);
   glShaderSource(id, 1, (const char **)&txt, NULL);
-  glCompileShader(id);
-  gl4duPrintShaderInfoLog(id, stderr);
-  if(shadercode == NULL)
-    free(txt);
-  return &shaders_list;
+  if(!_deferCompile || !pcacheEnabled())
+    compileShader(sh);
+  free(txt);
+  return sh->pprev;
 }
 
 /*!\brief ajoute un nouveau shader dans la liste de shaders \ref shaders_list.
- * Version FED
+ * Version FED (sans prétraitement des #include)
  *
  * \return l'adresse du shader ajouté sinon NULL.
  */
-static shader_t ** addInShadersListFED(const char * decData, GLenum shadertype, const char * filename) {
+static shader_t ** addInShadersListFED(const char * src, GLint len, GLenum shadertype, const char * filename) {
   GLuint id;
-  char * txt;
-  shader_t * ptr;
+  shader_t * sh;
   if(!(id = glCreateShader(shadertype))) {
     fprintf(stderr, "%s (%d): %s: impossible de créer le shader\nglCreateShader a retourné 0\n",
 	    __FILE__, __LINE__, __func__);
     return NULL;
   }
-  if(!(txt = gl4dExtractFromDecData(decData, filename))) {
-    glDeleteShader(id);
-    return NULL;
-  }
-  ptr = shaders_list;
-  shaders_list = malloc(sizeof * shaders_list);
-  assert(shaders_list);
-  shaders_list->id         = id;
-  shaders_list->shadertype = shadertype;
-  shaders_list->filename   = strdup(filename);
-  shaders_list->mod_time   = INT_MAX;
-  shaders_list->verify_timestamp = GL_FALSE;
-  shaders_list->todelete   = 0;
-  shaders_list->nprograms  = 0;
-  shaders_list->sprograms  = 2;
-  shaders_list->next       = ptr;
-  shaders_list->programs   = malloc(shaders_list->sprograms * sizeof shaders_list->programs);
-  assert(shaders_list->programs);
-  glShaderSource(id, 1, (const char **)&txt, NULL);
-  glCompileShader(id);
-  gl4duPrintShaderInfoLog(id, stderr);
-  free(txt);
-  return &shaders_list;
+  sh = newShader(id, shadertype, filename);
+  sh->srchash = hash64(FNV64_SEED, src, len);
+  glShaderSource(id, 1, &src, &len);
+  if(!_deferCompile || !pcacheEnabled())
+    compileShader(sh);
+  return sh->pprev;
 }
 
 /*!\brief supprime le shader pointé par \a shp de la liste de shaders
@@ -813,7 +1424,14 @@ static shader_t ** addInShadersListFED(const char * decData, GLenum shadertype,
  */
 static void deleteFromShadersList(shader_t ** shp) {
   shader_t * ptr = *shp;
-  *shp = (*shp)->next;
+  int i;
+  if((*ptr->pprev = ptr->next) != NULL)
+    ptr->next->pprev = ptr->pprev;
+  unindexShader(ptr);
+  for(i = 0; i < ptr->ndeps; i++)
+    fwRemove(ptr->deps[i]);
+  incRelease(ptr->deps, ptr->ndeps);
+  free(ptr->imsrc);
   free(ptr->filename);
   free(ptr->programs);
   glDeleteShader(ptr->id);
@@ -844,9 +1462,13 @@ static program_t ** findInProgramsList(GLuint id) {
  */
 static program_t ** addInProgramsList(GLuint id) {
   program_t * ptr = programs_list;
+  gl4duForgetUniformLocations(id); /* l'id a pu être recyclé par GL */
   programs_list = malloc(sizeof * programs_list);
   assert(programs_list);
   programs_list->id       = id;
+  programs_list->pending  = 0;
+  programs_list->tosave   = 0;
+  programs_list->key      = 0;
   programs_list->nshaders = 0;
   programs_list->sshaders = 4;
   programs_list->next     = ptr;
@@ -865,6 +1487,7 @@ static void deleteFromProgramsList(program_t ** pp) {
   for(i = 0; i < ptr->nshaders; i++)
     detachShader(ptr, ptr->shaders[i]);
   free(ptr->shaders);
+  gl4duForgetUniformLocations(ptr->id);
   glDeleteProgram(ptr->id);
   free(ptr);
 }
@@ -907,6 +1530,14 @@ static void detachShader(program_t * prg, shader_t * sh) {
     deleteFromShadersList(findidInShadersList(sh->id));
 }
 
+/*!\brief hachage FNV-1a (32 bits) du nom \a name. */
+static inline GLuint matrixHash(const char * name) {
+  GLuint h = 2166136261u;
+  while(*name)
+    h = (h ^ (GLubyte)*name++) * 16777619u;
+  return h;
+}
+
 /*!\brief créé une nouvelle pile de "une matrice 4x4" dont le nom
  * est \a name et le type est \a type.
  *
@@ -930,6 +1561,10 @@ static inline _GL4DUMatrix * newGL4DUMatrix(GLenum type, const char * name) {
   m->top   = 0; /* déjà une matrice en haut de la pile */
   m->data  = malloc(m->size * m->nmemb);
   assert(m->data);
+  m->hash   = matrixHash(name);
+  m->handle = 0;
+  m->hnext  = NULL;
+  touchMatrix(m);
   return m;
 }
 
@@ -943,43 +1578,152 @@ static inline void freeGL4DUMatrix(void * matrix) {
   free(matrix);
 }
 
-/*!\brief fonction de comparaison de deux matrices en fonction du nom
- * pour insertion dans l'arbre binaire.
- *
- * Cette fonction utilise strcmp.
+/*!\brief recherche la matrice dont le nom est passé en argument (\a
+ * name) dans la table de hachage \ref _gl4duMatBuckets.
  *
- * \param m1 première matrice (de type _GL4DUMatrix).
- *
- * \param m2 seconde matrice (de type _GL4DUMatrix).
+ * \param name le nom de la matrice recherchée.
  *
- * \return entier négatif, nul ou positif selon que le nom de la
- * première soit respectivement inférieur, égal ou supérieur à la
- * seconde.
+ * \return la matrice trouvée ou NULL si elle n'existe pas.
  */
-static inline int matrixCmpFunc(const void * m1, const void * m2) {
-  return strcmp( ((_GL4DUMatrix *)m1)->name, ((_GL4DUMatrix *)m2)->name );
+static inline _GL4DUMatrix * findMatrix(const char * name) {
+  GLuint h;
+  _GL4DUMatrix * m;
+  if(!_gl4duNbMatBuckets) return NULL;
+  h = matrixHash(name);
+  for(m = _gl4duMatBuckets[h & (_gl4duNbMatBuckets - 1)]; m; m = m->hnext)
+    if(m->hash == h && strcmp(m->name, name) == 0)
+      return m;
+  return NULL;
 }
 
-/*!\brief recherche et renvoie le pointeur de pointeur vers le noeud
- * de l'arbre binaire pointant vers la matrice dont le nom est passé
- * en argument (\a name).
+/*!\brief retourne la matrice dont l'identifiant est \a handle ou NULL
+ * s'il ne correspond à aucune matrice. */
+static inline _GL4DUMatrix * matrixFromHandle(GLuint handle) {
+  if(handle == 0 || handle > _gl4duNbMatrices) return NULL;
+  return _gl4duMatrices[handle - 1];
+}
+
+/*!\brief insère la matrice \a m dans la table de hachage \ref
+ * _gl4duMatBuckets en doublant celle-ci au delà d'un taux de
+ * remplissage de 3/4. */
+static void hashMatrix(_GL4DUMatrix * m) {
+  GLuint i, n;
+  _GL4DUMatrix ** b, * p, * q;
+  if(4 * (_gl4duNbLiveMatrices + 1) > 3 * _gl4duNbMatBuckets) {
+    n = _gl4duNbMatBuckets ? _gl4duNbMatBuckets << 1 : 16;
+    b = calloc(n, sizeof *b);
+    assert(b);
+    for(i = 0; i < _gl4duNbMatBuckets; i++)
+      for(p = _gl4duMatBuckets[i]; p; p = q) {
+        q = p->hnext;
+        p->hnext = b[p->hash & (n - 1)];
+        b[p->hash & (n - 1)] = p;
+      }
+    free(_gl4duMatBuckets);
+    _gl4duMatBuckets = b;
+    _gl4duNbMatBuckets = n;
+  }
+  b = &_gl4duMatBuckets[m->hash & (_gl4duNbMatBuckets - 1)];
+  m->hnext = *b;
+  *b = m;
+  _gl4duNbLiveMatrices++;
+}
+
+/*!\brief retire la matrice \a m de la table de hachage et libère son
+ * identifiant. */
+static void unhashMatrix(_GL4DUMatrix * m) {
+  _GL4DUMatrix ** b = &_gl4duMatBuckets[m->hash & (_gl4duNbMatBuckets - 1)];
+  while(*b != m)
+    b = &((*b)->hnext);
+  *b = m->hnext;
+  _gl4duMatrices[m->handle - 1] = NULL;
+  _gl4duNbLiveMatrices--;
+}
+
+/*!\brief libère toutes les matrices, la table de hachage et le cache
+ * des uniform locations (les identifiants repartent de 1). */
+static void freeMatrices(void) {
+  GLuint i;
+  for(i = 0; i < _gl4duNbMatrices; i++)
+    if(_gl4duMatrices[i])
+      freeGL4DUMatrix(_gl4duMatrices[i]);
+  free(_gl4duMatrices);
+  free(_gl4duMatBuckets);
+  _gl4duMatrices = _gl4duMatBuckets = NULL;
+  _gl4duNbMatrices = _gl4duSMatrices = _gl4duNbMatBuckets = _gl4duNbLiveMatrices = 0;
+  _gl4dCurMatrix = NULL;
+  _gl4duUploads = _gl4duSkippedUploads = 0;
+  free(_blockGLSL);
+  _blockGLSL = NULL;
+  free(_instances);
+  _instances = NULL;
+  _nbInstances = _sInstances = 0;
+  freeMatrixUBO();
+  gl4duForgetUniformLocations(0);
+}
+
+/*!\brief retourne le cache d'uniform locations du program \a pId, le
+ * créé au besoin et le place en tête de \ref _ulocs. */
+static uloc_cache_t * ulocCache(GLuint pId) {
+  uloc_cache_t ** pc = &_ulocs, * c;
+  while(*pc && (*pc)->pId != pId)
+    pc = &((*pc)->next);
+  if((c = *pc) == NULL) {
+    c = calloc(1, sizeof *c);
+    assert(c);
+    c->pId = pId;
+    c->block = ULOC_UNKNOWN;
+  } else
+    *pc = c->next;
+  c->next = _ulocs;
+  _ulocs = c;
+  return c;
+}
+
+/*!\brief retourne l'indice de la matrice \a m dans le cache \a c du
+ * program \a pId après y avoir placé son uniform location ; \a
+ * glGetUniformLocation n'est appelée qu'une fois par couple (program,
+ * matrice). */
+static GLuint ulocEntry(uloc_cache_t * c, _GL4DUMatrix * m) {
+  GLuint i = m->handle - 1;
+  if(i >= c->nlocs) {
+    GLuint n = _gl4duSMatrices;
+    c->locs = realloc(c->locs, n * sizeof *(c->locs));
+    c->sent = realloc(c->sent, n * sizeof *(c->sent));
+    assert(c->locs && c->sent);
+    for(; c->nlocs < n; c->nlocs++) {
+      c->locs[c->nlocs] = ULOC_UNKNOWN;
+      c->sent[c->nlocs] = 0;
+    }
+  }
+  if(c->locs[i] == ULOC_UNKNOWN)
+    c->locs[i] = glGetUniformLocation(c->pId, m->name);
+  return i;
+}
+
+/*!\brief oublie les uniform locations mises en cache pour le program
+ * \a pId (pour tous les programs si \a pId vaut 0) ; toutes les
+ * matrices lui seront renvoyées au prochain \ref gl4duSendMatrices.
  *
- * \param name le nom de la matrice recherchée.
+ * Appelée automatiquement quand GL4Dummies (re)lie ou supprime un
+ * program ; à appeler si un program utilisé avec \ref
+ * gl4duSendMatrices est relié (glLinkProgram) en dehors de
+ * GL4Dummies.
  *
- * \return le pointeur de pointeur vers le noeud de l'arbre binaire
- * pointant vers la matrice dont le nom est passé en argument (\a
- * name).
- */
-static inline bin_tree_t ** findMatrix(const char * name) {
-  pair_t pair;
-  _GL4DUMatrix m;
-  if(_gl4dLastMatrixn && strcmp(((_GL4DUMatrix *)((*_gl4dLastMatrixn)->data))->name, name) == 0)
-    return _gl4dLastMatrixn;
-  m.name = (char *)name;
-  pair = btFind(&_gl4duMatrices, &m, matrixCmpFunc);
-  if(!pair.compResult)
-    return (bin_tree_t **)pair.ptr;
-  return NULL;
+ * \param pId l'identifiant openGL du program ou 0.
+ */
+void gl4duForgetUniformLocations(GLuint pId) {
+  uloc_cache_t ** pc = &_ulocs, * c;
+  while((c = *pc) != NULL) {
+    if(pId && c->pId != pId) {
+      pc = &(c->next);
+      continue;
+    }
+    *pc = c->next;
+    free(c->locs);
+    free(c->sent);
+    free(c);
+  }
 }
 
 /*!\brief génère et gère une matrice (pile de "une matrice 4x4") liée
@@ -994,16 +1738,31 @@ static inline bin_tree_t ** findMatrix(const char * name) {
  * si le nom existe déjà).
  */
 GLboolean gl4duGenMatrix(GLenum type, const char * name) {
-  _GL4DUMatrix m, * p;
-  pair_t pair;
-  m.name = (char *)name;
-  pair = btFind(&_gl4duMatrices, &m, matrixCmpFunc);
-  if(pair.compResult) {
-    p = newGL4DUMatrix(type, name);
-    _gl4dLastMatrixn = (bin_tree_t **)(btInsert((bin_tree_t **)(pair.ptr), p, matrixCmpFunc).ptr);
-    return GL_TRUE;
-  }
-  return GL_FALSE;
+  _GL4DUMatrix * p;
+  uloc_cache_t * c;
+  GLuint i;
+  if(findMatrix(name))
+    return GL_FALSE;
+  p = newGL4DUMatrix(type, name);
+  /* réutilise le premier identifiant libre */
+  for(i = 0; i < _gl4duNbMatrices && _gl4duMatrices[i]; i++);
+  if(i == _gl4duNbMatrices) {
+    if(_gl4duNbMatrices == _gl4duSMatrices) {
+      _gl4duSMatrices = _gl4duSMatrices ? _gl4duSMatrices << 1 : 16;
+      _gl4duMatrices = realloc(_gl4duMatrices, _gl4duSMatrices * sizeof *_gl4duMatrices);
+      assert(_gl4duMatrices);
+    }
+    _gl4duNbMatrices++;
+  } else /* l'ancien occupant de l'identifiant avait un autre nom */
+    for(c = _ulocs; c; c = c->next)
+      if(i < c->nlocs) {
+        c->locs[i] = ULOC_UNKNOWN;
+        c->sent[i] = 0;
+      }
+  _gl4duMatrices[i] = p;
+  p->handle = i + 1;
+  hashMatrix(p);
+  return GL_TRUE;
 }
 
 /*!\brief indique s'il existe une matrice est liée
@@ -1014,9 +1773,25 @@ GLboolean gl4duGenMatrix(GLenum type, const char * name) {
  * \return GL_TRUE si la matrice existe, GL_FALSE sinon.
  */
 GLboolean gl4duIsMatrix(const char * name) {
-  _GL4DUMatrix m;
-  m.name = (char *)name;
-  return !btFind(&_gl4duMatrices, &m, matrixCmpFunc).compResult;
+  return findMatrix(name) != NULL;
+}
+
+/*!\brief retourne l'identifiant entier de la matrice liée au nom \a
+ * name.
+ *
+ * L'identifiant reste valable jusqu'à la suppression de la matrice
+ * (\ref gl4duDeleteMatrix ou \ref gl4duClean) et évite la recherche
+ * par nom dans \ref gl4duBindMatrixHandle et \ref
+ * gl4duMultMatrixByHandle.
+ *
+ * \param name le nom de la matrice.
+ *
+ * \return l'identifiant (non nul) de la matrice, 0 si elle n'existe
+ * pas.
+ */
+GLuint gl4duGetMatrixHandle(const char * name) {
+  _GL4DUMatrix * m = findMatrix(name);
+  return m ? m->handle : 0;
 }
 
 /*!\brief active (met en current) la matrice liée au nom \a name passé
@@ -1034,14 +1809,35 @@ GLboolean gl4duIsMatrix(const char * name) {
  * désactive toute matrice et renvoie GL_TRUE.
  */
 GLboolean gl4duBindMatrix(const char * name) {
-  bin_tree_t ** bt;
+  _GL4DUMatrix * m;
   if(!name) {
     _gl4dCurMatrix = NULL;
     return GL_TRUE;
   }
-  bt = findMatrix(name);
-  if(bt) {
-    _gl4dCurMatrix = (_GL4DUMatrix *)((*bt)->data);
+  if((m = findMatrix(name)) != NULL) {
+    _gl4dCurMatrix = m;
+    return GL_TRUE;
+  }
+  return GL_FALSE;
+}
+
+/*!\brief active (met en current) la matrice d'identifiant \a handle
+ * (voir \ref gl4duGetMatrixHandle).
+ *
+ * \param handle l'identifiant de la matrice, 0 désactive (dé-bind)
+ * tout.
+ *
+ * \return GL_TRUE si la matrice existe ou si \a handle est nul,
+ * GL_FALSE sinon.
+ */
+GLboolean gl4duBindMatrixHandle(GLuint handle) {
+  _GL4DUMatrix * m;
+  if(!handle) {
+    _gl4dCurMatrix = NULL;
+    return GL_TRUE;
+  }
+  if((m = matrixFromHandle(handle)) != NULL) {
+    _gl4dCurMatrix = m;
     return GL_TRUE;
   }
   return GL_FALSE;
@@ -1059,13 +1855,12 @@ GLboolean gl4duBindMatrix(const char * name) {
  * sinon.
  */
 GLboolean gl4duDeleteMatrix(const char * name) {
-  bin_tree_t ** bt = findMatrix(name);
-  if(bt) {
-    if(_gl4dCurMatrix == (_GL4DUMatrix *)((*bt)->data))
+  _GL4DUMatrix * m = findMatrix(name);
+  if(m) {
+    if(_gl4dCurMatrix == m)
       _gl4dCurMatrix = NULL;
-    btDelete(bt, freeGL4DUMatrix);
-    if(_gl4dLastMatrixn == bt)
-      _gl4dLastMatrixn = NULL;
+    unhashMatrix(m);
+    freeGL4DUMatrix(m);
     return GL_TRUE;
   }
   return GL_FALSE;
@@ -1085,6 +1880,7 @@ void gl4duPushMatrix(void) {
   memcpy(&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]),
 	 &(((GLubyte *)_gl4dCurMatrix->data)[(_gl4dCurMatrix->top - 1) * _gl4dCurMatrix->size]),
 	 _gl4dCurMatrix->size);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief dépile la matrice courante en restaurant l'état précédemment
@@ -1092,48 +1888,315 @@ void gl4duPushMatrix(void) {
  */
 void gl4duPopMatrix(void) {
   assert(_gl4dCurMatrix);
-  if(_gl4dCurMatrix->top)
+  if(_gl4dCurMatrix->top) {
     --_gl4dCurMatrix->top;
+    touchMatrix(_gl4dCurMatrix);
+  }
 }
 
-/*!\brief utilisée par \ref btForAll pour envoyer la matrice \a m sur
- * le program Id pointé par \a ppId.
+/*!\brief envoie la matrice \a matrix au program du cache \a c (le
+ * program en cours) en utilisant l'uniform location mise en cache ;
+ * rien n'est envoyé si le program a déjà reçu la version courante de
+ * la matrice.
  * \todo ajouter la gestion des GLdouble
  */
-void sendMatrix(void * m, void **ppId) {
-  _GL4DUMatrix * matrix = (_GL4DUMatrix * )m;
-  GLint pId = *(GLint *)ppId;
+static void sendMatrix(_GL4DUMatrix * matrix, uloc_cache_t * c) {
+  GLuint i = ulocEntry(c, matrix);
+  GLint loc = c->locs[i];
 #ifdef __ANDROID__
   /*!\todo voir pourquoi le transpose génère une erreur sous Android */
-  GLfloat t[16], * M = matrixData(matrix);
+  GLfloat t[16], * M;
+#endif
+  if(loc < 0) return;
+  if(c->sent[i] == matrix->version) {
+    _gl4duSkippedUploads++;
+    return;
+  }
+  c->sent[i] = matrix->version;
+  _gl4duUploads++;
+#ifdef __ANDROID__
+  M = matrixData(matrix);
   t[0] = M[0]; t[1] = M[4]; t[2] = M[8]; t[3] = M[12];
   t[4] = M[1]; t[5] = M[5]; t[6] = M[9]; t[7] = M[13];
   t[8] = M[2]; t[9] = M[6]; t[10] = M[10]; t[11] = M[14];
   t[12] = M[3]; t[13] = M[7]; t[14] = M[11]; t[15] = M[15];
-  glUniformMatrix4fv(glGetUniformLocation(pId, matrix->name), 1, GL_FALSE, t);
-  //__android_log_print(ANDROID_LOG_ERROR, "AndroidGL4D", "PROGRAM %d, Matrix %s : %d\n", pId, matrix->name, glGetUniformLocation(pId, matrix->name));
+  glUniformMatrix4fv(loc, 1, GL_FALSE, t);
 #else
-  glUniformMatrix4fv(glGetUniformLocation(pId, matrix->name), 1, GL_TRUE, matrixData(matrix));
+  glUniformMatrix4fv(loc, 1, GL_TRUE, matrixData(matrix));
 #endif
 }
 
+/*!\brief indique si les matrices du program du cache \a c passent
+ * par l'UBO : mode UBO actif et bloc GL4DU_MATRIX_BLOCK présent (cherché
+ * une fois par program). */
+static int usesMatrixUBO(uloc_cache_t * c) {
+#ifdef GL_UNIFORM_BUFFER
+  if(!_uboMode) return 0;
+  if(c->block == ULOC_UNKNOWN) {
+    GLuint b = glGetUniformBlockIndex(c->pId, GL4DU_MATRIX_BLOCK);
+    c->block = (b == GL_INVALID_INDEX) ? -1 : (GLint)b;
+    if(c->block >= 0)
+      glUniformBlockBinding(c->pId, b, GL4DU_MATRIX_BINDING);
+  }
+  return c->block >= 0;
+#else
+  (void)c;
+  return 0;
+#endif
+}
+
+/*!\brief retourne le cache du program \a pId, le plus récemment
+ * utilisé étant testé en premier. */
+static inline uloc_cache_t * programCache(GLuint pId) {
+  return (_ulocs && _ulocs->pId == pId) ? _ulocs : ulocCache(pId);
+}
+
 /*!\brief envoie la matrice courante au program shader en cours et en
  * utilisant le nom de la matrice pour obtenir le uniform location.
+ *
+ * La matrice n'est envoyée que si elle a été modifiée depuis son
+ * dernier envoi à ce program.
  */
 void gl4duSendMatrix(void) {
   GLint pId;
+  uloc_cache_t * c;
   assert(_gl4dCurMatrix);
   glGetIntegerv(GL_CURRENT_PROGRAM, &pId);
-  sendMatrix(_gl4dCurMatrix, (void **)&pId);
+  c = programCache((GLuint)pId);
+  if(usesMatrixUBO(c))
+    sendMatrixUBO();
+  else
+    sendMatrix(_gl4dCurMatrix, c);
 }
 
 /*!\brief envoie toutes matrices au program shader en cours et en
  * utilisant leurs noms pour obtenir le uniform location.
+ *
+ * Seules les matrices modifiées depuis leur dernier envoi à ce
+ * program sont envoyées (voir \ref gl4duGetIntegerv avec
+ * GL4DU_MATRIX_UPLOADS et GL4DU_MATRIX_SKIPPED_UPLOADS). Le program
+ * est obtenu par glGetIntegerv, voir \ref gl4duSendMatricesTo pour
+ * l'éviter.
  */
 void gl4duSendMatrices(void) {
   GLint pId;
   glGetIntegerv(GL_CURRENT_PROGRAM, &pId);
-  btForAll(_gl4duMatrices, sendMatrix, (void **)&pId);
+  gl4duSendMatricesTo((GLuint)pId);
+}
+
+/*!\brief comme \ref gl4duSendMatrices mais sans interroger GL sur le
+ * program en cours.
+ *
+ * \param pId le program en cours (celui passé au dernier
+ * glUseProgram), c'est à l'appelant de le garantir.
+ */
+void gl4duSendMatricesTo(GLuint pId) {
+  GLuint i;
+  uloc_cache_t * c = programCache(pId);
+  GL4D_PROF_BEGIN("gl4duSendMatrices");
+  if(usesMatrixUBO(c))
+    sendMatrixUBO();
+  else
+    for(i = 0; i < _gl4duNbMatrices; i++)
+      if(_gl4duMatrices[i])
+        sendMatrix(_gl4duMatrices[i], c);
+  GL4D_PROF_END();
+}
+
+#ifdef GL_UNIFORM_BUFFER
+/*!\brief créé l'anneau d'UBO avec des régions de \a regionSize
+ * octets. */
+static void newMatrixUBO(GLsizeiptr regionSize) {
+  GLint major = 0, minor = 0;
+  GLsizeiptr size;
+  _ubo = calloc(1, sizeof *_ubo);
+  assert(_ubo);
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &(_ubo->align));
+  if(_ubo->align < 16) _ubo->align = 16;
+  regionSize = ((regionSize + _ubo->align - 1) / _ubo->align) * _ubo->align;
+  _ubo->regionSize = regionSize;
+  size = UBO_RING_SIZE * regionSize;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  glGenBuffers(1, &(_ubo->buffer));
+  glBindBuffer(GL_UNIFORM_BUFFER, _ubo->buffer);
+#  ifdef GL_MAP_PERSISTENT_BIT
+  if(major > 4 || (major == 4 && minor >= 4)) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+    _ubo->map = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+  } else
+#  endif
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/*!\brief écrit, si une matrice a changé depuis le précédent, un
+ * instantané de toutes les matrices (dans l'ordre de leurs
+ * identifiants, une mat4 std140 de 64 octets chacune, converties en
+ * GLfloat) dans la région courante de l'anneau et le lie au point
+ * GL4DU_MATRIX_BINDING : un seul glBindBufferRange pour tous les
+ * programs. */
+static void sendMatrixUBO(void) {
+  GLuint i;
+  GLsizeiptr size = (_gl4duNbMatrices ? _gl4duNbMatrices : 1) * 16 * sizeof (GLfloat), asize, base;
+  GLubyte * dst;
+  if(_ubo && _ubo->version == _gl4duVersion && _ubo->nbMatrices == _gl4duNbMatrices) {
+    _gl4duSkippedUploads += _gl4duNbLiveMatrices;
+    return;
+  }
+  if(_ubo && size > _ubo->regionSize)
+    freeMatrixUBO();
+  if(!_ubo)
+    newMatrixUBO(MAX(size * 64, 1 << 16));
+  asize = ((size + _ubo->align - 1) / _ubo->align) * _ubo->align;
+  if(_ubo->offset + asize > _ubo->regionSize) { /* région suivante */
+    _ubo->fence[_ubo->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _ubo->region = (_ubo->region + 1) % UBO_RING_SIZE;
+    if(_ubo->fence[_ubo->region]) {
+      while(glClientWaitSync(_ubo->fence[_ubo->region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+      glDeleteSync(_ubo->fence[_ubo->region]);
+      _ubo->fence[_ubo->region] = 0;
+    }
+    _ubo->offset = 0;
+  }
+  base = _ubo->region * _ubo->regionSize + _ubo->offset;
+  glBindBuffer(GL_UNIFORM_BUFFER, _ubo->buffer);
+  dst = _ubo->map ? _ubo->map + base :
+    glMapBufferRange(GL_UNIFORM_BUFFER, base, asize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+  if(dst) {
+    for(i = 0; i < _gl4duNbMatrices; i++) {
+      GLfloat * f = (GLfloat *)(dst + i * 16 * sizeof (GLfloat));
+      _GL4DUMatrix * m = _gl4duMatrices[i];
+      if(!m) continue;
+      if(m->type == GL_FLOAT)
+        memcpy(f, matrixData(m), 16 * sizeof (GLfloat));
+      else {
+        GLdouble * d = matrixData(m);
+        int k;
+        for(k = 0; k < 16; k++)
+          f[k] = (GLfloat)d[k];
+      }
+    }
+    if(!_ubo->map)
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBufferRange(GL_UNIFORM_BUFFER, GL4DU_MATRIX_BINDING, _ubo->buffer, base, size);
+    _ubo->offset += asize;
+    _ubo->version = _gl4duVersion;
+    _ubo->nbMatrices = _gl4duNbMatrices;
+    _gl4duUploads += _gl4duNbLiveMatrices;
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+#else
+static void sendMatrixUBO(void) {
+}
+#endif
+
+/*!\brief libère l'anneau d'UBO des matrices (il sera recréé au
+ * prochain envoi si le mode UBO est toujours actif). */
+static void freeMatrixUBO(void) {
+#ifdef GL_UNIFORM_BUFFER
+  GLuint i;
+  if(!_ubo) return;
+  for(i = 0; i < UBO_RING_SIZE; i++)
+    if(_ubo->fence[i])
+      glDeleteSync(_ubo->fence[i]);
+  if(_ubo->map) {
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo->buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  glDeleteBuffers(1, &(_ubo->buffer));
+  free(_ubo);
+  _ubo = NULL;
+#endif
+}
+
+/*!\brief lie, s'il existe, le bloc GL4DU_MATRIX_BLOCK du program \a
+ * pId au point GL4DU_MATRIX_BINDING. Appelée après chaque édition de
+ * liens faite par GL4Dummies. */
+static void bindMatrixBlock(GLuint pId) {
+#ifdef GL_UNIFORM_BUFFER
+  GLuint b = glGetUniformBlockIndex(pId, GL4DU_MATRIX_BLOCK);
+  if(b != GL_INVALID_INDEX)
+    glUniformBlockBinding(pId, b, GL4DU_MATRIX_BINDING);
+#else
+  (void)pId;
+#endif
+}
+
+/*!\brief active ou désactive le mode UBO des matrices.
+ *
+ * En mode UBO, pour tout program déclarant le bloc uniforme
+ * GL4DU_MATRIX_BLOCK (voir \ref gl4duGetMatrixBlockGLSL), \ref
+ * gl4duSendMatrices n'envoie plus chaque matrice par
+ * glUniformMatrix4fv : un instantané de toutes les matrices est
+ * écrit, seulement si l'une d'elles a changé, dans un anneau d'UBO
+ * (mappé de manière persistante si GL >= 4.4) et lié une fois pour
+ * toutes au point GL4DU_MATRIX_BINDING, partagé par tous les
+ * programs. Les programs sans ce bloc continuent de recevoir leurs
+ * matrices une à une. GL4Dummies lie automatiquement le bloc de
+ * chaque program qu'il crée ou relie.
+ *
+ * \param enable GL_TRUE pour activer, GL_FALSE pour désactiver.
+ *
+ * \return GL_TRUE si le mode demandé est en place, GL_FALSE si les
+ * UBO ne sont pas disponibles (GL < 3.1).
+ */
+GLboolean gl4duSetMatrixUBO(GLboolean enable) {
+#ifdef GL_UNIFORM_BUFFER
+  GLint major = 0, minor = 0;
+  if(!enable) {
+    freeMatrixUBO();
+    _uboMode = GL_FALSE;
+    return GL_TRUE;
+  }
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if(major < 3 || (major == 3 && minor < 1))
+    return GL_FALSE;
+  _uboMode = GL_TRUE;
+  return GL_TRUE;
+#else
+  _uboMode = GL_FALSE;
+  return !enable;
+#endif
+}
+
+/*!\brief retourne la déclaration GLSL du bloc uniforme des matrices
+ * pour le mode UBO (\ref gl4duSetMatrixUBO), par exemple :
+ *
+ * layout(std140, row_major) uniform gl4duMatrices {
+ *   mat4 projectionMatrix;
+ *   mat4 modelViewMatrix;
+ * };
+ *
+ * Les matrices y apparaissent dans l'ordre de leurs identifiants
+ * (voir \ref gl4duGetMatrixHandle), les identifiants libérés étant
+ * remplacés par des membres de bourrage. La chaîne est valable
+ * jusqu'au prochain appel.
+ *
+ * \return la déclaration, à insérer dans les shaders (ou à reproduire
+ * à l'identique).
+ */
+const char * gl4duGetMatrixBlockGLSL(void) {
+  GLuint i;
+  size_t len = 128;
+  char * p;
+  for(i = 0; i < _gl4duNbMatrices; i++)
+    len += 32 + (_gl4duMatrices[i] ? strlen(_gl4duMatrices[i]->name) : 0);
+  _blockGLSL = realloc(_blockGLSL, len);
+  assert(_blockGLSL);
+  p = _blockGLSL;
+  p += sprintf(p, "layout(std140, row_major) uniform %s {\n", GL4DU_MATRIX_BLOCK);
+  for(i = 0; i < _gl4duNbMatrices; i++)
+    if(_gl4duMatrices[i])
+      p += sprintf(p, "  mat4 %s;\n", _gl4duMatrices[i]->name);
+    else
+      p += sprintf(p, "  mat4 gl4du_unused%u;\n", i);
+  sprintf(p, "};\n");
+  return _blockGLSL;
 }
 
 /*!\brief Création d'une matrice de projection perspective selon
@@ -1237,6 +2300,7 @@ void gl4duLoadIdentityf(void) {
   assert(_gl4dCurMatrix->type == GL_FLOAT);
   mat = (GLfloat *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
   MIDENTITY(mat);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief Chargement d'une matrice identité dans la matrice en cours.
@@ -1252,6 +2316,7 @@ void gl4duLoadIdentityd(void) {
   assert(_gl4dCurMatrix->type == GL_DOUBLE);
   mat = (GLdouble *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
   MIDENTITY(mat);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief Chargement d'une matrice \a matrix dans la matrice en cours.
@@ -1267,6 +2332,7 @@ void gl4duLoadMatrixf(const GLfloat * matrix) {
   assert(_gl4dCurMatrix);
   assert(_gl4dCurMatrix->type == GL_FLOAT);
   memcpy(&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]), matrix, _gl4dCurMatrix->size);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief Chargement d'une matrice \a matrix dans la matrice en cours.
@@ -1282,6 +2348,7 @@ void gl4duLoadMatrixd(const GLdouble * matrix) {
   assert(_gl4dCurMatrix);
   assert(_gl4dCurMatrix->type == GL_DOUBLE);
   memcpy(&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]), matrix, _gl4dCurMatrix->size);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief Multiplication de la matrice en cours par une matrice \a matrix.
@@ -1294,12 +2361,12 @@ void gl4duLoadMatrixd(const GLdouble * matrix) {
  * \see gl4duMultMatrixd
  */
 void gl4duMultMatrixf(const GLfloat * matrix) {
-  GLfloat * mat, cpy[16];
+  GLfloat * mat;
   assert(_gl4dCurMatrix);
   assert(_gl4dCurMatrix->type == GL_FLOAT);
   mat = (GLfloat *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
-  memcpy(cpy, mat, _gl4dCurMatrix->size);
-  MMAT4XMAT4(mat, cpy, matrix);
+  gl4dmMat4XMat4f(mat, mat, matrix);
+  touchMatrix(_gl4dCurMatrix);
 }
 
 /*!\brief Multiplication de la matrice en cours par une matrice \a matrix.
@@ -1318,6 +2385,36 @@ void gl4duMultMatrixd(const GLdouble * matrix) {
   mat = (GLdouble *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
   memcpy(cpy, mat, _gl4dCurMatrix->size);
   MMAT4XMAT4(mat, cpy, matrix);
+  touchMatrix(_gl4dCurMatrix);
+}
+
+/*!\brief multiplie à droite la matrice courante par la matrice \a
+ * namedMatrix (sans effet si elle est NULL). */
+static void multMatrixBy(_GL4DUMatrix * namedMatrix) {
+  assert(_gl4dCurMatrix);
+  if(!namedMatrix) return;
+  touchMatrix(_gl4dCurMatrix);
+  if(_gl4dCurMatrix->type == GL_FLOAT) {
+    GLfloat cpy[16], *mat = (GLfloat *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
+    if(namedMatrix->type == GL_FLOAT) {
+      GLfloat *matrix = (GLfloat *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
+      gl4dmMat4XMat4f(mat, mat, matrix);
+    } else { /* GL_DOUBLE */
+      GLdouble *matrix = (GLdouble *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
+      memcpy(cpy, mat, _gl4dCurMatrix->size);
+      MMAT4XMAT4(mat, cpy, matrix);
+    }
+  } else {
+    GLdouble cpy[16], *mat = (GLdouble *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
+    memcpy(cpy, mat, _gl4dCurMatrix->size);
+    if(namedMatrix->type == GL_FLOAT) {
+      GLfloat *matrix = (GLfloat *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
+      MMAT4XMAT4(mat, cpy, matrix);
+    } else { /* GL_DOUBLE */
+      GLdouble *matrix = (GLdouble *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
+      MMAT4XMAT4(mat, cpy, matrix);
+    }
+  }
 }
 
 /*!\brief Multiplication de la matrice en cours par une des matrices
@@ -1330,34 +2427,63 @@ void gl4duMultMatrixd(const GLdouble * matrix) {
  * multiplication (currentMatrix x matrixBy(name)).
  */
 void gl4duMultMatrixByName(const char * name) {
-  bin_tree_t ** bt;
+  multMatrixBy(name ? findMatrix(name) : NULL);
+}
+
+/*!\brief Multiplication de la matrice en cours par la matrice
+ *  GL4Dummies d'identifiant \a handle (voir \ref
+ *  gl4duGetMatrixHandle) : currentMatrix = currentMatrix x
+ *  matrixBy(handle).
+ *
+ * \param handle l'identifiant de la matrice GL4Dummies à utiliser
+ * pour la multiplication.
+ */
+void gl4duMultMatrixByHandle(GLuint handle) {
+  multMatrixBy(matrixFromHandle(handle));
+}
+
+/*!\brief retourne, en la considérant modifiée, la matrice courante
+ * qui doit être de type GLfloat. */
+static inline GLfloat * curMatrixf(void) {
   assert(_gl4dCurMatrix);
-  if(_gl4dCurMatrix->type == GL_FLOAT) {
-    GLfloat cpy[16], *mat = (GLfloat *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
-    memcpy(cpy, mat, _gl4dCurMatrix->size);
-    if(name && (bt = findMatrix(name))) {
-      _GL4DUMatrix * namedMatrix = (_GL4DUMatrix *)((*bt)->data);
-      if(namedMatrix->type == GL_FLOAT) {
-	GLfloat *matrix = (GLfloat *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
-	MMAT4XMAT4(mat, cpy, matrix);
-      } else { /* GL_DOUBLE */
-	GLdouble *matrix = (GLdouble *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
-	MMAT4XMAT4(mat, cpy, matrix);
-      }
-    }
-  } else {
-    GLdouble cpy[16], *mat = (GLdouble *)&(((GLubyte *)_gl4dCurMatrix->data)[_gl4dCurMatrix->top * _gl4dCurMatrix->size]);
-    memcpy(cpy, mat, _gl4dCurMatrix->size);
-    if(name && (bt = findMatrix(name))) {
-      _GL4DUMatrix * namedMatrix = (_GL4DUMatrix *)((*bt)->data);
-      if(namedMatrix->type == GL_FLOAT) {
-	GLfloat *matrix = (GLfloat *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
-	MMAT4XMAT4(mat, cpy, matrix);
-      } else { /* GL_DOUBLE */
-	GLdouble *matrix = (GLdouble *)&(((GLubyte *)namedMatrix->data)[namedMatrix->top * namedMatrix->size]);
-	MMAT4XMAT4(mat, cpy, matrix);
-      }
-    }
+  assert(_gl4dCurMatrix->type == GL_FLOAT);
+  touchMatrix(_gl4dCurMatrix);
+  return (GLfloat *)matrixData(_gl4dCurMatrix);
+}
+
+/*!\brief retourne, en la considérant modifiée, la matrice courante
+ * qui doit être de type GLdouble. */
+static inline GLdouble * curMatrixd(void) {
+  assert(_gl4dCurMatrix);
+  assert(_gl4dCurMatrix->type == GL_DOUBLE);
+  touchMatrix(_gl4dCurMatrix);
+  return (GLdouble *)matrixData(_gl4dCurMatrix);
+}
+
+/*!\brief multiplie à droite la matrice courante (GLfloat) par la
+ * rotation \a r dont seul le bloc 3x3 haut-gauche est renseigné :
+ * seules les trois premières colonnes changent (même résultat que \ref
+ * gl4duMultMatrixf avec la rotation complète). */
+static void rotateCurf(const GLfloat * r) {
+  GLfloat * m = curMatrixf(), a0, a1, a2;
+  int i;
+  for(i = 0; i < 16; i += 4) {
+    a0 = m[i]; a1 = m[i + 1]; a2 = m[i + 2];
+    m[i]     = a0 * r[0] + a1 * r[4] + a2 * r[8];
+    m[i + 1] = a0 * r[1] + a1 * r[5] + a2 * r[9];
+    m[i + 2] = a0 * r[2] + a1 * r[6] + a2 * r[10];
+  }
+}
+
+/*!\brief version GLdouble de \ref rotateCurf. */
+static void rotateCurd(const GLdouble * r) {
+  GLdouble * m = curMatrixd(), a0, a1, a2;
+  int i;
+  for(i = 0; i < 16; i += 4) {
+    a0 = m[i]; a1 = m[i + 1]; a2 = m[i + 2];
+    m[i]     = a0 * r[0] + a1 * r[4] + a2 * r[8];
+    m[i + 1] = a0 * r[1] + a1 * r[5] + a2 * r[9];
+    m[i + 2] = a0 * r[2] + a1 * r[6] + a2 * r[10];
   }
 }
 
@@ -1397,7 +2523,7 @@ void gl4duRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
     mat[10] = (cc * z2) + c;
     /* mat[11] = 0.0f; */
     /* mat[12] = 0.0f; mat[13] = 0.0f; mat[14] = 0.0f; mat[15] = 1.0f; */
-    gl4duMultMatrixf(mat);
+    rotateCurf(mat);
   }
 }
 
@@ -1437,7 +2563,7 @@ void gl4duRotated(GLdouble angle, GLdouble x, GLdouble y, GLdouble z) {
     mat[10] = (cc * z2) + c;
     /* mat[11] = 0.0; */
     /* mat[12] = 0.0; mat[13] = 0.0; mat[14] = 0.0; mat[15] = 1.0; */
-    gl4duMultMatrixd(mat);
+    rotateCurd(mat);
   }
 }
 
@@ -1449,11 +2575,8 @@ void gl4duRotated(GLdouble angle, GLdouble x, GLdouble y, GLdouble z) {
  * \param tz cote de la translation.
  */
 void gl4duTranslatef(GLfloat tx, GLfloat ty, GLfloat tz) {
-  GLfloat mat[] = { 1.0f, 0.0f, 0.0f, tx,
-		    0.0f, 1.0f, 0.0f, ty,
-		    0.0f, 0.0f, 1.0f, tz,
-		    0.0f, 0.0f, 0.0f, 1.0f };
-  gl4duMultMatrixf(mat);
+  GLfloat * mat = curMatrixf();
+  MMAT4XTRANSLATE(mat, tx, ty, tz);
 }
 
 /*!\brief Multiplication de la matrice en cours par une matrice de
@@ -1464,11 +2587,8 @@ void gl4duTranslatef(GLfloat tx, GLfloat ty, GLfloat tz) {
  * \param tz cote de la translation.
  */
 void gl4duTranslated(GLdouble tx, GLdouble ty, GLdouble tz) {
-  GLdouble mat[] = { 1.0, 0.0, 0.0, tx,
-		     0.0, 1.0, 0.0, ty,
-		     0.0, 0.0, 1.0, tz,
-		     0.0, 0.0, 0.0, 1.0 };
-  gl4duMultMatrixd(mat);
+  GLdouble * mat = curMatrixd();
+  MMAT4XTRANSLATE(mat, tx, ty, tz);
 }
 
 /*!\brief Multiplication de la matrice en cours par une matrice
@@ -1479,11 +2599,8 @@ void gl4duTranslated(GLdouble tx, GLdouble ty, GLdouble tz) {
  * \param sz cote de l'homothétie.
  */
 void gl4duScalef(GLfloat sx, GLfloat sy, GLfloat sz) {
-  GLfloat mat[] = { sx  , 0.0f, 0.0f, 0.0f,
-		    0.0f,   sy, 0.0f, 0.0f,
-		    0.0f, 0.0f,   sz, 0.0f,
-		    0.0f, 0.0f, 0.0f, 1.0f };
-  gl4duMultMatrixf(mat);
+  GLfloat * mat = curMatrixf();
+  MMAT4XSCALE(mat, sx, sy, sz);
 }
 
 /*!\brief Multiplication de la matrice en cours par une matrice
@@ -1494,11 +2611,8 @@ void gl4duScalef(GLfloat sx, GLfloat sy, GLfloat sz) {
  * \param sz cote de l'homothétie.
  */
 void gl4duScaled(GLdouble sx, GLdouble sy, GLdouble sz) {
-  GLdouble mat[] = { sx , 0.0, 0.0, 0.0,
-		     0.0,  sy, 0.0, 0.0,
-		     0.0, 0.0,  sz, 0.0,
-		     0.0, 0.0, 0.0, 1.0 };
-  gl4duMultMatrixd(mat);
+  GLdouble * mat = curMatrixd();
+  MMAT4XSCALE(mat, sx, sy, sz);
 }
 
 void gl4duLookAtf_DNW(GLfloat eyeX,  GLfloat eyeY,  GLfloat eyeZ,  GLfloat centerX,  GLfloat centerY,  GLfloat centerZ,  GLfloat upX,  GLfloat upY,  GLfloat upZ) {
@@ -1645,13 +2759,69 @@ static inline void * matrixData(_GL4DUMatrix * matrix) {
  * est (void *), il faut le caster dans le type correspondant au type
  * de la matrice.
  *
+ * Les données pouvant être modifiées au travers du pointeur, la
+ * matrice est considérée comme modifiée (elle sera renvoyée au
+ * prochain \ref gl4duSendMatrices).
+ *
  * \return retourne le pointeur vers les données de la matrice.
  */
 void * gl4duGetMatrixData(void) {
   assert(_gl4dCurMatrix);
+  touchMatrix(_gl4dCurMatrix);
   return matrixData(_gl4dCurMatrix);
 }
 
+/*!\brief ajoute une copie de la matrice courante (en haut de sa pile)
+ * aux matrices d'instances à envoyer par \ref
+ * gl4duUploadInstanceMatrices.
+ *
+ * Typiquement, pour chaque instance : modifier la matrice
+ * "modelMatrix" (gl4duLoadIdentityf, gl4duTranslatef, ...) puis
+ * appeler cette fonction.
+ */
+void gl4duAppendInstanceMatrix(void) {
+  GLfloat * f;
+  int i, j;
+  assert(_gl4dCurMatrix);
+  if(_nbInstances == _sInstances) {
+    _sInstances = _sInstances ? _sInstances << 1 : 256;
+    _instances = realloc(_instances, _sInstances * 16 * sizeof *_instances);
+    assert(_instances);
+  }
+  f = &_instances[16 * _nbInstances++];
+  /* les matrices gl4du sont rangées par lignes, un attribut mat4 est lu
+   * par colonnes */
+  for(i = 0; i < 4; i++)
+    for(j = 0; j < 4; j++)
+      f[4 * j + i] = _gl4dCurMatrix->type == GL_FLOAT ?
+	((GLfloat *)matrixData(_gl4dCurMatrix))[4 * i + j] :
+	(GLfloat)((GLdouble *)matrixData(_gl4dCurMatrix))[4 * i + j];
+}
+
+/*!\brief envoie dans le buffer \a buffer (réalloué, usage
+ * GL_STREAM_DRAW) les matrices accumulées par \ref
+ * gl4duAppendInstanceMatrix, 64 octets par instance, et vide
+ * l'accumulateur.
+ *
+ * Le buffer s'utilise avec \ref gl4dgDrawInstanced.
+ *
+ * \return le nombre de matrices envoyées.
+ */
+GLsizei gl4duUploadInstanceMatrices(GLuint buffer) {
+  GLsizei n = _nbInstances;
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, n * 16 * sizeof *_instances, _instances, GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  _nbInstances = 0;
+  return n;
+}
+
+/*!\brief donne à la matrice \a matrix une nouvelle version : elle
+ * devra être renvoyée à tous les programs. */
+static inline void touchMatrix(_GL4DUMatrix * matrix) {
+  matrix->version = ++_gl4duVersion;
+}
+
 /*!\brief Renseigne sur la valeur du paramètre demandé. Le paramètre
  * est envoyé via \a pname et sera stocké dans \a params.
  *
@@ -1671,6 +2841,18 @@ GLboolean gl4duGetIntegerv(GL4DUenum pname, GLint * params) {
     assert(_gl4dCurMatrix);
     *params = (GLint)_gl4dCurMatrix->type;
     return GL_TRUE;
+  case GL4DU_MATRIX_UPLOADS:
+    *params = _gl4duUploads;
+    return GL_TRUE;
+  case GL4DU_MATRIX_SKIPPED_UPLOADS:
+    *params = _gl4duSkippedUploads;
+    return GL_TRUE;
+  case GL4DU_PROGRAM_CACHE_HITS:
+    *params = _pcacheHits;
+    return GL_TRUE;
+  case GL4DU_PROGRAM_CACHE_MISSES:
+    *params = _pcacheMisses;
+    return GL_TRUE;
   default:
     return GL_FALSE;
   }
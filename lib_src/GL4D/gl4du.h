@@ -23,6 +23,10 @@ extern "C" {
     GL4DU_GEOMETRY_SHADER = 4,
     GL4DU_MATRIX          = 1024, /* les data de la matrice */
     GL4DU_MATRIX_TYPE     = 1025,
+    GL4DU_MATRIX_UPLOADS  = 1026, /* nombre de matrices envoyées */
+    GL4DU_MATRIX_SKIPPED_UPLOADS = 1027, /* nombre d'envois évités (matrice inchangée) */
+    GL4DU_PROGRAM_CACHE_HITS   = 1028, /* programs chargés depuis le cache de binaires */
+    GL4DU_PROGRAM_CACHE_MISSES = 1029, /* programs compilés faute de binaire en cache */
 #if defined(_MSC_VER) /* ENUM n'est que 32bits sous MSC !!! */
     GL4DU_SHADER          = 1 << 20,
     GL4DU_PROGRAM         = 1 << 21,
@@ -43,20 +47,52 @@ extern "C" {
   };
   typedef enum GL4DUenum GL4DUenum;
 
+/*!\brief statistiques des temps de frames (en millisecondes),
+ * voir gl4duFrameStats. */
+  typedef struct GL4DUframestats GL4DUframestats;
+  struct GL4DUframestats {
+    GLuint frames;                    /* frames prises en compte */
+    double min, avg, max, p50, p95, p99; /* temps CPU entre deux gl4duFrameTick */
+    GLuint gpuFrames;                 /* frames dont le temps GPU est connu */
+    double gpuMin, gpuAvg, gpuMax, gpuP50, gpuP95, gpuP99;
+  };
+
+/*!\brief nom du bloc uniforme des matrices en mode UBO, voir
+ * gl4duSetMatrixUBO. */
+#define GL4DU_MATRIX_BLOCK "gl4duMatrices"
+#ifndef GL4DU_MATRIX_BINDING
+/*!\brief point de liaison (GL_UNIFORM_BUFFER) du bloc des matrices. */
+#  define GL4DU_MATRIX_BINDING 15
+#endif
+
   GL4DAPI void      GL4DAPIENTRY gl4duInit(int argc, char ** argv);
   GL4DAPI int       GL4DAPIENTRY gl4duHasInit(void);
   GL4DAPI void      GL4DAPIENTRY gl4duMakeBinRelativePath(char * dst, size_t dst_size, const char * filename);
   GL4DAPI void      GL4DAPIENTRY gl4duPrintShaderInfoLog(GLuint object, FILE * f);
   GL4DAPI void      GL4DAPIENTRY gl4duPrintProgramInfoLog(GLuint object, FILE * f);
   GL4DAPI void      GL4DAPIENTRY gl4duPrintFPS(FILE * fp);
+  GL4DAPI void      GL4DAPIENTRY gl4duFrameTick(void);
+  GL4DAPI void      GL4DAPIENTRY gl4duFrameGPUTiming(GLboolean enable);
+  GL4DAPI void      GL4DAPIENTRY gl4duFrameReset(void);
+  GL4DAPI GLuint    GL4DAPIENTRY gl4duFrameStats(GLuint window, GL4DUframestats * stats);
+  GL4DAPI GLuint    GL4DAPIENTRY gl4duFrameDumpCSV(FILE * fp, GLuint window);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duProfileStart(GLboolean gpu);
+  GL4DAPI void      GL4DAPIENTRY gl4duProfileStop(void);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duProfileDump(const char * filename);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duCreateShader(GLenum shadertype, const char * filename);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duCreateShaderIM(GLenum shadertype, const char * filename, const char * shadercode);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duCreateShaderFED(const char * decData, GLenum shadertype, const char * filename);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duFindShader(const char * filename);
   GL4DAPI void      GL4DAPIENTRY gl4duDeleteShader(GLuint id);
+  GL4DAPI void      GL4DAPIENTRY gl4duAddShaderInclude(const char * name, const char * source);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duCreateProgram(const char * firstone, ...);
   GL4DAPI GLuint    GL4DAPIENTRY gl4duCreateProgramFED(const char * encData, const char * firstone, ...);
   GL4DAPI void      GL4DAPIENTRY gl4duDeleteProgram(GLuint id);
+  GL4DAPI void      GL4DAPIENTRY gl4duSetProgramCacheDir(const char * dir);
+  GL4DAPI void      GL4DAPIENTRY gl4duBeginAsyncPrograms(void);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duIsProgramReady(GLuint pId);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duWaitProgram(GLuint pId);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duWaitAllPrograms(void);
   GL4DAPI void      GL4DAPIENTRY gl4duCleanUnattached(GL4DUenum what);
   GL4DAPI void      GL4DAPIENTRY gl4duAtExit(void (*func)(void));
   GL4DAPI void      GL4DAPIENTRY gl4duClean(GL4DUenum what);
@@ -64,11 +100,17 @@ extern "C" {
   GL4DAPI GLboolean GL4DAPIENTRY gl4duGenMatrix(GLenum type, const char * name);
   GL4DAPI GLboolean GL4DAPIENTRY gl4duIsMatrix(const char * name);
   GL4DAPI GLboolean GL4DAPIENTRY gl4duBindMatrix(const char * name);
+  GL4DAPI GLuint    GL4DAPIENTRY gl4duGetMatrixHandle(const char * name);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duBindMatrixHandle(GLuint handle);
   GL4DAPI GLboolean GL4DAPIENTRY gl4duDeleteMatrix(const char * name);
   GL4DAPI void      GL4DAPIENTRY gl4duPushMatrix(void);
   GL4DAPI void      GL4DAPIENTRY gl4duPopMatrix(void);
   GL4DAPI void      GL4DAPIENTRY gl4duSendMatrix(void);
   GL4DAPI void      GL4DAPIENTRY gl4duSendMatrices(void);
+  GL4DAPI void      GL4DAPIENTRY gl4duSendMatricesTo(GLuint pId);
+  GL4DAPI GLboolean GL4DAPIENTRY gl4duSetMatrixUBO(GLboolean enable);
+  GL4DAPI const char * GL4DAPIENTRY gl4duGetMatrixBlockGLSL(void);
+  GL4DAPI void      GL4DAPIENTRY gl4duForgetUniformLocations(GLuint pId);
   GL4DAPI void      GL4DAPIENTRY gl4duFrustumf(GLfloat  l, GLfloat  r, GLfloat  b, GLfloat  t, GLfloat  n, GLfloat  f);
   GL4DAPI void      GL4DAPIENTRY gl4duFrustumd(GLdouble l, GLdouble r, GLdouble b, GLdouble t, GLdouble n, GLdouble f);
   GL4DAPI void      GL4DAPIENTRY gl4duOrthof(GLfloat  l, GLfloat  r, GLfloat  b, GLfloat  t, GLfloat  n, GLfloat  f);
@@ -84,6 +126,7 @@ extern "C" {
   GL4DAPI void      GL4DAPIENTRY gl4duMultMatrixf(const GLfloat * matrix);
   GL4DAPI void      GL4DAPIENTRY gl4duMultMatrixd(const GLdouble * matrix);
   GL4DAPI void      GL4DAPIENTRY gl4duMultMatrixByName(const char * name);
+  GL4DAPI void      GL4DAPIENTRY gl4duMultMatrixByHandle(GLuint handle);
   GL4DAPI void      GL4DAPIENTRY gl4duRotatef(GLfloat  angle, GLfloat x, GLfloat y, GLfloat z);
   GL4DAPI void      GL4DAPIENTRY gl4duRotated(GLdouble angle, GLdouble x, GLdouble y, GLdouble z);
   GL4DAPI void      GL4DAPIENTRY gl4duTranslatef(GLfloat tx, GLfloat ty, GLfloat tz);
@@ -93,6 +136,8 @@ extern "C" {
   GL4DAPI void      GL4DAPIENTRY gl4duLookAtf(GLfloat eyeX, GLfloat eyeY, GLfloat eyeZ, GLfloat centerX, GLfloat centerY, GLfloat centerZ, GLfloat upX, GLfloat upY, GLfloat upZ);
   GL4DAPI void      GL4DAPIENTRY gl4duLookAtd(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ, GLdouble centerX, GLdouble centerY, GLdouble centerZ, GLdouble upX, GLdouble upY, GLdouble upZ);
   GL4DAPI void *    GL4DAPIENTRY gl4duGetMatrixData(void);
+  GL4DAPI void      GL4DAPIENTRY gl4duAppendInstanceMatrix(void);
+  GL4DAPI GLsizei   GL4DAPIENTRY gl4duUploadInstanceMatrices(GLuint buffer);
   GL4DAPI GLboolean GL4DAPIENTRY gl4duGetIntegerv(GL4DUenum pname, GLint * params);
   
 #ifdef __cplusplus
@@ -0,0 +1,286 @@
+/*!\file gl4duFrame.c
+ *
+ * \brief statistiques des temps de frames (CPU et, en option, GPU).
+ *
+ * \ref gl4duFrameTick, appelée une fois par frame (elle l'est par
+ * gl4duwMainLoop), enregistre la durée écoulée depuis l'appel
+ * précédent, mesurée sur l'horloge monotone de \ref
+ * gl4dGetNanoseconds, dans un tampon circulaire des FRAME_RING
+ * dernières frames. Le tampon n'a qu'un écrivain (le thread de rendu)
+ * et se lit sans verrou : l'écrivain publie le nombre de frames par
+ * une écriture atomique après avoir rempli la case, le lecteur écarte
+ * les cases réécrites pendant sa copie.
+ *
+ * Avec \ref gl4duFrameGPUTiming, chaque frame est aussi encadrée par
+ * une requête GL_TIME_ELAPSED ; les FRAME_QUERIES requêtes tournent
+ * et leurs résultats sont lus quand ils sont disponibles, sans jamais
+ * attendre le GPU (une frame est laissée sans mesure s'il a trop de
+ * retard).
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4du.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*!\brief nombre de frames conservées (puissance de 2). */
+#define FRAME_RING 4096
+/*!\brief nombre de requêtes GL_TIME_ELAPSED en vol. */
+#define FRAME_QUERIES 4
+
+typedef struct frame_t frame_t;
+
+/*!\brief une frame : sa date de fin (ms depuis la première frame),
+ * ses temps CPU et GPU (ms, négatif si inconnu). */
+struct frame_t {
+  double t;
+  float cpu, gpu;
+};
+
+static frame_t _ring[FRAME_RING];
+/*!\brief nombre de frames publiées. */
+static SDL_atomic_t _nframes = {0};
+/*!\brief date (ns) du dernier \ref gl4duFrameTick et de la première
+ * frame, 0 avant le premier. */
+static unsigned long long _last = 0, _origin = 0;
+
+#ifndef __GLES4D__
+static GLuint _queries[FRAME_QUERIES] = {0};
+static unsigned _qframe[FRAME_QUERIES]; /* frame mesurée par chaque requête */
+static int _qfirst = 0, _qcount = 0;    /* requêtes terminées, pas encore lues */
+static int _qactive = -1;               /* requête en cours, -1 si aucune */
+static void gpuTick(unsigned frame);
+static void gpuQuit(void);
+#endif
+
+/*!\brief marque la fin d'une frame (et le début de la suivante) pour
+ * les statistiques de \ref gl4duFrameStats et \ref
+ * gl4duFrameDumpCSV ; le premier appel ne fait que démarrer la mesure.
+ *
+ * A appeler une fois par frame depuis le thread de rendu, par exemple
+ * juste après l'échange des buffers ; gl4duwMainLoop le fait.
+ */
+void gl4duFrameTick(void) {
+  unsigned long long now = gl4dGetNanoseconds();
+  unsigned n = (unsigned)SDL_AtomicGet(&_nframes);
+  frame_t * f;
+  if(_last) {
+    f = &_ring[n & (FRAME_RING - 1)];
+    f->t = (now - _origin) / 1000000.0;
+    f->cpu = (float)((now - _last) / 1000000.0);
+    f->gpu = -1.0f;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&_nframes, (int)(n + 1));
+#ifndef __GLES4D__
+    gpuTick(n);
+#endif
+  } else {
+    _origin = now;
+#ifndef __GLES4D__
+    gpuTick(~0u);
+#endif
+  }
+  _last = now;
+}
+
+/*!\brief active ou désactive la mesure du temps GPU de chaque frame
+ * par des requêtes GL_TIME_ELAPSED (sans effet sous GLES).
+ *
+ * Tant qu'elle est active, la cible GL_TIME_ELAPSED est occupée entre
+ * deux \ref gl4duFrameTick et ne peut servir à d'autres requêtes.
+ */
+void gl4duFrameGPUTiming(GLboolean enable) {
+#ifndef __GLES4D__
+  static int ft = 1;
+  if(!enable) {
+    gpuQuit();
+    return;
+  }
+  if(_queries[0])
+    return;
+  glGenQueries(FRAME_QUERIES, _queries);
+  _qfirst = _qcount = 0;
+  _qactive = -1;
+  if(ft) {
+    gl4duAtExit(gpuQuit);
+    ft = 0;
+  }
+#else
+  (void)enable;
+#endif
+}
+
+#ifndef __GLES4D__
+/*!\brief termine la requête de la frame \a frame, lit les résultats
+ * disponibles et lance la requête de la frame suivante. */
+static void gpuTick(unsigned frame) {
+  GLint ok;
+  GLuint64 ns;
+  unsigned n;
+  if(!_queries[0])
+    return;
+  if(_qactive >= 0) {
+    glEndQuery(GL_TIME_ELAPSED);
+    _qframe[_qactive] = frame;
+    _qcount++;
+    _qactive = -1;
+  }
+  while(_qcount) {
+    glGetQueryObjectiv(_queries[_qfirst], GL_QUERY_RESULT_AVAILABLE, &ok);
+    if(!ok)
+      break;
+    glGetQueryObjectui64v(_queries[_qfirst], GL_QUERY_RESULT, &ns);
+    n = (unsigned)SDL_AtomicGet(&_nframes);
+    if(_qframe[_qfirst] < n && n - _qframe[_qfirst] <= FRAME_RING)
+      _ring[_qframe[_qfirst] & (FRAME_RING - 1)].gpu = (float)(ns / 1000000.0);
+    _qfirst = (_qfirst + 1) % FRAME_QUERIES;
+    _qcount--;
+  }
+  if(_qcount < FRAME_QUERIES) {
+    _qactive = (_qfirst + _qcount) % FRAME_QUERIES;
+    glBeginQuery(GL_TIME_ELAPSED, _queries[_qactive]);
+  }
+}
+
+static void gpuQuit(void) {
+  if(!_queries[0])
+    return;
+  if(_qactive >= 0)
+    glEndQuery(GL_TIME_ELAPSED);
+  glDeleteQueries(FRAME_QUERIES, _queries);
+  memset(_queries, 0, sizeof _queries);
+  _qactive = -1;
+  _qfirst = _qcount = 0;
+}
+#endif
+
+/*!\brief oublie les frames enregistrées ; la prochaine frame démarre
+ * au prochain \ref gl4duFrameTick. */
+void gl4duFrameReset(void) {
+  SDL_AtomicSet(&_nframes, 0);
+  _last = _origin = 0;
+#ifndef __GLES4D__
+  if(_qactive >= 0) {
+    glEndQuery(GL_TIME_ELAPSED);
+    _qactive = -1;
+  }
+  /* les requêtes en vol ne correspondent plus à aucune frame */
+  while(_qcount--)
+    _qframe[(_qfirst + _qcount) % FRAME_QUERIES] = ~0u;
+  _qcount = 0;
+#endif
+}
+
+/*!\brief copie dans \a out les (au plus \a window, toutes si 0)
+ * dernières frames ; renvoie leur nombre et dans \a first le numéro de
+ * la première. */
+static unsigned snapshot(unsigned window, frame_t * out, unsigned * first) {
+  unsigned n, m, f, i, n2;
+  n = (unsigned)SDL_AtomicGet(&_nframes);
+  SDL_MemoryBarrierAcquire();
+  /* la case de la frame n (en cours d'écriture) est celle de n - FRAME_RING */
+  m = n < FRAME_RING ? n : FRAME_RING - 1;
+  if(window && window < m)
+    m = window;
+  f = n - m;
+  for(i = 0; i < m; i++)
+    out[i] = _ring[(f + i) & (FRAME_RING - 1)];
+  SDL_MemoryBarrierAcquire();
+  /* écarte les cases réécrites pendant la copie */
+  n2 = (unsigned)SDL_AtomicGet(&_nframes);
+  if(n2 - f >= FRAME_RING) {
+    i = n2 - f - FRAME_RING + 1;
+    if(i > m) i = m;
+    memmove(out, out + i, (m - i) * sizeof * out);
+    m -= i;
+    f += i;
+  }
+  *first = f;
+  return m;
+}
+
+static int cmpf(const void * a, const void * b) {
+  float x = *(const float *)a, y = *(const float *)b;
+  return x < y ? -1 : x > y;
+}
+
+/*!\brief min, moyenne, max et percentiles des \a n valeurs (triées
+ * sur place) de \a v. */
+static void summarize(float * v, unsigned n, double * r) {
+  unsigned i;
+  double s = 0.0;
+  qsort(v, n, sizeof *v, cmpf);
+  for(i = 0; i < n; i++)
+    s += v[i];
+  r[0] = v[0];
+  r[1] = s / n;
+  r[2] = v[n - 1];
+  /* percentile au rang le plus proche */
+  r[3] = v[(n * 50 + 99) / 100 - 1];
+  r[4] = v[(n * 95 + 99) / 100 - 1];
+  r[5] = v[(n * 99 + 99) / 100 - 1];
+}
+
+/*!\brief calcule dans \a stats les statistiques des temps des \a
+ * window dernières frames (toutes celles conservées si 0, au plus
+ * 4095).
+ *
+ * Les temps sont en millisecondes ; les temps GPU ne portent que sur
+ * les frames mesurées (voir \ref gl4duFrameGPUTiming). Contrairement à
+ * un FPS moyen, p95 et p99 (et max) révèlent les saccades.
+ *
+ * \return le nombre de frames prises en compte.
+ */
+GLuint gl4duFrameStats(GLuint window, GL4DUframestats * stats) {
+  frame_t * fr = malloc(FRAME_RING * sizeof * fr);
+  float * v = malloc(FRAME_RING * sizeof * v);
+  double r[6];
+  unsigned first, n, i, g;
+  assert(fr && v);
+  memset(stats, 0, sizeof * stats);
+  n = snapshot(window, fr, &first);
+  if(n) {
+    for(i = 0; i < n; i++)
+      v[i] = fr[i].cpu;
+    summarize(v, n, r);
+    stats->frames = n;
+    stats->min = r[0]; stats->avg = r[1]; stats->max = r[2];
+    stats->p50 = r[3]; stats->p95 = r[4]; stats->p99 = r[5];
+    for(i = g = 0; i < n; i++)
+      if(fr[i].gpu >= 0.0f)
+        v[g++] = fr[i].gpu;
+    if(g) {
+      summarize(v, g, r);
+      stats->gpuFrames = g;
+      stats->gpuMin = r[0]; stats->gpuAvg = r[1]; stats->gpuMax = r[2];
+      stats->gpuP50 = r[3]; stats->gpuP95 = r[4]; stats->gpuP99 = r[5];
+    }
+  }
+  free(v);
+  free(fr);
+  return n;
+}
+
+/*!\brief écrit dans \a fp, au format CSV (frame,time_ms,cpu_ms,gpu_ms),
+ * les \a window dernières frames (toutes celles conservées si 0) ; la
+ * colonne gpu_ms est vide pour les frames non mesurées.
+ *
+ * \return le nombre de frames écrites.
+ */
+GLuint gl4duFrameDumpCSV(FILE * fp, GLuint window) {
+  frame_t * fr = malloc(FRAME_RING * sizeof * fr);
+  unsigned first, n, i;
+  assert(fr);
+  n = snapshot(window, fr, &first);
+  fprintf(fp, "frame,time_ms,cpu_ms,gpu_ms\n");
+  for(i = 0; i < n; i++) {
+    if(fr[i].gpu >= 0.0f)
+      fprintf(fp, "%u,%.3f,%.3f,%.3f\n", first + i, fr[i].t, fr[i].cpu, fr[i].gpu);
+    else
+      fprintf(fp, "%u,%.3f,%.3f,\n", first + i, fr[i].t, fr[i].cpu);
+  }
+  free(fr);
+  return n;
+}
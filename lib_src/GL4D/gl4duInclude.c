@@ -0,0 +1,455 @@
+/*!\file gl4duInclude.c
+ *
+ * \brief prétraitement des directives #include des shaders et cache
+ * des sources lues, dédupliquées par le hachage de leur contenu.
+ *
+ * \ref incExpand remplace récursivement chaque ligne #include "x" (ou
+ * #include <x>) par le contenu de x, cherché d'abord parmi les extraits
+ * enregistrés par \ref incRegister, puis relativement au répertoire du
+ * fichier qui l'inclut, enfin tel quel. Un fichier n'est inclus qu'une
+ * fois par expansion et des directives #line conservent les numéros
+ * de lignes des logs de compilation (le numéro de source est le rang
+ * du fichier parmi ceux inclus, 0 pour le shader lui-même).
+ *
+ * Chaque fichier n'est lu qu'une fois : les entrées du cache
+ * (indexées par chemin normalisé) sont comptées par référence et
+ * pointent vers des textes partagés entre contenus identiques
+ * (indexés par hachage FNV-1a 64 bits). \ref incUpdate remplace le
+ * contenu d'un fichier, lit d'avance les fichiers qu'il inclut
+ * désormais et indique s'il a réellement changé ; elle est appelée par
+ * le thread de surveillance (gl4duWatch.c), le cache est donc protégé
+ * par un verrou.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4duInclude.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+/*!\brief nombre d'alvéoles (puissance de 2) des tables du cache. */
+#define INC_BUCKETS 256
+
+typedef struct inc_blob_t inc_blob_t;
+typedef struct inc_file_t inc_file_t;
+typedef struct inc_ctx_t inc_ctx_t;
+
+/*!\brief texte partagé par tous les fichiers de même contenu. */
+struct inc_blob_t {
+  unsigned long long hash;
+  char * text;
+  int refs;
+  inc_blob_t * next;
+};
+
+/*!\brief fichier (ou extrait enregistré) du cache. */
+struct inc_file_t {
+  char * path;
+  unsigned pinned:1; /* extrait enregistré, jamais libéré par incRelease */
+  int refs;          /* nombre de shaders dont il est une dépendance */
+  inc_blob_t * blob;
+  inc_file_t * next;
+};
+
+/*!\brief état d'une expansion : texte produit et fichiers inclus
+ * (seen[0] est le shader lui-même, NULL s'il est en mémoire). */
+struct inc_ctx_t {
+  char * out;
+  size_t len, size;
+  inc_file_t ** seen;
+  int nseen, sseen;
+};
+
+static inc_blob_t * _blobs[INC_BUCKETS];
+static inc_file_t * _files[INC_BUCKETS];
+/*!\brief verrou du cache, créé au premier usage (par le thread de
+ * rendu, avant que le thread de surveillance ne démarre). */
+static SDL_mutex * _mutex = NULL;
+
+static void lock(void) {
+  if(!_mutex) {
+    _mutex = SDL_CreateMutex();
+    assert(_mutex);
+  }
+  SDL_LockMutex(_mutex);
+}
+
+static inline void unlock(void) {
+  SDL_UnlockMutex(_mutex);
+}
+
+static unsigned long long incHash(const char * s) {
+  unsigned long long h = 14695981039346656037ULL;
+  while(*s)
+    h = (h ^ (unsigned char)*s++) * 1099511628211ULL;
+  return h;
+}
+
+/*!\brief retourne le texte partagé de contenu \a text (dont la
+ * fonction prend possession) avec une référence de plus. */
+static inc_blob_t * blobGet(char * text) {
+  unsigned long long h = incHash(text);
+  inc_blob_t ** l = &_blobs[h & (INC_BUCKETS - 1)], * b;
+  for(b = *l; b; b = b->next)
+    if(b->hash == h && !strcmp(b->text, text)) {
+      free(text);
+      b->refs++;
+      return b;
+    }
+  b = malloc(sizeof *b);
+  assert(b);
+  b->hash = h;
+  b->text = text;
+  b->refs = 1;
+  b->next = *l;
+  return *l = b;
+}
+
+static void blobPut(inc_blob_t * b) {
+  inc_blob_t ** l;
+  if(--b->refs > 0)
+    return;
+  for(l = &_blobs[b->hash & (INC_BUCKETS - 1)]; *l != b; l = &((*l)->next));
+  *l = b->next;
+  free(b->text);
+  free(b);
+}
+
+/*!\brief retourne le lien (dans sa table) vers l'entrée de \a path ;
+ * le lien pointe vers NULL si \a path n'est pas dans le cache. */
+static inc_file_t ** fileLink(const char * path) {
+  inc_file_t ** l = &_files[incHash(path) & (INC_BUCKETS - 1)];
+  while(*l && strcmp((*l)->path, path))
+    l = &((*l)->next);
+  return l;
+}
+
+static inc_file_t * fileNew(inc_file_t ** l, const char * path, inc_blob_t * b, int pinned) {
+  inc_file_t * f = malloc(sizeof *f);
+  assert(f);
+  f->path = strdup(path);
+  assert(f->path);
+  f->pinned = pinned;
+  f->refs = 0;
+  f->blob = b;
+  f->next = *l;
+  return *l = f;
+}
+
+static void fileFree(inc_file_t ** l) {
+  inc_file_t * f = *l;
+  *l = f->next;
+  blobPut(f->blob);
+  free(f->path);
+  free(f);
+}
+
+/*!\brief retourne l'entrée de \a path, lu si absent du cache ; si \a
+ * quiet est non nul, un fichier inexistant n'est pas une erreur. */
+static inc_file_t * fileLoad(const char * path, int quiet) {
+  inc_file_t ** l = fileLink(path);
+  struct stat buf;
+  char * txt;
+  if(*l)
+    return *l;
+  if(quiet && stat(path, &buf) != 0)
+    return NULL;
+  if(!(txt = gl4dReadTextFile(path)))
+    return NULL;
+  return fileNew(l, path, blobGet(txt), 0);
+}
+
+/*!\brief retourne (alloué) le chemin formé des \a ldir premiers
+ * caractères de \a dir suivis de \a name, débarrassé de ses segments
+ * "." et "x/..". */
+static char * normPath(const char * dir, size_t ldir, const char * name) {
+  size_t l = ldir + strlen(name), n;
+  char * s = malloc(l + 1), * r = malloc(l + 2), * p, * q, * root, * last;
+  assert(s && r);
+  memcpy(s, dir, ldir);
+  strcpy(s + ldir, name);
+  q = r;
+  if(s[0] == '/' || s[0] == '\\')
+    *q++ = '/';
+  root = q;
+  for(p = s; *p; p += n) {
+    while(*p == '/' || *p == '\\') p++;
+    for(n = 0; p[n] && p[n] != '/' && p[n] != '\\'; n++);
+    if(n == 0 || (n == 1 && p[0] == '.'))
+      continue;
+    if(n == 2 && p[0] == '.' && p[1] == '.' && q > root) {
+      for(last = q; last > root && last[-1] != '/'; last--);
+      if(!(q - last == 2 && last[0] == '.' && last[1] == '.')) {
+        q = last > root ? last - 1 : root;
+        continue;
+      }
+    }
+    if(q > root)
+      *q++ = '/';
+    memcpy(q, p, n);
+    q += n;
+  }
+  *q = '\0';
+  free(s);
+  return r;
+}
+
+/*!\brief cherche le fichier \a name inclus depuis \a cur. */
+static inc_file_t * resolve(const char * cur, const char * name) {
+  inc_file_t * f = *fileLink(name);
+  const char * s;
+  char * p;
+  if(f && f->pinned)
+    return f;
+  if(name[0] != '/' && name[0] != '\\' && !(name[0] && name[1] == ':')) {
+    for(s = cur + strlen(cur); s > cur && s[-1] != '/' && s[-1] != '\\'; s--);
+    if(s > cur) {
+      p = normPath(cur, s - cur, name);
+      f = fileLoad(p, 1);
+      free(p);
+      if(f)
+        return f;
+    }
+  }
+  p = normPath("", 0, name);
+  f = fileLoad(p, 1);
+  free(p);
+  return f;
+}
+
+/*!\brief si la ligne \a line (de longueur \a l) est une directive
+ * #include, copie le nom du fichier dans \a name et retourne 1. */
+static int parseInclude(const char * line, size_t l, char * name, size_t size) {
+  const char * e = line + l, * p = line;
+  char close;
+  size_t n;
+  while(p < e && (*p == ' ' || *p == '\t')) p++;
+  if(p >= e || *p++ != '#') return 0;
+  while(p < e && (*p == ' ' || *p == '\t')) p++;
+  if((size_t)(e - p) < 7 || strncmp(p, "include", 7)) return 0;
+  p += 7;
+  while(p < e && (*p == ' ' || *p == '\t')) p++;
+  if(p >= e || (*p != '"' && *p != '<')) return 0;
+  close = *p++ == '"' ? '"' : '>';
+  for(n = 0; p + n < e && p[n] != close; n++);
+  if(p + n >= e || n == 0 || n >= size) return 0;
+  memcpy(name, p, n);
+  name[n] = '\0';
+  return 1;
+}
+
+static void emit(inc_ctx_t * c, const char * s, size_t n) {
+  if(c->len + n + 1 > c->size) {
+    while(c->len + n + 1 > c->size)
+      c->size = c->size ? c->size << 1 : 1024;
+    c->out = realloc(c->out, c->size);
+    assert(c->out);
+  }
+  memcpy(c->out + c->len, s, n);
+  c->len += n;
+  c->out[c->len] = '\0';
+}
+
+static int addSeen(inc_ctx_t * c, inc_file_t * f) {
+  if(c->nseen == c->sseen) {
+    c->sseen = c->sseen ? c->sseen << 1 : 8;
+    c->seen = realloc(c->seen, c->sseen * sizeof * c->seen);
+    assert(c->seen);
+  }
+  c->seen[c->nseen] = f;
+  return c->nseen++;
+}
+
+/*!\brief produit dans \a c le texte \a text du fichier \a cur (source
+ * numéro \a idx) en y développant les #include. */
+static void expand(inc_ctx_t * c, const char * cur, const char * text, int idx) {
+  char name[BUFSIZ], ln[64];
+  const char * p = text, * eol;
+  inc_file_t * f;
+  size_t l;
+  int line, k;
+  for(line = 1; *p; line++, p += l + (eol != NULL)) {
+    eol = strchr(p, '\n');
+    l = eol ? (size_t)(eol - p) : strlen(p);
+    if(!parseInclude(p, l, name, sizeof name)) {
+      emit(c, p, l + (eol != NULL));
+      continue;
+    }
+    if(!(f = resolve(cur, name)))
+      fprintf(stderr, "%s:%d: #include \"%s\" : fichier introuvable\n", cur, line, name);
+    for(k = 0; f && k < c->nseen && c->seen[k] != f; k++);
+    if(!f || k < c->nseen) { /* directive retirée, numérotation conservée */
+      emit(c, "\n", 1);
+      continue;
+    }
+    k = addSeen(c, f);
+    emit(c, ln, snprintf(ln, sizeof ln, "#line 1 %d\n", k));
+    expand(c, f->path, f->blob->text, k);
+    if(c->out[c->len - 1] != '\n')
+      emit(c, "\n", 1);
+    emit(c, ln, snprintf(ln, sizeof ln, "#line %d %d\n", line + 1, idx));
+  }
+}
+
+/*!\brief lit d'avance dans le cache les fichiers inclus par le texte
+ * \a text du fichier \a cur, et ceux qu'ils incluent ; \a c retient
+ * les fichiers déjà parcourus. Les inclusions introuvables sont
+ * ignorées (\ref incExpand les signalera). */
+static void prefetch(inc_ctx_t * c, const char * cur, const char * text) {
+  char name[BUFSIZ];
+  const char * p = text, * eol;
+  inc_file_t * f;
+  size_t l;
+  int k;
+  for(; *p; p += l + (eol != NULL)) {
+    eol = strchr(p, '\n');
+    l = eol ? (size_t)(eol - p) : strlen(p);
+    if(!parseInclude(p, l, name, sizeof name) || !(f = resolve(cur, name)))
+      continue;
+    for(k = 0; k < c->nseen && c->seen[k] != f; k++);
+    if(k < c->nseen)
+      continue;
+    addSeen(c, f);
+    prefetch(c, f->path, f->blob->text);
+  }
+}
+
+/*!\brief retourne (alloué) le code source du shader \a path (lu depuis
+ * le cache) ou \a source s'il est non NULL, ses #include développés.
+ *
+ * Les fichiers lus (dont \a path) sont renvoyés dans \a deps (de
+ * taille \a ndeps, à rendre avec \ref incRelease) et restent dans le
+ * cache jusque-là.
+ *
+ * \return le code développé ou NULL si \a path ne peut être lu.
+ */
+char * incExpand(const char * path, const char * source, char *** deps, int * ndeps) {
+  inc_ctx_t c = { NULL, 0, 0, NULL, 0, 0 };
+  inc_file_t * root = NULL;
+  char * p;
+  int i;
+  *deps = NULL;
+  *ndeps = 0;
+  lock();
+  if(source == NULL) {
+    p = normPath("", 0, path);
+    root = fileLoad(p, 0);
+    free(p);
+    if(!root) {
+      unlock();
+      return NULL;
+    }
+    source = root->blob->text;
+  }
+  addSeen(&c, root);
+  expand(&c, root ? root->path : path, source, 0);
+  emit(&c, "", 0);
+  for(i = 0; i < c.nseen; i++)
+    if(c.seen[i] && !c.seen[i]->pinned) {
+      if(*deps == NULL) {
+        *deps = malloc(c.nseen * sizeof ** deps);
+        assert(*deps);
+      }
+      c.seen[i]->refs++;
+      (*deps)[(*ndeps)++] = strdup(c.seen[i]->path);
+    }
+  unlock();
+  free(c.seen);
+  return c.out;
+}
+
+/*!\brief rend les dépendances \a deps obtenues par \ref incExpand ;
+ * les fichiers qui ne sont plus utilisés quittent le cache. */
+void incRelease(char ** deps, int ndeps) {
+  inc_file_t ** l;
+  int i;
+  if(!ndeps) {
+    free(deps);
+    return;
+  }
+  lock();
+  for(i = 0; i < ndeps; i++) {
+    l = fileLink(deps[i]);
+    if(*l && !(*l)->pinned && --(*l)->refs <= 0)
+      fileFree(l);
+    free(deps[i]);
+  }
+  unlock();
+  free(deps);
+}
+
+/*!\brief remplace par \a source le contenu en cache du fichier \a
+ * path et, s'il a changé, y lit d'avance les fichiers qu'il inclut
+ * (pour que le développement des shaders qui en dépendent se fasse
+ * sans accès disque).
+ *
+ * \return 1 si \a path est en cache et que son contenu a changé, 0
+ * sinon.
+ */
+int incUpdate(const char * path, const char * source) {
+  inc_ctx_t c = { NULL, 0, 0, NULL, 0, 0 };
+  inc_file_t * f;
+  inc_blob_t * b;
+  char * txt;
+  int changed = 0;
+  lock();
+  if((f = *fileLink(path)) != NULL && !f->pinned) {
+    txt = strdup(source);
+    assert(txt);
+    if((b = blobGet(txt)) == f->blob)
+      blobPut(b);
+    else {
+      blobPut(f->blob);
+      f->blob = b;
+      changed = 1;
+      addSeen(&c, f);
+      prefetch(&c, f->path, f->blob->text);
+      free(c.seen);
+    }
+  }
+  unlock();
+  return changed;
+}
+
+/*!\brief enregistre (ou remplace) l'extrait \a source sous le nom \a
+ * name, prioritaire sur les fichiers pour la résolution des #include. */
+void incRegister(const char * name, const char * source) {
+  inc_file_t ** l;
+  char * txt = strdup(source);
+  assert(txt);
+  lock();
+  if(*(l = fileLink(name))) {
+    blobPut((*l)->blob);
+    (*l)->blob = blobGet(txt);
+    (*l)->pinned = 1;
+  } else
+    fileNew(l, name, blobGet(txt), 1);
+  unlock();
+}
+
+/*!\brief vide le cache des fichiers lus ; les extraits enregistrés,
+ * que les modules de la lib n'enregistrent qu'une fois, ne sont
+ * libérés que si \a all est non nul. */
+void incClean(int all) {
+  inc_file_t ** l;
+  int i;
+  if(!_mutex)
+    return;
+  lock();
+  for(i = 0; i < INC_BUCKETS; i++)
+    for(l = &_files[i]; *l; )
+      if(all || !(*l)->pinned)
+        fileFree(l);
+      else
+        l = &((*l)->next);
+  unlock();
+  if(all) { /* à la sortie, le thread de surveillance est arrêté */
+    SDL_DestroyMutex(_mutex);
+    _mutex = NULL;
+  }
+}
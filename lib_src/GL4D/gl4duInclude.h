@@ -0,0 +1,30 @@
+/*!\file gl4duInclude.h
+ *
+ * \brief prétraitement des directives #include des shaders et cache
+ * des sources lues, dédupliquées par le hachage de leur contenu.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DUINCLUDE_H
+#define _GL4DUINCLUDE_H
+
+#include "gl4dummies.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern GL4DHIDDEN char * incExpand(const char * path, const char * source, char *** deps, int * ndeps);
+  extern GL4DHIDDEN void   incRelease(char ** deps, int ndeps);
+  extern GL4DHIDDEN int    incUpdate(const char * path, const char * source);
+  extern GL4DHIDDEN void   incRegister(const char * name, const char * source);
+  extern GL4DHIDDEN void   incClean(int all);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,280 @@
+/*!\file gl4duProfile.c
+ *
+ * \brief profilage des portées marquées par GL4D_PROF_BEGIN /
+ * GL4D_PROF_END et export au format "trace event" de Chrome
+ * (chrome://tracing, Perfetto).
+ *
+ * Chaque thread enregistre ses portées dans son propre tampon
+ * (variable locale au thread, sans verrou ; seul l'enregistrement d'un
+ * nouveau thread prend le mutex). Sur le thread GL (celui qui a appelé
+ * \ref gl4duProfileStart), une portée peut aussi poser deux requêtes
+ * GL_TIMESTAMP, lues seulement à l'export ; les temps GPU sont recalés
+ * sur l'horloge CPU à partir d'un GL_TIMESTAMP pris au démarrage.
+ *
+ * Sans GL4D_PROFILE, les marqueurs ne produisent aucun code et \ref
+ * gl4duProfileStart retourne GL_FALSE.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4du.h"
+#include "gl4duProfile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef GL4D_PROFILE
+
+#if defined(_MSC_VER)
+#  define PROF_TLS __declspec(thread)
+#else
+#  define PROF_TLS __thread
+#endif
+/*!\brief profondeur maximale d'imbrication enregistrée. */
+#define PROF_DEPTH 64
+
+typedef struct prof_event_t prof_event_t;
+typedef struct prof_thread_t prof_thread_t;
+
+struct prof_event_t {
+  const char * name;
+  unsigned long long t0, t1; /* ns, t1 nul tant que la portée est ouverte */
+  int q;                     /* paire de requêtes GL_TIMESTAMP + 1, 0 si aucune */
+};
+
+struct prof_thread_t {
+  SDL_threadID tid;
+  prof_event_t * ev;
+  int n, s;
+  int stack[PROF_DEPTH], depth;
+  prof_thread_t * next;
+};
+
+/*!\brief tampon du thread courant, valable si _selfGen == _gen (les
+ * tampons sont libérés quand le profilage est quitté). */
+static PROF_TLS prof_thread_t * _self = NULL;
+static PROF_TLS unsigned _selfGen = 0;
+static unsigned _gen = 1;
+static prof_thread_t * _threads = NULL;
+static SDL_mutex * _mutex = NULL;
+static SDL_atomic_t _on = {0};
+/*!\brief origine (ns) des dates exportées. */
+static unsigned long long _origin = 0;
+static SDL_threadID _glThread = 0;
+static int _gpu = 0;
+#ifndef __GLES4D__
+/*!\brief requêtes GL_TIMESTAMP (par paires) et GL_TIMESTAMP du
+ * démarrage. */
+static GLuint * _queries = NULL;
+static int _nq = 0, _sq = 0;
+static GLint64 _gpuOrigin = 0;
+#endif
+
+static void profQuit(void);
+
+static prof_thread_t * profThread(void) {
+  prof_thread_t * t = calloc(1, sizeof * t);
+  assert(t);
+  t->tid = SDL_ThreadID();
+  SDL_LockMutex(_mutex);
+  t->next = _threads;
+  _threads = t;
+  SDL_UnlockMutex(_mutex);
+  _selfGen = _gen;
+  return _self = t;
+}
+
+#ifndef __GLES4D__
+/*!\brief retourne le numéro (+ 1) d'une paire de requêtes libre. */
+static int profQueries(void) {
+  if(_nq == _sq) {
+    _sq = _sq ? _sq << 1 : 256;
+    _queries = realloc(_queries, 2 * _sq * sizeof * _queries);
+    assert(_queries);
+    glGenQueries(2 * (_sq - _nq), &_queries[2 * _nq]);
+  }
+  return ++_nq;
+}
+#endif
+
+/*!\brief ouvre la portée \a name (une chaîne statique). */
+void profBegin(const char * name) {
+  prof_thread_t * t;
+  prof_event_t * e;
+  if(!SDL_AtomicGet(&_on))
+    return;
+  t = (_selfGen == _gen && _self) ? _self : profThread();
+  if(t->depth >= PROF_DEPTH) {
+    t->depth++;
+    return;
+  }
+  if(t->n == t->s) {
+    t->s = t->s ? t->s << 1 : 1024;
+    t->ev = realloc(t->ev, t->s * sizeof * t->ev);
+    assert(t->ev);
+  }
+  e = &t->ev[t->n];
+  e->name = name;
+  e->t1 = 0;
+  e->q = 0;
+#ifndef __GLES4D__
+  if(_gpu && t->tid == _glThread) {
+    e->q = profQueries();
+    glQueryCounter(_queries[2 * (e->q - 1)], GL_TIMESTAMP);
+  }
+#endif
+  t->stack[t->depth++] = t->n++;
+  e->t0 = gl4dGetNanoseconds();
+}
+
+/*!\brief ferme la dernière portée ouverte par le thread courant. */
+void profEnd(void) {
+  unsigned long long now = gl4dGetNanoseconds();
+  prof_thread_t * t = _self;
+  prof_event_t * e;
+  if(_selfGen != _gen || !t || t->depth <= 0)
+    return;
+  if(--t->depth >= PROF_DEPTH)
+    return;
+  e = &t->ev[t->stack[t->depth]];
+  e->t1 = now;
+#ifndef __GLES4D__
+  if(e->q)
+    glQueryCounter(_queries[2 * (e->q - 1) + 1], GL_TIMESTAMP);
+#endif
+}
+
+static void profQuit(void) {
+  prof_thread_t * t;
+  SDL_AtomicSet(&_on, 0);
+  while((t = _threads) != NULL) {
+    _threads = t->next;
+    free(t->ev);
+    free(t);
+  }
+  _gen++;
+#ifndef __GLES4D__
+  if(_queries) {
+    glDeleteQueries(2 * _sq, _queries);
+    free(_queries);
+    _queries = NULL;
+    _nq = _sq = 0;
+  }
+#endif
+  if(_mutex) {
+    SDL_DestroyMutex(_mutex);
+    _mutex = NULL;
+  }
+}
+
+/*!\brief catégorie (préfixe du module, "gl4dg" pour "gl4dgDraw")
+ * d'une portée. */
+static int category(const char * name) {
+  return (!strncmp(name, "gl4d", 4) && name[4]) ? 5 : (int)strlen(name);
+}
+#endif
+
+/*!\brief démarre (ou redémarre, en oubliant les mesures précédentes)
+ * l'enregistrement des portées profilées de la lib.
+ *
+ * \param gpu si vrai, les portées ouvertes depuis le thread appelant
+ * (celui du contexte GL) sont aussi mesurées côté GPU par des
+ * requêtes GL_TIMESTAMP (sans effet sous GLES).
+ *
+ * \return GL_FALSE si la lib a été compilée sans GL4D_PROFILE.
+ */
+GLboolean gl4duProfileStart(GLboolean gpu) {
+#ifdef GL4D_PROFILE
+  prof_thread_t * t;
+  if(!_mutex) {
+    _mutex = SDL_CreateMutex();
+    assert(_mutex);
+    gl4duAtExit(profQuit);
+  }
+  SDL_AtomicSet(&_on, 0);
+  SDL_LockMutex(_mutex);
+  for(t = _threads; t; t = t->next)
+    t->n = t->depth = 0;
+  SDL_UnlockMutex(_mutex);
+  _glThread = SDL_ThreadID();
+#ifndef __GLES4D__
+  _nq = 0;
+  if((_gpu = gpu) != 0)
+    glGetInteger64v(GL_TIMESTAMP, &_gpuOrigin);
+#else
+  (void)gpu;
+#endif
+  _origin = gl4dGetNanoseconds();
+  SDL_AtomicSet(&_on, 1);
+  return GL_TRUE;
+#else
+  (void)gpu;
+  return GL_FALSE;
+#endif
+}
+
+/*!\brief arrête l'enregistrement des portées ; les portées déjà
+ * ouvertes se ferment normalement.
+ */
+void gl4duProfileStop(void) {
+#ifdef GL4D_PROFILE
+  SDL_AtomicSet(&_on, 0);
+#endif
+}
+
+/*!\brief écrit dans \a filename les portées (terminées) enregistrées
+ * depuis \ref gl4duProfileStart, au format JSON "trace event" de
+ * Chrome (à ouvrir dans chrome://tracing ou ui.perfetto.dev).
+ *
+ * A appeler depuis le thread GL (les requêtes GPU y sont lues, en
+ * attendant leurs résultats), de préférence après \ref
+ * gl4duProfileStop et quand les threads de la lib sont au repos. Les
+ * mesures GPU apparaissent sur une ligne "GPU" distincte.
+ *
+ * \return GL_TRUE si le fichier a été écrit.
+ */
+GLboolean gl4duProfileDump(const char * filename) {
+#ifdef GL4D_PROFILE
+  FILE * fp;
+  prof_thread_t * t;
+  prof_event_t * e;
+  int i, on = SDL_AtomicGet(&_on);
+  if(!_mutex || !(fp = fopen(filename, "w"))) {
+    fprintf(stderr, "%s (%d): %s: impossible d'écrire %s\n", __FILE__, __LINE__, __func__, filename);
+    return GL_FALSE;
+  }
+  SDL_AtomicSet(&_on, 0);
+  SDL_LockMutex(_mutex);
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+  for(t = _threads; t; t = t->next) {
+    fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+	    (unsigned long)t->tid, t->tid == _glThread ? "GL" : "worker");
+    for(i = 0; i < t->n; i++) {
+      e = &t->ev[i];
+      if(!e->t1)
+	continue;
+      fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%.*s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+	      e->name, category(e->name), e->name, (unsigned long)t->tid,
+	      (e->t0 - _origin) / 1000.0, (e->t1 - e->t0) / 1000.0);
+#ifndef __GLES4D__
+      if(e->q) {
+	GLuint64 g0, g1;
+	glGetQueryObjectui64v(_queries[2 * (e->q - 1)], GL_QUERY_RESULT, &g0);
+	glGetQueryObjectui64v(_queries[2 * (e->q - 1) + 1], GL_QUERY_RESULT, &g1);
+	fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+		e->name, ((GLint64)g0 - _gpuOrigin) / 1000.0, (g1 - g0) / 1000.0);
+      }
+#endif
+    }
+  }
+  fprintf(fp, "\n]}\n");
+  SDL_UnlockMutex(_mutex);
+  SDL_AtomicSet(&_on, on);
+  fclose(fp);
+  return GL_TRUE;
+#else
+  (void)filename;
+  return GL_FALSE;
+#endif
+}
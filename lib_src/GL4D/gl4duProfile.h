@@ -0,0 +1,39 @@
+/*!\file gl4duProfile.h
+ *
+ * \brief marqueurs de profilage des points d'entrée de la lib.
+ *
+ * Les paires GL4D_PROF_BEGIN("nom") / GL4D_PROF_END() délimitent des
+ * portées (imbricables) mesurées quand la lib est compilée avec
+ * GL4D_PROFILE (configure --enable-profile) ; sans, elles ne
+ * produisent aucun code. Chaque GL4D_PROF_BEGIN doit être suivi d'un
+ * GL4D_PROF_END sur tous les chemins de sortie.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DUPROFILE_H
+#define _GL4DUPROFILE_H
+
+#include "gl4dummies.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef GL4D_PROFILE
+#  define GL4D_PROF_BEGIN(name) profBegin(name)
+#  define GL4D_PROF_END()       profEnd()
+  extern GL4DHIDDEN void profBegin(const char * name);
+  extern GL4DHIDDEN void profEnd(void);
+#else
+#  define GL4D_PROF_BEGIN(name) ((void)0)
+#  define GL4D_PROF_END()       ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,378 @@
+/*!\file gl4duWatch.c
+ *
+ * \brief surveillance (thread d'arrière-plan) des fichiers de shaders
+ * pour leur rechargement à chaud.
+ *
+ * Un thread SDL surveille les fichiers ajoutés par \ref fwAdd : par
+ * inotify sous Linux (sur les répertoires, pour voir aussi les
+ * sauvegardes par renommage des éditeurs), sinon en comparant leur
+ * date de modification toutes les FW_POLL_MS millisecondes. Une
+ * rafale de modifications d'un même fichier n'est prise en compte
+ * que FW_DEBOUNCE_MS millisecondes après la dernière ; le fichier est
+ * alors lu par le thread, qui en met la source dans le cache des
+ * #include (en y lisant aussi les fichiers qu'elle inclut désormais,
+ * voir \ref incUpdate) et, si elle a réellement changé, met son chemin
+ * en file pour le thread de rendu (\ref fwPending, \ref fwPop). Ce
+ * dernier n'a plus qu'à développer en mémoire, compiler et relier.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include "gl4duWatch.h"
+#include "gl4duInclude.h"
+#include "gl4du.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#  define FW_INOTIFY
+#  include <sys/inotify.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  include <limits.h>
+#endif
+
+/*!\brief délai d'anti-rebond après la dernière modification. */
+#define FW_DEBOUNCE_MS 100
+/*!\brief période de scrutation sans inotify. */
+#define FW_POLL_MS 250
+/*!\brief attente maximale du thread entre deux vérifications. */
+#define FW_TICK_MS 25
+
+/*!\brief un fichier surveillé. */
+typedef struct fw_file_t fw_file_t;
+struct fw_file_t {
+  char * path;
+  const char * base; /* nom du fichier (dans path) */
+  int dir;           /* indice du répertoire dans _dirs (inotify) */
+  int refs;
+  time_t mtime;      /* date et taille vues par la scrutation */
+  off_t size;
+  Uint32 deadline;   /* fin de l'anti-rebond, 0 si pas de changement */
+  fw_file_t * next;
+};
+
+/*!\brief un fichier modifié, en attente. */
+typedef struct fw_change_t fw_change_t;
+struct fw_change_t {
+  char * path;
+  fw_change_t * next;
+};
+
+#ifdef FW_INOTIFY
+/*!\brief un répertoire surveillé par inotify. */
+typedef struct fw_dir_t fw_dir_t;
+struct fw_dir_t {
+  char * path;
+  int wd, refs;
+};
+static fw_dir_t * _dirs = NULL;
+static int _nbDirs = 0;
+static int _ifd = -1;
+#endif
+
+static fw_file_t * _files = NULL;
+static fw_change_t * _changes = NULL;
+/*!\brief nombre de changements en file : seule donnée lue par le
+ * thread de rendu quand rien n'a changé. */
+static SDL_atomic_t _pending;
+static SDL_atomic_t _quit;
+static SDL_mutex * _mutex = NULL;
+static SDL_Thread * _thread = NULL;
+
+static void init(void);
+static int  watchLoop(void * arg);
+
+/*!\brief ajoute le fichier \a path aux fichiers surveillés (un
+ * compteur de références permet des ajouts multiples). */
+void fwAdd(const char * path) {
+  fw_file_t * f;
+  struct stat buf;
+  const char * s;
+  if(!_mutex)
+    init();
+  SDL_LockMutex(_mutex);
+  for(f = _files; f; f = f->next)
+    if(!strcmp(f->path, path)) {
+      f->refs++;
+      SDL_UnlockMutex(_mutex);
+      return;
+    }
+  f = calloc(1, sizeof *f);
+  assert(f);
+  f->path = strdup(path);
+  f->base = (s = strrchr(f->path, '/')) ? s + 1 : f->path;
+#ifdef _WIN32
+  if((s = strrchr(f->base, '\\')) != NULL)
+    f->base = s + 1;
+#endif
+  f->refs = 1;
+  f->dir = -1;
+  if(stat(path, &buf) == 0) {
+    f->mtime = buf.st_mtime;
+    f->size = buf.st_size;
+  }
+#ifdef FW_INOTIFY
+  if(_ifd >= 0) {
+    int i;
+    size_t l = f->base - f->path;
+    char * d = l ? strndup(f->path, l) : strdup(".");
+    for(i = 0; i < _nbDirs; i++)
+      if(_dirs[i].refs > 0 && !strcmp(_dirs[i].path, d))
+        break;
+    if(i < _nbDirs) {
+      _dirs[i].refs++;
+      free(d);
+    } else {
+      int wd = inotify_add_watch(_ifd, d, IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+      if(wd < 0)
+        free(d); /* la scrutation prendra le relais pour ce fichier */
+      else {
+        for(i = 0; i < _nbDirs && _dirs[i].refs > 0; i++);
+        if(i == _nbDirs) {
+          _dirs = realloc(_dirs, ++_nbDirs * sizeof *_dirs);
+          assert(_dirs);
+        }
+        _dirs[i].path = d;
+        _dirs[i].wd = wd;
+        _dirs[i].refs = 1;
+      }
+    }
+    if(i < _nbDirs && _dirs[i].refs > 0 && _dirs[i].path)
+      f->dir = i;
+  }
+#endif
+  f->next = _files;
+  _files = f;
+  SDL_UnlockMutex(_mutex);
+}
+
+/*!\brief retire une référence au fichier surveillé \a path. */
+void fwRemove(const char * path) {
+  fw_file_t ** pf, * f;
+  if(!_mutex) return;
+  SDL_LockMutex(_mutex);
+  for(pf = &_files; (f = *pf) != NULL; pf = &(f->next))
+    if(!strcmp(f->path, path))
+      break;
+  if(f && --f->refs == 0) {
+    *pf = f->next;
+#ifdef FW_INOTIFY
+    if(f->dir >= 0 && --_dirs[f->dir].refs == 0) {
+      inotify_rm_watch(_ifd, _dirs[f->dir].wd);
+      free(_dirs[f->dir].path);
+      _dirs[f->dir].path = NULL;
+    }
+#endif
+    free(f->path);
+    free(f);
+  }
+  SDL_UnlockMutex(_mutex);
+}
+
+/*!\brief indique si des fichiers modifiés attendent d'être récupérés
+ * par \ref fwPop (une lecture atomique, sans verrou). */
+int fwPending(void) {
+  return _mutex && SDL_AtomicGet(&_pending) > 0;
+}
+
+/*!\brief retire de la file le plus ancien fichier modifié, dont la
+ * nouvelle source est déjà dans le cache des #include.
+ *
+ * \param path reçoit le chemin du fichier (à libérer par free).
+ * \return 1 si un changement a été retiré, 0 si la file est vide.
+ */
+int fwPop(char ** path) {
+  fw_change_t ** pc, * c;
+  if(!fwPending()) return 0;
+  SDL_LockMutex(_mutex);
+  for(pc = &_changes; *pc && (*pc)->next; pc = &((*pc)->next));
+  if((c = *pc) != NULL) {
+    *pc = NULL;
+    SDL_AtomicAdd(&_pending, -1);
+  }
+  SDL_UnlockMutex(_mutex);
+  if(!c) return 0;
+  *path = c->path;
+  free(c);
+  return 1;
+}
+
+/*!\brief arrête le thread de surveillance et libère ses ressources. */
+static void fwClean(void) {
+  fw_file_t * f;
+  fw_change_t * c;
+  if(!_mutex) return;
+  SDL_AtomicSet(&_quit, 1);
+  SDL_WaitThread(_thread, NULL);
+  _thread = NULL;
+  while((f = _files) != NULL) {
+    _files = f->next;
+    free(f->path);
+    free(f);
+  }
+  while((c = _changes) != NULL) {
+    _changes = c->next;
+    free(c->path);
+    free(c);
+  }
+#ifdef FW_INOTIFY
+  if(_ifd >= 0) {
+    int i;
+    for(i = 0; i < _nbDirs; i++)
+      free(_dirs[i].path);
+    free(_dirs);
+    _dirs = NULL;
+    _nbDirs = 0;
+    close(_ifd);
+    _ifd = -1;
+  }
+#endif
+  SDL_DestroyMutex(_mutex);
+  _mutex = NULL;
+  SDL_AtomicSet(&_pending, 0);
+  SDL_AtomicSet(&_quit, 0);
+}
+
+static void init(void) {
+  static int ft = 1;
+  _mutex = SDL_CreateMutex();
+  assert(_mutex);
+  SDL_AtomicSet(&_pending, 0);
+  SDL_AtomicSet(&_quit, 0);
+#ifdef FW_INOTIFY
+  _ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+  _thread = SDL_CreateThread(watchLoop, "gl4dwatch", NULL);
+  assert(_thread);
+  if(ft) gl4duAtExit(fwClean);
+  ft = 0;
+}
+
+/*!\brief (ré)arme l'anti-rebond du fichier \a f. Verrou pris. */
+static inline void touch(fw_file_t * f, Uint32 now) {
+  f->deadline = now + FW_DEBOUNCE_MS;
+  if(!f->deadline) f->deadline = 1;
+}
+
+#ifdef FW_INOTIFY
+/*!\brief lit les événements inotify disponibles (en attendant au plus
+ * FW_TICK_MS) et arme l'anti-rebond des fichiers concernés. */
+static void readEvents(void) {
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct pollfd pfd;
+  ssize_t n;
+  char * p;
+  pfd.fd = _ifd;
+  pfd.events = POLLIN;
+  if(poll(&pfd, 1, FW_TICK_MS) <= 0)
+    return;
+  while((n = read(_ifd, buf, sizeof buf)) > 0) {
+    Uint32 now = SDL_GetTicks();
+    SDL_LockMutex(_mutex);
+    for(p = buf; p < buf + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+      const struct inotify_event * ev = (const struct inotify_event *)p;
+      fw_file_t * f;
+      if(!ev->len) continue;
+      for(f = _files; f; f = f->next)
+        if(f->dir >= 0 && _dirs[f->dir].wd == ev->wd && !strcmp(f->base, ev->name))
+          touch(f, now);
+    }
+    SDL_UnlockMutex(_mutex);
+  }
+}
+#endif
+
+/*!\brief compare la date de modification des fichiers non couverts par
+ * inotify à celle connue et arme l'anti-rebond de ceux qui ont
+ * changé. Un fichier momentanément absent (en cours de sauvegarde)
+ * est simplement ignoré jusqu'au prochain passage. */
+static void pollFiles(void) {
+  fw_file_t * f;
+  struct stat buf;
+  Uint32 now = SDL_GetTicks();
+  SDL_LockMutex(_mutex);
+  for(f = _files; f; f = f->next)
+    if(f->dir < 0 && stat(f->path, &buf) == 0 &&
+       (buf.st_mtime != f->mtime || buf.st_size != f->size)) {
+      f->mtime = buf.st_mtime;
+      f->size = buf.st_size;
+      touch(f, now);
+    }
+  SDL_UnlockMutex(_mutex);
+}
+
+/*!\brief lit (hors verrou) les fichiers dont l'anti-rebond a expiré,
+ * met à jour le cache des #include et met en file ceux dont le contenu
+ * a changé. */
+static void flushChanges(void) {
+  fw_file_t * f;
+  fw_change_t * ready = NULL, * c, ** pc;
+  Uint32 now = SDL_GetTicks();
+  SDL_LockMutex(_mutex);
+  for(f = _files; f; f = f->next)
+    if(f->deadline && (Sint32)(now - f->deadline) >= 0) {
+      f->deadline = 0;
+      c = calloc(1, sizeof *c);
+      assert(c);
+      c->path = strdup(f->path);
+      c->next = ready;
+      ready = c;
+    }
+  SDL_UnlockMutex(_mutex);
+  while((c = ready) != NULL) {
+    char * src;
+    int changed;
+    ready = c->next;
+    if((src = gl4dReadTextFile(c->path)) == NULL) {
+      free(c->path);
+      free(c);
+      continue;
+    }
+    changed = incUpdate(c->path, src);
+    free(src);
+    if(!changed) {
+      free(c->path);
+      free(c);
+      continue;
+    }
+    SDL_LockMutex(_mutex);
+    /* un changement plus ancien du même fichier devient inutile */
+    for(pc = &_changes; *pc; pc = &((*pc)->next))
+      if(!strcmp((*pc)->path, c->path)) {
+        fw_change_t * old = *pc;
+        *pc = old->next;
+        free(old->path);
+        free(old);
+        SDL_AtomicAdd(&_pending, -1);
+        break;
+      }
+    c->next = _changes;
+    _changes = c;
+    SDL_AtomicAdd(&_pending, 1);
+    SDL_UnlockMutex(_mutex);
+  }
+}
+
+static int watchLoop(void * arg) {
+  Uint32 lastPoll = 0;
+  (void)arg;
+  while(!SDL_AtomicGet(&_quit)) {
+#ifdef FW_INOTIFY
+    if(_ifd >= 0)
+      readEvents();
+    else
+#endif
+      SDL_Delay(FW_TICK_MS);
+    if(SDL_GetTicks() - lastPoll >= FW_POLL_MS) {
+      pollFiles();
+      lastPoll = SDL_GetTicks();
+    }
+    flushChanges();
+  }
+  return 0;
+}
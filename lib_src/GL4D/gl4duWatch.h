@@ -0,0 +1,29 @@
+/*!\file gl4duWatch.h
+ *
+ * \brief surveillance (thread d'arrière-plan) des fichiers de shaders
+ * pour leur rechargement à chaud.
+ *
+ * A usage interne à la lib.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#ifndef _GL4DUWATCH_H
+#define _GL4DUWATCH_H
+
+#include "gl4dummies.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern GL4DHIDDEN void fwAdd(const char * path);
+  extern GL4DHIDDEN void fwRemove(const char * path);
+  extern GL4DHIDDEN int  fwPending(void);
+  extern GL4DHIDDEN int  fwPop(char ** path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
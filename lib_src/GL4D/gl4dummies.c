@@ -10,6 +10,7 @@
 #  include <unistd.h>
 #endif
 #include "gl4dummies.h"
+#include "shader_bundle.h"
 #include <math.h>
 #include <time.h>
 #include <stdio.h>
@@ -101,19 +102,21 @@ char * gl4dReadTextFile(const char * filename) {
 
 /*!\brief recherche le shader filename dans le dat décrypté decData
  * et retourne une copie du code.
+ *
+ * decData étant une chaîne dont la taille n'est pas connue, seules les
+ * archives balisées y sont cherchées ; une archive indexée (voir
+ * shader_bundle.c) s'ouvre avec sbundleOpen, qui en vérifie l'en-tête.
  */
 char * gl4dExtractFromDecData(const char * decData, const char * filename) {
-	int i, j;
-	char a[BUFSIZ], * r;
-	snprintf(a, BUFSIZ, "<shader %s>", filename);
-	if((i = kmpSearch(a, decData)) < 0)
-		return NULL;
-	if((j = kmpSearch("</shader>", &decData[i + strlen(a)])) < 0)
+	GLint l;
+	char * r;
+	const char * src = sbundleFindInDecData(decData, strlen(decData) + 1, filename, &l);
+	if(!src)
 		return NULL;
-	r = malloc((j + 1) * sizeof * r);
+	r = malloc((l + 1) * sizeof * r);
 	assert(r);
-	strncpy(r, &decData[i + strlen(a)], j);
-	r[j] = 0;
+	memcpy(r, src, l);
+	r[l] = 0;
 	return r;
 }
 
@@ -149,41 +152,42 @@ static int kmpSearch(const char * p, const char * t) {
   return lt;
 }
 
-/****************************************************/
-/****** Version windows/mingw de gettimeofday *******/
-/****************************************************/
+/*****************************************************/
+/****** Horloge monotone (non affectée par les *******/
+/****** changements de l'heure du système)     *******/
+/*****************************************************/
 #if defined(_WIN32)
 #  include <windows.h>
-#  include <winsock2.h>
-    static int gettimeofday(struct timeval* p, void* tz) {
-        ULARGE_INTEGER ul; // As specified on MSDN.
-        FILETIME ft;
-        // Returns a 64-bit value representing the number of
-        // 100-nanosecond intervals since January 1, 1601 (UTC).
-        GetSystemTimeAsFileTime(&ft);
-        // Fill ULARGE_INTEGER low and high parts.
-        ul.LowPart = ft.dwLowDateTime;
-        ul.HighPart = ft.dwHighDateTime;
-        // Convert to microseconds.
-        ul.QuadPart /= 10ULL;
-        // Remove Windows to UNIX Epoch delta.
-        ul.QuadPart -= 11644473600000000ULL;
-        // Modulo to retrieve the microseconds.
-        p->tv_usec = (long) (ul.QuadPart % 1000000LL);
-        // Divide to retrieve the seconds.
-        p->tv_sec = (long) (ul.QuadPart / 1000000LL);
-        return 0;
-    }
+#endif
+
+/*!\brief Donne le temps d'une horloge monotone, en nanosecondes
+ * depuis une origine arbitraire (clock_gettime(CLOCK_MONOTONIC), ou
+ * QueryPerformanceCounter sous Windows).
+ *
+ * \return le temps courant en nanosecondes.
+ */
+unsigned long long gl4dGetNanoseconds(void) {
+#if defined(_WIN32)
+  static LARGE_INTEGER f = {0};
+  LARGE_INTEGER c;
+  if(!f.QuadPart)
+    QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (unsigned long long)(c.QuadPart / f.QuadPart) * 1000000000ULL +
+    (unsigned long long)(c.QuadPart % f.QuadPart) * 1000000000ULL / f.QuadPart;
 #else
-#  include <sys/time.h>
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 #endif
+}
 
 /*!\brief Le temps initial du programme. A initialiser avec \ref
  * gl4dInitTime0.
  *
  * \see gl4dInitTime0
  */
-static struct timeval t0;
+static unsigned long long t0;
 
 static double getElapsedTime_sub1(void);
 static double getElapsedTime_sub2(void);
@@ -197,18 +201,13 @@ static double getElapsedTime_sub1(void) {
 }
 
 static double getElapsedTime_sub2(void) {
-  struct timeval t;
-  double diff;
-  gettimeofday(&t, (struct timezone*) 0);
-  diff = (t.tv_sec - t0.tv_sec) * 1000000
-    + (t.tv_usec - t0.tv_usec);
-  return diff/1000.;
+  return (gl4dGetNanoseconds() - t0) / 1000000.0;
 }
 
 /*!\brief Initialise \a t0.
  */
 void gl4dInitTime0(void) {
-  gettimeofday(&t0, (struct timezone*) 0);
+  t0 = gl4dGetNanoseconds();
 }
 
 /*!\brief Donne le temps ecoule en millisecondes depuis \a t0.
@@ -226,12 +225,12 @@ double gl4dGetElapsedTime(void) {
  *
  * \see gl4dInitTime
  */
-static struct timeval ti;
+static unsigned long long ti;
 
 /*!\brief Initialise \a ti.
  */
 void gl4dInitTime(void) {
-  gettimeofday(&ti, (struct timezone*) 0);
+  ti = gl4dGetNanoseconds();
 }
 
 /*!\brief Donne le temps ecoule en millisecondes depuis \a ti.
@@ -241,12 +240,7 @@ void gl4dInitTime(void) {
  * \return le temps ecoule en millisecondes.
  */
 double gl4dGetTime(void) {
-  struct timeval t;
-  double diff;
-  gettimeofday(&t, (struct timezone*) 0);
-  diff = (t.tv_sec - ti.tv_sec) * 1000000
-    + (t.tv_usec - ti.tv_usec);
-  return diff/1000.;
+  return (gl4dGetNanoseconds() - ti) / 1000000.0;
 }
 
 /*!\brief Calcule le FPS - Frames Per Second.
@@ -1766,4 +1760,394 @@ void glGetFramebufferAttachmentParameteriv(GLenum target,  GLenum attachment,  G
 	    __FILE__, __LINE__, __func__);
   }
 }
+
+/*!\brief fait appel a glFenceSync si disponible
+ */
+GLsync gl4dFenceSync(GLenum condition, GLbitfield flags) {
+  GLsync (__stdcall *p)(GLenum, GLbitfield);
+  if((p = getProcAddress("glFenceSync")))
+    return p(condition, flags);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Fence Sync\n",
+	    __FILE__, __LINE__, __func__);
+    return 0;
+  }
+}
+
+/*!\brief fait appel a glClientWaitSync si disponible
+ */
+GLenum gl4dClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  GLenum (__stdcall *p)(GLsync, GLbitfield, GLuint64);
+  if((p = getProcAddress("glClientWaitSync")))
+    return p(sync, flags, timeout);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Client Wait Sync\n",
+	    __FILE__, __LINE__, __func__);
+    return GL_WAIT_FAILED;
+  }
+}
+
+/*!\brief fait appel a glDeleteSync si disponible
+ */
+void gl4dDeleteSync(GLsync sync) {
+  void (__stdcall *p)(GLsync);
+  if((p = getProcAddress("glDeleteSync")))
+    p(sync);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Delete Sync\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glBufferStorage si disponible
+ */
+void gl4dBufferStorage(GLenum target, GLsizeiptr size, const GLvoid * data, GLbitfield flags) {
+  void (__stdcall *p)(GLenum, GLsizeiptr, const GLvoid *, GLbitfield);
+  if((p = getProcAddress("glBufferStorage")))
+    p(target, size, data, flags);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Buffer Storage\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glMapBufferRange si disponible
+ */
+GLvoid * gl4dMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+  GLvoid * (__stdcall *p)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
+  if((p = getProcAddress("glMapBufferRange")))
+    return p(target, offset, length, access);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Map Buffer Range\n",
+	    __FILE__, __LINE__, __func__);
+    return NULL;
+  }
+}
+
+/*!\brief fait appel a glUnmapBuffer si disponible
+ */
+GLboolean gl4dUnmapBuffer(GLenum target) {
+  GLboolean (__stdcall *p)(GLenum);
+  if((p = getProcAddress("glUnmapBuffer")))
+    return p(target);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Unmap Buffer\n",
+	    __FILE__, __LINE__, __func__);
+    return GL_FALSE;
+  }
+}
+
+/*!\brief fait appel a glGenQueries si disponible
+ */
+void gl4dGenQueries(GLsizei n, GLuint * ids) {
+  void (__stdcall *p)(GLsizei, GLuint *);
+  if((p = getProcAddress("glGenQueries")))
+    p(n, ids);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Gen Queries\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glDeleteQueries si disponible
+ */
+void gl4dDeleteQueries(GLsizei n, const GLuint * ids) {
+  void (__stdcall *p)(GLsizei, const GLuint *);
+  if((p = getProcAddress("glDeleteQueries")))
+    p(n, ids);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Delete Queries\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetQueryObjectiv si disponible
+ */
+void gl4dGetQueryObjectiv(GLuint id, GLenum pname, GLint * params) {
+  void (__stdcall *p)(GLuint, GLenum, GLint *);
+  if((p = getProcAddress("glGetQueryObjectiv")))
+    p(id, pname, params);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Query Objectiv\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetQueryObjectui64v si disponible
+ */
+void gl4dGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 * params) {
+  void (__stdcall *p)(GLuint, GLenum, GLuint64 *);
+  if((p = getProcAddress("glGetQueryObjectui64v")))
+    p(id, pname, params);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Query Objectui64v\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glQueryCounter si disponible
+ */
+void gl4dQueryCounter(GLuint id, GLenum target) {
+  void (__stdcall *p)(GLuint, GLenum);
+  if((p = getProcAddress("glQueryCounter")))
+    p(id, target);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Query Counter\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glBindBufferRange si disponible
+ */
+void gl4dBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+  void (__stdcall *p)(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr);
+  if((p = getProcAddress("glBindBufferRange")))
+    p(target, index, buffer, offset, size);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Bind Buffer Range\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetUniformBlockIndex si disponible
+ */
+GLuint gl4dGetUniformBlockIndex(GLuint program, const GLchar * uniformBlockName) {
+  GLuint (__stdcall *p)(GLuint, const GLchar *);
+  if((p = getProcAddress("glGetUniformBlockIndex")))
+    return p(program, uniformBlockName);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Uniform Block Index\n",
+	    __FILE__, __LINE__, __func__);
+    return GL_INVALID_INDEX;
+  }
+}
+
+/*!\brief fait appel a glUniformBlockBinding si disponible
+ */
+void gl4dUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+  void (__stdcall *p)(GLuint, GLuint, GLuint);
+  if((p = getProcAddress("glUniformBlockBinding")))
+    p(program, uniformBlockIndex, uniformBlockBinding);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Uniform Block Binding\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetProgramBinary si disponible
+ */
+void gl4dGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei * length, GLenum * binaryFormat, GLvoid * binary) {
+  void (__stdcall *p)(GLuint, GLsizei, GLsizei *, GLenum *, GLvoid *);
+  if((p = getProcAddress("glGetProgramBinary")))
+    p(program, bufSize, length, binaryFormat, binary);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Program Binary\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glProgramBinary si disponible
+ */
+void gl4dProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid * binary, GLsizei length) {
+  void (__stdcall *p)(GLuint, GLenum, const GLvoid *, GLsizei);
+  if((p = getProcAddress("glProgramBinary")))
+    p(program, binaryFormat, binary, length);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Program Binary\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glProgramParameteri si disponible
+ */
+void gl4dProgramParameteri(GLuint program, GLenum pname, GLint value) {
+  void (__stdcall *p)(GLuint, GLenum, GLint);
+  if((p = getProcAddress("glProgramParameteri")))
+    p(program, pname, value);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Program Parameteri\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetStringi si disponible
+ */
+const GLubyte * gl4dGetStringi(GLenum name, GLuint index) {
+  const GLubyte * (__stdcall *p)(GLenum, GLuint);
+  if((p = getProcAddress("glGetStringi")))
+    return p(name, index);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Stringi\n",
+	    __FILE__, __LINE__, __func__);
+    return NULL;
+  }
+}
+
+/*!\brief fait appel a glBeginQuery si disponible
+ */
+void gl4dBeginQuery(GLenum target, GLuint id) {
+  void (__stdcall *p)(GLenum, GLuint);
+  if((p = getProcAddress("glBeginQuery")))
+    p(target, id);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Begin Query\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glEndQuery si disponible
+ */
+void gl4dEndQuery(GLenum target) {
+  void (__stdcall *p)(GLenum);
+  if((p = getProcAddress("glEndQuery")))
+    p(target);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour End Query\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetInteger64v si disponible
+ */
+void gl4dGetInteger64v(GLenum pname, GLint64 * data) {
+  void (__stdcall *p)(GLenum, GLint64 *);
+  if((p = getProcAddress("glGetInteger64v")))
+    p(pname, data);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Integer64v\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glDrawArraysInstanced si disponible
+ */
+void gl4dDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+  void (__stdcall *p)(GLenum, GLint, GLsizei, GLsizei);
+  if((p = getProcAddress("glDrawArraysInstanced")))
+    p(mode, first, count, instancecount);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Draw Arrays Instanced\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glDrawElementsInstanced si disponible
+ */
+void gl4dDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid * indices, GLsizei instancecount) {
+  void (__stdcall *p)(GLenum, GLsizei, GLenum, const GLvoid *, GLsizei);
+  if((p = getProcAddress("glDrawElementsInstanced")))
+    p(mode, count, type, indices, instancecount);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Draw Elements Instanced\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glVertexAttribDivisor si disponible
+ */
+void gl4dVertexAttribDivisor(GLuint index, GLuint divisor) {
+  void (__stdcall *p)(GLuint, GLuint);
+  if((p = getProcAddress("glVertexAttribDivisor")))
+    p(index, divisor);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Vertex Attrib Divisor\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glBufferSubData si disponible
+ */
+void gl4dBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data) {
+  void (__stdcall *p)(GLenum, GLintptr, GLsizeiptr, const GLvoid *);
+  if((p = getProcAddress("glBufferSubData")))
+    p(target, offset, size, data);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Buffer Sub Data\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glCopyBufferSubData si disponible
+ */
+void gl4dCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+  void (__stdcall *p)(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr);
+  if((p = getProcAddress("glCopyBufferSubData")))
+    p(readTarget, writeTarget, readOffset, writeOffset, size);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Copy Buffer Sub Data\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glMultiDrawElementsIndirect si disponible
+ */
+void gl4dMultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid * indirect, GLsizei drawcount, GLsizei stride) {
+  void (__stdcall *p)(GLenum, GLenum, const GLvoid *, GLsizei, GLsizei);
+  if((p = getProcAddress("glMultiDrawElementsIndirect")))
+    p(mode, type, indirect, drawcount, stride);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Multi Draw Elements Indirect\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGetQueryObjectuiv si disponible
+ */
+void gl4dGetQueryObjectuiv(GLuint id, GLenum pname, GLuint * params) {
+  void (__stdcall *p)(GLuint, GLenum, GLuint *);
+  if((p = getProcAddress("glGetQueryObjectuiv")))
+    p(id, pname, params);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Get Query Objectuiv\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glGenSamplers si disponible
+ */
+void gl4dGenSamplers(GLsizei n, GLuint * samplers) {
+  void (__stdcall *p)(GLsizei, GLuint *);
+  if((p = getProcAddress("glGenSamplers")))
+    p(n, samplers);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Gen Samplers\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glDeleteSamplers si disponible
+ */
+void gl4dDeleteSamplers(GLsizei n, const GLuint * samplers) {
+  void (__stdcall *p)(GLsizei, const GLuint *);
+  if((p = getProcAddress("glDeleteSamplers")))
+    p(n, samplers);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Delete Samplers\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glBindSampler si disponible
+ */
+void gl4dBindSampler(GLuint unit, GLuint sampler) {
+  void (__stdcall *p)(GLuint, GLuint);
+  if((p = getProcAddress("glBindSampler")))
+    p(unit, sampler);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Bind Sampler\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
+
+/*!\brief fait appel a glSamplerParameteri si disponible
+ */
+void gl4dSamplerParameteri(GLuint sampler, GLenum pname, GLint param) {
+  void (__stdcall *p)(GLuint, GLenum, GLint);
+  if((p = getProcAddress("glSamplerParameteri")))
+    p(sampler, pname, param);
+  else {
+    fprintf(stderr, "%s:%d:In %s: Aucune procedure pour Sampler Parameteri\n",
+	    __FILE__, __LINE__, __func__);
+  }
+}
 #endif
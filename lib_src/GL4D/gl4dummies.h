@@ -87,6 +87,14 @@
 #  define GL4DAPIENTRY
 #endif
 
+/* symboles partagés entre fichiers de la lib mais non exportés par
+ * celle-ci (sous Windows, seul ce qui est GL4DAPI l'est déjà) */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+#  define GL4DHIDDEN __attribute__((visibility("hidden")))
+#else
+#  define GL4DHIDDEN
+#endif
+
 /************************************************/
 /**************** Partie Liée à GL **************/
 /************************************************/
@@ -142,6 +150,7 @@ GL4DAPI int       GL4DAPIENTRY gl4dExtensionSupported(const char * extension);
 GL4DAPI void      GL4DAPIENTRY gl4dQuit(void);
 GL4DAPI char *    GL4DAPIENTRY gl4dReadTextFile(const char * filename);
 GL4DAPI char *    GL4DAPIENTRY gl4dExtractFromDecData(const char * decData, const char * filename);
+GL4DAPI unsigned long long GL4DAPIENTRY gl4dGetNanoseconds(void);
 GL4DAPI void      GL4DAPIENTRY gl4dInitTime0(void);
 GL4DAPI double    GL4DAPIENTRY gl4dGetElapsedTime(void);
 GL4DAPI void      GL4DAPIENTRY gl4dInitTime(void);
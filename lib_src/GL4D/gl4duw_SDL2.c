@@ -169,6 +169,7 @@ void gl4duwMainLoop(void) {
       manageEvents();
     btForAll(_btWindows, mainLoopBody, NULL);
     SDL_GL_MakeCurrent(_curWindow->window, _curWindow->glContext);
+    gl4duFrameTick();
     gl4duPrintFPS(stderr);
     gl4duUpdateShaders();
   }
@@ -279,6 +279,38 @@
     #define glGenVertexArrays               gl4dGenVertexArrays
     #define glBindVertexArray               gl4dBindVertexArray
     #define glGetFramebufferAttachmentParameteriv               gl4dGetFramebufferAttachmentParameteriv
+    #define glFenceSync                     gl4dFenceSync
+    #define glClientWaitSync                gl4dClientWaitSync
+    #define glDeleteSync                    gl4dDeleteSync
+    #define glBufferStorage                 gl4dBufferStorage
+    #define glMapBufferRange                gl4dMapBufferRange
+    #define glUnmapBuffer                   gl4dUnmapBuffer
+    #define glGenQueries                    gl4dGenQueries
+    #define glDeleteQueries                 gl4dDeleteQueries
+    #define glGetQueryObjectiv              gl4dGetQueryObjectiv
+    #define glGetQueryObjectui64v           gl4dGetQueryObjectui64v
+    #define glQueryCounter                  gl4dQueryCounter
+    #define glBindBufferRange               gl4dBindBufferRange
+    #define glGetUniformBlockIndex          gl4dGetUniformBlockIndex
+    #define glUniformBlockBinding           gl4dUniformBlockBinding
+    #define glGetProgramBinary              gl4dGetProgramBinary
+    #define glProgramBinary                 gl4dProgramBinary
+    #define glProgramParameteri             gl4dProgramParameteri
+    #define glGetStringi                    gl4dGetStringi
+    #define glBeginQuery                    gl4dBeginQuery
+    #define glEndQuery                      gl4dEndQuery
+    #define glGetInteger64v                 gl4dGetInteger64v
+    #define glDrawArraysInstanced           gl4dDrawArraysInstanced
+    #define glDrawElementsInstanced         gl4dDrawElementsInstanced
+    #define glVertexAttribDivisor           gl4dVertexAttribDivisor
+    #define glBufferSubData                 gl4dBufferSubData
+    #define glCopyBufferSubData             gl4dCopyBufferSubData
+    #define glMultiDrawElementsIndirect     gl4dMultiDrawElementsIndirect
+    #define glGetQueryObjectuiv             gl4dGetQueryObjectuiv
+    #define glGenSamplers                   gl4dGenSamplers
+    #define glDeleteSamplers                gl4dDeleteSamplers
+    #define glBindSampler                   gl4dBindSampler
+    #define glSamplerParameteri             gl4dSamplerParameteri
 
     #ifdef __cplusplus
     extern "C" {
@@ -379,6 +411,38 @@
     GL4DAPI void      GL4DAPIENTRY gl4dGenVertexArrays(GLsizei n, GLuint * arrays);
     GL4DAPI void      GL4DAPIENTRY gl4dBindVertexArray(GLuint array);
     GL4DAPI void      GL4DAPIENTRY glGetFramebufferAttachmentParameteriv(GLenum target,  GLenum attachment,  GLenum pname,  GLint * params);
+    GL4DAPI GLsync    GL4DAPIENTRY gl4dFenceSync(GLenum condition, GLbitfield flags);
+    GL4DAPI GLenum    GL4DAPIENTRY gl4dClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    GL4DAPI void      GL4DAPIENTRY gl4dDeleteSync(GLsync sync);
+    GL4DAPI void      GL4DAPIENTRY gl4dBufferStorage(GLenum target, GLsizeiptr size, const GLvoid * data, GLbitfield flags);
+    GL4DAPI GLvoid *  GL4DAPIENTRY gl4dMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    GL4DAPI GLboolean GL4DAPIENTRY gl4dUnmapBuffer(GLenum target);
+    GL4DAPI void      GL4DAPIENTRY gl4dGenQueries(GLsizei n, GLuint * ids);
+    GL4DAPI void      GL4DAPIENTRY gl4dDeleteQueries(GLsizei n, const GLuint * ids);
+    GL4DAPI void      GL4DAPIENTRY gl4dGetQueryObjectiv(GLuint id, GLenum pname, GLint * params);
+    GL4DAPI void      GL4DAPIENTRY gl4dGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 * params);
+    GL4DAPI void      GL4DAPIENTRY gl4dQueryCounter(GLuint id, GLenum target);
+    GL4DAPI void      GL4DAPIENTRY gl4dBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    GL4DAPI GLuint    GL4DAPIENTRY gl4dGetUniformBlockIndex(GLuint program, const GLchar * uniformBlockName);
+    GL4DAPI void      GL4DAPIENTRY gl4dUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+    GL4DAPI void      GL4DAPIENTRY gl4dGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei * length, GLenum * binaryFormat, GLvoid * binary);
+    GL4DAPI void      GL4DAPIENTRY gl4dProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid * binary, GLsizei length);
+    GL4DAPI void      GL4DAPIENTRY gl4dProgramParameteri(GLuint program, GLenum pname, GLint value);
+    GL4DAPI const GLubyte * GL4DAPIENTRY gl4dGetStringi(GLenum name, GLuint index);
+    GL4DAPI void      GL4DAPIENTRY gl4dBeginQuery(GLenum target, GLuint id);
+    GL4DAPI void      GL4DAPIENTRY gl4dEndQuery(GLenum target);
+    GL4DAPI void      GL4DAPIENTRY gl4dGetInteger64v(GLenum pname, GLint64 * data);
+    GL4DAPI void      GL4DAPIENTRY gl4dDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+    GL4DAPI void      GL4DAPIENTRY gl4dDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid * indices, GLsizei instancecount);
+    GL4DAPI void      GL4DAPIENTRY gl4dVertexAttribDivisor(GLuint index, GLuint divisor);
+    GL4DAPI void      GL4DAPIENTRY gl4dBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data);
+    GL4DAPI void      GL4DAPIENTRY gl4dCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+    GL4DAPI void      GL4DAPIENTRY gl4dMultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid * indirect, GLsizei drawcount, GLsizei stride);
+    GL4DAPI void      GL4DAPIENTRY gl4dGetQueryObjectuiv(GLuint id, GLenum pname, GLuint * params);
+    GL4DAPI void      GL4DAPIENTRY gl4dGenSamplers(GLsizei n, GLuint * samplers);
+    GL4DAPI void      GL4DAPIENTRY gl4dDeleteSamplers(GLsizei n, const GLuint * samplers);
+    GL4DAPI void      GL4DAPIENTRY gl4dBindSampler(GLuint unit, GLuint sampler);
+    GL4DAPI void      GL4DAPIENTRY gl4dSamplerParameteri(GLuint sampler, GLenum pname, GLint param);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,318 @@
+/*!\file shader_bundle.c
+ * \brief archives (éventuellement cryptées) de shaders indexées par
+ * une table de hachage.
+ *
+ * Une archive indexée (version \ref SBUNDLE_VERSION) est composée, en
+ * petit-boutiste (little endian), de :
+ * - un en-tête : la signature \ref SBUNDLE_MAGIC (8 octets), la
+ *   version, le nombre de shaders, le nombre d'alvéoles de la table de
+ *   hachage (une puissance de 2 strictement supérieure au nombre de
+ *   shaders) et la taille totale de l'archive, sur 4 octets chacun ;
+ * - la table de hachage à adressage ouvert (sondage linéaire) : pour
+ *   chaque alvéole, l'indice plus un de l'entrée correspondante, 0
+ *   pour une alvéole vide ;
+ * - les entrées : hachage FNV-1a du nom, position du nom, position du
+ *   code source et longueur du code source ;
+ * - les noms et codes sources, chacun terminé par un '\\0'.
+ *
+ * Trouver un shader coûte donc un hachage et, en moyenne, moins de deux
+ * comparaisons de noms ; le code source est utilisé sur place, sans
+ * copie. Les anciennes archives balisées (\<shader nom\>code\</shader\>)
+ * restent lisibles : elles sont indexées une fois pour toutes à
+ * l'ouverture.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ *
+*/
+
+#include "shader_bundle.h"
+#include "aes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SB_HEADER  24
+#define SB_ENTRY   16
+#define SB_OPEN    "<shader "
+#define SB_CLOSE   "</shader>"
+
+/*!\brief entrée de l'index d'une archive balisée. */
+typedef struct sbentry_t sbentry_t;
+struct sbentry_t {
+  GLuint hash;
+  const char * name, * src;
+  GLint len;
+};
+
+struct sbundle_t {
+  char * data;
+  size_t size;
+  /* index construit à l'ouverture, pour les archives balisées
+   * uniquement ; NULL pour les archives indexées */
+  sbentry_t * entries;
+  GLuint * buckets, nbuckets;
+};
+
+/*!\brief hachage FNV-1a (32 bits) du nom \a name. */
+static inline GLuint nameHash(const char * name) {
+  GLuint h = 2166136261u;
+  while(*name)
+    h = (h ^ (GLubyte)*name++) * 16777619u;
+  return h;
+}
+
+static inline GLuint rd32(const char * p) {
+  const GLubyte * u = (const GLubyte *)p;
+  return (GLuint)u[0] | ((GLuint)u[1] << 8) | ((GLuint)u[2] << 16) | ((GLuint)u[3] << 24);
+}
+
+static inline void wr32(char * p, GLuint v) {
+  GLubyte * u = (GLubyte *)p;
+  u[0] = (GLubyte)v; u[1] = (GLubyte)(v >> 8); u[2] = (GLubyte)(v >> 16); u[3] = (GLubyte)(v >> 24);
+}
+
+static GLuint pow2Above(GLuint n) {
+  GLuint nb = 1;
+  while(nb <= n)
+    nb <<= 1;
+  return nb;
+}
+
+/*!\brief indique si les \a size octets de \a data commencent par un
+ * en-tête d'archive indexée. */
+static int isIndexed(const char * data, size_t size) {
+  return size >= SB_HEADER && !strncmp(data, SBUNDLE_MAGIC, 8) && rd32(data + 8) == SBUNDLE_VERSION;
+}
+
+/*!\brief recherche \a name dans la table d'une archive indexée. */
+static const char * indexedFind(const char * data, const char * name, GLint * len) {
+  GLuint h = nameHash(name), nb = rd32(data + 16), i, k, e;
+  const char * entries = data + SB_HEADER + 4 * (size_t)nb, * ent;
+  for(i = h & (nb - 1), k = 0; k < nb && (e = rd32(data + SB_HEADER + 4 * (size_t)i)) != 0; i = (i + 1) & (nb - 1), k++) {
+    ent = entries + SB_ENTRY * (size_t)(e - 1);
+    if(rd32(ent) == h && !strcmp(data + rd32(ent + 4), name)) {
+      if(len) *len = (GLint)rd32(ent + 12);
+      return data + rd32(ent + 8);
+    }
+  }
+  return NULL;
+}
+
+/*!\brief vérifie la cohérence de l'en-tête et des entrées d'une
+ * archive indexée de \a size octets. */
+static int indexedCheck(const char * data, size_t size) {
+  GLuint n, nb, i, no, so, sl;
+  const char * ent;
+  if(size < SB_HEADER) return 0;
+  n = rd32(data + 12);
+  nb = rd32(data + 16);
+  if(rd32(data + 20) > size || nb == 0 || (nb & (nb - 1)) || nb <= n) return 0;
+  size = rd32(data + 20);
+  if(SB_HEADER + 4 * (size_t)nb + SB_ENTRY * (size_t)n > size) return 0;
+  for(i = 0; i < nb; i++)
+    if(rd32(data + SB_HEADER + 4 * (size_t)i) > n) return 0;
+  for(i = 0, ent = data + SB_HEADER + 4 * (size_t)nb; i < n; i++, ent += SB_ENTRY) {
+    no = rd32(ent + 4); so = rd32(ent + 8); sl = rd32(ent + 12);
+    if(no >= size || !memchr(data + no, 0, size - no)) return 0;
+    if(so >= size || sl >= size - so || data[so + sl]) return 0;
+  }
+  return 1;
+}
+
+/*!\brief indexe une fois pour toutes une archive balisée. Les balises
+ * fermantes et les '>' des balises ouvrantes sont remplacés par des
+ * '\\0' pour que noms et codes sources soient utilisables sur place. */
+static void indexTagged(sbundle_t * b) {
+  int n = 0, s = 16, i;
+  char * p = b->data, * name, * src, * end;
+  b->entries = malloc(s * sizeof * b->entries);
+  assert(b->entries);
+  while((p = strstr(p, SB_OPEN)) != NULL) {
+    name = p + sizeof SB_OPEN - 1;
+    if(!(src = strchr(name, '>'))) break;
+    if(!(end = strstr(++src, SB_CLOSE))) break;
+    if(n == s) {
+      b->entries = realloc(b->entries, (s *= 2) * sizeof * b->entries);
+      assert(b->entries);
+    }
+    src[-1] = '\0';
+    *end = '\0';
+    b->entries[n].hash = nameHash(name);
+    b->entries[n].name = name;
+    b->entries[n].src  = src;
+    b->entries[n].len  = (GLint)(end - src);
+    n++;
+    p = end + sizeof SB_CLOSE - 1;
+  }
+  b->nbuckets = pow2Above(2 * (GLuint)n);
+  b->buckets = calloc(b->nbuckets, sizeof * b->buckets);
+  assert(b->buckets);
+  for(i = 0; i < n; i++) {
+    GLuint j = b->entries[i].hash & (b->nbuckets - 1), e;
+    /* en cas de doublon, la première occurrence l'emporte (comme
+     * l'ancienne recherche linéaire) */
+    for(; (e = b->buckets[j]) != 0; j = (j + 1) & (b->nbuckets - 1))
+      if(b->entries[e - 1].hash == b->entries[i].hash && !strcmp(b->entries[e - 1].name, b->entries[i].name))
+        break;
+    if(!e) b->buckets[j] = i + 1;
+  }
+}
+
+/*!\brief ouvre l'archive décryptée \a decData de \a size octets.
+ *
+ * \a decData, allouée avec malloc et terminée par un '\\0' (comme le
+ * retour de \ref aes_from_tar_n), appartient ensuite à l'archive et
+ * sera libérée par \ref sbundleClose. Elle peut être au format indexé
+ * ou à l'ancien format balisé.
+ *
+ * \return l'archive ou NULL si l'en-tête d'une archive indexée est
+ * incohérent (\a decData est alors libérée).
+ */
+sbundle_t * sbundleOpen(char * decData, size_t size) {
+  sbundle_t * b;
+  if(!decData) return NULL;
+  if(isIndexed(decData, size) && !indexedCheck(decData, size)) {
+    fprintf(stderr, "%s (%d): %s: archive de shaders corrompue\n", __FILE__, __LINE__, __func__);
+    free(decData);
+    return NULL;
+  }
+  b = calloc(1, sizeof *b);
+  assert(b);
+  b->data = decData;
+  b->size = size;
+  if(!isIndexed(decData, size))
+    indexTagged(b);
+  return b;
+}
+
+/*!\brief lit, décrypte et ouvre l'archive contenue dans le fichier \a
+ * encFile. */
+sbundle_t * sbundleLoad(const char * encFile) {
+  size_t l = 0;
+  char * data = aes_from_tar_n(encFile, &l);
+  return data ? sbundleOpen(data, l) : NULL;
+}
+
+/*!\brief retourne le code source du shader \a name de l'archive \a b
+ * (terminé par un '\\0' et dont la longueur est renvoyée dans \a len si
+ * ce dernier n'est pas NULL), ou NULL s'il n'y figure pas. Le pointeur
+ * reste valide jusqu'à \ref sbundleClose. */
+const char * sbundleFind(const sbundle_t * b, const char * name, GLint * len) {
+  GLuint h, j, e;
+  if(!b->entries)
+    return indexedFind(b->data, name, len);
+  h = nameHash(name);
+  for(j = h & (b->nbuckets - 1); (e = b->buckets[j]) != 0; j = (j + 1) & (b->nbuckets - 1))
+    if(b->entries[e - 1].hash == h && !strcmp(b->entries[e - 1].name, name)) {
+      if(len) *len = b->entries[e - 1].len;
+      return b->entries[e - 1].src;
+    }
+  return NULL;
+}
+
+/*!\brief recherche le shader \a name directement dans le dat
+ * décrypté \a decData de \a size octets (terminé par un '\\0'), sans
+ * l'ouvrir : en temps constant pour une archive indexée, dont l'en-tête
+ * est alors vérifié comme par \ref sbundleOpen, par un parcours
+ * linéaire pour une archive balisée (le code source n'est alors pas
+ * terminé par un '\\0', seule \a len en donne la fin).
+ */
+const char * sbundleFindInDecData(const char * decData, size_t size, const char * name, GLint * len) {
+  char a[BUFSIZ];
+  const char * p, * end;
+  if(isIndexed(decData, size)) {
+    if(!indexedCheck(decData, size)) {
+      fprintf(stderr, "%s (%d): %s: archive de shaders corrompue\n", __FILE__, __LINE__, __func__);
+      return NULL;
+    }
+    return indexedFind(decData, name, len);
+  }
+  if(!strncmp(decData, SBUNDLE_MAGIC, 8)) { /* en-tête tronqué ou taille inconnue */
+    fprintf(stderr, "%s (%d): %s: archive indexée de taille inconnue ou tronquée, utiliser sbundleOpen\n", __FILE__, __LINE__, __func__);
+    return NULL;
+  }
+  snprintf(a, BUFSIZ, SB_OPEN "%s>", name);
+  if(!(p = strstr(decData, a)))
+    return NULL;
+  p += strlen(a);
+  if(!(end = strstr(p, SB_CLOSE)))
+    return NULL;
+  if(len) *len = (GLint)(end - p);
+  return p;
+}
+
+/*!\brief libère l'archive \a b et ses données. */
+void sbundleClose(sbundle_t * b) {
+  if(!b) return;
+  free(b->entries);
+  free(b->buckets);
+  free(b->data);
+  free(b);
+}
+
+/*!\brief écrit dans \a filename une archive indexée contenant les \a
+ * n shaders de noms \a names et de codes sources \a sources ; les noms
+ * en double sont ignorés. Si \a encrypt est non nul, l'archive est
+ * cryptée (et complétée au bloc AES) pour être lue par \ref
+ * sbundleLoad ou \ref gl4duCreateProgramFED.
+ *
+ * \return 1 en cas de succès, 0 sinon.
+ */
+int sbundleWrite(const char * filename, int n, const char ** names, const char ** sources, int encrypt) {
+  GLuint nb = pow2Above(2 * (GLuint)n), m = 0, j, e, h;
+  size_t size, pos, l, i;
+  char * data, * ent;
+  FILE * f;
+  int r;
+  size = SB_HEADER + 4 * (size_t)nb + SB_ENTRY * (size_t)n;
+  pos = size;
+  for(i = 0; i < (size_t)n; i++)
+    size += strlen(names[i]) + strlen(sources[i]) + 2;
+  data = calloc(encrypt ? (size + 15) & ~(size_t)15 : size, sizeof * data);
+  assert(data);
+  for(i = 0; i < (size_t)n; i++) {
+    h = nameHash(names[i]);
+    for(j = h & (nb - 1); (e = rd32(data + SB_HEADER + 4 * (size_t)j)) != 0; j = (j + 1) & (nb - 1)) {
+      ent = data + SB_HEADER + 4 * (size_t)nb + SB_ENTRY * (size_t)(e - 1);
+      if(rd32(ent) == h && !strcmp(data + rd32(ent + 4), names[i]))
+        break;
+    }
+    if(e) {
+      fprintf(stderr, "%s (%d): %s: shader \"%s\" en double, ignoré\n", __FILE__, __LINE__, __func__, names[i]);
+      continue;
+    }
+    wr32(data + SB_HEADER + 4 * (size_t)j, ++m);
+    ent = data + SB_HEADER + 4 * (size_t)nb + SB_ENTRY * (size_t)(m - 1);
+    wr32(ent, h);
+    wr32(ent + 4, (GLuint)pos);
+    l = strlen(names[i]) + 1;
+    memcpy(data + pos, names[i], l);
+    pos += l;
+    wr32(ent + 8, (GLuint)pos);
+    l = strlen(sources[i]);
+    wr32(ent + 12, (GLuint)l);
+    memcpy(data + pos, sources[i], l + 1);
+    pos += l + 1;
+  }
+  memcpy(data, SBUNDLE_MAGIC, 8);
+  wr32(data + 8, SBUNDLE_VERSION);
+  wr32(data + 12, m);
+  wr32(data + 16, nb);
+  wr32(data + 20, (GLuint)size);
+  if(encrypt) {
+    size = (size + 15) & ~(size_t)15;
+    vaetvient((unsigned char *)data, (int)size, 0);
+  }
+  if((f = fopen(filename, "wb")) == NULL) {
+    fprintf(stderr, "%s (%d): %s: impossible d'ouvrir le fichier %s en écriture\n",
+	    __FILE__, __LINE__, __func__, filename);
+    free(data);
+    return 0;
+  }
+  r = fwrite(data, 1, size, f) == size;
+  r = !fclose(f) && r;
+  free(data);
+  return r;
+}
@@ -0,0 +1,36 @@
+/*!\file shader_bundle.h
+ * \brief archives (éventuellement cryptées) de shaders indexées par
+ * une table de hachage.
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ *
+*/
+
+#ifndef _SHADER_BUNDLE_H
+
+#define _SHADER_BUNDLE_H
+#include "gl4dummies.h"
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/*!\brief signature (8 octets) placée en tête des archives indexées. */
+#define SBUNDLE_MAGIC   "GL4DSHB\0"
+/*!\brief version courante du format des archives indexées. */
+#define SBUNDLE_VERSION 1
+
+  typedef struct sbundle_t sbundle_t;
+
+  GL4DAPI sbundle_t *  GL4DAPIENTRY sbundleOpen(char * decData, size_t size);
+  GL4DAPI sbundle_t *  GL4DAPIENTRY sbundleLoad(const char * encFile);
+  GL4DAPI const char * GL4DAPIENTRY sbundleFind(const sbundle_t * b, const char * name, GLint * len);
+  GL4DAPI const char * GL4DAPIENTRY sbundleFindInDecData(const char * decData, size_t size, const char * name, GLint * len);
+  GL4DAPI void         GL4DAPIENTRY sbundleClose(sbundle_t * b);
+  GL4DAPI int          GL4DAPIENTRY sbundleWrite(const char * filename, int n, const char ** names, const char ** sources, int encrypt);
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -0,0 +1,214 @@
+/*!\file thread_pool.c
+ * \brief réserve de threads (SDL) et boucle parallèle à vol de
+ * tâches (work stealing).
+ *
+ * Les threads de la réserve sont créés au premier appel à \ref
+ * tpoolFor et attendent ensuite, endormis, les boucles suivantes. Pour
+ * chaque boucle, les tâches sont réparties en autant de plages
+ * contiguës que de threads (l'appelant compris) ; un thread qui a
+ * épuisé sa plage vole les tâches restantes des plages des autres.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ *
+*/
+
+#include "thread_pool.h"
+#include "gl4du.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#  define THREAD_LOCAL __declspec(thread)
+#else
+#  define THREAD_LOCAL __thread
+#endif
+
+/*!\brief plage de tâches [next, end) confiée à un thread ; next est
+ * incrémenté atomiquement aussi bien par son propriétaire que par les
+ * voleurs. Occupe une ligne de cache (64 octets) et le tableau est
+ * aligné dessus (voir init) pour éviter le faux partage. */
+typedef struct range_t range_t;
+struct range_t {
+  SDL_atomic_t next;
+  int end;
+  char pad[64 - sizeof(SDL_atomic_t) - sizeof(int)];
+};
+
+static void init(void);
+static int  workerLoop(void * arg);
+static void runTasks(GLuint thread);
+
+/*!\brief nombre de threads utilisés par une boucle, appelant compris
+ * ; 0 tant qu'il n'a pas été choisi. */
+static GLuint _nbThreads = 0;
+static SDL_Thread ** _threads = NULL;
+static range_t * _ranges = NULL;
+/*!\brief bloc alloué dont \a _ranges est la partie alignée. */
+static void * _rangesMem = NULL;
+/*!\brief _mutex protège l'état partagé avec les threads, _busy
+ * sérialise les boucles lancées depuis des threads différents. */
+static SDL_mutex * _mutex = NULL, * _busy = NULL;
+static SDL_cond * _start = NULL, * _done = NULL;
+static GLuint _generation = 0, _pending = 0, _quit = 0;
+static void (*_func)(size_t, GLuint, void *) = NULL;
+static void * _data = NULL;
+
+/*!\brief indique si le thread courant exécute une tâche de la réserve
+ * et, le cas échéant, son indice de thread. */
+static THREAD_LOCAL int _inPool = 0;
+static THREAD_LOCAL GLuint _self = 0;
+
+/*!\brief exécute en parallèle \a func(task, thread, data) pour chaque
+ * tâche de [0, \a nbTasks).
+ *
+ * Le thread appelant participe (il porte l'indice 0) et la fonction
+ * ne rend la main que lorsque toutes les tâches sont terminées. \a
+ * thread, compris entre 0 et \ref tpoolGetNbThreads - 1, permet aux
+ * tâches d'utiliser des données propres à chaque thread. Appelée
+ * depuis une tâche, la boucle imbriquée est exécutée séquentiellement
+ * par le thread courant (même indice).
+ *
+ * \param nbTasks nombre de tâches.
+ * \param func fonction exécutée pour chaque tâche.
+ * \param data donnée utilisateur passée à \a func.
+ */
+void tpoolFor(size_t nbTasks, void (*func)(size_t task, GLuint thread, void * data), void * data) {
+  GLuint i, n;
+  size_t t;
+  if(nbTasks == 0) return;
+  assert(nbTasks <= INT_MAX);
+  if(_inPool || tpoolGetNbThreads() < 2 || nbTasks < 2) {
+    for(t = 0; t < nbTasks; t++)
+      func(t, _self, data);
+    return;
+  }
+  if(!_mutex)
+    init();
+  SDL_LockMutex(_busy);
+  n = _nbThreads;
+  SDL_LockMutex(_mutex);
+  for(i = 0; i < n; i++) {
+    SDL_AtomicSet(&(_ranges[i].next), (int)((i * nbTasks) / n));
+    _ranges[i].end = (int)(((i + 1) * nbTasks) / n);
+  }
+  _func = func;
+  _data = data;
+  _pending = n - 1;
+  _generation++;
+  SDL_CondBroadcast(_start);
+  SDL_UnlockMutex(_mutex);
+  runTasks(0);
+  SDL_LockMutex(_mutex);
+  while(_pending)
+    SDL_CondWait(_done, _mutex);
+  SDL_UnlockMutex(_mutex);
+  SDL_UnlockMutex(_busy);
+}
+
+/*!\brief retourne le nombre de threads utilisés par \ref tpoolFor,
+ * appelant compris. Par défaut, le nombre de coeurs logiques. */
+GLuint tpoolGetNbThreads(void) {
+  if(_nbThreads == 0) {
+    int c = SDL_GetCPUCount();
+    _nbThreads = c > 0 ? (GLuint)c : 1;
+  }
+  return _nbThreads;
+}
+
+/*!\brief fixe le nombre de threads utilisés par \ref tpoolFor,
+ * appelant compris ; 0 pour revenir au nombre de coeurs logiques. Les
+ * threads existants sont arrêtés et seront recréés à la prochaine
+ * boucle.
+ */
+void tpoolSetNbThreads(GLuint n) {
+  tpoolClean();
+  _nbThreads = n;
+}
+
+/*!\brief arrête les threads de la réserve et libère ses ressources.
+ */
+void tpoolClean(void) {
+  GLuint i;
+  if(!_mutex) return;
+  SDL_LockMutex(_mutex);
+  _quit = 1;
+  SDL_CondBroadcast(_start);
+  SDL_UnlockMutex(_mutex);
+  for(i = 1; i < _nbThreads; i++)
+    SDL_WaitThread(_threads[i], NULL);
+  free(_threads);
+  _threads = NULL;
+  free(_rangesMem);
+  _rangesMem = NULL;
+  _ranges = NULL;
+  SDL_DestroyCond(_start);
+  SDL_DestroyCond(_done);
+  SDL_DestroyMutex(_mutex);
+  SDL_DestroyMutex(_busy);
+  _mutex = _busy = NULL;
+  _start = _done = NULL;
+  _quit = 0;
+}
+
+static void init(void) {
+  size_t i;
+  static int ft = 1;
+  _mutex = SDL_CreateMutex();
+  _busy  = SDL_CreateMutex();
+  _start = SDL_CreateCond();
+  _done  = SDL_CreateCond();
+  assert(_mutex && _busy && _start && _done);
+  /* calloc n'aligne pas sur 64 octets : on prend une ligne de plus */
+  _rangesMem = calloc(_nbThreads + 1, sizeof *_ranges);
+  assert(_rangesMem);
+  _ranges = (range_t *)(((uintptr_t)_rangesMem + sizeof *_ranges - 1) & ~(uintptr_t)(sizeof *_ranges - 1));
+  _threads = calloc(_nbThreads, sizeof *_threads);
+  assert(_threads);
+  _generation = 0;
+  for(i = 1; i < _nbThreads; i++) {
+    _threads[i] = SDL_CreateThread(workerLoop, "gl4dpool", (void *)i);
+    assert(_threads[i]);
+  }
+  if(ft) gl4duAtExit(tpoolClean);
+  ft = 0;
+}
+
+static int workerLoop(void * arg) {
+  GLuint seen = 0, id = (GLuint)(size_t)arg;
+  for(;;) {
+    SDL_LockMutex(_mutex);
+    while(_generation == seen && !_quit)
+      SDL_CondWait(_start, _mutex);
+    if(_quit) {
+      SDL_UnlockMutex(_mutex);
+      return 0;
+    }
+    seen = _generation;
+    SDL_UnlockMutex(_mutex);
+    runTasks(id);
+    SDL_LockMutex(_mutex);
+    if(--_pending == 0)
+      SDL_CondSignal(_done);
+    SDL_UnlockMutex(_mutex);
+  }
+  return 0;
+}
+
+/*!\brief épuise la plage du thread \a thread puis vole les tâches
+ * restantes des autres plages. */
+static void runTasks(GLuint thread) {
+  GLuint i, v;
+  int t;
+  _inPool = 1;
+  _self = thread;
+  for(i = 0; i < _nbThreads; i++) {
+    v = (thread + i) % _nbThreads;
+    while((t = SDL_AtomicAdd(&(_ranges[v].next), 1)) < _ranges[v].end)
+      _func((size_t)t, thread, _data);
+  }
+  _inPool = 0;
+  _self = 0;
+}
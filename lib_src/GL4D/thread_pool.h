@@ -0,0 +1,27 @@
+/*!\file thread_pool.h
+ * \brief réserve de threads (SDL) et boucle parallèle à vol de
+ * tâches (work stealing).
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ *
+*/
+
+#ifndef _THREAD_POOL_H
+
+#define _THREAD_POOL_H
+#include "gl4dummies.h"
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+  GL4DAPI void     GL4DAPIENTRY tpoolFor(size_t nbTasks, void (*func)(size_t task, GLuint thread, void * data), void * data);
+  GL4DAPI GLuint   GL4DAPIENTRY tpoolGetNbThreads(void);
+  GL4DAPI void     GL4DAPIENTRY tpoolSetNbThreads(GLuint n);
+  GL4DAPI void     GL4DAPIENTRY tpoolClean(void);
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
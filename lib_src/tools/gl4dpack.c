@@ -0,0 +1,131 @@
+/*!\file gl4dpack.c
+ *
+ * \brief construit une archive de shaders (cryptée par défaut) au
+ * format indexé, lisible par gl4duCreateProgramFED.
+ *
+ * Usage : gl4dpack [-n] archive.dat chemin [chemin ...]
+ *
+ * Chaque chemin est un fichier ou un répertoire parcouru
+ * récursivement (fichiers cachés exclus). Un shader est nommé dans
+ * l'archive par son chemin tel que donné (séparateurs '/'), ce nom est
+ * celui à utiliser ensuite : "<vs>shaders/basic.vs" pour un fichier
+ * shaders/basic.vs empaqueté avec "gl4dpack shaders.dat shaders". L'option
+ * -n produit une archive non cryptée.
+ *
+ * \author Farès BELHADJ amsi@ai.univ-paris8.fr
+ * \date October 17, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_MSC_VER)
+#  include <io.h>
+#else
+#  include <dirent.h>
+#endif
+#include <GL4D/gl4dummies.h>
+#include <GL4D/shader_bundle.h>
+
+static void addPath(const char * path);
+static void addFile(const char * path);
+
+static int _n = 0, _s = 0;
+static char ** _names = NULL, ** _sources = NULL;
+
+int main(int argc, char ** argv) {
+  int i, a = 1, encrypt = 1, r;
+  if(argc > 1 && !strcmp(argv[1], "-n")) {
+    encrypt = 0;
+    a++;
+  }
+  if(argc - a < 2) {
+    fprintf(stderr, "usage : %s [-n] archive.dat chemin [chemin ...]\n", argv[0]);
+    return 1;
+  }
+  for(i = a + 1; i < argc; i++)
+    addPath(argv[i]);
+  r = sbundleWrite(argv[a], _n, (const char **)_names, (const char **)_sources, encrypt);
+  if(r)
+    fprintf(stderr, "%s : %d shader(s) empaqueté(s)\n", argv[a], _n);
+  for(i = 0; i < _n; i++) {
+    free(_names[i]);
+    free(_sources[i]);
+  }
+  free(_names);
+  free(_sources);
+  return !r;
+}
+
+static void addPath(const char * path) {
+  struct stat buf;
+  char * sub;
+  size_t l = strlen(path);
+  if(stat(path, &buf) != 0) {
+    fprintf(stderr, "%s : introuvable\n", path);
+    return;
+  }
+  if(!(buf.st_mode & S_IFDIR)) {
+    addFile(path);
+    return;
+  }
+  while(l > 1 && (path[l - 1] == '/' || path[l - 1] == '\\'))
+    l--;
+  {
+#if defined(_MSC_VER)
+    struct _finddata_t fd;
+    intptr_t h;
+    sub = malloc(l + 3);
+    assert(sub);
+    snprintf(sub, l + 3, "%.*s/*", (int)l, path);
+    if((h = _findfirst(sub, &fd)) == -1) {
+      free(sub);
+      return;
+    }
+    free(sub);
+    do {
+      const char * name = fd.name;
+#else
+    DIR * d;
+    struct dirent * e;
+    if(!(d = opendir(path))) {
+      fprintf(stderr, "%s : impossible d'ouvrir le répertoire\n", path);
+      return;
+    }
+    while((e = readdir(d)) != NULL) {
+      const char * name = e->d_name;
+#endif
+      if(name[0] == '.') continue;
+      sub = malloc(l + strlen(name) + 2);
+      assert(sub);
+      sprintf(sub, "%.*s/%s", (int)l, path, name);
+      addPath(sub);
+      free(sub);
+#if defined(_MSC_VER)
+    } while(_findnext(h, &fd) == 0);
+    _findclose(h);
+#else
+    }
+    closedir(d);
+#endif
+  }
+}
+
+static void addFile(const char * path) {
+  char * src, * p;
+  if(!(src = gl4dReadTextFile(path)))
+    return;
+  if(_n == _s) {
+    _s = _s ? 2 * _s : 64;
+    _names = realloc(_names, _s * sizeof * _names);
+    _sources = realloc(_sources, _s * sizeof * _sources);
+    assert(_names && _sources);
+  }
+  _names[_n] = strdup(path);
+  assert(_names[_n]);
+  for(p = _names[_n]; *p; p++)
+    if(*p == '\\') *p = '/';
+  _sources[_n++] = src;
+}